@@ -21,16 +21,27 @@
  */
 
 #include <Python.h>
+#include <pythread.h>
 #include <pulse/pulseaudio.h>
 #include <pulse/glib-mainloop.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #define PACKAGE "Deepin PulseAudio Python Binding"
 
 #define INT(v) PyInt_FromLong(v)
-#define STRING(v) PyString_FromString(v)
 #define ERROR(v) PyErr_SetString(PyExc_TypeError, v)
 #define RETURN_TRUE Py_INCREF(Py_True); return Py_True
 #define RETURN_FALSE Py_INCREF(Py_False); return Py_False
+/* Result of a blocking call: True when done, None on timeout, else False */
+#define RETURN_SYNC(v) do {\
+    int r = (v); \
+    if (r > 0) { RETURN_TRUE; } \
+    if (r < 0) { Py_INCREF(Py_None); return Py_None; } \
+    RETURN_FALSE; \
+} while (0)
 
 /* Safe XDECREF for object states that handles nested deallocations */
 #define ZAP(v) do {\
@@ -39,53 +50,297 @@
     Py_XDECREF(tmp); \
 } while (0)
 
+/* None for names the server left unset, such as a missing default sink */
+static PyObject *STRING(const char *v)
+{
+    if (!v) {
+        Py_RETURN_NONE;
+    }
+    return PyString_FromString(v);
+}
+
+#define M_TOMBSTONE_MAX 256
+#define M_SNAPSHOT_MAGIC 0x53415044 /* "DPAS" */
+#define M_SNAPSHOT_VERSION 1
+
+/* Object kinds mirrored by the state store */
+typedef enum {
+    M_SINK,
+    M_SOURCE,
+    M_SINK_INPUT,
+    M_SOURCE_OUTPUT,
+    M_CARD,
+    M_KIND_COUNT
+} m_kind;
+
+/* connect() callbacks by subscription facility and event type, see
+ * m_signals */
+#define M_FACILITY_COUNT (PA_SUBSCRIPTION_EVENT_CARD + 1)
+#define M_EVENT_COUNT 3
+#define M_EVENT_SLOT(type) (((type) & PA_SUBSCRIPTION_EVENT_TYPE_MASK) >> 4)
+#define M_SIGNAL_CB(self, facility, type) \
+    ((self)->signal_cb[PA_SUBSCRIPTION_EVENT_##facility] \
+                      [M_EVENT_SLOT(PA_SUBSCRIPTION_EVENT_##type)])
+
+/* Python objects an entry is materialized into on demand */
+typedef enum {
+    M_OBJECT_INFO,          /* device, stream or card dict */
+    M_OBJECT_CHANNELS,
+    M_OBJECT_ACTIVE_PORT,
+    M_OBJECT_VOLUME,
+    M_OBJECT_PROPLIST,
+    M_OBJECT_PORTS,
+    M_OBJECT_MUTE,
+    M_OBJECT_COUNT
+} m_object;
+
+typedef struct {
+    char *name;
+    char *description;
+    int available;
+    int direction;          /* card ports only */
+    uint32_t n_profiles;    /* card ports only */
+} m_port;
+
+typedef struct {
+    char *name;
+    char *description;
+    uint32_t n_sinks;
+    uint32_t n_sources;
+} m_profile;
+
+/* Fields an update is compared on, see m_entry_diff() */
+typedef enum {
+    M_FIELD_NAME,
+    M_FIELD_DESCRIPTION,
+    M_FIELD_VOLUME,
+    M_FIELD_MUTE,
+    M_FIELD_CHANNELS,
+    M_FIELD_ACTIVE_PORT,
+    M_FIELD_PORTS,
+    M_FIELD_CORKED,
+    M_FIELD_DEVICE,         /* sink or source a stream plays on */
+    M_FIELD_PROFILES,
+    M_FIELD_ACTIVE_PROFILE,
+    M_FIELD_PROPLIST,
+    M_FIELD_OTHER,          /* anything else, reported as the whole info */
+    M_FIELD_FALLBACK_SINK,  /* server only */
+    M_FIELD_FALLBACK_SOURCE,
+    M_FIELD_COUNT
+} m_field;
+
+#define M_FIELD_BIT(f) (1 << (f))
+#define M_FIELD_ALL (M_FIELD_BIT(M_FIELD_COUNT) - 1)
+
+/* C copy of the pa_*_info of one sink, source, stream or card */
+typedef struct {
+    m_kind kind;
+    uint32_t index;
+    guint64 generation;     /* of the last change */
+    guint64 created;        /* generation the object first appeared in */
+    char *name;
+    char *description;
+    char *driver;
+    char *resample_method;
+    uint32_t owner_module;
+    uint32_t client;
+    uint32_t parent;        /* card of a device, sink or source of a stream */
+    pa_volume_t base_volume;
+    int mute;
+    int corked;
+    int has_volume;
+    int volume_writable;
+    pa_channel_map channel_map;
+    pa_cvolume volume;
+    uint32_t n_ports;
+    m_port *ports;
+    int active_port;        /* into ports, -1 for none */
+    uint32_t n_profiles;
+    m_profile *profiles;
+    int active_profile;     /* into profiles, -1 for none */
+    pa_proplist *proplist;
+    int changed;            /* M_FIELD_BIT()s moved by the last update */
+    int added;              /* the last update created it */
+    int stale;              /* loaded from a snapshot, not confirmed since */
+    int written;            /* M_FIELD_BIT()s set ahead of the server */
+    guint64 objects_generation;
+    PyObject *objects[M_OBJECT_COUNT]; /* built from this generation */
+} m_entry;
+
+typedef struct {
+    int valid;
+    guint64 generation;
+    char *user_name;
+    char *host_name;
+    char *server_version;
+    char *server_name;
+    char *default_sink_name;
+    char *default_source_name;
+    uint32_t cookie;
+    int changed;            /* M_FIELD_BIT()s moved by the last update */
+    int stale;              /* loaded from a snapshot, not confirmed since */
+    int written;            /* M_FIELD_BIT()s set ahead of the server */
+} m_server;
+
+/* Remembers a removed entry for get_changes_since() */
+typedef struct {
+    gint64 key;             /* kind << 32 | index */
+    guint64 created;
+    guint64 removed;
+} m_tombstone;
+
 typedef struct {
     PyObject_HEAD
     PyObject *dict; /* Python attributes dictionary */
     pa_glib_mainloop *pa_ml;
+    GMainContext *main_ctx; /* pa_ml runs on it, see new() */
+    GMainLoop *main_loop; /* runs main_ctx on main_thread */
+    GThread *main_thread;
     pa_context *pa_ctx;
     pa_mainloop_api *pa_mlapi;
     pa_stream *stream_conn_record;
-    PyObject *sink_new_cb; /* callback */                                       
-    PyObject *sink_changed_cb;                                                  
-    PyObject *sink_removed_cb;                                                  
-    PyObject *source_new_cb;                                                    
-    PyObject *source_changed_cb;                                                
-    PyObject *source_removed_cb;                                                
-    PyObject *card_new_cb;                                                      
-    PyObject *card_changed_cb;                                                  
-    PyObject *card_removed_cb;                                                  
-    PyObject *server_new_cb;                                                    
-    PyObject *server_changed_cb;                                                
-    PyObject *server_removed_cb;                                                
-    PyObject *sink_input_new_cb;                                                
-    PyObject *sink_input_changed_cb;                                            
-    PyObject *sink_input_removed_cb;                                            
-    PyObject *source_output_new_cb;                                             
-    PyObject *source_output_changed_cb;                                         
-    PyObject *source_output_removed_cb;
+    pa_mainloop *sync_ml; /* private loop for the blocking calls */
+    pa_context *sync_ctx;
+    int sync_ready;
+    PyThread_type_lock sync_lock; /* serialises threads on sync_ml */
+    pa_time_event *sync_timer;
+    int sync_expired;
+    int sync_timeout; /* deadline of a blocking call in ms, 0 waits forever */
+    pa_operation **sync_batch; /* set while apply_batch issues operations */
+    long sync_batch_thread; /* the thread running apply_batch */
+    int sync_batch_len;
+    int sync_batch_size;
+    struct m_write *writes; /* setters applied ahead of the server, newest first */
+    PyObject *signal_cb[M_FACILITY_COUNT][M_EVENT_COUNT]; /* see M_SIGNAL_CB */
     PyObject *stream_conn_record_read_cb;
     PyObject *stream_conn_record_suspended_cb;
-    PyObject *server_info;  /* data */
-    PyObject *card_devices;
-    PyObject *input_devices;
-    PyObject *output_devices;
-    PyObject *input_ports;
-    PyObject *output_ports;
-    PyObject *input_channels;
-    PyObject *output_channels;
-    PyObject *input_active_ports;
-    PyObject *output_active_ports;
-    PyObject *input_mute;
-    PyObject *output_mute;
-    PyObject *input_volume;
-    PyObject *output_volume;
-    PyObject *playback_streams;
-    PyObject *record_stream;
+    int subscribe_mask; /* explicit subscription mask, -1 derives it */
+    int event_window; /* subscription event coalescing window in ms */
+    guint event_timer;
+    GHashTable *event_pending; /* facility << 32 | index -> m_pending_event */
+    struct m_pending_event *event_head; /* in arrival order */
+    struct m_pending_event *event_tail;
+    GHashTable *entries[M_KIND_COUNT]; /* state store, index -> m_entry */
+    GHashTable *names[M_KIND_COUNT]; /* name -> m_entry, devices and cards */
+    m_server server;
+    guint64 generation; /* bumped on every store change */
+    guint64 kind_generation[M_KIND_COUNT];
+    GHashTable *tombstones; /* kind << 32 | index -> m_tombstone */
+    guint64 changes_floor; /* changes before this were not recorded */
+    char *snapshot_path; /* warm start file, see set_snapshot() */
+    int snapshot_pending; /* the store holds entries not confirmed yet */
+    int reconcile_pending; /* m_snapshot_reconcile() waits for sync_lock */
+    guint64 saved_generation; /* of the store last written to snapshot_path */
+    int cache_valid; /* get_devices() filled the store, keep it current */
+    int field_diffs; /* *_changed callbacks get a dict of moved fields */
 } DeepinPulseAudioObject;
 
+/* A subscription event waiting for the end of the coalescing window */
+typedef struct m_pending_event {
+    gint64 key; /* facility << 32 | index */
+    pa_subscription_event_type_t type;
+    int cancelled; /* NEW and REMOVE met inside the window */
+    struct m_pending_event *next;
+} m_pending_event;
+
+/* One field a setter writes, of an entry or of the server */
+typedef struct {
+    int mute;
+    pa_cvolume volume;
+    char *name;             /* active port or fallback device */
+} m_value;
+
+/* A setter applied to the store before the server answered it, see
+ * m_store_write() */
+typedef struct m_write {
+    m_kind kind;            /* M_KIND_COUNT for the server */
+    uint32_t index;
+    m_field field;
+    m_value value;          /* what the setter asked for */
+    m_value old;            /* what it replaced, put back on failure */
+    int applied;            /* the store held the field */
+    int slot;               /* of its operation in apply_batch, -1 outside */
+    int acked;              /* 1 success, -1 refused, 0 no answer */
+    struct m_write *next;
+} m_write;
+
+/* Read-only mapping over a copy of a pa_proplist. Values only become
+ * Python strings when asked for. */
+typedef struct {
+    PyObject_HEAD
+    pa_proplist *proplist;
+} DeepinPulseAudioProplist;
+
+/* Fixed layout info records, see m_record_layouts */
+typedef enum {
+    M_RECORD_SINK,
+    M_RECORD_SOURCE,
+    M_RECORD_SINK_INPUT,
+    M_RECORD_SOURCE_OUTPUT,
+    M_RECORD_CARD,
+    M_RECORD_SERVER,
+    M_RECORD_COUNT
+} m_record;
+
+/* Values by position instead of a dict per object. Fields read as
+ * attributes or, like the dicts records replace, as record["name"]. */
+typedef struct {
+    PyObject_VAR_HEAD
+    PyObject *values[1];
+} DeepinPulseAudioRecord;
+
 static PyObject *m_deepin_pulseaudio_object_constants = NULL;
 static PyTypeObject *m_DeepinPulseAudio_Type = NULL;
+static PyTypeObject *m_DeepinPulseAudioProplist_Type = NULL;
+
+static const char *m_device_fields[] = 
+{
+    "name", "description", "base_volume", "n_ports", "mute", "ports", 
+    "proplist", NULL
+};
+
+static const char *m_sink_input_fields[] = 
+{
+    "name", "owner_module", "client", "sink", "channel", "resample_method", 
+    "driver", "proplist", "corked", "volume", "mute", "has_volume", 
+    "volume_writable", NULL
+};
+
+static const char *m_source_output_fields[] = 
+{
+    "name", "owner_module", "client", "source", "channel", "resample_method", 
+    "driver", "proplist", "corked", "volume", "mute", "has_volume", 
+    "volume_writable", NULL
+};
+
+static const char *m_card_fields[] = 
+{
+    "name", "n_profiles", "profiles", "active_profile", "proplist", "n_ports", 
+    "ports", NULL
+};
+
+static const char *m_server_fields[] = 
+{
+    "user_name", "host_name", "server_version", "server_name", 
+    "fallback_sink", "fallback_source", "cookie", NULL
+};
+
+/* Type name and field names of every m_record */
+static const struct {
+    const char *type_name;
+    const char **fields;
+} m_record_layouts[M_RECORD_COUNT] = 
+{
+    {"deepin_pulseaudio.SinkInfo", m_device_fields}, 
+    {"deepin_pulseaudio.SourceInfo", m_device_fields}, 
+    {"deepin_pulseaudio.SinkInputInfo", m_sink_input_fields}, 
+    {"deepin_pulseaudio.SourceOutputInfo", m_source_output_fields}, 
+    {"deepin_pulseaudio.CardInfo", m_card_fields}, 
+    {"deepin_pulseaudio.ServerInfo", m_server_fields}
+};
+
+/* Filled from DeepinPulseAudioRecord_Type at module init */
+static PyTypeObject m_record_types[M_RECORD_COUNT];
 
 static DeepinPulseAudioObject *m_init_deepin_pulseaudio_object();
 static void m_pa_context_subscribe_cb(pa_context *c,                            
@@ -93,17 +348,28 @@ static void m_pa_context_subscribe_cb(pa_context *c,
                                       uint32_t idx,                             
                                       void *userdata);                          
 static void m_context_state_cb(pa_context *c, void *userdata);
+static void m_event_clear(DeepinPulseAudioObject *self);
+static gboolean m_event_flush(gpointer userdata);
+static void m_update_subscription(DeepinPulseAudioObject *self);
 static DeepinPulseAudioObject *m_new(PyObject *self, PyObject *args);
 static PyObject *m_pa_volume_get_balance(PyObject *self, PyObject *args);
 
 static PyMethodDef deepin_pulseaudio_methods[] = 
 {
-    {"new", m_new, METH_NOARGS, "Deepin PulseAudio Construction"}, 
+    {"new", (PyCFunction)m_new, METH_VARARGS, "Deepin PulseAudio Construction, optionally on a GMainContext or a thread of its own"}, 
     {"volume_get_balance", m_pa_volume_get_balance, METH_VARARGS, "Get volume balance"},
     {NULL, NULL, 0, NULL}
 };
 
 static PyObject *m_delete(DeepinPulseAudioObject *self);
+static void m_store_init(DeepinPulseAudioObject *self);
+static void m_store_destroy(DeepinPulseAudioObject *self);
+static void m_snapshot_sweep(DeepinPulseAudioObject *self);
+static void m_snapshot_drop(DeepinPulseAudioObject *self, m_kind kind, uint32_t index);
+static void m_snapshot_reconcile(DeepinPulseAudioObject *self);
+static int m_snapshot_save(DeepinPulseAudioObject *self, const char *path);
+static PyObject *m_entry_object(m_entry *e, m_object which);
+static int m_store_settle(DeepinPulseAudioObject *self);
 static void m_pa_server_info_cb(pa_context *c,
                                 const pa_server_info *i,
                                 void *userdate);
@@ -158,6 +424,13 @@ static PyObject *m_get_input_mute_by_index(DeepinPulseAudioObject *self, PyObjec
 
 static PyObject *m_get_fallback_sink(DeepinPulseAudioObject *self);
 static PyObject *m_get_fallback_source(DeepinPulseAudioObject *self);
+static PyObject *m_get_sink_by_name(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_get_source_by_name(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_get_card_by_name(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_fallback_sink_index(DeepinPulseAudioObject *self);
+static PyObject *m_fallback_source_index(DeepinPulseAudioObject *self);
+static PyObject *m_get_generation(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_get_changes_since(DeepinPulseAudioObject *self, PyObject *args);
 
 static PyObject *m_get_output_volume(DeepinPulseAudioObject *self);
 static PyObject *m_get_output_volume_by_index(DeepinPulseAudioObject *self, PyObject *args);
@@ -181,8 +454,20 @@ static PyObject *m_set_sink_input_volume(DeepinPulseAudioObject *self, PyObject
 static PyObject *m_set_fallback_sink(DeepinPulseAudioObject *self, PyObject *args);
 static PyObject *m_set_fallback_source(DeepinPulseAudioObject *self, PyObject *args);
 
+static PyObject *m_apply_batch(DeepinPulseAudioObject *self, PyObject *args);
+
+static PyObject *m_set_timeout(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_set_event_window(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_set_field_diffs(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_set_snapshot(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_save_snapshot(DeepinPulseAudioObject *self);
+static PyObject *m_get_timeout(DeepinPulseAudioObject *self);
+
 static PyObject *m_connect_to_pulse(DeepinPulseAudioObject *self);        
 static PyObject *m_connect(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_disconnect(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_set_subscription_mask(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_get_subscription_mask(DeepinPulseAudioObject *self);
 static PyObject *m_connect_record(DeepinPulseAudioObject *self, PyObject *args);
 
 static PyMethodDef deepin_pulseaudio_object_methods[] = 
@@ -190,6 +475,9 @@ static PyMethodDef deepin_pulseaudio_object_methods[] =
     {"delete", (PyCFunction)m_delete, METH_NOARGS, "Deepin PulseAudio destruction"}, 
     {"connect_to_pulse", (PyCFunction)m_connect_to_pulse, METH_NOARGS, "Connect to PulseAudio"},
     {"connect", (PyCFunction)m_connect, METH_VARARGS, "Connect signal callback"},
+    {"disconnect", (PyCFunction)m_disconnect, METH_VARARGS, "Disconnect signal callback"},
+    {"set_subscription_mask", (PyCFunction)m_set_subscription_mask, METH_VARARGS, "Override subscription mask, -1 derives it from the callbacks"},
+    {"get_subscription_mask", (PyCFunction)m_get_subscription_mask, METH_NOARGS, "Get subscription mask"},
     {"connect_record", (PyCFunction)m_connect_record, METH_VARARGS, "Connect stream to a source"},
     {"get_server_info", (PyCFunction)m_get_server_info, METH_NOARGS, "Get server info"},
     {"get_cards", (PyCFunction)m_get_cards, METH_NOARGS, "Get card list"}, 
@@ -227,6 +515,13 @@ static PyMethodDef deepin_pulseaudio_object_methods[] =
     
     {"get_fallback_sink", (PyCFunction)m_get_fallback_sink, METH_NOARGS, "Get fallback sink"},
     {"get_fallback_source", (PyCFunction)m_get_fallback_source, METH_NOARGS, "Get fallback source"},
+    {"get_sink_by_name", (PyCFunction)m_get_sink_by_name, METH_VARARGS, "Get sink index by name"},
+    {"get_source_by_name", (PyCFunction)m_get_source_by_name, METH_VARARGS, "Get source index by name"},
+    {"get_card_by_name", (PyCFunction)m_get_card_by_name, METH_VARARGS, "Get card index by name"},
+    {"fallback_sink_index", (PyCFunction)m_fallback_sink_index, METH_NOARGS, "Get fallback sink index"},
+    {"fallback_source_index", (PyCFunction)m_fallback_source_index, METH_NOARGS, "Get fallback source index"},
+    {"get_generation", (PyCFunction)m_get_generation, METH_VARARGS, "Get store generation, or of one entry given kind and index"},
+    {"get_changes_since", (PyCFunction)m_get_changes_since, METH_VARARGS, "Get indices added, changed or removed after a generation"},
 
     {"set_output_active_port", (PyCFunction)m_set_output_active_port, METH_VARARGS, "Set output active port"}, 
     {"set_input_active_port", (PyCFunction)m_set_input_active_port, METH_VARARGS, "Set input active port"}, 
@@ -244,6 +539,14 @@ static PyMethodDef deepin_pulseaudio_object_methods[] =
     
     {"set_fallback_sink", (PyCFunction)m_set_fallback_sink, METH_VARARGS, "Set fallback sink"},
     {"set_fallback_source", (PyCFunction)m_set_fallback_source, METH_VARARGS, "Set fallback source"},
+    {"apply_batch", (PyCFunction)m_apply_batch, METH_VARARGS, "Apply a list of set operations in one round trip"},
+
+    {"set_timeout", (PyCFunction)m_set_timeout, METH_VARARGS, "Set blocking call timeout in ms, 0 waits forever"},
+    {"get_timeout", (PyCFunction)m_get_timeout, METH_NOARGS, "Get blocking call timeout in ms"},
+    {"set_event_window", (PyCFunction)m_set_event_window, METH_VARARGS, "Coalesce subscription events over a window in ms, 0 disables"},
+    {"set_field_diffs", (PyCFunction)m_set_field_diffs, METH_VARARGS, "Pass changed callbacks a dict of the fields that moved"},
+    {"set_snapshot", (PyCFunction)m_set_snapshot, METH_VARARGS, "Keep the state in a file across runs, fill an empty store from it"},
+    {"save_snapshot", (PyCFunction)m_save_snapshot, METH_NOARGS, "Write the state to the snapshot file now"},
     {NULL, NULL, 0, NULL}
 };
 
@@ -362,307 +665,1078 @@ static PyTypeObject DeepinPulseAudio_Type = {
     (inquiry)m_deepin_pulseaudio_clear
 };
 
-PyMODINIT_FUNC initdeepin_pulseaudio() 
+static PyObject *m_proplist_value(const pa_proplist *p, const char *key)
 {
-    PyObject *m = NULL;
-             
-    m_DeepinPulseAudio_Type = &DeepinPulseAudio_Type;
-    DeepinPulseAudio_Type.ob_type = &PyType_Type;
+    const char *value = pa_proplist_gets(p, key);
 
-    m = Py_InitModule("deepin_pulseaudio", deepin_pulseaudio_methods);
-    if (!m)
-        return;
-    // pulseaudio module constants
-    if (PyModule_AddObject(m, "CVOLUME_SNPRINT_MAX",
-                           PyLong_FromLong(PA_CVOLUME_SNPRINT_MAX)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "DECIBEL_MININFTY",
-                           PyFloat_FromDouble(PA_DECIBEL_MININFTY)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "SW_CVOLUME_SNPRINT_DB_MAX",
-                           PyLong_FromLong(PA_SW_CVOLUME_SNPRINT_DB_MAX)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "SW_VOLUME_SNPRINT_DB_MAX",
-                           PyLong_FromLong(PA_SW_VOLUME_SNPRINT_DB_MAX)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "VOLUME_INVALID",
-                           PyLong_FromUnsignedLong(PA_VOLUME_INVALID)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "VOLUME_MAX",
-                           PyLong_FromUnsignedLong(PA_VOLUME_MAX)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "VOLUME_MUTED",
-                           PyLong_FromUnsignedLong(PA_VOLUME_MUTED)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "VOLUME_NORM",
-                           PyLong_FromUnsignedLong(PA_VOLUME_NORM)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "VOLUME_SNPRINT_MAX",
-                           PyLong_FromLong(PA_VOLUME_SNPRINT_MAX)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "VOLUME_UI_MAX",
-                           PyLong_FromLong(PA_VOLUME_UI_MAX)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "API_VERSION",
-                           PyLong_FromLong(PA_API_VERSION)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "MAJOR",
-                           PyLong_FromLong(PA_MAJOR)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "MICRO",
-                           PyLong_FromLong(PA_MICRO)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "MINOR",
-                           PyLong_FromLong(PA_MINOR)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "PROTOCOL_VERSION",
-                           PyLong_FromLong(PA_PROTOCOL_VERSION)) < 0) {
-        return;
+    // binary properties have no string form
+    if (!value) {
+        Py_INCREF(Py_None);
+        return Py_None;
     }
-    m_deepin_pulseaudio_object_constants = PyDict_New();
+    return PyString_FromString(value);
 }
 
-static DeepinPulseAudioObject *m_init_deepin_pulseaudio_object() 
+static void m_proplist_dealloc(DeepinPulseAudioProplist *self)
 {
-    DeepinPulseAudioObject *self = NULL;
-
-    self = (DeepinPulseAudioObject *) PyObject_GC_New(DeepinPulseAudioObject, 
-                                                      m_DeepinPulseAudio_Type);
-    if (!self)
-        return NULL;
-    
-    PyObject_GC_Track(self);
-
-    self->dict = NULL;
-    
-    self->server_info = NULL;
-    self->card_devices = NULL;
-    self->input_devices = NULL;
-    self->output_devices = NULL;
-    self->input_ports = NULL;
-    self->output_ports = NULL;
-    self->input_channels = NULL;
-    self->output_channels = NULL;
-    self->input_active_ports = NULL;
-    self->output_active_ports = NULL;
-    self->input_mute = NULL;
-    self->output_mute = NULL;
-    self->input_volume = NULL;
-    self->output_volume = NULL;
-    self->playback_streams = NULL;
-    self->record_stream = NULL;
+    if (self->proplist)
+        pa_proplist_free(self->proplist);
+    PyObject_Del(self);
+}
 
-    self->pa_ml = NULL;                                                         
-    self->pa_ctx = NULL;                                                        
-    self->pa_mlapi = NULL;                                                      
-    self->stream_conn_record = NULL;
-                                                                                
-    self->sink_new_cb = NULL;                                                   
-    self->sink_changed_cb = NULL;                                               
-    self->sink_removed_cb = NULL;                                               
-    self->source_new_cb = NULL;                                                 
-    self->source_changed_cb = NULL;                                             
-    self->source_removed_cb = NULL;                                             
-    self->card_new_cb = NULL;                                                   
-    self->card_changed_cb = NULL;                                               
-    self->card_removed_cb = NULL;                                               
-    self->server_new_cb = NULL;                                                 
-    self->server_changed_cb = NULL;                                             
-    self->server_removed_cb = NULL;                                             
-    self->sink_input_new_cb = NULL;                                             
-    self->sink_input_changed_cb = NULL;                                         
-    self->sink_input_removed_cb = NULL;                                         
-    self->source_output_new_cb = NULL;                                          
-    self->source_output_changed_cb = NULL;                                      
-    self->source_output_removed_cb = NULL;
-    self->stream_conn_record_read_cb = NULL;
-    self->stream_conn_record_suspended_cb = NULL;
+static Py_ssize_t m_proplist_length(DeepinPulseAudioProplist *self)
+{
+    return pa_proplist_size(self->proplist);
+}
 
-    return self;
+static int m_proplist_contains(DeepinPulseAudioProplist *self, PyObject *key)
+{
+    if (!PyString_Check(key))
+        return 0;
+    return pa_proplist_contains(self->proplist, PyString_AS_STRING(key)) == 1;
 }
 
-static void m_pa_state_cb(pa_context *c, void *userdata) {                               
-    pa_context_state_t state;                                               
-    int *pa_ready = userdata;                                               
-                                                                                
-    state = pa_context_get_state(c);                                        
-    switch (state) {                                                       
-        // There are just here for reference                            
-        case PA_CONTEXT_UNCONNECTED:                                    
-        case PA_CONTEXT_CONNECTING:                                     
-        case PA_CONTEXT_AUTHORIZING:                                    
-        case PA_CONTEXT_SETTING_NAME:                                   
-        default:                                                        
-            break;                                                  
-        case PA_CONTEXT_FAILED:                                         
-        case PA_CONTEXT_TERMINATED:                                     
-            *pa_ready = 2;                                          
-            break;                                                  
-        case PA_CONTEXT_READY:                                          
-            *pa_ready = 1;                                          
-            break;                                                  
+static PyObject *m_proplist_subscript(DeepinPulseAudioProplist *self, PyObject *key)
+{
+    if (!m_proplist_contains(self, key)) {
+        PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
     }
+    return m_proplist_value(self->proplist, PyString_AS_STRING(key));
 }
 
-static DeepinPulseAudioObject *m_new(PyObject *dummy, PyObject *args) 
+static PyObject *m_proplist_get(DeepinPulseAudioProplist *self, PyObject *args)
 {
-    DeepinPulseAudioObject *self = NULL;
+    PyObject *key = NULL;
+    PyObject *default_value = Py_None;
 
-    self = m_init_deepin_pulseaudio_object();
-    if (!self)
+    if (!PyArg_ParseTuple(args, "O|O:get", &key, &default_value))
         return NULL;
 
-    self->server_info = PyDict_New();
-    if (!self->server_info) {
-        ERROR("PyDict_New error");
-        m_delete(self);
-        return NULL;
+    if (!m_proplist_contains(self, key)) {
+        Py_INCREF(default_value);
+        return default_value;
     }
+    return m_proplist_value(self->proplist, PyString_AS_STRING(key));
+}
 
-    self->card_devices = PyDict_New();
-    if (!self->card_devices) {
-        ERROR("PyDict_New error");
-        m_delete(self);
-        return NULL;
-    }
+static PyObject *m_proplist_has_key(DeepinPulseAudioProplist *self, PyObject *key)
+{
+    return PyBool_FromLong(m_proplist_contains(self, key));
+}
 
-    self->input_devices = PyDict_New();
-    if (!self->input_devices) {
-        ERROR("PyDict_New error");
-        m_delete(self);
-        return NULL;
-    }
+/* keys(), values() or items() */
+static PyObject *m_proplist_list(DeepinPulseAudioProplist *self, char what)
+{
+    PyObject *list = NULL;
+    PyObject *tmp_obj = NULL;
+    const char *key;
+    void *state = NULL;
 
-    self->output_devices = PyDict_New();
-    if (!self->output_devices) {
-        ERROR("PyDict_New error");
-        m_delete(self);
+    list = PyList_New(0);
+    if (!list)
         return NULL;
-    }
 
-    self->input_ports = PyDict_New();
-    if (!self->input_ports) {
-        ERROR("PyDict_New error");
-        return NULL;
+    while ((key = pa_proplist_iterate(self->proplist, &state))) {
+        if (what == 'k')
+            tmp_obj = PyString_FromString(key);
+        else if (what == 'v')
+            tmp_obj = m_proplist_value(self->proplist, key);
+        else
+            tmp_obj = Py_BuildValue("(sN)", key, m_proplist_value(self->proplist, key));
+        if (!tmp_obj) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_Append(list, tmp_obj);
+        Py_DECREF(tmp_obj);
     }
+    return list;
+}
 
-    self->output_ports = PyDict_New();
-    if (!self->output_ports) {
-        ERROR("PyDict_New error");
-        return NULL;
-    }
+static PyObject *m_proplist_keys(DeepinPulseAudioProplist *self)
+{
+    return m_proplist_list(self, 'k');
+}
 
-    self->input_channels = PyDict_New();
-    if (!self->input_channels) {
-        ERROR("PyDict_New error");
-        m_delete(self);
-        return NULL;
-    }
+static PyObject *m_proplist_values(DeepinPulseAudioProplist *self)
+{
+    return m_proplist_list(self, 'v');
+}
 
-    self->output_channels = PyDict_New();
-    if (!self->output_channels) {
-        ERROR("PyDict_New error");
-        m_delete(self);
-        return NULL;
-    }
+static PyObject *m_proplist_items(DeepinPulseAudioProplist *self)
+{
+    return m_proplist_list(self, 'i');
+}
 
-    self->input_active_ports = PyDict_New();
-    if (!self->input_active_ports) {
-        ERROR("PyDict_New error");
-        m_delete(self);
-        return NULL;
-    }
+/* A plain dict of every property, what info dicts used to carry */
+static PyObject *m_proplist_copy(DeepinPulseAudioProplist *self)
+{
+    PyObject *prop_dict = NULL;
+    PyObject *tmp_obj = NULL;
+    const char *prop_key;
+    void *prop_state = NULL;
 
-    self->output_active_ports = PyDict_New();
-    if (!self->output_active_ports) {
-        ERROR("PyDict_New error");
-        m_delete(self);
+    prop_dict = PyDict_New();
+    if (!prop_dict)
         return NULL;
-    }
 
-    self->input_mute = PyDict_New();
-    if (!self->input_mute) {
-        ERROR("PyDict_New error");
-        m_delete(self);
-        return NULL;
+    while ((prop_key = pa_proplist_iterate(self->proplist, &prop_state))) {
+        tmp_obj = m_proplist_value(self->proplist, prop_key);
+        PyDict_SetItemString(prop_dict, prop_key, tmp_obj);
+        Py_XDECREF(tmp_obj);
     }
+    return prop_dict;
+}
 
-    self->output_mute = PyDict_New();                                            
-    if (!self->output_mute) {                                                    
-        ERROR("PyDict_New error");                                              
-        m_delete(self);                                                         
-        return NULL;                                                            
-    } 
-
-    self->input_volume = PyDict_New();                                         
-    if (!self->input_volume) {                                                 
-        ERROR("PyDict_New error");                                              
-        m_delete(self);                                                         
-        return NULL;                                                            
-    }
+static PyObject *m_proplist_iter(DeepinPulseAudioProplist *self)
+{
+    PyObject *keys = NULL;
+    PyObject *iter = NULL;
 
-    self->output_volume = PyDict_New();
-    if (!self->output_volume) {
-        ERROR("PyDict_New error");
-        m_delete(self);
+    keys = m_proplist_keys(self);
+    if (!keys)
         return NULL;
-    }
+    iter = PyObject_GetIter(keys);
+    Py_DECREF(keys);
+    return iter;
+}
 
-    self->playback_streams = PyDict_New();
-    if (!self->playback_streams) {
-        ERROR("PyDict_New error");
-        m_delete(self);
-        return NULL;
-    }
+static PyObject *m_proplist_repr(DeepinPulseAudioProplist *self)
+{
+    PyObject *prop_dict = NULL;
+    PyObject *repr = NULL;
 
-    self->record_stream = PyDict_New();
-    if (!self->record_stream) {
-        ERROR("PyDict_New error");
-        m_delete(self);
+    prop_dict = m_proplist_copy(self);
+    if (!prop_dict)
         return NULL;
-    }
-
-    self->pa_ml = pa_glib_mainloop_new(g_main_context_default());               
-    if (!self->pa_ml) {                                                         
-        ERROR("pa_glib_mainloop_new() failed");                                 
-        m_delete(self);                                                         
-        return NULL;                                                            
-    }                                                                           
-                                                                                
-    self->pa_mlapi = pa_glib_mainloop_get_api(self->pa_ml);                     
-    if (!self->pa_mlapi) {                                                      
-        ERROR("pa_glib_mainloop_get_api() failed");                             
-        m_delete(self);                                                         
-        return NULL;                                                            
-    }
-
-    return self;
+    repr = PyObject_Repr(prop_dict);
+    Py_DECREF(prop_dict);
+    return repr;
 }
 
-static PyObject *m_pa_volume_get_balance(PyObject *self, PyObject *args)
+static PyMethodDef deepin_pulseaudio_proplist_methods[] = 
 {
-    pa_cvolume cvolume;
-    pa_channel_map channel_map;
-    PyObject *volume = NULL;
-    PyObject *channel = NULL;
-    PyObject *balance = NULL;
-    int channel_num = 0;
-    int i;
-    Py_ssize_t size_volume, size_channel;
+    {"get", (PyCFunction)m_proplist_get, METH_VARARGS, "Get a property, or default"},
+    {"has_key", (PyCFunction)m_proplist_has_key, METH_O, "Whether a property is set"},
+    {"keys", (PyCFunction)m_proplist_keys, METH_NOARGS, "Get property names"},
+    {"values", (PyCFunction)m_proplist_values, METH_NOARGS, "Get property values"},
+    {"items", (PyCFunction)m_proplist_items, METH_NOARGS, "Get (name, value) pairs"},
+    {"copy", (PyCFunction)m_proplist_copy, METH_NOARGS, "Get the properties as a dict"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyObject *m_proplist_getattr(DeepinPulseAudioProplist *self, 
+                                    char *name) 
+{
+    return Py_FindMethod(deepin_pulseaudio_proplist_methods, (PyObject *)self, name);
+}
+
+static PySequenceMethods deepin_pulseaudio_proplist_as_sequence = {
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    (objobjproc)m_proplist_contains, 
+};
+
+static PyMappingMethods deepin_pulseaudio_proplist_as_mapping = {
+    (lenfunc)m_proplist_length, 
+    (binaryfunc)m_proplist_subscript, 
+    0, 
+};
+
+static PyTypeObject DeepinPulseAudioProplist_Type = {
+    PyObject_HEAD_INIT(NULL)
+    0, 
+    "deepin_pulseaudio.Proplist", 
+    sizeof(DeepinPulseAudioProplist), 
+    0, 
+    (destructor)m_proplist_dealloc,
+    0, 
+    (getattrfunc)m_proplist_getattr, 
+    0, 
+    0, 
+    (reprfunc)m_proplist_repr, 
+    0, 
+    &deepin_pulseaudio_proplist_as_sequence, 
+    &deepin_pulseaudio_proplist_as_mapping, 
+    PyObject_HashNotImplemented, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    Py_TPFLAGS_DEFAULT, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    (getiterfunc)m_proplist_iter, 
+};
+
+static const char **m_record_fields(DeepinPulseAudioRecord *self)
+{
+    return m_record_layouts[Py_TYPE(self) - m_record_types].fields;
+}
+
+/* Position of the field called name, -1 if there is none */
+static int m_record_find(DeepinPulseAudioRecord *self, const char *name)
+{
+    const char **fields = m_record_fields(self);
+    int i;
+
+    for (i = 0; i < Py_SIZE(self); i++) {
+        if (strcmp(fields[i], name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void m_record_dealloc(DeepinPulseAudioRecord *self)
+{
+    Py_ssize_t i;
+
+    for (i = 0; i < Py_SIZE(self); i++)
+        Py_XDECREF(self->values[i]);
+    PyObject_Del(self);
+}
+
+static Py_ssize_t m_record_length(DeepinPulseAudioRecord *self)
+{
+    return Py_SIZE(self);
+}
+
+static int m_record_contains(DeepinPulseAudioRecord *self, PyObject *key)
+{
+    if (!PyString_Check(key))
+        return 0;
+    return m_record_find(self, PyString_AS_STRING(key)) >= 0;
+}
+
+static PyObject *m_record_subscript(DeepinPulseAudioRecord *self, PyObject *key)
+{
+    int i = -1;
+
+    if (PyString_Check(key))
+        i = m_record_find(self, PyString_AS_STRING(key));
+    if (i < 0) {
+        PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
+    }
+    Py_INCREF(self->values[i]);
+    return self->values[i];
+}
+
+static PyObject *m_record_get(DeepinPulseAudioRecord *self, PyObject *args)
+{
+    PyObject *key = NULL;
+    PyObject *default_value = Py_None;
+
+    if (!PyArg_ParseTuple(args, "O|O:get", &key, &default_value))
+        return NULL;
+
+    if (!m_record_contains(self, key)) {
+        Py_INCREF(default_value);
+        return default_value;
+    }
+    return m_record_subscript(self, key);
+}
+
+static PyObject *m_record_has_key(DeepinPulseAudioRecord *self, PyObject *key)
+{
+    return PyBool_FromLong(m_record_contains(self, key));
+}
+
+/* keys(), values() or items() */
+static PyObject *m_record_list(DeepinPulseAudioRecord *self, char what)
+{
+    const char **fields = m_record_fields(self);
+    PyObject *list = NULL;
+    PyObject *tmp_obj = NULL;
+    Py_ssize_t i;
+
+    list = PyList_New(Py_SIZE(self));
+    if (!list)
+        return NULL;
+
+    for (i = 0; i < Py_SIZE(self); i++) {
+        if (what == 'k') {
+            tmp_obj = PyString_FromString(fields[i]);
+        } else if (what == 'v') {
+            tmp_obj = self->values[i];
+            Py_INCREF(tmp_obj);
+        } else {
+            tmp_obj = Py_BuildValue("(sO)", fields[i], self->values[i]);
+        }
+        if (!tmp_obj) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, tmp_obj);
+    }
+    return list;
+}
+
+static PyObject *m_record_keys(DeepinPulseAudioRecord *self)
+{
+    return m_record_list(self, 'k');
+}
+
+static PyObject *m_record_values(DeepinPulseAudioRecord *self)
+{
+    return m_record_list(self, 'v');
+}
+
+static PyObject *m_record_items(DeepinPulseAudioRecord *self)
+{
+    return m_record_list(self, 'i');
+}
+
+/* A plain dict, what the callbacks used to get */
+static PyObject *m_record_copy(DeepinPulseAudioRecord *self)
+{
+    const char **fields = m_record_fields(self);
+    PyObject *dict = NULL;
+    Py_ssize_t i;
+
+    dict = PyDict_New();
+    if (!dict)
+        return NULL;
+
+    for (i = 0; i < Py_SIZE(self); i++)
+        PyDict_SetItemString(dict, fields[i], self->values[i]);
+    return dict;
+}
+
+static PyObject *m_record_iter(DeepinPulseAudioRecord *self)
+{
+    PyObject *keys = NULL;
+    PyObject *iter = NULL;
+
+    keys = m_record_keys(self);
+    if (!keys)
+        return NULL;
+    iter = PyObject_GetIter(keys);
+    Py_DECREF(keys);
+    return iter;
+}
+
+static PyObject *m_record_repr(DeepinPulseAudioRecord *self)
+{
+    const char **fields = m_record_fields(self);
+    const char *type_name = strrchr(Py_TYPE(self)->tp_name, '.') + 1;
+    PyObject *repr = NULL;
+    Py_ssize_t i;
+
+    repr = PyString_FromFormat("%s(", type_name);
+    for (i = 0; repr && i < Py_SIZE(self); i++) {
+        PyString_ConcatAndDel(&repr, PyString_FromFormat(i ? ", %s=" : "%s=", fields[i]));
+        if (repr)
+            PyString_ConcatAndDel(&repr, PyObject_Repr(self->values[i]));
+    }
+    if (repr)
+        PyString_ConcatAndDel(&repr, PyString_FromString(")"));
+    return repr;
+}
+
+static PyMethodDef deepin_pulseaudio_record_methods[] = 
+{
+    {"get", (PyCFunction)m_record_get, METH_VARARGS, "Get a field, or default"},
+    {"has_key", (PyCFunction)m_record_has_key, METH_O, "Whether there is such a field"},
+    {"keys", (PyCFunction)m_record_keys, METH_NOARGS, "Get field names"},
+    {"values", (PyCFunction)m_record_values, METH_NOARGS, "Get field values"},
+    {"items", (PyCFunction)m_record_items, METH_NOARGS, "Get (name, value) pairs"},
+    {"copy", (PyCFunction)m_record_copy, METH_NOARGS, "Get the fields as a dict"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyObject *m_record_getattr(DeepinPulseAudioRecord *self, 
+                                  char *name) 
+{
+    int i = m_record_find(self, name);
+
+    if (i >= 0) {
+        Py_INCREF(self->values[i]);
+        return self->values[i];
+    }
+    return Py_FindMethod(deepin_pulseaudio_record_methods, (PyObject *)self, name);
+}
+
+static PySequenceMethods deepin_pulseaudio_record_as_sequence = {
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    (objobjproc)m_record_contains, 
+};
+
+static PyMappingMethods deepin_pulseaudio_record_as_mapping = {
+    (lenfunc)m_record_length, 
+    (binaryfunc)m_record_subscript, 
+    0, 
+};
+
+/* Template for m_record_types, tp_name comes from m_record_layouts */
+static PyTypeObject DeepinPulseAudioRecord_Type = {
+    PyObject_HEAD_INIT(NULL)
+    0, 
+    NULL, 
+    offsetof(DeepinPulseAudioRecord, values), 
+    sizeof(PyObject *), 
+    (destructor)m_record_dealloc,
+    0, 
+    (getattrfunc)m_record_getattr, 
+    0, 
+    0, 
+    (reprfunc)m_record_repr, 
+    0, 
+    &deepin_pulseaudio_record_as_sequence, 
+    &deepin_pulseaudio_record_as_mapping, 
+    PyObject_HashNotImplemented, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    Py_TPFLAGS_DEFAULT, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    (getiterfunc)m_record_iter, 
+};
+
+PyMODINIT_FUNC initdeepin_pulseaudio() 
+{
+    PyObject *m = NULL;
+    int i;
+             
+    m_DeepinPulseAudio_Type = &DeepinPulseAudio_Type;
+    DeepinPulseAudio_Type.ob_type = &PyType_Type;
+    m_DeepinPulseAudioProplist_Type = &DeepinPulseAudioProplist_Type;
+    DeepinPulseAudioProplist_Type.ob_type = &PyType_Type;
+    for (i = 0; i < M_RECORD_COUNT; i++) {
+        m_record_types[i] = DeepinPulseAudioRecord_Type;
+        m_record_types[i].ob_type = &PyType_Type;
+        m_record_types[i].tp_name = m_record_layouts[i].type_name;
+    }
+
+    m = Py_InitModule("deepin_pulseaudio", deepin_pulseaudio_methods);
+    if (!m)
+        return;
+    // pulseaudio module constants
+    if (PyModule_AddObject(m, "CVOLUME_SNPRINT_MAX",
+                           PyLong_FromLong(PA_CVOLUME_SNPRINT_MAX)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "DECIBEL_MININFTY",
+                           PyFloat_FromDouble(PA_DECIBEL_MININFTY)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SW_CVOLUME_SNPRINT_DB_MAX",
+                           PyLong_FromLong(PA_SW_CVOLUME_SNPRINT_DB_MAX)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SW_VOLUME_SNPRINT_DB_MAX",
+                           PyLong_FromLong(PA_SW_VOLUME_SNPRINT_DB_MAX)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "VOLUME_INVALID",
+                           PyLong_FromUnsignedLong(PA_VOLUME_INVALID)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "VOLUME_MAX",
+                           PyLong_FromUnsignedLong(PA_VOLUME_MAX)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "VOLUME_MUTED",
+                           PyLong_FromUnsignedLong(PA_VOLUME_MUTED)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "VOLUME_NORM",
+                           PyLong_FromUnsignedLong(PA_VOLUME_NORM)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "VOLUME_SNPRINT_MAX",
+                           PyLong_FromLong(PA_VOLUME_SNPRINT_MAX)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "VOLUME_UI_MAX",
+                           PyLong_FromLong(PA_VOLUME_UI_MAX)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "API_VERSION",
+                           PyLong_FromLong(PA_API_VERSION)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "MAJOR",
+                           PyLong_FromLong(PA_MAJOR)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "MICRO",
+                           PyLong_FromLong(PA_MICRO)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "MINOR",
+                           PyLong_FromLong(PA_MINOR)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "PROTOCOL_VERSION",
+                           PyLong_FromLong(PA_PROTOCOL_VERSION)) < 0) {
+        return;
+    }
+    // subscription masks for set_subscription_mask()
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_SINK",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_SINK)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_SOURCE",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_SOURCE)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_SINK_INPUT",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_SINK_INPUT)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_SOURCE_OUTPUT",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_SOURCE_OUTPUT)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_CLIENT",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_CLIENT)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_SERVER",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_SERVER)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_CARD",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_CARD)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_ALL",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_ALL)) < 0) {
+        return;
+    }
+    m_deepin_pulseaudio_object_constants = PyDict_New();
+}
+
+static DeepinPulseAudioObject *m_init_deepin_pulseaudio_object() 
+{
+    DeepinPulseAudioObject *self = NULL;
+
+    self = (DeepinPulseAudioObject *) PyObject_GC_New(DeepinPulseAudioObject, 
+                                                      m_DeepinPulseAudio_Type);
+    if (!self)
+        return NULL;
+    
+    PyObject_GC_Track(self);
+
+    self->dict = NULL;
+    
+    self->pa_ml = NULL;                                                         
+    self->main_ctx = NULL;
+    self->main_loop = NULL;
+    self->main_thread = NULL;
+    self->pa_ctx = NULL;                                                        
+    self->pa_mlapi = NULL;                                                      
+    self->stream_conn_record = NULL;
+    self->sync_ml = NULL;
+    self->sync_ctx = NULL;
+    self->sync_ready = 0;
+    self->sync_lock = NULL;
+    self->sync_timer = NULL;
+    self->sync_expired = 0;
+    self->sync_timeout = 5000;
+    self->sync_batch = NULL;
+    self->sync_batch_thread = 0;
+    self->sync_batch_len = 0;
+    self->sync_batch_size = 0;
+    self->writes = NULL;
+                                                                                
+    memset(self->signal_cb, 0, sizeof(self->signal_cb));
+    self->stream_conn_record_read_cb = NULL;
+    self->stream_conn_record_suspended_cb = NULL;
+    self->subscribe_mask = -1;
+    self->event_window = 0;
+    self->event_timer = 0;
+    self->event_pending = NULL;
+    self->event_head = NULL;
+    self->event_tail = NULL;
+    memset(self->entries, 0, sizeof(self->entries));
+    memset(self->names, 0, sizeof(self->names));
+    memset(&self->server, 0, sizeof(self->server));
+    self->generation = 0;
+    memset(self->kind_generation, 0, sizeof(self->kind_generation));
+    self->tombstones = NULL;
+    self->changes_floor = 0;
+    self->snapshot_path = NULL;
+    self->snapshot_pending = 0;
+    self->reconcile_pending = 0;
+    self->saved_generation = 0;
+    self->cache_valid = 0;
+    self->field_diffs = 0;
+
+    return self;
+}
+
+static void m_pa_state_cb(pa_context *c, void *userdata) {                               
+    pa_context_state_t state;                                               
+    int *pa_ready = userdata;                                               
+                                                                                
+    state = pa_context_get_state(c);                                        
+    switch (state) {                                                       
+        // There are just here for reference                            
+        case PA_CONTEXT_UNCONNECTED:                                    
+        case PA_CONTEXT_CONNECTING:                                     
+        case PA_CONTEXT_AUTHORIZING:                                    
+        case PA_CONTEXT_SETTING_NAME:                                   
+        default:                                                        
+            break;                                                  
+        case PA_CONTEXT_FAILED:                                         
+        case PA_CONTEXT_TERMINATED:                                     
+            *pa_ready = 2;                                          
+            break;                                                  
+        case PA_CONTEXT_READY:                                          
+            *pa_ready = 1;                                          
+            break;                                                  
+    }
+}
+
+static void m_sync_disconnect(DeepinPulseAudioObject *self)
+{
+    if (self->sync_ctx) {
+        pa_context_set_state_callback(self->sync_ctx, NULL, NULL);
+        pa_context_disconnect(self->sync_ctx);
+        pa_context_unref(self->sync_ctx);
+        self->sync_ctx = NULL;
+    }
+    self->sync_ready = 0;
+}
+
+/* Run one iteration of the private loop. Only the poll, which is where we
+ * block on the server, runs without the GIL; the callbacks are dispatched
+ * with the GIL held since they fill the Python caches. */
+static int m_sync_iterate(DeepinPulseAudioObject *self)
+{
+    int ret;
+
+    if (pa_mainloop_prepare(self->sync_ml, -1) < 0)
+        return -1;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = pa_mainloop_poll(self->sync_ml);
+    Py_END_ALLOW_THREADS
+
+    if (ret < 0)
+        return -1;
+    return pa_mainloop_dispatch(self->sync_ml);
+}
+
+/* Other Python threads may call in while we wait without the GIL, so the
+ * private loop is only ever driven by the thread holding sync_lock. */
+static void m_sync_lock(DeepinPulseAudioObject *self)
+{
+    if (!PyThread_acquire_lock(self->sync_lock, 0)) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(self->sync_lock, 1);
+        Py_END_ALLOW_THREADS
+    }
+}
+
+static void m_sync_timeout_cb(pa_mainloop_api *api,
+                              pa_time_event *e,
+                              const struct timeval *tv,
+                              void *userdata)
+{
+    DeepinPulseAudioObject *self = userdata;
+
+    self->sync_expired = 1;
+}
+
+/* Arm the deadline of the current call on the private loop */
+static void m_sync_arm(DeepinPulseAudioObject *self)
+{
+    pa_mainloop_api *api = pa_mainloop_get_api(self->sync_ml);
+    struct timeval tv;
+
+    self->sync_expired = 0;
+    if (self->sync_timeout <= 0)
+        return;
+
+    pa_gettimeofday(&tv);
+    pa_timeval_add(&tv, (pa_usec_t) self->sync_timeout * PA_USEC_PER_MSEC);
+    self->sync_timer = api->time_new(api, &tv, m_sync_timeout_cb, self);
+}
+
+/* Drop the deadline and release sync_lock; returns -1 when it expired */
+static int m_sync_finish(DeepinPulseAudioObject *self, int ret)
+{
+    pa_mainloop_api *api = NULL;
+
+    if (self->sync_timer) {
+        api = pa_mainloop_get_api(self->sync_ml);
+        api->time_free(self->sync_timer);
+        self->sync_timer = NULL;
+    }
+    if (self->sync_expired)
+        ret = -1;
+    self->sync_expired = 0;
+
+    PyThread_release_lock(self->sync_lock);
+    if (self->reconcile_pending)
+        m_snapshot_reconcile(self);
+    return ret;
+}
+
+/* Whether this thread is inside apply_batch. Other threads wait for
+ * sync_lock, which the batch holds until its end. */
+static int m_sync_batching(DeepinPulseAudioObject *self)
+{
+    return self->sync_batch &&
+           self->sync_batch_thread == PyThread_get_thread_ident();
+}
+
+/* The blocking getters and setters share one long-lived context driven by
+ * a private pa_mainloop, so a call costs a protocol round trip instead of a
+ * full connection setup. The context is (re)connected lazily when it is
+ * missing or the server went away. On success sync_lock is held and the
+ * call deadline is armed until the matching m_sync_wait_all(); on failure
+ * *ret is 0, or -1 when the deadline expired while connecting. */
+static pa_context *m_sync_context(DeepinPulseAudioObject *self, int *ret)
+{
+    // apply_batch already holds the lock and a ready context
+    if (m_sync_batching(self))
+        return self->sync_ctx;
+
+    m_sync_lock(self);
+
+    if (!self->sync_ml) {
+        self->sync_ml = pa_mainloop_new();
+        if (!self->sync_ml) {
+            *ret = m_sync_finish(self, 0);
+            return NULL;
+        }
+    }
+
+    m_sync_arm(self);
+
+    if (self->sync_ctx && self->sync_ready == 1)
+        return self->sync_ctx;
+
+    m_sync_disconnect(self);
+
+    self->sync_ctx = pa_context_new(pa_mainloop_get_api(self->sync_ml), PACKAGE);
+    if (!self->sync_ctx)
+        goto fail;
+
+    pa_context_set_state_callback(self->sync_ctx, m_pa_state_cb, &self->sync_ready);
+    if (pa_context_connect(self->sync_ctx, NULL, 0, NULL) < 0)
+        goto fail;
+
+    while (self->sync_ready == 0 && !self->sync_expired) {
+        if (m_sync_iterate(self) < 0)
+            break;
+    }
+
+    if (self->sync_ready != 1)
+        goto fail;
+    return self->sync_ctx;
+
+fail:
+    m_sync_disconnect(self);
+    *ret = m_sync_finish(self, 0);
+    return NULL;
+}
+
+/* Drive the private loop until none of pa_ops is running any more.
+ * Operations still running when the deadline expires are cancelled. */
+static void m_sync_drive(DeepinPulseAudioObject *self,
+                         pa_operation **pa_ops,
+                         int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        if (!pa_ops[i])
+            continue;
+        while (pa_operation_get_state(pa_ops[i]) == PA_OPERATION_RUNNING) {
+            if (self->sync_ready != 1 || self->sync_expired ||
+                m_sync_iterate(self) < 0) {
+                pa_operation_cancel(pa_ops[i]);
+                break;
+            }
+        }
+    }
+}
+
+/* Wait for every operation in pa_ops on the shared context, drop them and
+ * release sync_lock. All of them are already in flight, so the wait costs
+ * one round trip no matter how many there are. Returns 1 when every
+ * operation completed, -1 on timeout, 0 when one of them could not be sent,
+ * was refused by the server or was cancelled otherwise. While apply_batch
+ * is issuing, the operations are queued on the batch instead and 1 is
+ * returned. */
+static int m_sync_wait_all(DeepinPulseAudioObject *self,
+                           pa_operation **pa_ops,
+                           int n)
+{
+    int done = 1;
+    int i;
+
+    if (m_sync_batching(self)) {
+        for (i = 0; i < n; i++) {
+            if (self->sync_batch_len < self->sync_batch_size) {
+                self->sync_batch[self->sync_batch_len++] = pa_ops[i];
+            } else if (pa_ops[i]) {
+                pa_operation_cancel(pa_ops[i]);
+                pa_operation_unref(pa_ops[i]);
+                done = 0;
+            }
+        }
+        return done;
+    }
+
+    m_sync_drive(self, pa_ops, n);
+
+    for (i = 0; i < n; i++) {
+        if (!pa_ops[i]) {
+            done = 0;
+            continue;
+        }
+        if (pa_operation_get_state(pa_ops[i]) != PA_OPERATION_DONE)
+            done = 0;
+        pa_operation_unref(pa_ops[i]);
+    }
+    if (!m_store_settle(self))
+        done = 0;
+
+    return m_sync_finish(self, done);
+}
+
+static int m_sync_wait(DeepinPulseAudioObject *self, pa_operation *pa_op)
+{
+    return m_sync_wait_all(self, &pa_op, 1);
+}
+
+/* Sources go to the context pa_ml runs on, which need not be the default one */
+static guint m_source_attach(DeepinPulseAudioObject *self, 
+                             GSource *source, 
+                             GSourceFunc func)
+{
+    guint id;
+
+    g_source_set_callback(source, func, self, NULL);
+    id = g_source_attach(source, self->main_ctx);
+    g_source_unref(source);
+    return id;
+}
+
+static void m_source_remove(DeepinPulseAudioObject *self, guint id)
+{
+    GSource *source = g_main_context_find_source_by_id(self->main_ctx, id);
+
+    if (source)
+        g_source_destroy(source);
+}
+
+/* The private thread may sit in poll while a method queued requests */
+static void m_main_wakeup(DeepinPulseAudioObject *self)
+{
+    if (self->main_thread)
+        g_main_context_wakeup(self->main_ctx);
+}
+
+/* The private thread only drops the GIL while it polls, see m_main_thread() */
+static gint m_main_poll(GPollFD *fds, guint nfds, gint timeout)
+{
+    gint ret;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = g_poll(fds, nfds, timeout);
+    Py_END_ALLOW_THREADS
+    return ret;
+}
+
+/* Runs the private context until m_main_stop(). Like any Python thread it
+ * holds the GIL while it dispatches, so it never runs alongside a method
+ * touching the context or the store. The loop is our own reference, as
+ * delete() from one of the callbacks leaves the thread to end by itself. */
+static gpointer m_main_thread(gpointer userdata)
+{
+    GMainLoop *loop = userdata;
+    GMainContext *ctx = g_main_loop_get_context(loop);
+    PyGILState_STATE gstate;
+
+    gstate = PyGILState_Ensure();
+    g_main_context_push_thread_default(ctx);
+    g_main_loop_run(loop);
+    g_main_context_pop_thread_default(ctx);
+    g_main_loop_unref(loop);
+    PyGILState_Release(gstate);
+    return NULL;
+}
+
+static void m_main_start(DeepinPulseAudioObject *self)
+{
+    PyEval_InitThreads();
+    g_main_context_set_poll_func(self->main_ctx, m_main_poll);
+    self->main_loop = g_main_loop_new(self->main_ctx, FALSE);
+    self->main_thread = g_thread_new("deepin-pulseaudio", m_main_thread, 
+                                     g_main_loop_ref(self->main_loop));
+}
+
+static gboolean m_main_quit(gpointer userdata)
+{
+    g_main_loop_quit(userdata);
+    return FALSE;
+}
+
+/* Quit the private thread and wait for it. The quit is queued on the
+ * context so that it is not lost on a thread that did not get to run the
+ * loop yet. */
+static void m_main_stop(DeepinPulseAudioObject *self)
+{
+    GSource *source = NULL;
+
+    if (!self->main_thread)
+        return;
+
+    if (g_thread_self() == self->main_thread) {
+        g_main_loop_quit(self->main_loop);
+        g_thread_unref(self->main_thread);
+    } else {
+        source = g_idle_source_new();
+        g_source_set_callback(source, m_main_quit, self->main_loop, NULL);
+        g_source_attach(source, self->main_ctx);
+        g_source_unref(source);
+        Py_BEGIN_ALLOW_THREADS
+        g_thread_join(self->main_thread);
+        Py_END_ALLOW_THREADS
+    }
+    self->main_thread = NULL;
+}
+
+/* PyGObject keeps the GMainContext right after the object head, both in
+ * gi's GLib.MainContext (a PyGBoxed) and in the static bindings'
+ * glib.MainContext. Mirrored here instead of building against pygobject.h. */
+typedef struct {
+    PyObject_HEAD
+    gpointer pointer;
+} m_pygobject_wrapper;
+
+/* The GMainContext wrapped by context, or NULL with TypeError set when it
+ * is no MainContext of a PyGObject module the application has loaded */
+static GMainContext *m_main_context_from(PyObject *context)
+{
+    static const char *modules[] = {"gi.repository.GLib", "glib"};
+    PyObject *module = NULL;
+    PyObject *type = NULL;
+    GMainContext *ctx = NULL;
+    int i;
+
+    for (i = 0; i < 2 && !ctx; i++) {
+        // only look at modules already there, importing gi into a pygtk
+        // application would break it
+        module = PyDict_GetItemString(PyImport_GetModuleDict(), modules[i]);
+        if (!module || !(type = PyObject_GetAttrString(module, "MainContext"))) {
+            PyErr_Clear();
+            continue;
+        }
+        if (PyType_Check(type) && PyObject_IsInstance(context, type) > 0)
+            ctx = ((m_pygobject_wrapper *) context)->pointer;
+        Py_DECREF(type);
+    }
+    if (!ctx)
+        ERROR("context is not a GLib.MainContext");
+    return ctx;
+}
+
+/* new(context=None, thread=False) attaches to context, a GLib.MainContext,
+ * instead of the default one. With thread a private context
+ * is created and run on a thread of our own, so the server traffic and
+ * the callbacks keep going however busy the application's main loop is. */
+static DeepinPulseAudioObject *m_new(PyObject *dummy, PyObject *args) 
+{
+    DeepinPulseAudioObject *self = NULL;
+    PyObject *context = Py_None;
+    PyObject *thread = Py_False;
+    GMainContext *ctx = NULL;
+    int private_thread = 0;
+
+    if (!PyArg_ParseTuple(args, "|OO", &context, &thread)) {
+        ERROR("invalid arguments to new");
+        return NULL;
+    }
+
+    private_thread = PyObject_IsTrue(thread) > 0;
+    if (context != Py_None) {
+        if (private_thread) {
+            ERROR("new takes a context or a thread, not both");
+            return NULL;
+        }
+        if (!(ctx = m_main_context_from(context)))
+            return NULL;
+    }
+
+    self = m_init_deepin_pulseaudio_object();
+    if (!self)
+        return NULL;
+
+    self->sync_lock = PyThread_allocate_lock();
+    if (!self->sync_lock) {
+        ERROR("PyThread_allocate_lock error");
+        m_delete(self);
+        return NULL;
+    }
+
+    m_store_init(self);
+
+    if (private_thread)
+        self->main_ctx = g_main_context_new();
+    else
+        self->main_ctx = g_main_context_ref(ctx ? ctx : g_main_context_default());
+
+    self->pa_ml = pa_glib_mainloop_new(self->main_ctx);
+    if (!self->pa_ml) {                                                         
+        ERROR("pa_glib_mainloop_new() failed");                                 
+        m_delete(self);                                                         
+        return NULL;                                                            
+    }                                                                           
+                                                                                
+    self->pa_mlapi = pa_glib_mainloop_get_api(self->pa_ml);                     
+    if (!self->pa_mlapi) {                                                      
+        ERROR("pa_glib_mainloop_get_api() failed");                             
+        m_delete(self);                                                         
+        return NULL;                                                            
+    }
+
+    self->event_pending = g_hash_table_new(g_int64_hash, g_int64_equal);
+
+    if (private_thread)
+        m_main_start(self);
+    return self;
+}
+
+static PyObject *m_pa_volume_get_balance(PyObject *self, PyObject *args)
+{
+    pa_cvolume cvolume;
+    pa_channel_map channel_map;
+    PyObject *volume = NULL;
+    PyObject *channel = NULL;
+    PyObject *balance = NULL;
+    int channel_num = 0;
+    int i;
+    Py_ssize_t size_volume, size_channel;
 
     if (!PyArg_ParseTuple(args, "iOO", &channel_num, &volume, &channel)) {
         ERROR("invalid arguments to connect");                                  
@@ -675,368 +1749,1667 @@ static PyObject *m_pa_volume_get_balance(PyObject *self, PyObject *args)
         Py_RETURN_NONE;
     }
 
-    if (PyList_Check(channel)) {
-        channel = PyList_AsTuple(channel);
-    }
-    if (!PyTuple_Check(channel)) {
-        Py_RETURN_NONE;
-    }
+    if (PyList_Check(channel)) {
+        channel = PyList_AsTuple(channel);
+    }
+    if (!PyTuple_Check(channel)) {
+        Py_RETURN_NONE;
+    }
+
+    memset(&cvolume, 0, sizeof(pa_cvolume));
+    memset(&channel_map, 0, sizeof(pa_channel_map));
+    channel_map.channels = channel_num;
+    cvolume.channels = channel_num;
+
+    size_volume = PyTuple_Size(volume);
+    size_channel = PyTuple_Size(channel);
+    if (channel_num < size_volume) {
+        channel_num = size_volume;
+    }
+    if (channel_num < size_channel) {
+        channel_num = size_channel;
+    }
+    for (i = 0; i < channel_num; i++) {
+        cvolume.values[i] = PyInt_AsUnsignedLongMask(PyTuple_GetItem(volume, i));
+        channel_map.map[i] = PyInt_AsUnsignedLongMask(PyTuple_GetItem(channel, i));
+    }
+    balance = PyFloat_FromDouble(pa_cvolume_get_balance(&cvolume, &channel_map));
+    Py_INCREF(balance);
+    return balance;
+}
+
+/* FIXME: fuzzy ... more object wait for destruction */
+static PyObject *m_delete(DeepinPulseAudioObject *self) 
+{
+    int f;
+    int t;
+
+    m_main_stop(self);
+
+    // The store as the session ends is what the next one starts from
+    if (self->snapshot_path) {
+        if (self->generation != self->saved_generation)
+            m_snapshot_save(self, self->snapshot_path);
+        g_free(self->snapshot_path);
+        self->snapshot_path = NULL;
+    }
+
+    m_store_destroy(self);
+
+    for (f = 0; f < M_FACILITY_COUNT; f++) {
+        for (t = 0; t < M_EVENT_COUNT; t++)
+            ZAP(self->signal_cb[f][t]);
+    }
+
+    if (self->stream_conn_record) {
+        pa_stream_disconnect(self->stream_conn_record);
+        pa_stream_unref(self->stream_conn_record);
+        self->stream_conn_record = NULL;
+    }
+
+    if (self->pa_ctx) {                                                         
+        pa_context_disconnect(self->pa_ctx);                                    
+        pa_context_unref(self->pa_ctx);                                         
+        self->pa_ctx = NULL;                                                    
+    }                                                                           
+                                                                                
+    if (self->pa_ml) {                                                          
+        pa_glib_mainloop_free(self->pa_ml);                                     
+        self->pa_ml = NULL;                                                     
+    }
+
+    if (self->event_pending) {
+        m_event_clear(self);
+        g_hash_table_destroy(self->event_pending);
+        self->event_pending = NULL;
+    }
+
+    if (self->main_loop) {
+        g_main_loop_unref(self->main_loop);
+        self->main_loop = NULL;
+    }
+
+    if (self->main_ctx) {
+        g_main_context_unref(self->main_ctx);
+        self->main_ctx = NULL;
+    }
+
+    // Another thread may be polling sync_ml without the GIL, wait for its
+    // call to finish before the loop goes away
+    if (self->sync_lock)
+        m_sync_lock(self);
+    m_sync_disconnect(self);
+    if (self->sync_ml) {
+        pa_mainloop_free(self->sync_ml);
+        self->sync_ml = NULL;
+    }
+    if (self->sync_lock) {
+        PyThread_release_lock(self->sync_lock);
+        PyThread_free_lock(self->sync_lock);
+        self->sync_lock = NULL;
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+//****************************************
+// state store: pa_*_info copied into C, Python objects built on demand
+static const char *m_kind_names[M_KIND_COUNT] = {
+    "sink", 
+    "source", 
+    "sinkinput", 
+    "sourceoutput", 
+    "card"
+};
+
+static int m_kind_from_name(const char *name)
+{
+    int kind;
+
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (strcmp(name, m_kind_names[kind]) == 0)
+            return kind;
+    }
+    return -1;
+}
+
+static void m_entry_drop_objects(m_entry *e)
+{
+    int i;
+
+    for (i = 0; i < M_OBJECT_COUNT; i++)
+        ZAP(e->objects[i]);
+    e->objects_generation = e->generation;
+}
+
+static void m_entry_free(gpointer data)
+{
+    m_entry *e = data;
+    uint32_t i;
+
+    m_entry_drop_objects(e);
+    for (i = 0; i < e->n_ports; i++) {
+        g_free(e->ports[i].name);
+        g_free(e->ports[i].description);
+    }
+    g_free(e->ports);
+    for (i = 0; i < e->n_profiles; i++) {
+        g_free(e->profiles[i].name);
+        g_free(e->profiles[i].description);
+    }
+    g_free(e->profiles);
+    g_free(e->name);
+    g_free(e->description);
+    g_free(e->driver);
+    g_free(e->resample_method);
+    if (e->proplist)
+        pa_proplist_free(e->proplist);
+    g_free(e);
+}
+
+static m_entry *m_entry_new(m_kind kind,
+                            uint32_t index,
+                            const char *name,
+                            const char *driver,
+                            const pa_proplist *proplist)
+{
+    m_entry *e = g_new0(m_entry, 1);
+
+    e->kind = kind;
+    e->index = index;
+    e->name = g_strdup(name);
+    e->driver = g_strdup(driver);
+    e->proplist = proplist ? pa_proplist_copy(proplist) : NULL;
+    e->active_port = -1;
+    e->active_profile = -1;
+    return e;
+}
+
+static void m_store_init(DeepinPulseAudioObject *self)
+{
+    int kind;
+
+    for (kind = 0; kind < M_KIND_COUNT; kind++)
+        self->entries[kind] = g_hash_table_new_full(g_direct_hash,
+                                                    g_direct_equal,
+                                                    NULL,
+                                                    m_entry_free);
+    self->tombstones = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                             NULL, g_free);
+    // Stream names are not unique, only devices and cards get a name index
+    self->names[M_SINK] = g_hash_table_new(g_str_hash, g_str_equal);
+    self->names[M_SOURCE] = g_hash_table_new(g_str_hash, g_str_equal);
+    self->names[M_CARD] = g_hash_table_new(g_str_hash, g_str_equal);
+}
+
+/* Drop the name index slot of e unless it already points elsewhere */
+static void m_store_unname(DeepinPulseAudioObject *self, m_entry *e)
+{
+    GHashTable *names = self->names[e->kind];
+
+    if (names && e->name && g_hash_table_lookup(names, e->name) == e)
+        g_hash_table_remove(names, e->name);
+}
+
+static void m_server_clear(m_server *s)
+{
+    g_free(s->user_name);
+    g_free(s->host_name);
+    g_free(s->server_version);
+    g_free(s->server_name);
+    g_free(s->default_sink_name);
+    g_free(s->default_source_name);
+    s->user_name = s->host_name = s->server_version = s->server_name = NULL;
+    s->default_sink_name = s->default_source_name = NULL;
+    s->cookie = 0;
+    s->valid = 0;
+}
+
+/* Forget everything, e.g. before a full enumeration */
+static void m_store_clear(DeepinPulseAudioObject *self)
+{
+    int kind;
+
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (!self->entries[kind])
+            continue;
+        if (self->names[kind])
+            g_hash_table_remove_all(self->names[kind]);
+        g_hash_table_remove_all(self->entries[kind]);
+        self->kind_generation[kind] = ++self->generation;
+    }
+    m_server_clear(&self->server);
+    self->server.generation = ++self->generation;
+    if (self->tombstones)
+        g_hash_table_remove_all(self->tombstones);
+    self->changes_floor = self->generation;
+    self->server.stale = 0;
+    self->snapshot_pending = 0;
+}
+
+/* Have the next full enumeration confirm every entry, as after a warm
+ * start, instead of clearing the store and building it anew */
+static void m_store_mark_stale(DeepinPulseAudioObject *self)
+{
+    GHashTableIter iter;
+    gpointer value;
+    int kind;
+
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (!self->entries[kind])
+            continue;
+        g_hash_table_iter_init(&iter, self->entries[kind]);
+        while (g_hash_table_iter_next(&iter, NULL, &value))
+            ((m_entry *) value)->stale = 1;
+    }
+    if (self->server.valid)
+        self->server.stale = 1;
+    self->snapshot_pending = 1;
+}
+
+static void m_store_destroy(DeepinPulseAudioObject *self)
+{
+    int kind;
+
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (self->names[kind]) {
+            g_hash_table_destroy(self->names[kind]);
+            self->names[kind] = NULL;
+        }
+        if (self->entries[kind]) {
+            g_hash_table_destroy(self->entries[kind]);
+            self->entries[kind] = NULL;
+        }
+    }
+    m_server_clear(&self->server);
+    if (self->tombstones) {
+        g_hash_table_destroy(self->tombstones);
+        self->tombstones = NULL;
+    }
+}
+
+static m_entry *m_store_lookup(DeepinPulseAudioObject *self,
+                               m_kind kind,
+                               uint32_t index)
+{
+    if (!self->entries[kind])
+        return NULL;
+    return g_hash_table_lookup(self->entries[kind], GUINT_TO_POINTER(index));
+}
+
+static int m_cvolume_differ(const pa_cvolume *a, const pa_cvolume *b)
+{
+    return a->channels != b->channels ||
+           memcmp(a->values, b->values, a->channels * sizeof(pa_volume_t)) != 0;
+}
+
+static int m_channel_map_differ(const pa_channel_map *a, const pa_channel_map *b)
+{
+    return a->channels != b->channels ||
+           memcmp(a->map, b->map, a->channels * sizeof(pa_channel_position_t)) != 0;
+}
+
+static const char *m_active_port_name(const m_entry *e)
+{
+    return e->active_port < 0 ? NULL : e->ports[e->active_port].name;
+}
+
+static const char *m_active_profile_name(const m_entry *e)
+{
+    return e->active_profile < 0 ? NULL : e->profiles[e->active_profile].name;
+}
+
+/* M_FIELD_BIT()s of what a client can see differ between two copies of
+ * the same object */
+static int m_entry_diff(const m_entry *a, const m_entry *b)
+{
+    int fields = 0;
+    uint32_t i;
+
+    if (g_strcmp0(a->name, b->name))
+        fields |= M_FIELD_BIT(M_FIELD_NAME);
+    if (g_strcmp0(a->description, b->description))
+        fields |= M_FIELD_BIT(M_FIELD_DESCRIPTION);
+    if (m_cvolume_differ(&a->volume, &b->volume))
+        fields |= M_FIELD_BIT(M_FIELD_VOLUME);
+    if (a->mute != b->mute)
+        fields |= M_FIELD_BIT(M_FIELD_MUTE);
+    if (m_channel_map_differ(&a->channel_map, &b->channel_map))
+        fields |= M_FIELD_BIT(M_FIELD_CHANNELS);
+    if (g_strcmp0(m_active_port_name(a), m_active_port_name(b)))
+        fields |= M_FIELD_BIT(M_FIELD_ACTIVE_PORT);
+    if (a->n_ports != b->n_ports) {
+        fields |= M_FIELD_BIT(M_FIELD_PORTS);
+    } else {
+        for (i = 0; i < a->n_ports; i++) {
+            if (g_strcmp0(a->ports[i].name, b->ports[i].name) ||
+                g_strcmp0(a->ports[i].description, b->ports[i].description) ||
+                a->ports[i].available != b->ports[i].available ||
+                a->ports[i].direction != b->ports[i].direction ||
+                a->ports[i].n_profiles != b->ports[i].n_profiles) {
+                fields |= M_FIELD_BIT(M_FIELD_PORTS);
+                break;
+            }
+        }
+    }
+    if (a->corked != b->corked)
+        fields |= M_FIELD_BIT(M_FIELD_CORKED);
+    if (a->parent != b->parent && a->kind != M_SINK && a->kind != M_SOURCE)
+        fields |= M_FIELD_BIT(M_FIELD_DEVICE);
+    if (a->n_profiles != b->n_profiles) {
+        fields |= M_FIELD_BIT(M_FIELD_PROFILES);
+    } else {
+        for (i = 0; i < a->n_profiles; i++) {
+            if (g_strcmp0(a->profiles[i].name, b->profiles[i].name) ||
+                g_strcmp0(a->profiles[i].description, b->profiles[i].description) ||
+                a->profiles[i].n_sinks != b->profiles[i].n_sinks ||
+                a->profiles[i].n_sources != b->profiles[i].n_sources) {
+                fields |= M_FIELD_BIT(M_FIELD_PROFILES);
+                break;
+            }
+        }
+    }
+    if (g_strcmp0(m_active_profile_name(a), m_active_profile_name(b)))
+        fields |= M_FIELD_BIT(M_FIELD_ACTIVE_PROFILE);
+    if (a->proplist && b->proplist ? !pa_proplist_equal(a->proplist, b->proplist)
+                                   : a->proplist != b->proplist)
+        fields |= M_FIELD_BIT(M_FIELD_PROPLIST);
+    if (g_strcmp0(a->driver, b->driver) ||
+        g_strcmp0(a->resample_method, b->resample_method) ||
+        a->owner_module != b->owner_module ||
+        a->client != b->client ||
+        (a->parent != b->parent && (a->kind == M_SINK || a->kind == M_SOURCE)) ||
+        a->base_volume != b->base_volume ||
+        a->has_volume != b->has_volume ||
+        a->volume_writable != b->volume_writable)
+        fields |= M_FIELD_BIT(M_FIELD_OTHER);
+    return fields;
+}
+
+/* Replace whatever the store held for e->index, which owns e from now on.
+ * Fields written ahead of the server count as changed once it echoes them. */
+static m_entry *m_store_put(DeepinPulseAudioObject *self, m_entry *e)
+{
+    gint64 key = (gint64) e->kind << 32 | e->index;
+    m_entry *old = NULL;
+    m_tombstone *t = NULL;
+
+    if (!self->entries[e->kind]) {
+        m_entry_free(e);
+        return NULL;
+    }
+    old = m_store_lookup(self, e->kind, e->index);
+    if (old && !(e->changed = m_entry_diff(old, e) | old->written)) {
+        // Nothing visible moved, keep the old entry and the objects
+        // already built from it
+        old->changed = 0;
+        old->added = 0;
+        old->stale = 0;
+        m_entry_free(e);
+        return old;
+    }
+    e->generation = ++self->generation;
+    e->created = e->generation;
+    if (old) {
+        e->created = old->created;
+        m_store_unname(self, old);
+    } else if ((t = g_hash_table_lookup(self->tombstones, &key))) {
+        // Back under the same index, report it as changed rather than
+        // removed and added
+        e->created = t->created;
+        g_hash_table_remove(self->tombstones, &key);
+    }
+    if (!old) {
+        e->changed = M_FIELD_ALL;
+        e->added = 1;
+    }
+    if (self->names[e->kind] && e->name)
+        g_hash_table_replace(self->names[e->kind], e->name, e);
+    e->objects_generation = e->generation;
+    self->kind_generation[e->kind] = e->generation;
+    g_hash_table_replace(self->entries[e->kind], GUINT_TO_POINTER(e->index), e);
+    return e;
+}
+
+static void m_store_remove(DeepinPulseAudioObject *self,
+                           m_kind kind,
+                           uint32_t index)
+{
+    m_entry *e = m_store_lookup(self, kind, index);
+    m_tombstone *t = NULL;
+
+    if (!e)
+        return;
+    self->kind_generation[kind] = ++self->generation;
+
+    // Tombstones are only kept for a while; past that get_changes_since()
+    // asks the caller for a full refresh instead
+    if (g_hash_table_size(self->tombstones) >= M_TOMBSTONE_MAX) {
+        g_hash_table_remove_all(self->tombstones);
+        self->changes_floor = self->generation - 1;
+    }
+    t = g_new0(m_tombstone, 1);
+    t->key = (gint64) kind << 32 | index;
+    t->created = e->created;
+    t->removed = self->generation;
+    g_hash_table_replace(self->tombstones, &t->key, t);
+
+    m_store_unname(self, e);
+    g_hash_table_remove(self->entries[kind], GUINT_TO_POINTER(index));
+}
+
+static m_entry *m_store_find(DeepinPulseAudioObject *self,
+                             m_kind kind,
+                             const char *name)
+{
+    if (!name || !self->names[kind])
+        return NULL;
+    return g_hash_table_lookup(self->names[kind], name);
+}
+
+static m_entry *m_store_sink(DeepinPulseAudioObject *self, const pa_sink_info *l)
+{
+    m_entry *e = m_entry_new(M_SINK, l->index, l->name, l->driver, l->proplist);
+    uint32_t i;
+
+    e->description = g_strdup(l->description);
+    e->owner_module = l->owner_module;
+    e->parent = l->card;
+    e->base_volume = l->base_volume;
+    e->mute = l->mute;
+    e->channel_map = l->channel_map;
+    e->volume = l->volume;
+    e->n_ports = l->n_ports;
+    e->ports = g_new0(m_port, l->n_ports);
+    for (i = 0; i < l->n_ports; i++) {
+        e->ports[i].name = g_strdup(l->ports[i]->name);
+        e->ports[i].description = g_strdup(l->ports[i]->description);
+        e->ports[i].available = l->ports[i]->available;
+        if (l->ports[i] == l->active_port)
+            e->active_port = i;
+    }
+    return m_store_put(self, e);
+}
+
+static m_entry *m_store_source(DeepinPulseAudioObject *self, const pa_source_info *l)
+{
+    m_entry *e = m_entry_new(M_SOURCE, l->index, l->name, l->driver, l->proplist);
+    uint32_t i;
+
+    e->description = g_strdup(l->description);
+    e->owner_module = l->owner_module;
+    e->parent = l->card;
+    e->base_volume = l->base_volume;
+    e->mute = l->mute;
+    e->channel_map = l->channel_map;
+    e->volume = l->volume;
+    e->n_ports = l->n_ports;
+    e->ports = g_new0(m_port, l->n_ports);
+    for (i = 0; i < l->n_ports; i++) {
+        e->ports[i].name = g_strdup(l->ports[i]->name);
+        e->ports[i].description = g_strdup(l->ports[i]->description);
+        e->ports[i].available = l->ports[i]->available;
+        if (l->ports[i] == l->active_port)
+            e->active_port = i;
+    }
+    return m_store_put(self, e);
+}
+
+static m_entry *m_store_sink_input(DeepinPulseAudioObject *self,
+                                   const pa_sink_input_info *l)
+{
+    m_entry *e = m_entry_new(M_SINK_INPUT, l->index, l->name, l->driver, l->proplist);
+
+    e->resample_method = g_strdup(l->resample_method);
+    e->owner_module = l->owner_module;
+    e->client = l->client;
+    e->parent = l->sink;
+    e->mute = l->mute;
+    e->corked = l->corked;
+    e->has_volume = l->has_volume;
+    e->volume_writable = l->volume_writable;
+    e->channel_map = l->channel_map;
+    e->volume = l->volume;
+    return m_store_put(self, e);
+}
+
+static m_entry *m_store_source_output(DeepinPulseAudioObject *self,
+                                      const pa_source_output_info *l)
+{
+    m_entry *e = m_entry_new(M_SOURCE_OUTPUT, l->index, l->name, l->driver, l->proplist);
+
+    e->resample_method = g_strdup(l->resample_method);
+    e->owner_module = l->owner_module;
+    e->client = l->client;
+    e->parent = l->source;
+    e->mute = l->mute;
+    e->corked = l->corked;
+    e->has_volume = l->has_volume;
+    e->volume_writable = l->volume_writable;
+    e->channel_map = l->channel_map;
+    e->volume = l->volume;
+    return m_store_put(self, e);
+}
+
+static m_entry *m_store_card(DeepinPulseAudioObject *self, const pa_card_info *i)
+{
+    m_entry *e = m_entry_new(M_CARD, i->index, i->name, i->driver, i->proplist);
+    uint32_t ctr;
+
+    e->owner_module = i->owner_module;
+    e->n_profiles = i->n_profiles;
+    e->profiles = g_new0(m_profile, i->n_profiles);
+    for (ctr = 0; ctr < i->n_profiles; ctr++) {
+        e->profiles[ctr].name = g_strdup(i->profiles[ctr].name);
+        e->profiles[ctr].description = g_strdup(i->profiles[ctr].description);
+        e->profiles[ctr].n_sinks = i->profiles[ctr].n_sinks;
+        e->profiles[ctr].n_sources = i->profiles[ctr].n_sources;
+        if (i->active_profile &&
+            g_strcmp0(i->active_profile->name, i->profiles[ctr].name) == 0)
+            e->active_profile = ctr;
+    }
+    e->n_ports = i->n_ports;
+    e->ports = g_new0(m_port, i->n_ports);
+    for (ctr = 0; ctr < i->n_ports; ctr++) {
+        e->ports[ctr].name = g_strdup(i->ports[ctr]->name);
+        e->ports[ctr].description = g_strdup(i->ports[ctr]->description);
+        e->ports[ctr].available = i->ports[ctr]->available;
+        e->ports[ctr].direction = i->ports[ctr]->direction;
+        e->ports[ctr].n_profiles = i->ports[ctr]->n_profiles;
+    }
+    return m_store_put(self, e);
+}
+
+/* Returns the M_FIELD_BIT()s that moved, 0 leaves the store untouched */
+static int m_store_server(DeepinPulseAudioObject *self, const pa_server_info *i)
+{
+    m_server *s = &self->server;
+    int changed = M_FIELD_ALL;
+
+    // The stale entries described another server instance, none of their
+    // indices mean anything here. The sweep runs removed callbacks, so the
+    // caller runs it once that is safe, see m_snapshot_reconcile().
+    if (s->stale && s->cookie != i->cookie)
+        self->reconcile_pending = 1;
+    s->stale = 0;
+
+    if (s->valid) {
+        changed = 0;
+        if (g_strcmp0(s->default_sink_name, i->default_sink_name))
+            changed |= M_FIELD_BIT(M_FIELD_FALLBACK_SINK);
+        if (g_strcmp0(s->default_source_name, i->default_source_name))
+            changed |= M_FIELD_BIT(M_FIELD_FALLBACK_SOURCE);
+        if (g_strcmp0(s->user_name, i->user_name) ||
+            g_strcmp0(s->host_name, i->host_name) ||
+            g_strcmp0(s->server_version, i->server_version) ||
+            g_strcmp0(s->server_name, i->server_name) ||
+            s->cookie != i->cookie)
+            changed |= M_FIELD_BIT(M_FIELD_OTHER);
+        changed |= s->written;
+        s->changed = changed;
+        if (!changed)
+            return 0;
+    }
+    m_server_clear(s);
+    s->changed = changed;
+    s->written = 0;
+    s->user_name = g_strdup(i->user_name);
+    s->host_name = g_strdup(i->host_name);
+    s->server_version = g_strdup(i->server_version);
+    s->server_name = g_strdup(i->server_name);
+    s->default_sink_name = g_strdup(i->default_sink_name);
+    s->default_source_name = g_strdup(i->default_source_name);
+    s->cookie = i->cookie;
+    s->valid = 1;
+    s->generation = ++self->generation;
+    return changed;
+}
+
+/* Read the field w is about from the store into v */
+static int m_value_get(DeepinPulseAudioObject *self,
+                       const m_write *w,
+                       m_value *v)
+{
+    m_entry *e = NULL;
+
+    memset(v, 0, sizeof(m_value));
+    if (w->kind == M_KIND_COUNT) {
+        if (!self->server.valid)
+            return 0;
+        v->name = g_strdup(w->field == M_FIELD_FALLBACK_SINK ?
+                           self->server.default_sink_name :
+                           self->server.default_source_name);
+        return 1;
+    }
+    if (!(e = m_store_lookup(self, w->kind, w->index)))
+        return 0;
+    v->mute = e->mute;
+    v->volume = e->volume;
+    v->name = g_strdup(m_active_port_name(e));
+    return 1;
+}
+
+static int m_value_differ(m_field field, const m_value *a, const m_value *b)
+{
+    switch (field) {
+    case M_FIELD_MUTE:
+        return a->mute != b->mute;
+    case M_FIELD_VOLUME:
+        return m_cvolume_differ(&a->volume, &b->volume);
+    default:
+        return g_strcmp0(a->name, b->name) != 0;
+    }
+}
+
+/* Store v as the field w is about, like an update from the server would.
+ * written marks it as set ahead of the server, see m_store_put(). */
+static int m_value_set(DeepinPulseAudioObject *self,
+                       const m_write *w,
+                       const m_value *v,
+                       int written)
+{
+    m_server *s = &self->server;
+    m_entry *e = NULL;
+    int bit = M_FIELD_BIT(w->field);
+    uint32_t i;
+
+    if (w->kind == M_KIND_COUNT) {
+        if (w->field == M_FIELD_FALLBACK_SINK) {
+            g_free(s->default_sink_name);
+            s->default_sink_name = g_strdup(v->name);
+        } else {
+            g_free(s->default_source_name);
+            s->default_source_name = g_strdup(v->name);
+        }
+        s->written = written ? s->written | bit : s->written & ~bit;
+        s->changed = bit;
+        s->generation = ++self->generation;
+        return 1;
+    }
+
+    if (!(e = m_store_lookup(self, w->kind, w->index)))
+        return 0;
+    switch (w->field) {
+    case M_FIELD_MUTE:
+        e->mute = v->mute;
+        break;
+    case M_FIELD_VOLUME:
+        e->volume = v->volume;
+        break;
+    default:
+        for (i = 0; i < e->n_ports; i++) {
+            if (g_strcmp0(e->ports[i].name, v->name) == 0)
+                break;
+        }
+        if (i == e->n_ports)
+            return 0;
+        e->active_port = i;
+        break;
+    }
+    e->written = written ? e->written | bit : e->written & ~bit;
+    e->changed = bit;
+    e->added = 0;
+    e->generation = ++self->generation;
+    self->kind_generation[e->kind] = e->generation;
+    return 1;
+}
+
+/* Queue a write of field for a setter about to send its operation. The
+ * caller fills in w->value, applies it with m_store_write() and passes w
+ * to the operation as the userdata of m_write_ack_cb(). */
+static m_write *m_write_new(DeepinPulseAudioObject *self,
+                            m_kind kind,
+                            uint32_t index,
+                            m_field field)
+{
+    m_write *w = g_new0(m_write, 1);
+
+    w->kind = kind;
+    w->index = index;
+    w->field = field;
+    w->slot = m_sync_batching(self) ? self->sync_batch_len : -1;
+    w->next = self->writes;
+    self->writes = w;
+    return w;
+}
+
+/* Make the store show w->value right away, so reads issued before the
+ * next update from the server already see the write */
+static void m_store_write(DeepinPulseAudioObject *self, m_write *w)
+{
+    if (!m_value_get(self, w, &w->old))
+        return;
+    w->applied = m_value_set(self, w, &w->value, 1);
+}
+
+static void m_write_ack_cb(pa_context *c, int success, void *userdata)
+{
+    m_write *w = userdata;
+
+    w->acked = success ? 1 : -1;
+}
+
+/* Whether the server refused the operation queued at slot of a batch */
+static int m_write_refused(DeepinPulseAudioObject *self, int slot)
+{
+    m_write *w = NULL;
+
+    for (w = self->writes; w; w = w->next) {
+        if (w->slot == slot && w->acked < 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* Drop the writes of the operations just waited for. Those the server did
+ * not acknowledge are rolled back, unless the store holds something other
+ * than what they wrote by now. Returns 0 when one of them was refused. */
+static int m_store_settle(DeepinPulseAudioObject *self)
+{
+    m_write *w = NULL;
+    m_value v;
+    int ret = 1;
+
+    // Newest first, so stacked writes to one field unwind in order
+    while ((w = self->writes)) {
+        self->writes = w->next;
+        if (w->acked < 0)
+            ret = 0;
+        if (w->applied && w->acked != 1 && m_value_get(self, w, &v)) {
+            if (!m_value_differ(w->field, &v, &w->value))
+                m_value_set(self, w, &w->old, 0);
+            g_free(v.name);
+        }
+        g_free(w->value.name);
+        g_free(w->old.name);
+        g_free(w);
+    }
+    return ret;
+}
+
+/* Snapshot file: a header, the server, then every entry, all in host byte
+ * order with strings prefixed by their length including the NUL (0 for
+ * none). It is only meant to be read back on the same machine, by a
+ * libpulse of the same protocol version, see m_snapshot_load(). */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t protocol;      /* PA_PROTOCOL_VERSION of the writer */
+    uint32_t cookie;        /* of the server the state came from */
+    uint32_t n_entries;
+} m_snapshot_header;
+
+typedef struct {
+    const char *p;
+    const char *end;
+    int ok;                 /* cleared by the first short or bad read */
+} m_snapshot_cursor;
+
+static void m_snapshot_put_u32(FILE *fp, uint32_t v)
+{
+    fwrite(&v, sizeof(v), 1, fp);
+}
+
+static void m_snapshot_put_string(FILE *fp, const char *s)
+{
+    uint32_t len = s ? strlen(s) + 1 : 0;
+
+    m_snapshot_put_u32(fp, len);
+    if (len)
+        fwrite(s, 1, len, fp);
+}
+
+static void m_snapshot_put_entry(FILE *fp, const m_entry *e)
+{
+    const char *key = NULL;
+    void *state = NULL;
+    uint32_t i;
+
+    m_snapshot_put_u32(fp, e->kind);
+    m_snapshot_put_u32(fp, e->index);
+    m_snapshot_put_string(fp, e->name);
+    m_snapshot_put_string(fp, e->description);
+    m_snapshot_put_string(fp, e->driver);
+    m_snapshot_put_string(fp, e->resample_method);
+    m_snapshot_put_u32(fp, e->owner_module);
+    m_snapshot_put_u32(fp, e->client);
+    m_snapshot_put_u32(fp, e->parent);
+    m_snapshot_put_u32(fp, e->base_volume);
+    m_snapshot_put_u32(fp, e->mute);
+    m_snapshot_put_u32(fp, e->corked);
+    m_snapshot_put_u32(fp, e->has_volume);
+    m_snapshot_put_u32(fp, e->volume_writable);
+    fwrite(&e->channel_map, sizeof(pa_channel_map), 1, fp);
+    fwrite(&e->volume, sizeof(pa_cvolume), 1, fp);
+    m_snapshot_put_u32(fp, e->n_ports);
+    for (i = 0; i < e->n_ports; i++) {
+        m_snapshot_put_string(fp, e->ports[i].name);
+        m_snapshot_put_string(fp, e->ports[i].description);
+        m_snapshot_put_u32(fp, e->ports[i].available);
+        m_snapshot_put_u32(fp, e->ports[i].direction);
+        m_snapshot_put_u32(fp, e->ports[i].n_profiles);
+    }
+    m_snapshot_put_u32(fp, e->active_port);
+    m_snapshot_put_u32(fp, e->n_profiles);
+    for (i = 0; i < e->n_profiles; i++) {
+        m_snapshot_put_string(fp, e->profiles[i].name);
+        m_snapshot_put_string(fp, e->profiles[i].description);
+        m_snapshot_put_u32(fp, e->profiles[i].n_sinks);
+        m_snapshot_put_u32(fp, e->profiles[i].n_sources);
+    }
+    m_snapshot_put_u32(fp, e->active_profile);
+    // (uint32_t) -1 tells a missing proplist from an empty one
+    m_snapshot_put_u32(fp, e->proplist ? pa_proplist_size(e->proplist) : (uint32_t) -1);
+    while (e->proplist && (key = pa_proplist_iterate(e->proplist, &state))) {
+        m_snapshot_put_string(fp, key);
+        m_snapshot_put_string(fp, pa_proplist_gets(e->proplist, key));
+    }
+}
+
+/* Write the store to path, through a temporary file so that a reader never
+ * maps half of it */
+static int m_snapshot_save(DeepinPulseAudioObject *self, const char *path)
+{
+    m_server *s = &self->server;
+    m_snapshot_header h;
+    GHashTableIter iter;
+    gpointer value;
+    char *tmp = NULL;
+    FILE *fp = NULL;
+    int kind, ok;
+
+    // Nothing worth keeping before the server answered, nor while it has
+    // not confirmed what the store holds
+    if (!s->valid || self->snapshot_pending)
+        return 0;
+
+    memset(&h, 0, sizeof(h));
+    h.magic = M_SNAPSHOT_MAGIC;
+    h.version = M_SNAPSHOT_VERSION;
+    h.protocol = PA_PROTOCOL_VERSION;
+    h.cookie = s->cookie;
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (self->entries[kind])
+            h.n_entries += g_hash_table_size(self->entries[kind]);
+    }
+
+    tmp = g_malloc(strlen(path) + 5);
+    sprintf(tmp, "%s.tmp", path);
+    if (!(fp = fopen(tmp, "wb"))) {
+        g_free(tmp);
+        return 0;
+    }
+    fwrite(&h, sizeof(h), 1, fp);
+    m_snapshot_put_string(fp, s->user_name);
+    m_snapshot_put_string(fp, s->host_name);
+    m_snapshot_put_string(fp, s->server_version);
+    m_snapshot_put_string(fp, s->server_name);
+    m_snapshot_put_string(fp, s->default_sink_name);
+    m_snapshot_put_string(fp, s->default_source_name);
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (!self->entries[kind])
+            continue;
+        g_hash_table_iter_init(&iter, self->entries[kind]);
+        while (g_hash_table_iter_next(&iter, NULL, &value))
+            m_snapshot_put_entry(fp, value);
+    }
+
+    ok = !ferror(fp);
+    ok = fclose(fp) == 0 && ok;
+    if (ok)
+        ok = rename(tmp, path) == 0;
+    if (!ok)
+        unlink(tmp);
+    else
+        self->saved_generation = self->generation;
+    g_free(tmp);
+    return ok;
+}
+
+static void m_snapshot_get(m_snapshot_cursor *c, void *data, size_t len)
+{
+    if (!c->ok || (size_t) (c->end - c->p) < len) {
+        c->ok = 0;
+        memset(data, 0, len);
+        return;
+    }
+    memcpy(data, c->p, len);
+    c->p += len;
+}
+
+static uint32_t m_snapshot_get_u32(m_snapshot_cursor *c)
+{
+    uint32_t v;
 
-    memset(&cvolume, 0, sizeof(pa_cvolume));
-    memset(&channel_map, 0, sizeof(pa_channel_map));
-    channel_map.channels = channel_num;
-    cvolume.channels = channel_num;
+    m_snapshot_get(c, &v, sizeof(v));
+    return v;
+}
 
-    size_volume = PyTuple_Size(volume);
-    size_channel = PyTuple_Size(channel);
-    if (channel_num < size_volume) {
-        channel_num = size_volume;
-    }
-    if (channel_num < size_channel) {
-        channel_num = size_channel;
-    }
-    for (i = 0; i < channel_num; i++) {
-        cvolume.values[i] = PyInt_AsUnsignedLongMask(PyTuple_GetItem(volume, i));
-        channel_map.map[i] = PyInt_AsUnsignedLongMask(PyTuple_GetItem(channel, i));
+static char *m_snapshot_get_string(m_snapshot_cursor *c)
+{
+    uint32_t len = m_snapshot_get_u32(c);
+    char *s = NULL;
+
+    if (!c->ok || !len)
+        return NULL;
+    if ((size_t) (c->end - c->p) < len || c->p[len - 1] != '\0') {
+        c->ok = 0;
+        return NULL;
     }
-    balance = PyFloat_FromDouble(pa_cvolume_get_balance(&cvolume, &channel_map));
-    Py_INCREF(balance);
-    return balance;
+    s = g_strdup(c->p);
+    c->p += len;
+    return s;
 }
 
-/* FIXME: fuzzy ... more object wait for destruction */
-static PyObject *m_delete(DeepinPulseAudioObject *self) 
+/* Room left for n more items of at least size bytes each, so a corrupt
+ * count cannot make us allocate much */
+static int m_snapshot_fits(m_snapshot_cursor *c, uint32_t n, size_t size)
 {
-    if (self->server_info) {
-        Py_XDECREF(self->server_info);
-        self->server_info = NULL;
-    }
+    if (c->ok && n > (size_t) (c->end - c->p) / size)
+        c->ok = 0;
+    return c->ok;
+}
 
-    if (self->card_devices) {
-        Py_XDECREF(self->card_devices);
-        self->card_devices = NULL;
+static m_entry *m_snapshot_get_entry(m_snapshot_cursor *c)
+{
+    m_entry *e = NULL;
+    uint32_t kind, index, i, n;
+    char *key = NULL;
+    char *value = NULL;
+
+    kind = m_snapshot_get_u32(c);
+    index = m_snapshot_get_u32(c);
+    if (!c->ok || kind >= M_KIND_COUNT) {
+        c->ok = 0;
+        return NULL;
     }
 
-    if (self->input_devices) {
-        Py_XDECREF(self->input_devices);
-        self->input_devices = NULL;
+    e = m_entry_new(kind, index, NULL, NULL, NULL);
+    e->name = m_snapshot_get_string(c);
+    e->description = m_snapshot_get_string(c);
+    e->driver = m_snapshot_get_string(c);
+    e->resample_method = m_snapshot_get_string(c);
+    e->owner_module = m_snapshot_get_u32(c);
+    e->client = m_snapshot_get_u32(c);
+    e->parent = m_snapshot_get_u32(c);
+    e->base_volume = m_snapshot_get_u32(c);
+    e->mute = m_snapshot_get_u32(c);
+    e->corked = m_snapshot_get_u32(c);
+    e->has_volume = m_snapshot_get_u32(c);
+    e->volume_writable = m_snapshot_get_u32(c);
+    m_snapshot_get(c, &e->channel_map, sizeof(pa_channel_map));
+    m_snapshot_get(c, &e->volume, sizeof(pa_cvolume));
+    if (e->channel_map.channels > PA_CHANNELS_MAX ||
+        e->volume.channels > PA_CHANNELS_MAX)
+        c->ok = 0;
+
+    n = m_snapshot_get_u32(c);
+    if (m_snapshot_fits(c, n, 5 * sizeof(uint32_t))) {
+        e->ports = g_new0(m_port, n);
+        e->n_ports = n;
+    }
+    for (i = 0; i < e->n_ports; i++) {
+        e->ports[i].name = m_snapshot_get_string(c);
+        e->ports[i].description = m_snapshot_get_string(c);
+        e->ports[i].available = m_snapshot_get_u32(c);
+        e->ports[i].direction = m_snapshot_get_u32(c);
+        e->ports[i].n_profiles = m_snapshot_get_u32(c);
+    }
+    e->active_port = m_snapshot_get_u32(c);
+
+    n = m_snapshot_get_u32(c);
+    if (m_snapshot_fits(c, n, 4 * sizeof(uint32_t))) {
+        e->profiles = g_new0(m_profile, n);
+        e->n_profiles = n;
+    }
+    for (i = 0; i < e->n_profiles; i++) {
+        e->profiles[i].name = m_snapshot_get_string(c);
+        e->profiles[i].description = m_snapshot_get_string(c);
+        e->profiles[i].n_sinks = m_snapshot_get_u32(c);
+        e->profiles[i].n_sources = m_snapshot_get_u32(c);
+    }
+    e->active_profile = m_snapshot_get_u32(c);
+    if (e->active_port < -1 || e->active_port >= (int) e->n_ports ||
+        e->active_profile < -1 || e->active_profile >= (int) e->n_profiles)
+        c->ok = 0;
+
+    n = m_snapshot_get_u32(c);
+    if (c->ok && n != (uint32_t) -1 &&
+        m_snapshot_fits(c, n, 2 * sizeof(uint32_t))) {
+        e->proplist = pa_proplist_new();
+        for (i = 0; i < n && c->ok; i++) {
+            key = m_snapshot_get_string(c);
+            value = m_snapshot_get_string(c);
+            if (key && value)
+                pa_proplist_sets(e->proplist, key, value);
+            g_free(key);
+            g_free(value);
+        }
     }
 
-    if (self->output_devices) {
-        Py_XDECREF(self->output_devices);
-        self->output_devices = NULL;
+    if (!c->ok) {
+        m_entry_free(e);
+        return NULL;
     }
+    return e;
+}
 
-    if (self->input_ports) {
-        Py_XDECREF(self->input_ports);
-        self->input_ports = NULL;
-    }
+/* Fill the empty store from the snapshot at path. Its entries are served
+ * right away and marked stale until the server confirms them, see
+ * m_snapshot_sweep(). */
+static int m_snapshot_load(DeepinPulseAudioObject *self, const char *path)
+{
+    m_server *s = &self->server;
+    m_snapshot_header h;
+    m_snapshot_cursor c;
+    m_entry *e = NULL;
+    struct stat st;
+    void *map = NULL;
+    uint32_t i;
+    int fd;
+
+    if (s->valid || !self->entries[M_SINK])
+        return 0;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return 0;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(h)) {
+        close(fd);
+        return 0;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return 0;
+
+    c.p = map;
+    c.end = c.p + st.st_size;
+    c.ok = 1;
+    m_snapshot_get(&c, &h, sizeof(h));
+    if (h.magic != M_SNAPSHOT_MAGIC || h.version != M_SNAPSHOT_VERSION ||
+        h.protocol != PA_PROTOCOL_VERSION) {
+        munmap(map, st.st_size);
+        return 0;
+    }
+
+    s->user_name = m_snapshot_get_string(&c);
+    s->host_name = m_snapshot_get_string(&c);
+    s->server_version = m_snapshot_get_string(&c);
+    s->server_name = m_snapshot_get_string(&c);
+    s->default_sink_name = m_snapshot_get_string(&c);
+    s->default_source_name = m_snapshot_get_string(&c);
+    s->cookie = h.cookie;
+    s->valid = 1;
+    s->stale = 1;
+    s->changed = M_FIELD_ALL;
+    s->generation = ++self->generation;
+
+    for (i = 0; c.ok && i < h.n_entries; i++) {
+        if ((e = m_snapshot_get_entry(&c)) && (e = m_store_put(self, e)))
+            e->stale = 1;
+    }
+    munmap(map, st.st_size);
+
+    if (!c.ok) {
+        m_store_clear(self);
+        return 0;
+    }
+    self->snapshot_pending = 1;
+    self->saved_generation = self->generation;
+    return 1;
+}
 
-    if (self->output_ports) {
-        Py_XDECREF(self->output_ports);
-        self->output_ports = NULL;
+/* Drop the entries the last full enumeration did not confirm: they went
+ * away unnoticed, e.g. while we were not running, or belong to another
+ * server instance */
+static void m_snapshot_sweep(DeepinPulseAudioObject *self)
+{
+    GHashTableIter iter;
+    gpointer value;
+    uint32_t *stale = NULL;
+    guint n, i;
+    int kind;
+
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (!self->entries[kind])
+            continue;
+        stale = g_new(uint32_t, g_hash_table_size(self->entries[kind]) + 1);
+        n = 0;
+        g_hash_table_iter_init(&iter, self->entries[kind]);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            if (((m_entry *) value)->stale)
+                stale[n++] = ((m_entry *) value)->index;
+        }
+        // Reported to listeners like any other removal
+        for (i = 0; i < n; i++)
+            m_snapshot_drop(self, kind, stale[i]);
+        g_free(stale);
     }
+    self->snapshot_pending = 0;
+}
 
-    if (self->input_channels) {
-        Py_XDECREF(self->input_channels);
-        self->input_channels = NULL;
-    }
+/* A full enumeration just completed, or the server turned out to be
+ * another instance. Either settles the stale entries, and the store is
+ * what the next run starts from if it moved since the last save. */
+static void m_snapshot_reconcile(DeepinPulseAudioObject *self)
+{
+    self->reconcile_pending = 0;
+    if (self->snapshot_pending)
+        m_snapshot_sweep(self);
+    if (self->snapshot_path && self->generation != self->saved_generation)
+        m_snapshot_save(self, self->snapshot_path);
+}
 
-    if (self->output_channels) {
-        Py_XDECREF(self->output_channels);
-        self->output_channels = NULL;
-    }
+static PyObject *m_port_build(const m_port *p)
+{
+    return Py_BuildValue("(ssi)", p->name, p->description, p->available);
+}
 
-    if (self->input_active_ports) {
-        Py_XDECREF(self->input_active_ports);
-        self->input_active_ports = NULL;
-    }
+/* Lookups are left to the Proplist, which owns its own copy so it can
+ * outlive the entry */
+static PyObject *m_proplist_build(const pa_proplist *p)
+{
+    DeepinPulseAudioProplist *proplist = NULL;
 
-    if (self->output_active_ports) {
-        Py_XDECREF(self->output_active_ports);
-        self->output_active_ports = NULL;
-    }
+    proplist = PyObject_New(DeepinPulseAudioProplist, m_DeepinPulseAudioProplist_Type);
+    if (!proplist)
+        return NULL;
+    proplist->proplist = p ? pa_proplist_copy(p) : pa_proplist_new();
+    return (PyObject *) proplist;
+}
 
-    if (self->input_mute) {
-        Py_XDECREF(self->input_mute);
-        self->input_mute = NULL;
-    }
+static PyObject *m_channel_map_build(const pa_channel_map *map)
+{
+    PyObject *channel_value = NULL;
+    PyObject *tmp_obj = NULL;
+    int i;
 
-    if (self->output_mute) {
-        Py_XDECREF(self->output_mute);
-        self->output_mute = NULL;
-    }
+    channel_value = PyList_New(0);
+    if (!channel_value)
+        return NULL;
 
-    if (self->input_volume) {
-        Py_XDECREF(self->input_volume);
-        self->input_volume = NULL;
+    for (i = 0; i < map->channels; i++) {
+        tmp_obj = INT(map->map[i]);
+        PyList_Append(channel_value, tmp_obj);
+        Py_DecRef(tmp_obj);
     }
+    return channel_value;
+}
+
+static PyObject *m_volume_build(const pa_cvolume *volume)
+{
+    PyObject *volume_value = NULL;
+    PyObject *tmp_obj = NULL;
+    int i;
+
+    volume_value = PyList_New(0);
+    if (!volume_value)
+        return NULL;
 
-    if (self->output_volume) {
-        Py_XDECREF(self->output_volume);
-        self->output_volume = NULL;
+    for (i = 0; i < volume->channels; i++) {
+        tmp_obj = INT(volume->values[i]);
+        PyList_Append(volume_value, tmp_obj);
+        Py_DecRef(tmp_obj);
     }
+    return volume_value;
+}
 
-    if (self->playback_streams) {
-        Py_XDECREF(self->playback_streams);
-        self->playback_streams = NULL;
+/* Device ports are (name, description, available) tuples, card ports
+ * dicts */
+static PyObject *m_ports_build(const m_entry *e)
+{
+    PyObject *port_list = NULL;
+    PyObject *tmp_obj = NULL;
+    const m_port *port = NULL;
+    uint32_t i;
+
+    port_list = PyList_New(0);
+    if (!port_list)
+        return NULL;
+
+    for (i = 0; i < e->n_ports; i++) {
+        port = &e->ports[i];
+        if (e->kind != M_CARD)
+            tmp_obj = m_port_build(port);
+        else
+            tmp_obj = Py_BuildValue("{sssssisisi}",
+                                    "name", port->name,
+                                    "description", port->description,
+                                    "available", port->available,
+                                    "direction", port->direction,
+                                    "n_profiles", port->n_profiles);
+        PyList_Append(port_list, tmp_obj);
+        Py_XDECREF(tmp_obj);
     }
+    return port_list;
+}
+
+/* A record of kind from a Py_BuildValue() tuple format with one item
+ * per field */
+static PyObject *m_record_build(m_record kind, const char *format, ...)
+{
+    DeepinPulseAudioRecord *record = NULL;
+    PyObject *values = NULL;
+    Py_ssize_t i, n;
+    va_list va;
+
+    va_start(va, format);
+    values = Py_VaBuildValue(format, va);
+    va_end(va);
+    if (!values)
+        return NULL;
 
-    if (self->record_stream) {
-        Py_XDECREF(self->record_stream);
-        self->record_stream = NULL;
+    n = PyTuple_GET_SIZE(values);
+    record = PyObject_NewVar(DeepinPulseAudioRecord, &m_record_types[kind], n);
+    if (!record) {
+        Py_DECREF(values);
+        return NULL;
     }
-    
-    if (self->stream_conn_record) {
-        pa_stream_disconnect(self->stream_conn_record);
-        pa_stream_unref(self->stream_conn_record);
-        self->stream_conn_record = NULL;
+    for (i = 0; i < n; i++) {
+        record->values[i] = PyTuple_GET_ITEM(values, i);
+        Py_INCREF(record->values[i]);
     }
+    Py_DECREF(values);
+    return (PyObject *) record;
+}
 
-    if (self->pa_ctx) {                                                         
-        pa_context_disconnect(self->pa_ctx);                                    
-        pa_context_unref(self->pa_ctx);                                         
-        self->pa_ctx = NULL;                                                    
-    }                                                                           
-                                                                                
-    if (self->pa_ml) {                                                          
-        pa_glib_mainloop_free(self->pa_ml);                                     
-        self->pa_ml = NULL;                                                     
-    }
+static PyObject *m_device_build(m_entry *e)
+{
+    return m_record_build(e->kind == M_SINK ? M_RECORD_SINK : M_RECORD_SOURCE,
+                          "(ssiIOOO)",
+                          e->name,
+                          e->description,
+                          e->base_volume,
+                          e->n_ports,
+                          m_entry_object(e, M_OBJECT_MUTE),
+                          m_entry_object(e, M_OBJECT_PORTS),
+                          m_entry_object(e, M_OBJECT_PROPLIST));
+}
 
-    Py_INCREF(Py_None);
-    return Py_None;
+static PyObject *m_stream_build(m_entry *e)
+{
+    return m_record_build(e->kind == M_SINK_INPUT ? M_RECORD_SINK_INPUT : M_RECORD_SOURCE_OUTPUT,
+                          "(siiiNssOiNiii)",
+                          e->name,
+                          e->owner_module,
+                          e->client,
+                          e->parent,
+                          m_channel_map_build(&e->channel_map),
+                          e->resample_method,
+                          e->driver,
+                          m_entry_object(e, M_OBJECT_PROPLIST),
+                          e->corked,
+                          m_volume_build(&e->volume),
+                          e->mute,
+                          e->has_volume,
+                          e->volume_writable);
 }
 
-static PyObject *m_get_server_info(DeepinPulseAudioObject *self)
+static PyObject *m_profile_build(const m_profile *p)
 {
-    if (self->server_info) {
-        Py_INCREF(self->server_info);
-        return self->server_info;
-    } else {
-        Py_INCREF(Py_None);
-        return Py_None;
+    return Py_BuildValue("{sssssisi}",
+                         "name", p->name,
+                         "description", p->description,
+                         "n_sinks", p->n_sinks,
+                         "n_sources", p->n_sources);
+}
+
+static PyObject *m_profiles_build(const m_entry *e)
+{
+    PyObject *profile_list = NULL;
+    PyObject *tmp_obj = NULL;
+    uint32_t ctr;
+
+    profile_list = PyList_New(0);
+    if (!profile_list)
+        return NULL;
+
+    for (ctr = 0; ctr < e->n_profiles; ctr++) {
+        tmp_obj = m_profile_build(&e->profiles[ctr]);
+        PyList_Append(profile_list, tmp_obj);
+        Py_XDECREF(tmp_obj);
     }
+    return profile_list;
 }
 
-static PyObject *m_get_cards(DeepinPulseAudioObject *self) 
+static PyObject *m_active_profile_build(const m_entry *e)
 {
-    if (self->card_devices) {
-        Py_INCREF(self->card_devices);
-        return self->card_devices;
-    } else {
+    if (e->active_profile < 0) {
         Py_INCREF(Py_None);
         return Py_None;
     }
+    return m_profile_build(&e->profiles[e->active_profile]);
 }
 
-/* http://freedesktop.org/software/pulseaudio/doxygen/introspect.html#sinksrc_subsec */
-static PyObject *m_get_devices(DeepinPulseAudioObject *self) 
+static PyObject *m_card_build(m_entry *e)
 {
-    // Define our pulse audio loop and connection variables                     
-    pa_mainloop *pa_ml;                                                         
-    pa_mainloop_api *pa_mlapi;                                                  
-    pa_context *pa_ctx;
-    pa_operation *pa_op;                                                        
-                                                                                
-    // We'll need these state variables to keep track of our requests           
-    int state = 0;
-    int pa_ready = 0;                                                           
-
-    PyDict_Clear(self->server_info);
-    PyDict_Clear(self->card_devices);
-
-    PyDict_Clear(self->input_devices);
-    PyDict_Clear(self->output_devices);
-    PyDict_Clear(self->input_ports);
-    PyDict_Clear(self->output_ports);
-    PyDict_Clear(self->input_channels);
-    PyDict_Clear(self->output_channels);
-    PyDict_Clear(self->input_active_ports);
-    PyDict_Clear(self->output_active_ports);
-    PyDict_Clear(self->input_mute);
-    PyDict_Clear(self->output_mute);
-    PyDict_Clear(self->input_volume);
-    PyDict_Clear(self->output_volume);
-    PyDict_Clear(self->playback_streams);
-    PyDict_Clear(self->record_stream);
-
-    // Create a mainloop API and connection to the default server               
-    pa_ml = pa_mainloop_new();                                                  
-    pa_mlapi = pa_mainloop_get_api(pa_ml);                                      
-    pa_ctx = pa_context_new(pa_mlapi, PACKAGE);       
-                                                                                
-    // This function connects to the pulse server                               
-    pa_context_connect(pa_ctx, NULL, 0, NULL);
-
-    // This function defines a callback so the server will tell us it's state.  
-    // Our callback will wait for the state to be ready.  The callback will     
-    // modify the variable to 1 so we know when we have a connection and it's   
-    // ready.                                                                   
-    // If there's an error, the callback will set pa_ready to 2                 
-    pa_context_set_state_callback(pa_ctx, m_pa_state_cb, &pa_ready);              
-                                                                                
-    // Now we'll enter into an infinite loop until we get the data we receive   
-    // or if there's an error                                                   
-    for (;;) {                                                                  
-        // We can't do anything until PA is ready, so just iterate the mainloop 
-        // and continue                                                         
-        if (pa_ready == 0) {                                                    
-            pa_mainloop_iterate(pa_ml, 1, NULL);                                
-            continue;                                                           
-        }                                                                       
-        // We couldn't get a connection to the server, so exit out              
-        if (pa_ready == 2) {                                                    
-            pa_context_disconnect(pa_ctx);                                      
-            pa_context_unref(pa_ctx);
-            pa_mainloop_free(pa_ml);                                            
-            Py_INCREF(Py_False);                                                    
-            return Py_False;     
-        }                                                                       
-        // At this point, we're connected to the server and ready to make
-        // requests                                                             
-        switch (state) {                                                        
-            // State 0: we haven't done anything yet                            
-            case 0:                                                             
-                // This sends an operation to the server.  pa_sinklist_info is  
-                // our callback function and a pointer to our devicelist will   
-                // be passed to the callback The operation ID is stored in the  
-                // pa_op variable                                               
-                pa_op = pa_context_get_sink_info_list(pa_ctx,                   
-                        m_pa_sinklist_cb,                                         
-                        self);                                                      
-                                                                                
-                // Update state for next iteration through the loop             
-                state++;                                                        
-                break;                                                          
-            case 1:                                                             
-                // Now we wait for our operation to complete.  When it's        
-                // complete our pa_output_devices is filled out, and we move 
-                // along to the next state                                      
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {
-                    pa_operation_unref(pa_op);                                  
-                                                                                
-                    // Now we perform another operation to get the source       
-                    // (input device) list just like before.  This time we pass 
-                    // a pointer to our input structure                         
-                    pa_op = pa_context_get_source_info_list(pa_ctx,             
-                            m_pa_sourcelist_cb,                                   
-                            self);                                                  
-                    // Update the state so we know what to do next              
-                    state++;
-                }                                                               
-                break;                                                          
-            case 2:                                                             
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {
-                    pa_operation_unref(pa_op);
-                    // Now wo perform another operation to get the card list.
-                    pa_op = pa_context_get_card_info_list(pa_ctx,
-                            m_pa_cardlist_cb, self);
-                    state++;
-                }
+    PyObject *profile_list = NULL;
+
+    profile_list = m_profiles_build(e);
+    if (!profile_list)
+        return NULL;
+
+    return m_record_build(M_RECORD_CARD,
+                          "(siNNOiO)",
+                          e->name,
+                          e->n_profiles,
+                          profile_list,
+                          m_active_profile_build(e),
+                          m_entry_object(e, M_OBJECT_PROPLIST),
+                          e->n_ports,
+                          m_entry_object(e, M_OBJECT_PORTS));
+}
+
+static PyObject *m_server_build(const m_server *s)
+{
+    return m_record_build(M_RECORD_SERVER,
+                          "(ssssssi)",
+                          s->user_name,
+                          s->host_name,
+                          s->server_version,
+                          s->server_name,
+                          s->default_sink_name,
+                          s->default_source_name,
+                          s->cookie);
+}
+
+static PyObject *m_entry_build(m_entry *e, m_object which)
+{
+    switch (which) {
+        case M_OBJECT_CHANNELS:
+            return Py_BuildValue("{sisisN}",
+                                 "can_balance", pa_channel_map_can_balance(&e->channel_map),
+                                 "channels", e->channel_map.channels,
+                                 "map", m_channel_map_build(&e->channel_map));
+        case M_OBJECT_ACTIVE_PORT:
+            if (e->active_port < 0) {
+                Py_INCREF(Py_None);
+                return Py_None;
+            }
+            return m_port_build(&e->ports[e->active_port]);
+        case M_OBJECT_VOLUME:
+            return m_volume_build(&e->volume);
+        case M_OBJECT_PROPLIST:
+            return m_proplist_build(e->proplist);
+        case M_OBJECT_PORTS:
+            return m_ports_build(e);
+        case M_OBJECT_MUTE:
+            return PyBool_FromLong(e->mute);
+        default:
+            break;
+    }
+    switch (e->kind) {
+        case M_SINK:
+        case M_SOURCE:
+            return m_device_build(e);
+        case M_SINK_INPUT:
+        case M_SOURCE_OUTPUT:
+            return m_stream_build(e);
+        default:
+            return m_card_build(e);
+    }
+}
+
+/* Borrowed reference to a Python view of e, built on first use and kept
+ * until the entry changes */
+static PyObject *m_entry_object(m_entry *e, m_object which)
+{
+    if (e->objects_generation != e->generation)
+        m_entry_drop_objects(e);
+    if (!e->objects[which])
+        e->objects[which] = m_entry_build(e, which);
+    return e->objects[which];
+}
+
+/* Keys of the dicts handed out by m_entry_changes() */
+static const char *m_field_names[M_FIELD_COUNT] =
+{
+    "name", "description", "volume", "mute", "channels", "active_port",
+    "ports", "corked", "device", "profiles", "active_profile", "proplist",
+    "info", "fallback_sink", "fallback_source"
+};
+
+/* {field: new value} for the fields the last update of e moved */
+static PyObject *m_entry_changes(m_entry *e)
+{
+    PyObject *changes = NULL;
+    PyObject *value = NULL;
+    int f;
+
+    if (!(changes = PyDict_New()))
+        return NULL;
+
+    for (f = 0; f < M_FIELD_COUNT; f++) {
+        if (!(e->changed & M_FIELD_BIT(f)))
+            continue;
+        switch (f) {
+            case M_FIELD_NAME:
+                value = STRING(e->name);
                 break;
-            case 3:
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {
-                    pa_operation_unref(pa_op);
-                    // Now to get the server info
-                    pa_op = pa_context_get_server_info(pa_ctx,
-                            m_pa_server_info_cb, self);
-                    state++;
-                }
+            case M_FIELD_DESCRIPTION:
+                value = STRING(e->description);
                 break;
-            case 4:
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {
-                    pa_operation_unref(pa_op);
-                    // Now to get the server info
-                    pa_op = pa_context_get_sink_input_info_list(pa_ctx,
-                            m_pa_sinkinputlist_info_cb, self);
-                    state++;
-                }
+            case M_FIELD_VOLUME:
+                value = m_entry_object(e, M_OBJECT_VOLUME);
+                Py_XINCREF(value);
                 break;
-            case 5:
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {
-                    pa_operation_unref(pa_op);
-                    // Now to get the server info
-                    pa_op = pa_context_get_source_output_info_list(pa_ctx,
-                            m_pa_sourceoutputlist_info_cb, self);
-                    state++;
-                }
+            case M_FIELD_MUTE:
+                value = PyBool_FromLong(e->mute);
+                break;
+            case M_FIELD_CHANNELS:
+                value = m_entry_object(e, M_OBJECT_CHANNELS);
+                Py_XINCREF(value);
+                break;
+            case M_FIELD_ACTIVE_PORT:
+                value = m_entry_object(e, M_OBJECT_ACTIVE_PORT);
+                Py_XINCREF(value);
                 break;
-            case 6:
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {       
-                    // Now we're done, clean up and disconnect and return       
-                    pa_operation_unref(pa_op);                                  
-                    pa_context_disconnect(pa_ctx);                              
-                    pa_context_unref(pa_ctx);                                   
-                    pa_mainloop_free(pa_ml);
-                    Py_INCREF(Py_True);                                                    
-                    return Py_True;     
-                }                                                               
-                break;                                                          
-            default:                                                            
-                // We should never see this state                               
-                Py_INCREF(Py_False);                                                    
-                return Py_False;     
-        }                               
-        // Iterate the main loop and go again.  The second argument is whether  
-        // or not the iteration should block until something is ready to be     
-        // done.  Set it to zero for non-blocking.                              
-        pa_mainloop_iterate(pa_ml, 1, NULL);                                    
-    }
-
-    Py_INCREF(Py_True);                                                    
-    return Py_True;             
+            case M_FIELD_PORTS:
+                value = m_entry_object(e, M_OBJECT_PORTS);
+                Py_XINCREF(value);
+                break;
+            case M_FIELD_CORKED:
+                value = PyBool_FromLong(e->corked);
+                break;
+            case M_FIELD_DEVICE:
+                value = INT(e->parent);
+                break;
+            case M_FIELD_PROFILES:
+                value = m_profiles_build(e);
+                break;
+            case M_FIELD_ACTIVE_PROFILE:
+                value = m_active_profile_build(e);
+                break;
+            case M_FIELD_PROPLIST:
+                value = m_entry_object(e, M_OBJECT_PROPLIST);
+                Py_XINCREF(value);
+                break;
+            case M_FIELD_OTHER:
+                value = m_entry_object(e, M_OBJECT_INFO);
+                Py_XINCREF(value);
+                break;
+            default:
+                continue;
+        }
+        if (!value) {
+            Py_DECREF(changes);
+            return NULL;
+        }
+        PyDict_SetItemString(changes, m_field_names[f], value);
+        Py_DECREF(value);
+    }
+    return changes;
 }
 
-static PyObject *m_get_output_devices(DeepinPulseAudioObject *self) 
+/* Same for the server */
+static PyObject *m_server_changes(const m_server *s)
 {
-    /*ERROR("get_output_devices: %p %d\n", self->output_devices, self->output_devices->ob_refcnt);*/
-    if (self->output_devices) {
-        Py_INCREF(self->output_devices);
-        return self->output_devices;
-    } else {
-        Py_INCREF(Py_None);
-        return Py_None;
+    PyObject *changes = NULL;
+    PyObject *value = NULL;
+    int f;
+
+    if (!(changes = PyDict_New()))
+        return NULL;
+
+    for (f = 0; f < M_FIELD_COUNT; f++) {
+        if (!(s->changed & M_FIELD_BIT(f)))
+            continue;
+        switch (f) {
+            // STRING() gives None once the last sink or source went away
+            case M_FIELD_FALLBACK_SINK:
+                value = STRING(s->default_sink_name);
+                break;
+            case M_FIELD_FALLBACK_SOURCE:
+                value = STRING(s->default_source_name);
+                break;
+            case M_FIELD_OTHER:
+                value = m_server_build(s);
+                break;
+            default:
+                continue;
+        }
+        if (!value) {
+            Py_DECREF(changes);
+            return NULL;
+        }
+        PyDict_SetItemString(changes, m_field_names[f], value);
+        Py_DECREF(value);
     }
+    return changes;
 }
 
-static PyObject *m_get_input_devices(DeepinPulseAudioObject *self)          
-{                                                                               
-    if (self->input_devices) {
-        Py_INCREF(self->input_devices);
-        return self->input_devices;                                                                
-    } else {
+/* {index: object} over every entry of kind, what the list getters hand
+ * out. The objects are shared with the store and only rebuilt after the
+ * entry changed. */
+static PyObject *m_store_view(DeepinPulseAudioObject *self,
+                              m_kind kind,
+                              m_object which)
+{
+    PyObject *view = NULL;
+    PyObject *key = NULL;
+    PyObject *obj = NULL;
+    GHashTableIter iter;
+    gpointer value;
+
+    view = PyDict_New();
+    if (!view || !self->entries[kind])
+        return view;
+
+    g_hash_table_iter_init(&iter, self->entries[kind]);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        if (!(obj = m_entry_object(value, which)))
+            continue;
+        key = INT(((m_entry *) value)->index);
+        PyDict_SetItem(view, key, obj);
+        Py_DecRef(key);
+    }
+    return view;
+}
+
+/* One object of the view above, None for an unknown index */
+static PyObject *m_store_view_item(DeepinPulseAudioObject *self,
+                                   m_kind kind,
+                                   int index,
+                                   m_object which)
+{
+    m_entry *e = m_store_lookup(self, kind, index);
+    PyObject *obj = NULL;
+
+    if (!e) {
         Py_INCREF(Py_None);
         return Py_None;
     }
+    obj = m_entry_object(e, which);
+    Py_XINCREF(obj);
+    return obj;
+}
+
+static PyObject *m_get_server_info(DeepinPulseAudioObject *self)
+{
+    if (!self->server.valid)
+        return PyDict_New();
+    return m_server_build(&self->server);
+}
+
+static PyObject *m_get_cards(DeepinPulseAudioObject *self) 
+{
+    return m_store_view(self, M_CARD, M_OBJECT_INFO);
+}
+
+/* Send all introspection requests at once; the server answers them in
+ * order on the same connection, so the whole enumeration completes in
+ * roughly one round trip. Every callback fills the state store. */
+static void m_store_request_all(DeepinPulseAudioObject *self,
+                                pa_context *pa_ctx,
+                                pa_operation **pa_ops)
+{
+    pa_ops[0] = pa_context_get_sink_info_list(pa_ctx,
+            m_pa_sinklist_cb, self);
+    pa_ops[1] = pa_context_get_source_info_list(pa_ctx,
+            m_pa_sourcelist_cb, self);
+    pa_ops[2] = pa_context_get_card_info_list(pa_ctx,
+            m_pa_cardlist_cb, self);
+    pa_ops[3] = pa_context_get_server_info(pa_ctx,
+            m_pa_server_info_cb, self);
+    pa_ops[4] = pa_context_get_sink_input_info_list(pa_ctx,
+            m_pa_sinkinputlist_info_cb, self);
+    // Keep it last, its end marks the end of the enumeration
+    pa_ops[5] = pa_context_get_source_output_info_list(pa_ctx,
+            m_pa_sourceoutputlist_info_cb, self);
+}
+
+/* http://freedesktop.org/software/pulseaudio/doxygen/introspect.html#sinksrc_subsec */
+static PyObject *m_get_devices(DeepinPulseAudioObject *self) 
+{
+    pa_context *pa_ctx = NULL;
+    int ret = 0;
+    pa_operation *pa_ops[6];
+
+    // Reuse (or lazily open) the shared connection to the default server
+    if (!(pa_ctx = m_sync_context(self, &ret))) {
+        RETURN_SYNC(ret);
+    }
+
+    // Under sync_lock, and only once the server can answer. The entries
+    // stay visible until the enumeration below confirms or sweeps them.
+    m_store_mark_stale(self);
+
+    m_store_request_all(self, pa_ctx, pa_ops);
+
+    // From now on NEW/CHANGE/REMOVE events patch the store in place, so
+    // make sure the context is subscribed to every cached facility
+    if (!self->cache_valid) {
+        self->cache_valid = 1;
+        m_update_subscription(self);
+    }
+
+    RETURN_SYNC(m_sync_wait_all(self, pa_ops, 6));
+}
+
+static PyObject *m_get_output_devices(DeepinPulseAudioObject *self) 
+{
+    return m_store_view(self, M_SINK, M_OBJECT_INFO);
+}
+
+static PyObject *m_get_input_devices(DeepinPulseAudioObject *self)          
+{
+    return m_store_view(self, M_SOURCE, M_OBJECT_INFO);
 }        
 
 static PyObject *m_get_playback_streams(DeepinPulseAudioObject *self)
 {
-    if (self->playback_streams) {
-        Py_INCREF(self->playback_streams);
-        return self->playback_streams;
-    } else {
-        Py_INCREF(Py_None);
-        return Py_None;
-    }
+    return m_store_view(self, M_SINK_INPUT, M_OBJECT_INFO);
 }
 
 static PyObject *m_get_record_streams(DeepinPulseAudioObject *self)
 {
-    if (self->record_stream) {
-        Py_INCREF(self->record_stream);
-        return self->record_stream;
-    } else {
-        Py_INCREF(Py_None);
-        return Py_None;
-    }
+    return m_store_view(self, M_SOURCE_OUTPUT, M_OBJECT_INFO);
 }
 
 static PyObject *m_get_output_ports(DeepinPulseAudioObject *self) 
 {
-    Py_INCREF(self->output_ports);
-    return self->output_ports;
+    return m_store_view(self, M_SINK, M_OBJECT_PORTS);
 }
 
 static PyObject *m_get_output_ports_by_index(DeepinPulseAudioObject *self, PyObject *args)
@@ -1047,22 +3420,13 @@ static PyObject *m_get_output_ports_by_index(DeepinPulseAudioObject *self, PyObj
         ERROR("invalid arguments to get_output_ports_by_index");
         return NULL;
     }
-    PyObject *tmp = NULL;
-    if (self->output_devices && PyDict_Contains(self->output_devices, INT(device))) {
-        tmp = PyDict_GetItemString(PyDict_GetItem(
-                        self->output_devices, INT(device)), "ports");
-        Py_INCREF(tmp);
-        return tmp;
-    } else {
-        Py_INCREF(Py_None);
-        return Py_None;
-    }
+
+    return m_store_view_item(self, M_SINK, device, M_OBJECT_PORTS);
 }
 
 static PyObject *m_get_input_ports(DeepinPulseAudioObject *self)               
 {
-    Py_INCREF(self->input_ports);
-    return self->input_ports;
+    return m_store_view(self, M_SOURCE, M_OBJECT_PORTS);
 }
 
 static PyObject *m_get_input_ports_by_index(DeepinPulseAudioObject *self, PyObject *args)
@@ -1073,22 +3437,13 @@ static PyObject *m_get_input_ports_by_index(DeepinPulseAudioObject *self, PyObje
         ERROR("invalid arguments to get_output_channels");
         return NULL;
     }
-    PyObject *tmp = NULL;
-    if (self->input_devices && PyDict_Contains(self->input_devices, INT(device))) {
-        tmp = PyDict_GetItemString(PyDict_GetItem(
-                        self->input_devices, INT(device)), "ports");
-        Py_INCREF(tmp);
-        return tmp;
-    } else {
-        Py_INCREF(Py_None);
-        return Py_None;
-    }
+
+    return m_store_view_item(self, M_SOURCE, device, M_OBJECT_PORTS);
 }    
 
 static PyObject *m_get_output_channels(DeepinPulseAudioObject *self)
 {
-    Py_INCREF(self->output_channels);
-    return self->output_channels;
+    return m_store_view(self, M_SINK, M_OBJECT_CHANNELS);
 }
 
 static PyObject *m_get_output_channels_by_index(DeepinPulseAudioObject *self, PyObject *args) 
@@ -1099,22 +3454,13 @@ static PyObject *m_get_output_channels_by_index(DeepinPulseAudioObject *self, Py
         ERROR("invalid arguments to get_output_channels");
         return NULL;
     }
-    
-    PyObject *tmp = NULL;
-    if (self->output_channels && PyDict_Contains(self->output_channels, INT(device))) {
-        tmp = PyDict_GetItem(self->output_channels, INT(device));
-        Py_INCREF(tmp);
-        return tmp;
-    } else {
-        Py_INCREF(Py_None);
-        return Py_None;
-    }
+
+    return m_store_view_item(self, M_SINK, device, M_OBJECT_CHANNELS);
 }
 
 static PyObject *m_get_input_channels(DeepinPulseAudioObject *self)
 {
-    Py_INCREF(self->input_channels);
-    return self->input_channels;
+    return m_store_view(self, M_SOURCE, M_OBJECT_CHANNELS);
 }
 
 static PyObject *m_get_input_channels_by_index(DeepinPulseAudioObject *self, PyObject *args)
@@ -1124,23 +3470,14 @@ static PyObject *m_get_input_channels_by_index(DeepinPulseAudioObject *self, PyO
     if (!PyArg_ParseTuple(args, "i", &device)) {
         ERROR("invalid arguments to get_input_channels");                      
         return NULL;                                                            
-    } 
-                                                                                
-    PyObject *tmp = NULL;
-    if (self->input_channels && PyDict_Contains(self->input_channels, INT(device))) {
-        tmp = PyDict_GetItem(self->input_channels, INT(device));
-        Py_INCREF(tmp);
-        return tmp;
-    } else {
-        Py_INCREF(Py_None);
-        return Py_None;
     }
+
+    return m_store_view_item(self, M_SOURCE, device, M_OBJECT_CHANNELS);
 }             
 
 static PyObject *m_get_output_active_ports(DeepinPulseAudioObject *self)
 {
-    Py_INCREF(self->output_active_ports);
-    return self->output_active_ports;
+    return m_store_view(self, M_SINK, M_OBJECT_ACTIVE_PORT);
 }
 
 static PyObject *m_get_output_active_ports_by_index(DeepinPulseAudioObject *self, PyObject *args)
@@ -1150,23 +3487,14 @@ static PyObject *m_get_output_active_ports_by_index(DeepinPulseAudioObject *self
     if (!PyArg_ParseTuple(args, "i", &device)) {
         ERROR("invalid arguments to get_output_active_ports");                      
         return NULL; 
-    }                                                                           
-                                                                                
-    PyObject *tmp = NULL;
-    if (self->output_active_ports && PyDict_Contains(self->output_active_ports, INT(device))) {
-        tmp = PyDict_GetItem(self->output_active_ports, INT(device));
-        Py_INCREF(tmp);
-        return tmp;
-    } else {
-        Py_INCREF(Py_None);
-        return Py_None;
     }
+
+    return m_store_view_item(self, M_SINK, device, M_OBJECT_ACTIVE_PORT);
 }           
 
 static PyObject *m_get_input_active_ports(DeepinPulseAudioObject *self)
 {
-    Py_INCREF(self->input_active_ports);
-    return self->input_active_ports;
+    return m_store_view(self, M_SOURCE, M_OBJECT_ACTIVE_PORT);
 }
 
 static PyObject *m_get_input_active_ports_by_index(DeepinPulseAudioObject *self, PyObject *args)
@@ -1176,23 +3504,14 @@ static PyObject *m_get_input_active_ports_by_index(DeepinPulseAudioObject *self,
     if (!PyArg_ParseTuple(args, "i", &device)) {
         ERROR("invalid arguments to get_input_active_ports");                          
         return NULL;                                                               
-    }                                                                              
-                                                                                   
-    PyObject *tmp = NULL;
-    if (self->input_active_ports && PyDict_Contains(self->input_active_ports, INT(device))) {
-        tmp = PyDict_GetItem(self->input_active_ports, INT(device));
-        Py_INCREF(tmp);
-        return tmp;
-    } else {
-        Py_INCREF(Py_None);
-        return Py_None;
     }
+
+    return m_store_view_item(self, M_SOURCE, device, M_OBJECT_ACTIVE_PORT);
 }                
 
 static PyObject *m_get_output_mute(DeepinPulseAudioObject *self)
 {
-    Py_INCREF(self->output_mute);
-    return self->output_mute;
+    return m_store_view(self, M_SINK, M_OBJECT_MUTE);
 }
 
 static PyObject *m_get_output_mute_by_index(DeepinPulseAudioObject *self, PyObject *args) 
@@ -1202,24 +3521,14 @@ static PyObject *m_get_output_mute_by_index(DeepinPulseAudioObject *self, PyObje
     if (!PyArg_ParseTuple(args, "i", &device)) {                                   
         ERROR("invalid arguments to get_output_mute");                              
         return NULL;                                                               
-    }                                                                              
-
-    PyObject *tmp = NULL;
-    if (self->output_devices && PyDict_Contains(self->output_devices, INT(device))) {
-        tmp = PyDict_GetItemString(PyDict_GetItem(
-                        self->output_devices, INT(device)), "mute");
-        Py_INCREF(tmp);
-        return tmp;
-    } else {
-        Py_INCREF(Py_None);
-        return Py_None;
     }
+
+    return m_store_view_item(self, M_SINK, device, M_OBJECT_MUTE);
 }
 
 static PyObject *m_get_input_mute(DeepinPulseAudioObject *self)
 {
-    Py_INCREF(self->input_mute);
-    return self->input_mute;
+    return m_store_view(self, M_SOURCE, M_OBJECT_MUTE);
 }
 
 static PyObject *m_get_input_mute_by_index(DeepinPulseAudioObject *self, PyObject *args) 
@@ -1229,24 +3538,14 @@ static PyObject *m_get_input_mute_by_index(DeepinPulseAudioObject *self, PyObjec
     if (!PyArg_ParseTuple(args, "i", &device)) {
         ERROR("invalid arguments to get_input_mute");                              
         return NULL;                                                            
-    }                                                                           
-                                                                                
-    PyObject *tmp = NULL;
-    if (self->input_devices && PyDict_Contains(self->input_devices, INT(device))) {
-        tmp = PyDict_GetItemString(PyDict_GetItem(
-                        self->input_devices, INT(device)),"mute");
-        Py_INCREF(tmp);
-        return tmp;
-    } else {
-        Py_INCREF(Py_None);
-        return Py_None;
     }
+
+    return m_store_view_item(self, M_SOURCE, device, M_OBJECT_MUTE);
 }                
 
 static PyObject *m_get_output_volume(DeepinPulseAudioObject *self)
 {
-    Py_INCREF(self->output_volume);
-    return self->output_volume;
+    return m_store_view(self, M_SINK, M_OBJECT_VOLUME);
 }
 
 static PyObject *m_get_output_volume_by_index(DeepinPulseAudioObject *self, PyObject *args) 
@@ -1256,23 +3555,14 @@ static PyObject *m_get_output_volume_by_index(DeepinPulseAudioObject *self, PyOb
     if (!PyArg_ParseTuple(args, "i", &device)) {
         ERROR("invalid arguments to get_output_volume");                              
         return NULL;                                                            
-    }                                                                           
-                                                                                
-    PyObject *tmp = NULL;
-    if (self->output_volume && PyDict_Contains(self->output_volume, INT(device))) {
-        tmp = PyDict_GetItem(self->output_volume, INT(device));
-        Py_INCREF(tmp);
-        return tmp;
-    } else {
-        Py_INCREF(Py_None);
-        return Py_None;
     }
+
+    return m_store_view_item(self, M_SINK, device, M_OBJECT_VOLUME);
 }           
 
 static PyObject *m_get_input_volume(DeepinPulseAudioObject *self)
 {
-    Py_INCREF(self->input_volume);
-    return self->input_volume;
+    return m_store_view(self, M_SOURCE, M_OBJECT_VOLUME);
 }
 
 static PyObject *m_get_input_volume_by_index(DeepinPulseAudioObject *self, PyObject *args)
@@ -1282,326 +3572,323 @@ static PyObject *m_get_input_volume_by_index(DeepinPulseAudioObject *self, PyObj
     if (!PyArg_ParseTuple(args, "i", &device)) {
         ERROR("invalid arguments to get_input_volume");                            
         return NULL;                                                            
-    }                                                                           
-                                                                                
-    PyObject *tmp = NULL;
-    if (self->input_volume && PyDict_Contains(self->input_volume, INT(device))) {
-        tmp = PyDict_GetItem(self->input_volume, INT(device));             
-        Py_INCREF(tmp);
-        return tmp;
-    } else {
-        Py_INCREF(self->input_volume);
-        return self->input_volume;                                             
     }
+
+    return m_store_view_item(self, M_SOURCE, device, M_OBJECT_VOLUME);
 }                                                                                        
 
 static PyObject *m_get_fallback_sink(DeepinPulseAudioObject *self)
 {
-    PyObject *tmp = NULL;
-    if (self->server_info && PyDict_Contains(self->server_info, STRING("fallback_sink"))) {
-        tmp = PyDict_GetItemString(self->server_info, "fallback_sink");
-        Py_INCREF(tmp);
-        return tmp;
-    } else {
+    return STRING(self->server.default_sink_name);
+}
+
+static PyObject *m_get_fallback_source(DeepinPulseAudioObject *self)
+{
+    return STRING(self->server.default_source_name);
+}
+
+static PyObject *m_get_by_name(DeepinPulseAudioObject *self, 
+                               PyObject *args, 
+                               m_kind kind)
+{
+    char *name = NULL;
+    m_entry *e = NULL;
+
+    if (!PyArg_ParseTuple(args, "s", &name)) {
+        ERROR("invalid arguments to get_by_name");
+        return NULL;
+    }
+    if (!(e = m_store_find(self, kind, name))) {
         Py_INCREF(Py_None);
         return Py_None;
     }
+    return INT(e->index);
 }
 
-static PyObject *m_get_fallback_source(DeepinPulseAudioObject *self)
+static PyObject *m_get_sink_by_name(DeepinPulseAudioObject *self, PyObject *args)
 {
-    PyObject *tmp = NULL;
-    if (self->server_info && PyDict_Contains(self->server_info, STRING("fallback_source"))) {
-        tmp = PyDict_GetItemString(self->server_info, "fallback_source");
-        Py_INCREF(tmp);
-        return tmp;
-    } else {
+    return m_get_by_name(self, args, M_SINK);
+}
+
+static PyObject *m_get_source_by_name(DeepinPulseAudioObject *self, PyObject *args)
+{
+    return m_get_by_name(self, args, M_SOURCE);
+}
+
+static PyObject *m_get_card_by_name(DeepinPulseAudioObject *self, PyObject *args)
+{
+    return m_get_by_name(self, args, M_CARD);
+}
+
+static PyObject *m_fallback_sink_index(DeepinPulseAudioObject *self)
+{
+    m_entry *e = m_store_find(self, M_SINK, self->server.default_sink_name);
+
+    if (!e) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    return INT(e->index);
+}
+
+static PyObject *m_fallback_source_index(DeepinPulseAudioObject *self)
+{
+    m_entry *e = m_store_find(self, M_SOURCE, self->server.default_source_name);
+
+    if (!e) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    return INT(e->index);
+}
+
+static PyObject *m_get_generation(DeepinPulseAudioObject *self, PyObject *args)
+{
+    char *kind_name = NULL;
+    int index = -1;
+    int kind = -1;
+    m_entry *e = NULL;
+
+    if (!PyArg_ParseTuple(args, "|si", &kind_name, &index)) {
+        ERROR("invalid arguments to get_generation");
+        return NULL;
+    }
+    if (!kind_name)
+        return PyLong_FromUnsignedLongLong(self->generation);
+
+    if ((kind = m_kind_from_name(kind_name)) < 0) {
+        ERROR("unknown kind");
+        return NULL;
+    }
+    if (!(e = m_store_lookup(self, kind, index))) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    return PyLong_FromUnsignedLongLong(e->generation);
+}
+
+/* (generation, changes) where changes maps each kind touched after since
+ * to its added, changed and removed indices, and "server" to True if the
+ * server info changed. None when since predates what the store remembers,
+ * the caller then has to refresh everything. */
+static PyObject *m_get_changes_since(DeepinPulseAudioObject *self, PyObject *args)
+{
+    unsigned PY_LONG_LONG since = 0;
+    PyObject *lists[M_KIND_COUNT][3];
+    PyObject *changes = NULL;
+    PyObject *tmp_obj = NULL;
+    GHashTableIter iter;
+    gpointer value;
+    m_entry *e = NULL;
+    m_tombstone *t = NULL;
+    int kind;
+    int i;
+
+    if (!PyArg_ParseTuple(args, "K", &since)) {
+        ERROR("invalid arguments to get_changes_since");
+        return NULL;
+    }
+    if (since < self->changes_floor || !self->tombstones) {
         Py_INCREF(Py_None);
         return Py_None;
     }
+
+    memset(lists, 0, sizeof(lists));
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (self->kind_generation[kind] <= since)
+            continue;
+        for (i = 0; i < 3; i++) {
+            if (!(lists[kind][i] = PyList_New(0)))
+                goto fail;
+        }
+
+        g_hash_table_iter_init(&iter, self->entries[kind]);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            e = value;
+            if (e->generation <= since)
+                continue;
+            tmp_obj = INT(e->index);
+            if (!tmp_obj ||
+                PyList_Append(lists[kind][e->created > since ? 0 : 1], tmp_obj) < 0) {
+                Py_XDECREF(tmp_obj);
+                goto fail;
+            }
+            Py_DecRef(tmp_obj);
+        }
+    }
+
+    g_hash_table_iter_init(&iter, self->tombstones);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        t = value;
+        kind = t->key >> 32;
+        // Appeared and vanished in between: nothing to report
+        if (t->removed <= since || t->created > since || !lists[kind][2])
+            continue;
+        tmp_obj = INT((uint32_t) t->key);
+        if (!tmp_obj || PyList_Append(lists[kind][2], tmp_obj) < 0) {
+            Py_XDECREF(tmp_obj);
+            goto fail;
+        }
+        Py_DecRef(tmp_obj);
+    }
+
+    if (!(changes = PyDict_New()))
+        goto fail;
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (!lists[kind][0])
+            continue;
+        tmp_obj = Py_BuildValue("{sNsNsN}",
+                                "added", lists[kind][0],
+                                "changed", lists[kind][1],
+                                "removed", lists[kind][2]);
+        // The lists went to tmp_obj
+        for (i = 0; i < 3; i++)
+            lists[kind][i] = NULL;
+        if (!tmp_obj ||
+            PyDict_SetItemString(changes, m_kind_names[kind], tmp_obj) < 0) {
+            Py_XDECREF(tmp_obj);
+            goto fail;
+        }
+        Py_DecRef(tmp_obj);
+    }
+    if (self->server.generation > since &&
+        PyDict_SetItemString(changes, "server", Py_True) < 0)
+        goto fail;
+
+    return Py_BuildValue("(KN)", (unsigned PY_LONG_LONG) self->generation, changes);
+
+fail:
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        for (i = 0; i < 3; i++)
+            Py_XDECREF(lists[kind][i]);
+    }
+    Py_XDECREF(changes);
+    return NULL;
 }
 
-static PyObject *m_set_output_active_port(DeepinPulseAudioObject *self, 
-                                          PyObject *args) 
+static PyObject *m_set_output_active_port(DeepinPulseAudioObject *self,
+                                          PyObject *args)
 {
     int index = 0;
     char *port = NULL;
-    pa_mainloop *pa_ml = NULL;                                                         
-    pa_mainloop_api *pa_mlapi = NULL;                                                  
-    pa_context *pa_ctx = NULL;                                                         
-    pa_operation *pa_op = NULL;   
-    int state = 0;
-    int pa_ready = 0;
+    pa_context *pa_ctx = NULL;
+    m_write *w = NULL;
+    int ret = 0;
 
     if (!PyArg_ParseTuple(args, "ns", &index, &port)) {
         ERROR("invalid arguments to set_output_active_port");
         return NULL;
     }
-                                                                                
-    pa_ml = pa_mainloop_new();                                                  
-    pa_mlapi = pa_mainloop_get_api(pa_ml);                                      
-    pa_ctx = pa_context_new(pa_mlapi, PACKAGE);                                
-                                                                                
-    pa_context_connect(pa_ctx, NULL, 0, NULL);
-    pa_context_set_state_callback(pa_ctx, m_pa_state_cb, &pa_ready);            
-
-    for (;;) {                                                                  
-        if (pa_ready == 0) {                                                    
-            pa_mainloop_iterate(pa_ml, 1, NULL);                                
-            continue;                                                           
-        }                                                                       
-        if (pa_ready == 2) {                                                    
-            pa_context_disconnect(pa_ctx);                                      
-            pa_context_unref(pa_ctx);                                           
-            pa_mainloop_free(pa_ml);                                            
-            Py_INCREF(Py_False);                                                    
-            return Py_False;                                                    
-        }                                                                       
-        switch (state) {                                                        
-            case 0:
-                pa_op = pa_context_set_sink_port_by_index(pa_ctx, 
-                                                          index, 
-                                                          port, 
-                                                          NULL, 
-                                                          NULL);                                       
-                state++;                                                        
-                break;                                                          
-            case 1:                                                             
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {                    
-                    pa_operation_unref(pa_op);                                  
-                    pa_context_disconnect(pa_ctx);                              
-                    pa_context_unref(pa_ctx);                                   
-                    pa_mainloop_free(pa_ml);                                    
-                    Py_INCREF(Py_True);                                             
-                    return Py_True;                                             
-                }                                                               
-                break;                                                          
-            default:                                                            
-                Py_INCREF(Py_False);                                                
-                return Py_False;                                                
-        }                                                                       
-        pa_mainloop_iterate(pa_ml, 1, NULL);                                    
-    }                                    
-
-    Py_INCREF(Py_False);
-    return Py_False;
-}
-
-static PyObject *m_set_input_active_port(DeepinPulseAudioObject *self,         
-                                         PyObject *args)                       
-{                                                                               
-    int index = 0;                                                              
-    char *port = NULL;                                                          
-    pa_mainloop *pa_ml = NULL;                                                      
-    pa_mainloop_api *pa_mlapi = NULL;                                               
-    pa_context *pa_ctx = NULL;                                                      
-    pa_operation *pa_op = NULL;                                                 
-    int state = 0;                                                              
-    int pa_ready = 0;                                                           
-                                                                                
-    if (!PyArg_ParseTuple(args, "ns", &index, &port)) {                         
-        ERROR("invalid arguments to set_input_active_port");                   
-        return NULL;                                                            
-    }                                                                           
-                                                                                
-    pa_ml = pa_mainloop_new();                                                  
-    pa_mlapi = pa_mainloop_get_api(pa_ml);                                      
-    pa_ctx = pa_context_new(pa_mlapi, PACKAGE);                                
-                                                                                
-    pa_context_connect(pa_ctx, NULL, 0, NULL);                                  
-    pa_context_set_state_callback(pa_ctx, m_pa_state_cb, &pa_ready);            
-                                                                                
-    for (;;) {                                                                  
-        if (pa_ready == 0) {
-            pa_mainloop_iterate(pa_ml, 1, NULL);                                
-            continue;                                                           
-        }                                                                       
-        if (pa_ready == 2) {                                                    
-            pa_context_disconnect(pa_ctx);                                      
-            pa_context_unref(pa_ctx);                                           
-            pa_mainloop_free(pa_ml);                                            
-            Py_INCREF(Py_False);                                                
-            return Py_False;                                                    
-        }                                                                       
-        switch (state) {                                                        
-            case 0:                                                             
-                pa_op = pa_context_set_source_port_by_index(pa_ctx,               
-                                                            index,                
-                                                            port,                 
-                                                            NULL,                 
-                                                            NULL);                
-                state++;                                                        
-                break;                                                          
-            case 1:                                                             
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {       
-                    pa_operation_unref(pa_op);                                  
-                    pa_context_disconnect(pa_ctx);                              
-                    pa_context_unref(pa_ctx);                                   
-                    pa_mainloop_free(pa_ml);                                    
-                    Py_INCREF(Py_True);                                         
-                    return Py_True;                                             
-                }                                                               
-                break;                                                          
-            default:                                                            
-                Py_INCREF(Py_False);                                            
-                return Py_False;                                                
-        }                                                                       
-        pa_mainloop_iterate(pa_ml, 1, NULL);                                    
-    }                                                                           
-                                                                                
-    Py_INCREF(Py_False);                                                        
-    return Py_False;                                                            
+
+    if (!(pa_ctx = m_sync_context(self, &ret))) {
+        RETURN_SYNC(ret);
+    }
+    w = m_write_new(self, M_SINK, index, M_FIELD_ACTIVE_PORT);
+    w->value.name = g_strdup(port);
+    m_store_write(self, w);
+    RETURN_SYNC(m_sync_wait(self, pa_context_set_sink_port_by_index(pa_ctx,
+                                                                    index,
+                                                                    port,
+                                                                    m_write_ack_cb,
+                                                                    w)));
+}
+
+static PyObject *m_set_input_active_port(DeepinPulseAudioObject *self,
+                                         PyObject *args)
+{
+    int index = 0;
+    char *port = NULL;
+    pa_context *pa_ctx = NULL;
+    m_write *w = NULL;
+    int ret = 0;
+
+    if (!PyArg_ParseTuple(args, "ns", &index, &port)) {
+        ERROR("invalid arguments to set_input_active_port");
+        return NULL;
+    }
+
+    if (!(pa_ctx = m_sync_context(self, &ret))) {
+        RETURN_SYNC(ret);
+    }
+    w = m_write_new(self, M_SOURCE, index, M_FIELD_ACTIVE_PORT);
+    w->value.name = g_strdup(port);
+    m_store_write(self, w);
+    RETURN_SYNC(m_sync_wait(self, pa_context_set_source_port_by_index(pa_ctx,
+                                                                      index,
+                                                                      port,
+                                                                      m_write_ack_cb,
+                                                                      w)));
 }
 
-static PyObject *m_set_output_mute(DeepinPulseAudioObject *self, 
-                                   PyObject *args) 
+static PyObject *m_set_output_mute(DeepinPulseAudioObject *self,
+                                   PyObject *args)
 {
     int index = 0;
     PyObject *mute = NULL;
-    pa_mainloop *pa_ml = NULL;                                                         
-    pa_mainloop_api *pa_mlapi = NULL;                                                  
-    pa_context *pa_ctx = NULL;                                                         
-    pa_operation *pa_op = NULL;   
-    int state = 0;
-    int pa_ready = 0;
+    pa_context *pa_ctx = NULL;
+    m_write *w = NULL;
+    int ret = 0;
 
     if (!PyArg_ParseTuple(args, "nO", &index, &mute)) {
         ERROR("invalid arguments to set_output_mute");
         return NULL;
     }
-    
-    if (!PyBool_Check(mute)) {                                                 
-        Py_INCREF(Py_False);                                                    
-        return Py_False;                                                        
-    } 
-                                                                            
-    pa_ml = pa_mainloop_new();                                                  
-    pa_mlapi = pa_mainloop_get_api(pa_ml);                                      
-    pa_ctx = pa_context_new(pa_mlapi, PACKAGE);                                
-                                                                                
-    pa_context_connect(pa_ctx, NULL, 0, NULL);
-    pa_context_set_state_callback(pa_ctx, m_pa_state_cb, &pa_ready);            
-
-    for (;;) {                                                                  
-        if (pa_ready == 0) {                                                    
-            pa_mainloop_iterate(pa_ml, 1, NULL);                                
-            continue;                                                           
-        }                                                                       
-        if (pa_ready == 2) {                                                    
-            pa_context_disconnect(pa_ctx);                                      
-            pa_context_unref(pa_ctx);                                           
-            pa_mainloop_free(pa_ml);                                            
-            Py_INCREF(Py_False);                                                    
-            return Py_False;                                                    
-        }                                                                       
-        switch (state) {                                                        
-            case 0:
-                pa_op = pa_context_set_sink_mute_by_index(pa_ctx, 
-                    index, mute == Py_True ? 1 : 0, NULL, NULL);                                       
-                state++;                                                        
-                break;                                                          
-            case 1:                                                             
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {                    
-                    pa_operation_unref(pa_op);                                  
-                    pa_context_disconnect(pa_ctx);                              
-                    pa_context_unref(pa_ctx);                                   
-                    pa_mainloop_free(pa_ml);                                    
-                    Py_INCREF(Py_True);                                             
-                    return Py_True;                                             
-                }                                                               
-                break;                                                          
-            default:                                                            
-                Py_INCREF(Py_False);                                                
-                return Py_False;                                                
-        }                                                                       
-        pa_mainloop_iterate(pa_ml, 1, NULL);                                    
-    }                                    
-
-    Py_INCREF(Py_False);
-    return Py_False;
-}
-
-static PyObject *m_set_input_mute(DeepinPulseAudioObject *self, 
-                                  PyObject *args) 
+
+    if (!PyBool_Check(mute)) {
+        Py_INCREF(Py_False);
+        return Py_False;
+    }
+
+    if (!(pa_ctx = m_sync_context(self, &ret))) {
+        RETURN_SYNC(ret);
+    }
+    w = m_write_new(self, M_SINK, index, M_FIELD_MUTE);
+    w->value.mute = mute == Py_True ? 1 : 0;
+    m_store_write(self, w);
+    RETURN_SYNC(m_sync_wait(self, pa_context_set_sink_mute_by_index(pa_ctx,
+                           index, w->value.mute, m_write_ack_cb, w)));
+}
+
+static PyObject *m_set_input_mute(DeepinPulseAudioObject *self,
+                                  PyObject *args)
 {
     int index = 0;
     PyObject *mute = NULL;
-    pa_mainloop *pa_ml = NULL;                                                         
-    pa_mainloop_api *pa_mlapi = NULL;                                                  
-    pa_context *pa_ctx = NULL;                                                         
-    pa_operation *pa_op = NULL;   
-    int state = 0;
-    int pa_ready = 0;
+    pa_context *pa_ctx = NULL;
+    m_write *w = NULL;
+    int ret = 0;
 
     if (!PyArg_ParseTuple(args, "nO", &index, &mute)) {
         ERROR("invalid arguments to set_input_mute");
         return NULL;
     }
-    
-    if (!PyBool_Check(mute)) {                                                 
-        Py_INCREF(Py_False);                                                    
-        return Py_False;                                                        
+
+    if (!PyBool_Check(mute)) {
+        Py_INCREF(Py_False);
+        return Py_False;
     }
 
-    pa_ml = pa_mainloop_new();                                                  
-    pa_mlapi = pa_mainloop_get_api(pa_ml);                                      
-    pa_ctx = pa_context_new(pa_mlapi, PACKAGE);                                
-                                                                                
-    pa_context_connect(pa_ctx, NULL, 0, NULL);
-    pa_context_set_state_callback(pa_ctx, m_pa_state_cb, &pa_ready);            
-
-    for (;;) {                                                                  
-        if (pa_ready == 0) {                                                    
-            pa_mainloop_iterate(pa_ml, 1, NULL);                                
-            continue;                                                           
-        }                                                                       
-        if (pa_ready == 2) {                                                    
-            pa_context_disconnect(pa_ctx);                                      
-            pa_context_unref(pa_ctx);                                           
-            pa_mainloop_free(pa_ml);                                            
-            Py_INCREF(Py_False);                                                    
-            return Py_False;                                                    
-        }                                                                       
-        switch (state) {                                                        
-            case 0:
-                pa_op = pa_context_set_source_mute_by_index(pa_ctx, 
-                    index, mute == Py_True ? 1 : 0, NULL, NULL);                                       
-                state++;                                                        
-                break;                                                          
-            case 1:                                                             
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {                    
-                    pa_operation_unref(pa_op);                                  
-                    pa_context_disconnect(pa_ctx);                              
-                    pa_context_unref(pa_ctx);                                   
-                    pa_mainloop_free(pa_ml);                                    
-                    Py_INCREF(Py_True);                                             
-                    return Py_True;                                             
-                }                                                               
-                break;                                                          
-            default:                                                            
-                Py_INCREF(Py_False);                                                
-                return Py_False;                                                
-        }                                                                       
-        pa_mainloop_iterate(pa_ml, 1, NULL);                                    
-    }                                    
-
-    Py_INCREF(Py_False);
-    return Py_False;
-}
-
-static PyObject *m_set_output_volume(DeepinPulseAudioObject *self, 
-                                     PyObject *args) 
+    if (!(pa_ctx = m_sync_context(self, &ret))) {
+        RETURN_SYNC(ret);
+    }
+    w = m_write_new(self, M_SOURCE, index, M_FIELD_MUTE);
+    w->value.mute = mute == Py_True ? 1 : 0;
+    m_store_write(self, w);
+    RETURN_SYNC(m_sync_wait(self, pa_context_set_source_mute_by_index(pa_ctx,
+                           index, w->value.mute, m_write_ack_cb, w)));
+}
+
+static PyObject *m_set_output_volume(DeepinPulseAudioObject *self,
+                                     PyObject *args)
 {
     int index = -1;
     PyObject *volume = NULL;
-    pa_mainloop *pa_ml = NULL;
-    pa_mainloop_api *pa_mlapi = NULL;
     pa_context *pa_ctx = NULL;
-    pa_operation *pa_op = NULL;
+    m_write *w = NULL;
+    int ret = 0;
     pa_cvolume output_volume;
-    int state = 0;
-    int pa_ready = 0;
     int channel_num = 1, i;
+    m_entry *e = NULL;
     Py_ssize_t tuple_size = 0;
 
     if (!PyArg_ParseTuple(args, "nO", &index, &volume)) {
@@ -1617,25 +3904,14 @@ static PyObject *m_set_output_volume(DeepinPulseAudioObject *self,
         return Py_False;
     }
 
-    if (!PyDict_Contains(self->output_devices, INT(index))) {
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
-    if (!PyDict_Contains(self->output_channels, INT(index))) {
+    if (!(e = m_store_lookup(self, M_SINK, index))) {
         Py_INCREF(Py_False);
         return Py_False;
     }
-    channel_num = PyInt_AsLong(PyDict_GetItemString(PyDict_GetItem(
-                                    self->output_channels, INT(index)), "channels"));
-
-    pa_ml = pa_mainloop_new();
-    pa_mlapi = pa_mainloop_get_api(pa_ml);
-    pa_ctx = pa_context_new(pa_mlapi, PACKAGE);
+    channel_num = e->channel_map.channels;
 
-    pa_context_connect(pa_ctx, NULL, 0, NULL);
-    pa_context_set_state_callback(pa_ctx, m_pa_state_cb, &pa_ready);
     memset(&output_volume, 0, sizeof(pa_cvolume));
-    
+
     tuple_size = PyTuple_Size(volume);
     output_volume.channels = channel_num;
     if (tuple_size > channel_num) {
@@ -1645,46 +3921,17 @@ static PyObject *m_set_output_volume(DeepinPulseAudioObject *self,
             output_volume.values[i] = PyInt_AsLong(PyTuple_GetItem(volume, i));
     }
 
-    for (;;) {
-        if (pa_ready == 0) {
-            pa_mainloop_iterate(pa_ml, 1, NULL);
-            continue;
-        }
-        if (pa_ready == 2) {
-            pa_context_disconnect(pa_ctx);
-            pa_context_unref(pa_ctx);
-            pa_mainloop_free(pa_ml);
-            Py_INCREF(Py_False);
-            return Py_False;
-        }
-        switch (state) {
-            case 0:
-                pa_op = pa_context_set_sink_volume_by_index(pa_ctx,
-                                                            index,
-                                                            &output_volume,
-                                                            NULL,
-                                                            NULL);
-                state++;
-                break;
-            case 1:
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {
-                    pa_operation_unref(pa_op);
-                    pa_context_disconnect(pa_ctx);
-                    pa_context_unref(pa_ctx);
-                    pa_mainloop_free(pa_ml);
-                    Py_INCREF(Py_True);
-                    return Py_True;
-                }
-                break;
-            default:
-                Py_INCREF(Py_False);
-                return Py_False;
-        }
-        pa_mainloop_iterate(pa_ml, 1, NULL);
+    if (!(pa_ctx = m_sync_context(self, &ret))) {
+        RETURN_SYNC(ret);
     }
-    
-    Py_INCREF(Py_True);
-    return Py_True;
+    w = m_write_new(self, M_SINK, index, M_FIELD_VOLUME);
+    w->value.volume = output_volume;
+    m_store_write(self, w);
+    RETURN_SYNC(m_sync_wait(self, pa_context_set_sink_volume_by_index(pa_ctx,
+                                                                      index,
+                                                                      &output_volume,
+                                                                      m_write_ack_cb,
+                                                                      w)));
 }
 
 static PyObject *m_set_output_volume_with_balance(DeepinPulseAudioObject *self,
@@ -1693,112 +3940,56 @@ static PyObject *m_set_output_volume_with_balance(DeepinPulseAudioObject *self,
     int index = -1;
     long int volume;
     float balance;
-    pa_mainloop *pa_ml = NULL;
-    pa_mainloop_api *pa_mlapi = NULL;
     pa_context *pa_ctx = NULL;
-    pa_operation *pa_op = NULL;
+    m_write *w = NULL;
+    int ret = 0;
     pa_cvolume output_volume;
     pa_channel_map output_channel_map;
-    int state = 0;
-    int pa_ready = 0;
-    int channel_num = 1, i;
-
-    PyObject *channel_map_list = NULL;
+    int channel_num = 1;
+    m_entry *e = NULL;
 
     if (!PyArg_ParseTuple(args, "nlf", &index, &volume, &balance)) {
         ERROR("invalid arguments to set_output_volume");
         return NULL;
     }
 
-    if (!PyDict_Contains(self->output_devices, INT(index))) {
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
-    if (!PyDict_Contains(self->output_channels, INT(index))) {
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
-    channel_num = PyInt_AsLong(PyDict_GetItemString(PyDict_GetItem(
-                                    self->output_channels, INT(index)), "channels"));
-    channel_map_list = PyDict_GetItemString(PyDict_GetItem(
-                                    self->output_channels, INT(index)), "map");
-    if (!channel_map_list) {
+    if (!(e = m_store_lookup(self, M_SINK, index))) {
         Py_INCREF(Py_False);
         return Py_False;
     }
+    channel_num = e->channel_map.channels;
+    output_channel_map = e->channel_map;
 
-    pa_ml = pa_mainloop_new();
-    pa_mlapi = pa_mainloop_get_api(pa_ml);
-    pa_ctx = pa_context_new(pa_mlapi, PACKAGE);
-
-    pa_context_connect(pa_ctx, NULL, 0, NULL);
-    pa_context_set_state_callback(pa_ctx, m_pa_state_cb, &pa_ready);
     memset(&output_volume, 0, sizeof(pa_cvolume));
-    memset(&output_channel_map, 0, sizeof(pa_channel_map));
 
     pa_cvolume_set(&output_volume, channel_num, volume);
-    output_channel_map.channels = channel_num;
-    for (i = 0; i < PyList_Size(channel_map_list); i++) {
-        output_channel_map.map[i] = PyInt_AsLong(PyList_GetItem(channel_map_list, i));
-    }
     // set balance
     pa_cvolume_set_balance(&output_volume, &output_channel_map, balance);
 
-    for (;;) {
-        if (pa_ready == 0) {
-            pa_mainloop_iterate(pa_ml, 1, NULL);
-            continue;
-        }
-        if (pa_ready == 2) {
-            pa_context_disconnect(pa_ctx);
-            pa_context_unref(pa_ctx);
-            pa_mainloop_free(pa_ml);
-            Py_INCREF(Py_False);
-            return Py_False;
-        }
-        switch (state) {
-            case 0:
-                pa_op = pa_context_set_sink_volume_by_index(pa_ctx,
-                                                            index,
-                                                            &output_volume,
-                                                            NULL,
-                                                            NULL);
-                state++;
-                break;
-            case 1:
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {
-                    pa_operation_unref(pa_op);
-                    pa_context_disconnect(pa_ctx);
-                    pa_context_unref(pa_ctx);
-                    pa_mainloop_free(pa_ml);
-                    Py_INCREF(Py_True);
-                    return Py_True;
-                }
-                break;
-            default:
-                Py_INCREF(Py_False);
-                return Py_False;
-        }
-        pa_mainloop_iterate(pa_ml, 1, NULL);
-    }
-
-    Py_INCREF(Py_True);
-    return Py_True;
+    if (!(pa_ctx = m_sync_context(self, &ret))) {
+        RETURN_SYNC(ret);
+    }
+    w = m_write_new(self, M_SINK, index, M_FIELD_VOLUME);
+    w->value.volume = output_volume;
+    m_store_write(self, w);
+    RETURN_SYNC(m_sync_wait(self, pa_context_set_sink_volume_by_index(pa_ctx,
+                                                                      index,
+                                                                      &output_volume,
+                                                                      m_write_ack_cb,
+                                                                      w)));
 }
 
-static PyObject *m_set_input_volume(DeepinPulseAudioObject *self, 
-                                    PyObject *args) 
+static PyObject *m_set_input_volume(DeepinPulseAudioObject *self,
+                                    PyObject *args)
 {
     int index = 0;
     PyObject *volume = NULL;
-    pa_mainloop *pa_ml = NULL;
-    pa_mainloop_api *pa_mlapi = NULL;
     pa_context *pa_ctx = NULL;
-    pa_operation *pa_op = NULL;
+    m_write *w = NULL;
+    int ret = 0;
     pa_cvolume pa_input_volume;
-    int state = 0;
-    int pa_ready = 0;
     int channel_num = 1, i;
+    m_entry *e = NULL;
     Py_ssize_t tuple_size = 0;
 
     if (!PyArg_ParseTuple(args, "nO", &index, &volume)) {
@@ -1814,23 +4005,12 @@ static PyObject *m_set_input_volume(DeepinPulseAudioObject *self,
         return Py_False;
     }
 
-    if (!PyDict_Contains(self->input_devices, INT(index))) {
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
-    if (!PyDict_Contains(self->input_channels, INT(index))) {
+    if (!(e = m_store_lookup(self, M_SOURCE, index))) {
         Py_INCREF(Py_False);
         return Py_False;
     }
-    channel_num = PyInt_AsLong(PyDict_GetItemString(PyDict_GetItem(
-                                    self->input_channels, INT(index)), "channels"));
+    channel_num = e->channel_map.channels;
 
-    pa_ml = pa_mainloop_new();
-    pa_mlapi = pa_mainloop_get_api(pa_ml);
-    pa_ctx = pa_context_new(pa_mlapi, PACKAGE);
-
-    pa_context_connect(pa_ctx, NULL, 0, NULL);
-    pa_context_set_state_callback(pa_ctx, m_pa_state_cb, &pa_ready);
     memset(&pa_input_volume, 0, sizeof(pa_cvolume));
 
     tuple_size = PyTuple_Size(volume);
@@ -1842,46 +4022,17 @@ static PyObject *m_set_input_volume(DeepinPulseAudioObject *self,
         pa_input_volume.values[i] = PyInt_AsLong(PyTuple_GetItem(volume, i));
     }
 
-    for (;;) {
-        if (pa_ready == 0) {
-            pa_mainloop_iterate(pa_ml, 1, NULL);
-            continue;
-        }
-        if (pa_ready == 2) {
-            pa_context_disconnect(pa_ctx);
-            pa_context_unref(pa_ctx);
-            pa_mainloop_free(pa_ml);
-            Py_INCREF(Py_False);
-            return Py_False;
-        }
-        switch (state) {
-            case 0:
-                pa_op = pa_context_set_source_volume_by_index(pa_ctx,
-                                                              index,
-                                                              &pa_input_volume,
-                                                              NULL,
-                                                              NULL);
-                state++;
-                break;
-            case 1:
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {
-                    pa_operation_unref(pa_op);
-                    pa_context_disconnect(pa_ctx);
-                    pa_context_unref(pa_ctx);
-                    pa_mainloop_free(pa_ml);
-                    Py_INCREF(Py_True);
-                    return Py_True;
-                }
-                break;
-            default:
-                Py_INCREF(Py_False);
-                return Py_False;
-        }
-        pa_mainloop_iterate(pa_ml, 1, NULL);
+    if (!(pa_ctx = m_sync_context(self, &ret))) {
+        RETURN_SYNC(ret);
     }
-                                                                                
-    Py_INCREF(Py_True);
-    return Py_True;
+    w = m_write_new(self, M_SOURCE, index, M_FIELD_VOLUME);
+    w->value.volume = pa_input_volume;
+    m_store_write(self, w);
+    RETURN_SYNC(m_sync_wait(self, pa_context_set_source_volume_by_index(pa_ctx,
+                                                                        index,
+                                                                        &pa_input_volume,
+                                                                        m_write_ack_cb,
+                                                                        w)));
 }
 
 static PyObject *m_set_input_volume_with_balance(DeepinPulseAudioObject *self,
@@ -1890,164 +4041,72 @@ static PyObject *m_set_input_volume_with_balance(DeepinPulseAudioObject *self,
     int index = -1;
     long int volume;
     float balance;
-    pa_mainloop *pa_ml = NULL;
-    pa_mainloop_api *pa_mlapi = NULL;
     pa_context *pa_ctx = NULL;
-    pa_operation *pa_op = NULL;
+    m_write *w = NULL;
+    int ret = 0;
     pa_cvolume input_volume;
     pa_channel_map input_channel_map;
-    int state = 0;
-    int pa_ready = 0;
-    int channel_num = 1, i;
-
-    PyObject *channel_map_list = NULL;
+    int channel_num = 1;
+    m_entry *e = NULL;
 
     if (!PyArg_ParseTuple(args, "nlf", &index, &volume, &balance)) {
         ERROR("invalid arguments to set_output_volume");
         return NULL;
     }
 
-    if (!PyDict_Contains(self->input_devices, INT(index))) {
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
-    if (!PyDict_Contains(self->input_channels, INT(index))) {
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
-    channel_num = PyInt_AsLong(PyDict_GetItemString(PyDict_GetItem(
-                                    self->input_channels, INT(index)), "channels"));
-    channel_map_list = PyDict_GetItemString(PyDict_GetItem(
-                                    self->input_channels, INT(index)), "map");
-    if (!channel_map_list) {
+    if (!(e = m_store_lookup(self, M_SOURCE, index))) {
         Py_INCREF(Py_False);
         return Py_False;
     }
+    channel_num = e->channel_map.channels;
+    input_channel_map = e->channel_map;
 
-    pa_ml = pa_mainloop_new();
-    pa_mlapi = pa_mainloop_get_api(pa_ml);
-    pa_ctx = pa_context_new(pa_mlapi, PACKAGE);
-
-    pa_context_connect(pa_ctx, NULL, 0, NULL);
-    pa_context_set_state_callback(pa_ctx, m_pa_state_cb, &pa_ready);
     memset(&input_volume, 0, sizeof(pa_cvolume));
-    memset(&input_channel_map, 0, sizeof(pa_channel_map));
 
     pa_cvolume_set(&input_volume, channel_num, volume);
-    input_channel_map.channels = channel_num;
-    for (i = 0; i < PyList_Size(channel_map_list); i++) {
-        input_channel_map.map[i] = PyInt_AsLong(PyList_GetItem(channel_map_list, i));
-    }
     // set balance
     pa_cvolume_set_balance(&input_volume, &input_channel_map, balance);
 
-    for (;;) {
-        if (pa_ready == 0) {
-            pa_mainloop_iterate(pa_ml, 1, NULL);
-            continue;
-        }
-        if (pa_ready == 2) {
-            pa_context_disconnect(pa_ctx);
-            pa_context_unref(pa_ctx);
-            pa_mainloop_free(pa_ml);
-            Py_INCREF(Py_False);
-            return Py_False;
-        }
-        switch (state) {
-            case 0:
-                pa_op = pa_context_set_source_volume_by_index(pa_ctx,
-                                                              index,
-                                                              &input_volume,
-                                                              NULL,
-                                                              NULL);
-                state++;
-                break;
-            case 1:
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {
-                    pa_operation_unref(pa_op);
-                    pa_context_disconnect(pa_ctx);
-                    pa_context_unref(pa_ctx);
-                    pa_mainloop_free(pa_ml);
-                    Py_INCREF(Py_True);
-                    return Py_True;
-                }
-                break;
-            default:
-                Py_INCREF(Py_False);
-                return Py_False;
-        }
-        pa_mainloop_iterate(pa_ml, 1, NULL);
-    }
-
-    Py_INCREF(Py_True);
-    return Py_True;
+    if (!(pa_ctx = m_sync_context(self, &ret))) {
+        RETURN_SYNC(ret);
+    }
+    w = m_write_new(self, M_SOURCE, index, M_FIELD_VOLUME);
+    w->value.volume = input_volume;
+    m_store_write(self, w);
+    RETURN_SYNC(m_sync_wait(self, pa_context_set_source_volume_by_index(pa_ctx,
+                                                                        index,
+                                                                        &input_volume,
+                                                                        m_write_ack_cb,
+                                                                        w)));
 }
 
 static PyObject *m_set_sink_input_mute(DeepinPulseAudioObject *self,
                                        PyObject *args)
 {
-    pa_mainloop *pa_ml = NULL;
-    pa_mainloop_api *pa_mlapi = NULL;
     pa_context *pa_ctx = NULL;
-    pa_operation *pa_op = NULL;
+    m_write *w = NULL;
+    int ret = 0;
     int index = 0;
     PyObject *mute = NULL;
-    int pa_ready = 0;
-    int state = 0;
 
     if (!PyArg_ParseTuple(args, "nO", &index, &mute)) {
         ERROR("invalid arguments to set_sink_input_mute");
         return NULL;
     }
 
-    if (!PyBool_Check(mute)) {                                                 
-        Py_INCREF(Py_False);                                                    
-        return Py_False;                                                        
+    if (!PyBool_Check(mute)) {
+        Py_INCREF(Py_False);
+        return Py_False;
     }
 
-    pa_ml = pa_mainloop_new();
-    pa_mlapi = pa_mainloop_get_api(pa_ml);
-    pa_ctx = pa_context_new(pa_mlapi, PACKAGE);
-
-    pa_context_connect(pa_ctx, NULL, 0, NULL);
-    pa_context_set_state_callback(pa_ctx, m_pa_state_cb, &pa_ready);
-
-    for (;;) {
-        if (pa_ready == 0) {
-            pa_mainloop_iterate(pa_ml, 1, NULL);
-            continue;
-        }
-        if (pa_ready == 2) {
-            pa_context_disconnect(pa_ctx);
-            pa_context_unref(pa_ctx);
-            pa_mainloop_free(pa_ml);
-            Py_INCREF(Py_False);
-            return Py_False;
-        }
-        switch (state) {
-            case 0:
-                pa_op = pa_context_set_sink_input_mute(pa_ctx, 
-                    index, mute == Py_True ? 1 : 0, NULL, NULL);                                       
-                state++;
-                break;
-            case 1:
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {
-                    pa_operation_unref(pa_op);
-                    pa_context_disconnect(pa_ctx);
-                    pa_context_unref(pa_ctx);
-                    pa_mainloop_free(pa_ml);
-                    Py_INCREF(Py_True);
-                    return Py_True;
-                }
-                break;
-            default:
-                Py_INCREF(Py_False);
-                return Py_False;
-        }
-        pa_mainloop_iterate(pa_ml, 1, NULL);
+    if (!(pa_ctx = m_sync_context(self, &ret))) {
+        RETURN_SYNC(ret);
     }
-    Py_INCREF(Py_True);
-    return Py_True;
+    w = m_write_new(self, M_SINK_INPUT, index, M_FIELD_MUTE);
+    w->value.mute = mute == Py_True ? 1 : 0;
+    m_store_write(self, w);
+    RETURN_SYNC(m_sync_wait(self, pa_context_set_sink_input_mute(pa_ctx,
+                           index, w->value.mute, m_write_ack_cb, w)));
 }
 
 static PyObject *m_set_sink_input_volume(DeepinPulseAudioObject *self,
@@ -2055,14 +4114,12 @@ static PyObject *m_set_sink_input_volume(DeepinPulseAudioObject *self,
 {
     int index = 0;
     PyObject *volume = NULL;
-    pa_mainloop *pa_ml = NULL;
-    pa_mainloop_api *pa_mlapi = NULL;
     pa_context *pa_ctx = NULL;
-    pa_operation *pa_op = NULL;
+    m_write *w = NULL;
+    int ret = 0;
     pa_cvolume pa_sink_input_volume;
-    int state = 0;
-    int pa_ready = 0;
     int channel_num = 1, i;
+    m_entry *e = NULL;
     Py_ssize_t tuple_size = 0;
 
     if (!PyArg_ParseTuple(args, "nO", &index, &volume)) {
@@ -2078,19 +4135,12 @@ static PyObject *m_set_sink_input_volume(DeepinPulseAudioObject *self,
         return Py_False;
     }
 
-    if (!PyDict_Contains(self->playback_streams, INT(index))) {
+    if (!(e = m_store_lookup(self, M_SINK_INPUT, index))) {
         Py_INCREF(Py_False);
         return Py_False;
     }
-    channel_num = PyList_Size(PyDict_GetItemString(PyDict_GetItem(
-                                self->playback_streams, INT(index)), "channel"));
-
-    pa_ml = pa_mainloop_new();
-    pa_mlapi = pa_mainloop_get_api(pa_ml);
-    pa_ctx = pa_context_new(pa_mlapi, PACKAGE);
+    channel_num = e->channel_map.channels;
 
-    pa_context_connect(pa_ctx, NULL, 0, NULL);
-    pa_context_set_state_callback(pa_ctx, m_pa_state_cb, &pa_ready);
     memset(&pa_sink_input_volume, 0, sizeof(pa_cvolume));
 
     tuple_size = PyTuple_Size(volume);
@@ -2102,682 +4152,372 @@ static PyObject *m_set_sink_input_volume(DeepinPulseAudioObject *self,
         pa_sink_input_volume.values[i] = PyInt_AsLong(PyTuple_GetItem(volume, i));
     }
 
-    for (;;) {
-        if (pa_ready == 0) {
-            pa_mainloop_iterate(pa_ml, 1, NULL);
-            continue;
-        }
-        if (pa_ready == 2) {
-            pa_context_disconnect(pa_ctx);
-            pa_context_unref(pa_ctx);
-            pa_mainloop_free(pa_ml);
-            Py_INCREF(Py_False);
-            return Py_False;
-        }
-        switch (state) {
-            case 0:
-                pa_op = pa_context_set_sink_input_volume(pa_ctx,
-                                                         index,
-                                                         &pa_sink_input_volume,
-                                                         NULL,
-                                                         NULL);
-                state++;
-                break;
-            case 1:
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {
-                    pa_operation_unref(pa_op);
-                    pa_context_disconnect(pa_ctx);
-                    pa_context_unref(pa_ctx);
-                    pa_mainloop_free(pa_ml);
-                    Py_INCREF(Py_True);
-                    return Py_True;
-                }
-                break;
-            default:
-                Py_INCREF(Py_False);
-                return Py_False;
-        }
-        pa_mainloop_iterate(pa_ml, 1, NULL);
+    if (!(pa_ctx = m_sync_context(self, &ret))) {
+        RETURN_SYNC(ret);
     }
-                                                                                
-    Py_INCREF(Py_True);
-    return Py_True;
+    w = m_write_new(self, M_SINK_INPUT, index, M_FIELD_VOLUME);
+    w->value.volume = pa_sink_input_volume;
+    m_store_write(self, w);
+    RETURN_SYNC(m_sync_wait(self, pa_context_set_sink_input_volume(pa_ctx,
+                                                                   index,
+                                                                   &pa_sink_input_volume,
+                                                                   m_write_ack_cb,
+                                                                   w)));
 }
 
 static PyObject *m_set_fallback_sink(DeepinPulseAudioObject *self,
                                      PyObject *args)
 {
-    pa_mainloop *pa_ml = NULL;
-    pa_mainloop_api *pa_mlapi = NULL;
     pa_context *pa_ctx = NULL;
-    pa_operation *pa_op = NULL;
+    m_write *w = NULL;
+    int ret = 0;
     char *name = NULL;
-    int pa_ready = 0;
-    int state = 0;
 
     if (!PyArg_ParseTuple(args, "s", &name)) {
         ERROR("invalid arguments to set_fallback_sink");
         return NULL;
     }
 
-    pa_ml = pa_mainloop_new();
-    pa_mlapi = pa_mainloop_get_api(pa_ml);
-    pa_ctx = pa_context_new(pa_mlapi, PACKAGE);
-
-    pa_context_connect(pa_ctx, NULL, 0, NULL);
-    pa_context_set_state_callback(pa_ctx, m_pa_state_cb, &pa_ready);
-
-    for (;;) {
-        if (pa_ready == 0) {
-            pa_mainloop_iterate(pa_ml, 1, NULL);
-            continue;
-        }
-        if (pa_ready == 2) {
-            pa_context_disconnect(pa_ctx);
-            pa_context_unref(pa_ctx);
-            pa_mainloop_free(pa_ml);
-            Py_INCREF(Py_False);
-            return Py_False;
-        }
-        switch (state) {
-            case 0:
-                pa_op = pa_context_set_default_sink(pa_ctx, name, NULL, NULL);
-                state++;
-                break;
-            case 1:
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {
-                    pa_operation_unref(pa_op);
-                    pa_context_disconnect(pa_ctx);
-                    pa_context_unref(pa_ctx);
-                    pa_mainloop_free(pa_ml);
-                    Py_INCREF(Py_True);
-                    return Py_True;
-                }
-                break;
-            default:
-                Py_INCREF(Py_False);
-                return Py_False;
-        }
-        pa_mainloop_iterate(pa_ml, 1, NULL);
+    if (!(pa_ctx = m_sync_context(self, &ret))) {
+        RETURN_SYNC(ret);
     }
-    Py_INCREF(Py_True);
-    return Py_True;
+    w = m_write_new(self, M_KIND_COUNT, 0, M_FIELD_FALLBACK_SINK);
+    w->value.name = g_strdup(name);
+    m_store_write(self, w);
+    RETURN_SYNC(m_sync_wait(self, pa_context_set_default_sink(pa_ctx, name, m_write_ack_cb, w)));
 }
 
 static PyObject *m_set_fallback_source(DeepinPulseAudioObject *self,
                                        PyObject *args)
 {
-    pa_mainloop *pa_ml = NULL;
-    pa_mainloop_api *pa_mlapi = NULL;
     pa_context *pa_ctx = NULL;
-    pa_operation *pa_op = NULL;
+    m_write *w = NULL;
+    int ret = 0;
     char *name = NULL;
-    int pa_ready = 0;
-    int state = 0;
 
     if (!PyArg_ParseTuple(args, "s", &name)) {
         ERROR("invalid arguments to set_fallback_source");
         return NULL;
     }
 
-    pa_ml = pa_mainloop_new();
-    pa_mlapi = pa_mainloop_get_api(pa_ml);
-    pa_ctx = pa_context_new(pa_mlapi, PACKAGE);
-
-    pa_context_connect(pa_ctx, NULL, 0, NULL);
-    pa_context_set_state_callback(pa_ctx, m_pa_state_cb, &pa_ready);
-
-    for (;;) {
-        if (pa_ready == 0) {
-            pa_mainloop_iterate(pa_ml, 1, NULL);
-            continue;
-        }
-        if (pa_ready == 2) {
-            pa_context_disconnect(pa_ctx);
-            pa_context_unref(pa_ctx);
-            pa_mainloop_free(pa_ml);
-            Py_INCREF(Py_False);
-            return Py_False;
-        }
-        switch (state) {
-            case 0:
-                pa_op = pa_context_set_default_source(pa_ctx, name, NULL, NULL);
-                state++;
-                break;
-            case 1:
-                if (pa_operation_get_state(pa_op) == PA_OPERATION_DONE) {
-                    pa_operation_unref(pa_op);
-                    pa_context_disconnect(pa_ctx);
-                    pa_context_unref(pa_ctx);
-                    pa_mainloop_free(pa_ml);
-                    Py_INCREF(Py_True);
-                    return Py_True;
-                }
-                break;
-            default:
-                Py_INCREF(Py_False);
-                return Py_False;
-        }
-        pa_mainloop_iterate(pa_ml, 1, NULL);
+    if (!(pa_ctx = m_sync_context(self, &ret))) {
+        RETURN_SYNC(ret);
     }
-    Py_INCREF(Py_True);
-    return Py_True;
+    w = m_write_new(self, M_KIND_COUNT, 0, M_FIELD_FALLBACK_SOURCE);
+    w->value.name = g_strdup(name);
+    m_store_write(self, w);
+    RETURN_SYNC(m_sync_wait(self, pa_context_set_default_source(pa_ctx, name, m_write_ack_cb, w)));
 }
 
-static void m_pa_server_info_cb(pa_context *c, 
-                                const pa_server_info *i, 
-                                void *userdata)
+/* Setters that may appear in an apply_batch() operation list */
+static const char *m_batch_methods[] = 
 {
-    if (!c || !i || !userdata) 
-        return;
-    
-    DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
-    PyObject *tmp_obj = NULL;
-    
-    tmp_obj = STRING(i->user_name);
-    PyDict_SetItemString(self->server_info, "user_name", tmp_obj);
-    Py_DecRef(tmp_obj);
-
-    tmp_obj = STRING(i->host_name);
-    PyDict_SetItemString(self->server_info, "host_name", tmp_obj);
-    Py_DecRef(tmp_obj);
-
-    tmp_obj = STRING(i->server_version);
-    PyDict_SetItemString(self->server_info, "server_version", tmp_obj);
-    Py_DecRef(tmp_obj);
-
-    tmp_obj = STRING(i->server_name);
-    PyDict_SetItemString(self->server_info, "server_name", tmp_obj);
-    Py_DecRef(tmp_obj);
-
-    tmp_obj = STRING(i->default_sink_name);
-    PyDict_SetItemString(self->server_info, "fallback_sink", tmp_obj);
-    Py_DecRef(tmp_obj);
-
-    tmp_obj = STRING(i->default_source_name);
-    PyDict_SetItemString(self->server_info, "fallback_source", tmp_obj);
-    Py_DecRef(tmp_obj);
-
-    tmp_obj = INT(i->cookie);
-    PyDict_SetItemString(self->server_info, "cookie", tmp_obj);
-    Py_DecRef(tmp_obj);
-}
+    "set_output_active_port", 
+    "set_input_active_port", 
+    "set_output_mute", 
+    "set_input_mute", 
+    "set_output_volume", 
+    "set_output_volume_with_balance", 
+    "set_input_volume", 
+    "set_input_volume_with_balance", 
+    "set_sink_input_mute", 
+    "set_sink_input_volume", 
+    "set_fallback_sink", 
+    "set_fallback_source", 
+    NULL
+};
 
-static void m_pa_cardlist_cb(pa_context *c,
-                             const pa_card_info *i,
-                             int eol,
-                             void *userdata)
+/* The setter called name, taken from the type's method table so that no
+ * attribute set on the instance runs while the batch holds sync_lock.
+ * NULL when name is not a batch setter. */
+static PyCFunction m_batch_method(PyObject *name)
 {
-    if (!c || !i || eol > 0 || !userdata) 
-        return;
-
-    DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
-
-    PyObject *card_dict = NULL;         // a dict save the card info
-    PyObject *profile_list = NULL;      // card_profile_info list
-    PyObject *profile_dict = NULL;
-    PyObject *port_list = NULL;         // card_port_info
-    PyObject *port_dict = NULL;
-    PyObject *active_profile = NULL;
-    PyObject *prop_dict = NULL;
-    PyObject *key = NULL;
-
-    int ctr = 0;
-    const char *prop_key;
-    void *prop_state = NULL;
-    PyObject *tmp_obj = NULL;
+    PyMethodDef *m = NULL;
+    int i;
 
-    card_dict = PyDict_New();
-    if (!card_dict) {
-        ERROR("PyDict_New error");
-        return;
+    if (!PyString_Check(name))
+        return NULL;
+    for (i = 0; m_batch_methods[i]; i++) {
+        if (strcmp(PyString_AsString(name), m_batch_methods[i]) == 0)
+            break;
     }
-
-    active_profile = PyDict_New();
-    if (!active_profile) {
-        ERROR("PyDict_New error");
-        return;
+    if (!m_batch_methods[i])
+        return NULL;
+    for (m = deepin_pulseaudio_object_methods; m->ml_name; m++) {
+        if (strcmp(m->ml_name, m_batch_methods[i]) == 0)
+            return m->ml_meth;
     }
+    return NULL;
+}
 
-    prop_dict = PyDict_New();
-    if (!prop_dict) {
-        ERROR("PyDict_New error");
-        return;
+/* apply_batch([("set_output_volume", index, volume), ...]) runs every
+ * setter in issue-only mode so all operations are sent back to back on the
+ * shared context, then waits once for all of them. Returns a list with
+ * True, False or None (timed out) for each operation; one whose setter
+ * raised, e.g. on bad arguments, sent nothing and is False. */
+static PyObject *m_apply_batch(DeepinPulseAudioObject *self, 
+                               PyObject *args)
+{
+    PyObject *ops = NULL;
+    PyObject *item = NULL;
+    PyCFunction method = NULL;
+    PyObject *method_args = NULL;
+    PyObject *method_ret = NULL;
+    PyObject *results = NULL;
+    PyObject *result = NULL;
+    pa_operation **pa_ops = NULL;
+    int *first = NULL;      // first queued operation of every item
+    int *count = NULL;      // number of operations it queued
+    Py_ssize_t n = 0, issued = 0, i;
+    int ret = 0, expired = 0, failed = 0, done, j;
+
+    if (!PyArg_ParseTuple(args, "O!", &PyList_Type, &ops)) {
+        ERROR("invalid arguments to apply_batch");
+        return NULL;
     }
 
-    profile_list = PyList_New(0);
-    if (!profile_list) {
-        ERROR("PyList_New error");
-        return;
-    }
-    port_list = PyList_New(0);
-    if (!port_list) {
-        ERROR("PyList_New error");
-        return;
+    n = PyList_Size(ops);
+    for (i = 0; i < n; i++) {
+        item = PyList_GetItem(ops, i);
+        if (!PyTuple_Check(item) || PyTuple_Size(item) < 1 || 
+            !m_batch_method(PyTuple_GetItem(item, 0))) {
+            ERROR("apply_batch expects a list of (setter name, args...) tuples");
+            return NULL;
+        }
     }
 
-    tmp_obj = STRING(i->name);
-    PyDict_SetItemString(card_dict, "name", tmp_obj);
-    Py_DecRef(tmp_obj);
-
-    tmp_obj = INT(i->n_profiles);
-    PyDict_SetItemString(card_dict, "n_profiles", tmp_obj);
-    Py_DecRef(tmp_obj);
-
-    // profile list
-    for (ctr = 0; ctr < i->n_profiles; ctr++) {
-        profile_dict = PyDict_New();
-        if (!profile_dict) {
-            ERROR("PyDict_New error");
-            return;
+    results = PyList_New(n);
+    if (!results)
+        return NULL;
+    if (n == 0)
+        return results;
+
+    pa_ops = PyMem_New(pa_operation *, n);
+    first = PyMem_New(int, n);
+    count = PyMem_New(int, n);
+    if (!pa_ops || !first || !count) {
+        PyErr_NoMemory();
+        failed = 1;
+        goto out;
+    }
+
+    if (!m_sync_context(self, &ret)) {
+        result = ret < 0 ? Py_None : Py_False;
+        for (i = 0; i < n; i++) {
+            Py_INCREF(result);
+            PyList_SetItem(results, i, result);
+        }
+        goto out;
+    }
+
+    self->sync_batch = pa_ops;
+    self->sync_batch_thread = PyThread_get_thread_ident();
+    self->sync_batch_len = 0;
+    self->sync_batch_size = n;
+    for (issued = 0; issued < n; issued++) {
+        item = PyList_GetItem(ops, issued);
+        first[issued] = self->sync_batch_len;
+
+        method = m_batch_method(PyTuple_GetItem(item, 0));
+        method_args = PyTuple_GetSlice(item, 1, PyTuple_Size(item));
+        method_ret = method_args ? 
+                     method((PyObject *) self, method_args) : NULL;
+        Py_XDECREF(method_args);
+        // Reported as False like a refused write, the rest of the batch
+        // still goes out
+        if (!method_ret) {
+            PyErr_Clear();
+            count[issued] = 0;
+            continue;
         }
-        tmp_obj = STRING(i->profiles[ctr].name);
-        PyDict_SetItemString(profile_dict, "name", tmp_obj);
-        Py_DecRef(tmp_obj);
-
-        tmp_obj = STRING(i->profiles[ctr].description);
-        PyDict_SetItemString(profile_dict, "description", tmp_obj);
-        Py_DecRef(tmp_obj);
-
-        tmp_obj = INT(i->profiles[ctr].n_sinks);
-        PyDict_SetItemString(profile_dict, "n_sinks", tmp_obj);
-        Py_DecRef(tmp_obj);
-
-        tmp_obj = INT(i->profiles[ctr].n_sources);
-        PyDict_SetItemString(profile_dict, "n_sources", tmp_obj);
-        Py_DecRef(tmp_obj);
 
-        PyList_Append(profile_list, profile_dict);
-        Py_DecRef(profile_dict);
+        // False means the setter rejected its arguments before sending
+        count[issued] = method_ret == Py_True ? 
+                        self->sync_batch_len - first[issued] : 0;
+        Py_DECREF(method_ret);
     }
-    PyDict_SetItemString(card_dict, "profiles", profile_list);
-    Py_DecRef(profile_list);
+    self->sync_batch = NULL;
 
-    // active profile
-    if (i->active_profile) {
-        tmp_obj = STRING(i->active_profile->name);
-        PyDict_SetItemString(active_profile, "name", tmp_obj);
-        Py_DecRef(tmp_obj);
-
-        tmp_obj = STRING(i->active_profile->description);
-        PyDict_SetItemString(active_profile, "description", tmp_obj);
-        Py_DecRef(tmp_obj);
+    m_sync_drive(self, pa_ops, self->sync_batch_len);
+    expired = self->sync_expired;
 
-        tmp_obj = INT(i->active_profile->n_sinks);
-        PyDict_SetItemString(active_profile, "n_sinks", tmp_obj);
-        Py_DecRef(tmp_obj);
+    for (i = 0; i < issued; i++) {
+        done = count[i] > 0;
+        for (j = first[i]; j < first[i] + count[i]; j++) {
+            if (!pa_ops[j] || 
+                pa_operation_get_state(pa_ops[j]) != PA_OPERATION_DONE ||
+                m_write_refused(self, j))
+                done = 0;
+        }
+        if (done)
+            result = Py_True;
+        else if (count[i] > 0 && expired)
+            result = Py_None;
+        else
+            result = Py_False;
+        Py_INCREF(result);
+        PyList_SetItem(results, i, result);
+    }
+    m_store_settle(self);
+
+    for (j = 0; j < self->sync_batch_len; j++) {
+        if (pa_ops[j])
+            pa_operation_unref(pa_ops[j]);
+    }
+    self->sync_batch_len = 0;
+    self->sync_batch_size = 0;
+    m_sync_finish(self, 1);
+
+out:
+    PyMem_Free(pa_ops);
+    PyMem_Free(first);
+    PyMem_Free(count);
+    if (failed) {
+        Py_DECREF(results);
+        return NULL;
+    }
+    return results;
+}
 
-        tmp_obj = INT(i->active_profile->n_sources);
-        PyDict_SetItemString(active_profile, "n_sources", tmp_obj);
-        Py_DecRef(tmp_obj);
+static PyObject *m_set_timeout(DeepinPulseAudioObject *self, 
+                               PyObject *args)
+{
+    int timeout = 0;
 
-        PyDict_SetItemString(card_dict, "active_profile", active_profile);
-        Py_DecRef(active_profile);
-    } else {
-        PyDict_SetItemString(card_dict, "active_profile", Py_None);
-        Py_DecRef(active_profile);
-    }
-    // proplist
-    while ((prop_key=pa_proplist_iterate(i->proplist, &prop_state))) {
-        tmp_obj = STRING(pa_proplist_gets(i->proplist, prop_key));
-        PyDict_SetItemString(prop_dict, prop_key, tmp_obj);
-        Py_DecRef(tmp_obj);
+    if (!PyArg_ParseTuple(args, "i", &timeout)) {
+        ERROR("invalid arguments to set_timeout");
+        return NULL;
     }
-    PyDict_SetItemString(card_dict, "proplist", prop_dict);
-    Py_DecRef(prop_dict);
 
-    tmp_obj = INT(i->n_ports);
-    PyDict_SetItemString(card_dict, "n_ports", tmp_obj);
-    Py_DecRef(tmp_obj);
+    self->sync_timeout = timeout > 0 ? timeout : 0;
+    RETURN_TRUE;
+}
 
-    // ports list
-    for (ctr = 0; ctr < i->n_ports; ctr++) {
-        port_dict = PyDict_New();
-        if (!port_dict) {
-            ERROR("PyDict_New error");
-            return;
-        }
-        tmp_obj = STRING(i->ports[ctr]->name);
-        PyDict_SetItemString(port_dict, "name", tmp_obj);
-        Py_DecRef(tmp_obj);
+static PyObject *m_get_timeout(DeepinPulseAudioObject *self)
+{
+    return INT(self->sync_timeout);
+}
 
-        tmp_obj = STRING(i->ports[ctr]->description);
-        PyDict_SetItemString(port_dict, "description", tmp_obj);
-        Py_DecRef(tmp_obj);
+static PyObject *m_set_event_window(DeepinPulseAudioObject *self,
+                                    PyObject *args)
+{
+    int window = 0;
 
-        tmp_obj = INT(i->ports[ctr]->available);
-        PyDict_SetItemString(port_dict, "available", tmp_obj);
-        Py_DecRef(tmp_obj);
+    if (!PyArg_ParseTuple(args, "i", &window)) {
+        ERROR("invalid arguments to set_event_window");
+        return NULL;
+    }
 
-        tmp_obj = INT(i->ports[ctr]->direction);
-        PyDict_SetItemString(port_dict, "direction", tmp_obj);
-        Py_DecRef(tmp_obj);
+    self->event_window = window > 0 ? window : 0;
+    // deliver what was held back under the old window right away
+    if (self->event_timer) {
+        m_source_remove(self, self->event_timer);
+        m_event_flush(self);
+    }
+    RETURN_TRUE;
+}
 
-        tmp_obj = INT(i->ports[ctr]->n_profiles);
-        PyDict_SetItemString(port_dict, "n_profiles", tmp_obj);
-        Py_DecRef(tmp_obj);
+static PyObject *m_set_field_diffs(DeepinPulseAudioObject *self,
+                                   PyObject *args)
+{
+    PyObject *enable = NULL;
 
-        PyList_Append(port_list, port_dict);
-        Py_DecRef(port_dict);
+    if (!PyArg_ParseTuple(args, "O", &enable)) {
+        ERROR("invalid arguments to set_field_diffs");
+        return NULL;
     }
-    PyDict_SetItemString(card_dict, "ports", port_list);
-    Py_DecRef(port_list);
 
-    key = INT(i->index);
-    PyDict_SetItem(self->card_devices, key, card_dict);
-    Py_DecRef(card_dict);
-    Py_DecRef(key);
+    self->field_diffs = PyObject_IsTrue(enable);
+    RETURN_TRUE;
 }
 
-static void m_pa_sinklist_cb(pa_context *c, 
-                             const pa_sink_info *l, 
-                             int eol, 
-                             void *userdata) 
+/* set_snapshot(path) keeps the store in path across runs. When the store
+ * is still empty it is filled from the file right away; returns whether
+ * that happened. None stops using a file. */
+static PyObject *m_set_snapshot(DeepinPulseAudioObject *self,
+                                PyObject *args)
 {
-    if (!c || !l || eol > 0 || !userdata) 
-        return;
-   
-    DeepinPulseAudioObject *self = userdata;
-
-    pa_sink_port_info **ports  = NULL;                                          
-    pa_sink_port_info *port = NULL;        
-    pa_sink_port_info *active_port = NULL;
-    PyObject *key = NULL;
-    PyObject *channel_value = NULL;
-    PyObject *active_port_value = NULL;
-    PyObject *volume_value = NULL;
-    PyObject *prop_dict = NULL;
-    PyObject *port_list = NULL;
-    int i = 0;
-    const char *prop_key;
-    void *prop_state = NULL;
-    PyObject *tmp_obj = NULL;
+    char *path = NULL;
 
-    channel_value = PyList_New(0);
-    if (!channel_value) {
-        ERROR("PyList_New error");
-        return;
-    }
-    volume_value = PyList_New(0);
-    if (!volume_value) {
-        ERROR("PyList_New error");
-        return;
-    }
-    prop_dict = PyDict_New();
-    if (!prop_dict) {
-        ERROR("PyDict_New error");
-        return;
-    }
-    port_list = PyList_New(0);
-    if (!port_list) {
-        ERROR("PyList_New error");
-        return;
-    }
-                                                                                
-    key = INT(l->index);
-    while ((prop_key = pa_proplist_iterate(l->proplist, &prop_state))) {
-        tmp_obj = STRING(pa_proplist_gets(l->proplist, prop_key));
-        PyDict_SetItemString(prop_dict, prop_key, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    // channel list
-    for (i = 0; i < l->channel_map.channels; i++) {
-        tmp_obj = INT(l->channel_map.map[i]);
-        PyList_Append(channel_value, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    tmp_obj = Py_BuildValue("{sisnsO}", 
-                            "can_balance", pa_channel_map_can_balance(&l->channel_map),
-                            "channels", l->channel_map.channels,
-                            "map", channel_value);
-    Py_DecRef(channel_value);
-
-    PyDict_SetItem(self->output_channels, key, tmp_obj);
-    Py_DecRef(tmp_obj);
-    // ports list
-    ports = l->ports;   
-    for (i = 0; i < l->n_ports; i++) {                                  
-        port = ports[i];   
-        tmp_obj = Py_BuildValue("(ssi)",
-                                port->name,
-                                port->description,
-                                port->available);
-        PyList_Append(port_list, tmp_obj); 
-        Py_DecRef(tmp_obj);
-    }                
-    // active port
-    active_port = l->active_port;
-    if (active_port) {
-        active_port_value = Py_BuildValue("(ssi)", 
-                                          active_port->name,
-                                          active_port->description, 
-                                          active_port->available);
-        PyDict_SetItem(self->output_active_ports, key, active_port_value);
-        Py_DecRef(active_port_value);
-    } else {
-        PyDict_SetItem(self->output_active_ports, key, Py_None);
+    if (!PyArg_ParseTuple(args, "z", &path)) {
+        ERROR("invalid arguments to set_snapshot");
+        return NULL;
     }
-    // volume list
-    for (i = 0; i < l->volume.channels; i++) {
-        tmp_obj = INT(l->volume.values[i]);
-        PyList_Append(volume_value, tmp_obj);
-        Py_DecRef(tmp_obj);
+
+    g_free(self->snapshot_path);
+    self->snapshot_path = g_strdup(path);
+    if (path && m_snapshot_load(self, path)) {
+        RETURN_TRUE;
     }
-    PyDict_SetItem(self->output_volume, key, volume_value);
-    Py_DecRef(volume_value);
-    PyObject *tmp_obj1 = PyBool_FromLong(l->mute);
-    tmp_obj = Py_BuildValue("{sssssisIsOsOsO}",
-                            "name", l->name,
-                            "description", l->description,
-                            "base_volume", l->base_volume,
-                            "n_ports", l->n_ports,
-                            "mute", tmp_obj1,
-                            "ports", port_list,
-                            "proplist", prop_dict);
-    Py_DecRef(tmp_obj1);
-    Py_DecRef(port_list);
-    Py_DecRef(prop_dict);
-
-    PyDict_SetItem(self->output_devices, key,tmp_obj);
-    Py_DecRef(tmp_obj);
-    Py_DecRef(key);
-}                   
+    RETURN_FALSE;
+}
 
-// See above.  This callback is pretty much identical to the previous
-static void m_pa_sourcelist_cb(pa_context *c, 
-                               const pa_source_info *l, 
-                               int eol, 
-                               void *userdata) 
+static PyObject *m_save_snapshot(DeepinPulseAudioObject *self)
 {
-    if (!c || !l || eol > 0 || !userdata) 
-        return;
+    if (self->snapshot_path && m_snapshot_save(self, self->snapshot_path)) {
+        RETURN_TRUE;
+    }
+    RETURN_FALSE;
+}
 
+static void m_pa_server_info_cb(pa_context *c, 
+                                const pa_server_info *i, 
+                                void *userdata)
+{
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
-    
-    pa_source_port_info **ports = NULL;                                         
-    pa_source_port_info *port = NULL;      
-    pa_source_port_info *active_port = NULL;
-    PyObject *key = NULL;
-    PyObject *channel_value = NULL;
-    PyObject *active_port_value = NULL;
-    PyObject *volume_value = NULL;
-    PyObject *prop_dict = NULL;
-    PyObject *port_list = NULL;
-    int i = 0;                                                                  
-    const char *prop_key;
-    void *prop_state = NULL;
-    PyObject *tmp_obj = NULL;
-                                                                                
-    if (eol > 0 || !l) {                                                              
-        return;                                                                 
-    }
 
-    channel_value = PyList_New(0);
-    if (!channel_value) {
-        ERROR("PyList_New error");
-        return;
-    }
-    volume_value = PyList_New(0);
-    if (!volume_value) {
-        ERROR("PyList_New error");
+    if (!c || !i || !self) 
         return;
-    }
-    prop_dict = PyDict_New();
-    if (!prop_dict) {
-        ERROR("PyDict_New error\n");
-        return;
-    }
-        
-    port_list = PyList_New(0);
-    if (!port_list) {
-        ERROR("PyList_New error");
+
+    m_store_server(self, i);
+    // On the private loop m_sync_finish() runs it once sync_lock is free
+    if (self->reconcile_pending && c != self->sync_ctx)
+        m_snapshot_reconcile(self);
+}
+
+static void m_pa_cardlist_cb(pa_context *c,
+                             const pa_card_info *i,
+                             int eol,
+                             void *userdata)
+{
+    if (!c || !i || eol > 0 || !userdata) 
         return;
-    }
-                                                                                
-    key = INT(l->index);
-    while ((prop_key=pa_proplist_iterate(l->proplist, &prop_state))) {
-        tmp_obj = STRING(pa_proplist_gets(l->proplist, prop_key));
-        PyDict_SetItemString(prop_dict, prop_key,tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    // channel list
-    for (i = 0; i < l->channel_map.channels; i++) {                    
-        tmp_obj = INT(l->channel_map.map[i]);
-        PyList_Append(channel_value, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }                                                                   
-    tmp_obj = Py_BuildValue("{sisnsO}",
-                            "can_balance", pa_channel_map_can_balance(&l->channel_map),
-                            "channels", l->channel_map.channels,
-                            "map", channel_value);
-    Py_DecRef(channel_value);
-
-    PyDict_SetItem(self->input_channels, key, tmp_obj);
-    Py_DecRef(tmp_obj);
-    // ports list
-    ports = l->ports;                                                   
-    for (i = 0; i < l->n_ports; i++) {                                  
-        port = ports[i];                                                
-        tmp_obj = Py_BuildValue("(ssi)",
-                                port->name,
-                                port->description,
-                                port->available);
-        PyList_Append(port_list, tmp_obj);
-        Py_DecRef(tmp_obj);
-    } 
-    // active port
-    active_port = l->active_port;                                       
-    if (active_port) {
-        active_port_value = Py_BuildValue("(ssi)",
-                                          active_port->name,
-                                          active_port->description,         
-                                          active_port->available);               
-        PyDict_SetItem(self->input_active_ports, key, active_port_value);
-        Py_DecRef(active_port_value);
-    } else {
-        PyDict_SetItem(self->input_active_ports, key, Py_None);
-    }
-    // volume list
-    for (i = 0; i < l->volume.channels; i++) {
-        tmp_obj = INT(l->volume.values[i]);
-        PyList_Append(volume_value, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    PyDict_SetItem(self->input_volume, key, volume_value);
-    Py_DecRef(volume_value);
-    PyObject *tmp_obj1 = PyBool_FromLong(l->mute);
-    tmp_obj = Py_BuildValue("{sssssisIsOsOsO}",
-                            "name", l->name,
-                            "description", l->description,
-                            "base_volume", l->base_volume,
-                            "n_ports", l->n_ports,
-                            "mute", tmp_obj1,
-                            "ports", port_list,
-                            "proplist", prop_dict);
-    Py_DecRef(tmp_obj1);
-    Py_DecRef(port_list);
-    Py_DecRef(prop_dict);
-
-    PyDict_SetItem(self->input_devices, key, tmp_obj);
-    Py_DecRef(tmp_obj);
-    Py_DecRef(key);
+
+    m_store_card((DeepinPulseAudioObject *) userdata, i);
 }
 
-static void m_pa_sinkinputlist_info_cb(pa_context *c,
-                                       const pa_sink_input_info *l,
-                                       int eol,
-                                       void *userdata)
+static void m_pa_sinklist_cb(pa_context *c, 
+                             const pa_sink_info *l, 
+                             int eol, 
+                             void *userdata) 
 {
     if (!c || !l || eol > 0 || !userdata) 
         return;
 
-    DeepinPulseAudioObject *self = userdata;
-    
-    PyObject *key = NULL;
-    PyObject *volume_value = NULL;
-    PyObject *channel_value = NULL;
-    PyObject *prop_dict = NULL;
-    int i;
-    const char *prop_key;
-    void *prop_state = NULL;
-    PyObject *tmp_obj = NULL;
+    m_store_sink((DeepinPulseAudioObject *) userdata, l);
+}                   
 
-    channel_value = PyList_New(0);
-    if (!channel_value) {
-        ERROR("PyList_New error");
-        return;
-    }
-    volume_value = PyList_New(0);
-    if (!volume_value) {
-        ERROR("PyList_New error");
+// See above.  This callback is pretty much identical to the previous
+static void m_pa_sourcelist_cb(pa_context *c, 
+                               const pa_source_info *l, 
+                               int eol, 
+                               void *userdata) 
+{
+    if (!c || !l || eol > 0 || !userdata) 
         return;
-    }
-    prop_dict = PyDict_New();
-    if (!prop_dict) {
-        ERROR("PyDict_New error\n");
+
+    m_store_source((DeepinPulseAudioObject *) userdata, l);
+}
+
+static void m_pa_sinkinputlist_info_cb(pa_context *c,
+                                       const pa_sink_input_info *l,
+                                       int eol,
+                                       void *userdata)
+{
+    if (!c || !l || eol > 0 || !userdata) 
         return;
-    }
 
-    key = INT(l->index);
-    // proplist
-    while ((prop_key=pa_proplist_iterate(l->proplist, &prop_state))) {
-        tmp_obj = STRING(pa_proplist_gets(l->proplist, prop_key));
-        PyDict_SetItemString(prop_dict, prop_key, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    // channel list
-    for (i = 0; i < l->channel_map.channels; i++) {
-        tmp_obj = INT(l->channel_map.map[i]);
-        PyList_Append(channel_value, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    //volume list
-    for (i = 0; i < l->volume.channels; i++) {
-        tmp_obj = INT(l->volume.values[i]);
-        PyList_Append(volume_value, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    tmp_obj = Py_BuildValue("{sssisisisOsssssOsisOsisisi}",
-                            "name", l->name,
-                            "owner_module", l->owner_module,
-                            "client", l->client,
-                            "sink", l->sink,
-                            "channel", channel_value,
-                            "resample_method", l->resample_method,
-                            "driver", l->driver,
-                            "proplist", prop_dict,
-                            "corked", l->corked,
-                            "volume", volume_value,
-                            "mute", l->mute,
-                            "has_volume", l->has_volume,
-                            "volume_writable", l->volume_writable);
-    Py_DecRef(channel_value);
-    Py_DecRef(prop_dict);
-    Py_DecRef(volume_value);
-
-    PyDict_SetItem(self->playback_streams, key, tmp_obj);
-    Py_DecRef(tmp_obj);
-    Py_DecRef(key);
+    m_store_sink_input((DeepinPulseAudioObject *) userdata, l);
 }
 
 static void m_pa_sourceoutputlist_info_cb(pa_context *c,
@@ -2785,75 +4525,43 @@ static void m_pa_sourceoutputlist_info_cb(pa_context *c,
                                           int eol,
                                           void *userdata)
 {
-    if (!c || !l || eol > 0 || !userdata) 
-        return;
-
-    DeepinPulseAudioObject *self = userdata;
-    
-    PyObject *key = NULL;
-    PyObject *volume_value = NULL;
-    PyObject *channel_value = NULL;
-    PyObject *prop_dict = NULL;
-    int i;
-    const char *prop_key;
-    void *prop_state = NULL;
-    PyObject *tmp_obj = NULL;
+    DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
 
-    channel_value = PyList_New(0);
-    if (!channel_value) {
-        ERROR("PyList_New error");
-        return;
+    // Requested last, so every other list is complete by now. The sweep
+    // runs removed callbacks, which may call back into blocking calls, so
+    // on the private loop it waits for m_sync_finish() to drop sync_lock.
+    if (eol > 0 && self) {
+        self->reconcile_pending = 1;
+        if (c != self->sync_ctx)
+            m_snapshot_reconcile(self);
     }
-    volume_value = PyList_New(0);
-    if (!volume_value) {
-        ERROR("PyList_New error");
+    if (!c || !l || eol > 0 || !self) 
         return;
-    }
-    prop_dict = PyDict_New();
-    if (!prop_dict) {
-        ERROR("PyDict_New error\n");
+
+    m_store_source_output(self, l);
+}
+
+/* Run a *_changed callback for an update of e, if the store has it.
+ * Updates that moved nothing visible are swallowed, and with
+ * set_field_diffs(True) the callback also gets {field: new value}. */
+static void m_changed_notify(DeepinPulseAudioObject *self,
+                             PyObject *callback,
+                             m_entry *e,
+                             uint32_t index)
+{
+    PyObject *changes = NULL;
+
+    if (!callback || (e && !e->changed))
         return;
-    }
 
-    key = INT(l->index);
-    // proplist
-    while ((prop_key=pa_proplist_iterate(l->proplist, &prop_state))) {
-        tmp_obj = STRING(pa_proplist_gets(l->proplist, prop_key));
-        PyDict_SetItemString(prop_dict, prop_key,tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    // channel list
-    for (i = 0; i < l->channel_map.channels; i++) {
-        tmp_obj = INT(l->channel_map.map[i]);
-        PyList_Append(channel_value, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    //volume list
-    for (i = 0; i < l->volume.channels; i++) {
-        tmp_obj = INT(l->volume.values[i]);
-        PyList_Append(volume_value, tmp_obj);
-        Py_DecRef(tmp_obj);
+    if (e && self->field_diffs) {
+        if (!(changes = m_entry_changes(e)))
+            return;
+        PyEval_CallFunction(callback, "(OiO)", self, index, changes);
+        Py_DECREF(changes);
+    } else {
+        PyEval_CallFunction(callback, "(Oi)", self, index);
     }
-    tmp_obj = Py_BuildValue("{sssisisisOsssssOsisOsisisi}",
-                            "name", l->name,
-                            "owner_module", l->owner_module,
-                            "client", l->client,
-                            "source", l->source,
-                            "channel", channel_value,
-                            "resample_method", l->resample_method,
-                            "driver", l->driver,
-                            "proplist", prop_dict,
-                            "corked", l->corked,
-                            "volume", volume_value,
-                            "mute", l->mute,
-                            "has_volume", l->has_volume,
-                            "volume_writable", l->volume_writable);
-    Py_DecRef(channel_value);
-    Py_DecRef(prop_dict);
-    Py_DecRef(volume_value);
-    PyDict_SetItem(self->record_stream, key, tmp_obj);
-    Py_DecRef(tmp_obj);
-    Py_DecRef(key);
 }
 
 static void m_pa_sink_new_cb(pa_context *c,
@@ -2866,12 +4574,13 @@ static void m_pa_sink_new_cb(pa_context *c,
 
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
 
-    if (self->sink_new_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->sink_new_cb, "(Oi)", self, info->index);
-        PyGILState_Release(gstate);
-    }
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    if (self->cache_valid || self->field_diffs)
+        m_pa_sinklist_cb(c, info, eol, self);
+    if (M_SIGNAL_CB(self, SINK, NEW))
+        PyEval_CallFunction(M_SIGNAL_CB(self, SINK, NEW), "(Oi)", self, info->index);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_sink_changed_cb(pa_context *c, 
@@ -2884,13 +4593,14 @@ static void m_pa_sink_changed_cb(pa_context *c,
     }
 
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
-
-    if (self->sink_changed_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->sink_changed_cb, "(Oi)", self, info->index);
-        PyGILState_Release(gstate);
-    }
+    m_entry *e = NULL;
+
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    if (self->cache_valid || self->field_diffs)
+        e = m_store_sink(self, info);
+    m_changed_notify(self, M_SIGNAL_CB(self, SINK, CHANGE), e, info->index);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_sink_removed_cb(DeepinPulseAudioObject *self, uint32_t idx)
@@ -2898,33 +4608,12 @@ static void m_pa_sink_removed_cb(DeepinPulseAudioObject *self, uint32_t idx)
     if (!self) 
         return;
 
-    PyObject *key = NULL;
-    key = INT(idx);
-    if (self->output_active_ports && PyDict_Contains(self->output_active_ports, key)) {
-        PyDict_DelItem(self->output_active_ports, key);
-    }
-    if (self->output_channels && PyDict_Contains(self->output_channels, key)) {
-        PyDict_DelItem(self->output_channels, key);
-    }
-    if (self->output_devices && PyDict_Contains(self->output_devices, key)) {
-        PyDict_DelItem(self->output_devices, key);
-    }
-    if (self->output_mute && PyDict_Contains(self->output_mute, key)) {
-        PyDict_DelItem(self->output_mute, key);
-    }
-    if (self->output_ports && PyDict_Contains(self->output_ports, key)) {
-        PyDict_DelItem(self->output_ports, key);
-    }
-    if (self->output_volume && PyDict_Contains(self->output_volume, key)) {
-        PyDict_DelItem(self->output_volume, key);
-    }
-    Py_DecRef(key);
-    if (self->sink_removed_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->sink_removed_cb, "(Oi)", self, idx);
-        PyGILState_Release(gstate);
-    }
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    m_store_remove(self, M_SINK, idx);
+    if (M_SIGNAL_CB(self, SINK, REMOVE))
+        PyEval_CallFunction(M_SIGNAL_CB(self, SINK, REMOVE), "(Oi)", self, idx);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_source_new_cb(pa_context *c,                               
@@ -2937,12 +4626,13 @@ static void m_pa_source_new_cb(pa_context *c,
 
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;         
 
-    if (self->source_new_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->source_new_cb, "(Oi)", self, info->index);
-        PyGILState_Release(gstate);
-    }
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    if (self->cache_valid || self->field_diffs)
+        m_pa_sourcelist_cb(c, info, eol, self);
+    if (M_SIGNAL_CB(self, SOURCE, NEW))
+        PyEval_CallFunction(M_SIGNAL_CB(self, SOURCE, NEW), "(Oi)", self, info->index);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_source_changed_cb(pa_context *c,
@@ -2954,13 +4644,14 @@ static void m_pa_source_changed_cb(pa_context *c,
         return;
 
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
-
-    if (self->source_changed_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->source_changed_cb, "(Oi)", self, info->index);
-        PyGILState_Release(gstate);
-    }
+    m_entry *e = NULL;
+
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    if (self->cache_valid || self->field_diffs)
+        e = m_store_source(self, info);
+    m_changed_notify(self, M_SIGNAL_CB(self, SOURCE, CHANGE), e, info->index);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_source_removed_cb(DeepinPulseAudioObject *self, uint32_t idx)
@@ -2968,33 +4659,12 @@ static void m_pa_source_removed_cb(DeepinPulseAudioObject *self, uint32_t idx)
     if (!self) 
         return;
 
-    PyObject *key = NULL;
-    key = INT(idx);
-    if (self->input_active_ports && PyDict_Contains(self->input_active_ports, key)) {
-        PyDict_DelItem(self->input_active_ports, key);
-    }
-    if (self->input_channels && PyDict_Contains(self->input_channels, key)) {
-        PyDict_DelItem(self->input_channels, key);
-    }
-    if (self->input_devices && PyDict_Contains(self->input_devices, key)) {
-        PyDict_DelItem(self->input_devices, key);
-    }
-    if (self->input_mute && PyDict_Contains(self->input_mute, key)) {
-        PyDict_DelItem(self->input_mute, key);
-    }
-    if (self->input_ports && PyDict_Contains(self->input_ports, key)) {
-        PyDict_DelItem(self->input_ports, key);
-    }
-    if (self->input_volume && PyDict_Contains(self->input_volume, key)) {
-        PyDict_DelItem(self->input_volume, key);
-    }
-    Py_DecRef(key);
-    if (self->source_removed_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->source_removed_cb, "(Oi)", self, idx);
-        PyGILState_Release(gstate);
-    }
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    m_store_remove(self, M_SOURCE, idx);
+    if (M_SIGNAL_CB(self, SOURCE, REMOVE))
+        PyEval_CallFunction(M_SIGNAL_CB(self, SOURCE, REMOVE), "(Oi)", self, idx);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_sink_input_new_cb(pa_context *c,
@@ -3007,12 +4677,13 @@ static void m_pa_sink_input_new_cb(pa_context *c,
 
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
 
-    if (self->sink_input_new_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->sink_input_new_cb, "(Oi)", self, info->index);
-        PyGILState_Release(gstate);
-    }
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    if (self->cache_valid || self->field_diffs)
+        m_pa_sinkinputlist_info_cb(c, info, eol, self);
+    if (M_SIGNAL_CB(self, SINK_INPUT, NEW))
+        PyEval_CallFunction(M_SIGNAL_CB(self, SINK_INPUT, NEW), "(Oi)", self, info->index);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_sink_input_changed_cb(pa_context *c,                               
@@ -3024,13 +4695,14 @@ static void m_pa_sink_input_changed_cb(pa_context *c,
         return;                                                                     
                                                                                     
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;             
-
-    if (self->sink_input_changed_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->sink_input_changed_cb, "(Oi)", self, info->index);               
-        PyGILState_Release(gstate);
-    }
+    m_entry *e = NULL;
+
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    if (self->cache_valid || self->field_diffs)
+        e = m_store_sink_input(self, info);
+    m_changed_notify(self, M_SIGNAL_CB(self, SINK_INPUT, CHANGE), e, info->index);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_sink_input_removed_cb(DeepinPulseAudioObject *self, uint32_t idx)
@@ -3038,18 +4710,12 @@ static void m_pa_sink_input_removed_cb(DeepinPulseAudioObject *self, uint32_t id
     if (!self) 
         return;
 
-    /*PyObject *key = NULL;*/
-    /*key = INT(idx);*/
-    /*if (self->playback_streams && PyDict_Contains(self->playback_streams, key)) {*/
-        /*PyDict_DelItem(self->playback_streams, key);*/
-    /*}*/
-    /*Py_DecRef(key);*/
-    if (self->sink_input_removed_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->sink_input_removed_cb, "(Oi)", self, idx);
-        PyGILState_Release(gstate);
-    }
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    m_store_remove(self, M_SINK_INPUT, idx);
+    if (M_SIGNAL_CB(self, SINK_INPUT, REMOVE))
+        PyEval_CallFunction(M_SIGNAL_CB(self, SINK_INPUT, REMOVE), "(Oi)", self, idx);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_source_output_new_cb(pa_context *c,
@@ -3062,12 +4728,13 @@ static void m_pa_source_output_new_cb(pa_context *c,
 
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
 
-    if (self->source_output_new_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->source_output_new_cb, "(Oi)", self, info->index);
-        PyGILState_Release(gstate);
-    }
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    if (self->cache_valid || self->field_diffs)
+        m_pa_sourceoutputlist_info_cb(c, info, eol, self);
+    if (M_SIGNAL_CB(self, SOURCE_OUTPUT, NEW))
+        PyEval_CallFunction(M_SIGNAL_CB(self, SOURCE_OUTPUT, NEW), "(Oi)", self, info->index);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_source_output_changed_cb(pa_context *c,                                
@@ -3079,13 +4746,14 @@ static void m_pa_source_output_changed_cb(pa_context *c,
         return;                                                                     
                                                                                     
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;             
-
-    if (self->source_output_changed_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->source_output_changed_cb, "(Oi)", self, info->index);    
-        PyGILState_Release(gstate);
-    }
+    m_entry *e = NULL;
+
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    if (self->cache_valid || self->field_diffs)
+        e = m_store_source_output(self, info);
+    m_changed_notify(self, M_SIGNAL_CB(self, SOURCE_OUTPUT, CHANGE), e, info->index);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_source_output_removed_cb(DeepinPulseAudioObject *self, uint32_t idx)
@@ -3093,18 +4761,12 @@ static void m_pa_source_output_removed_cb(DeepinPulseAudioObject *self, uint32_t
     if (!self) 
         return;
 
-    /*PyObject *key = NULL;*/
-    /*key = INT(idx);*/
-    /*if (self->record_stream && PyDict_Contains(self->record_stream, key)) {*/
-        /*PyDict_DelItem(self->record_stream, key);*/
-    /*}*/
-    /*Py_DecRef(key);*/
-    if (self->source_output_removed_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->source_output_removed_cb, "(Oi)", self, idx);
-        PyGILState_Release(gstate);
-    }
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    m_store_remove(self, M_SOURCE_OUTPUT, idx);
+    if (M_SIGNAL_CB(self, SOURCE_OUTPUT, REMOVE))
+        PyEval_CallFunction(M_SIGNAL_CB(self, SOURCE_OUTPUT, REMOVE), "(Oi)", self, idx);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_server_new_cb(pa_context *c,
@@ -3116,12 +4778,13 @@ static void m_pa_server_new_cb(pa_context *c,
 
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
 
-    if (self->server_new_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->server_new_cb, "(O)", self);
-        PyGILState_Release(gstate);
-    }
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    if (self->cache_valid || self->field_diffs)
+        m_pa_server_info_cb(c, info, self);
+    if (M_SIGNAL_CB(self, SERVER, NEW))
+        PyEval_CallFunction(M_SIGNAL_CB(self, SERVER, NEW), "(O)", self);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_server_changed_cb(pa_context *c,                                   
@@ -3132,13 +4795,26 @@ static void m_pa_server_changed_cb(pa_context *c,
         return;                                                                     
                                                                                     
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;             
-
-    if (self->server_changed_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->server_changed_cb, "(O)", self);                         
-        PyGILState_Release(gstate);
+    PyObject *changes = NULL;
+    int changed = -1;
+
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    if (self->cache_valid || self->field_diffs)
+        changed = m_store_server(self, info);
+    if (self->reconcile_pending)
+        m_snapshot_reconcile(self);
+    if (M_SIGNAL_CB(self, SERVER, CHANGE) && changed) {
+        if (changed > 0 && self->field_diffs) {
+            changes = m_server_changes(&self->server);
+            if (changes)
+                PyEval_CallFunction(M_SIGNAL_CB(self, SERVER, CHANGE), "(OO)", self, changes);
+            Py_XDECREF(changes);
+        } else {
+            PyEval_CallFunction(M_SIGNAL_CB(self, SERVER, CHANGE), "(O)", self);
+        }
     }
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_server_removed_cb(DeepinPulseAudioObject *self)
@@ -3146,10 +4822,10 @@ static void m_pa_server_removed_cb(DeepinPulseAudioObject *self)
     if (!self) 
         return;
 
-    if (self->server_removed_cb) {
+    if (M_SIGNAL_CB(self, SERVER, REMOVE)) {
         PyGILState_STATE gstate;
         gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->server_removed_cb, "(O)", self);
+        PyEval_CallFunction(M_SIGNAL_CB(self, SERVER, REMOVE), "(O)", self);
         PyGILState_Release(gstate);
     }
 }
@@ -3164,12 +4840,13 @@ static void m_pa_card_new_cb(pa_context *c,
 
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
 
-    if (self->card_new_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->card_new_cb, "(Oi)", self, info->index);
-        PyGILState_Release(gstate);
-    }
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    if (self->cache_valid || self->field_diffs)
+        m_pa_cardlist_cb(c, info, eol, self);
+    if (M_SIGNAL_CB(self, CARD, NEW))
+        PyEval_CallFunction(M_SIGNAL_CB(self, CARD, NEW), "(Oi)", self, info->index);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_card_changed_cb(pa_context *c,                                         
@@ -3181,13 +4858,14 @@ static void m_pa_card_changed_cb(pa_context *c,
         return;                                                                     
                                                                                     
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;             
-
-    if (self->card_changed_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->card_changed_cb, "(Oi)", self, info->index);             
-        PyGILState_Release(gstate);
-    }
+    m_entry *e = NULL;
+
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    if (self->cache_valid || self->field_diffs)
+        e = m_store_card(self, info);
+    m_changed_notify(self, M_SIGNAL_CB(self, CARD, CHANGE), e, info->index);
+    PyGILState_Release(gstate);
 }
 
 static void m_pa_card_removed_cb(DeepinPulseAudioObject *self, uint32_t idx)
@@ -3195,24 +4873,41 @@ static void m_pa_card_removed_cb(DeepinPulseAudioObject *self, uint32_t idx)
     if (!self) 
         return;
 
-    /*PyObject *key = NULL;*/
-    /*key = INT(idx);*/
-    /*if (self->card_devices && PyDict_Contains(self->card_devices, key)) {*/
-        /*PyDict_DelItem(self->card_devices, key);*/
-    /*}*/
-    /*Py_DecRef(key);*/
-    if (self->card_removed_cb) {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyEval_CallFunction(self->card_removed_cb, "(Oi)", self, idx);
-        PyGILState_Release(gstate);
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    m_store_remove(self, M_CARD, idx);
+    if (M_SIGNAL_CB(self, CARD, REMOVE))
+        PyEval_CallFunction(M_SIGNAL_CB(self, CARD, REMOVE), "(Oi)", self, idx);
+    PyGILState_Release(gstate);
+}
+
+static void m_snapshot_drop(DeepinPulseAudioObject *self,
+                            m_kind kind,
+                            uint32_t index)
+{
+    switch (kind) {
+    case M_SINK:
+        m_pa_sink_removed_cb(self, index);
+        break;
+    case M_SOURCE:
+        m_pa_source_removed_cb(self, index);
+        break;
+    case M_SINK_INPUT:
+        m_pa_sink_input_removed_cb(self, index);
+        break;
+    case M_SOURCE_OUTPUT:
+        m_pa_source_output_removed_cb(self, index);
+        break;
+    default:
+        m_pa_card_removed_cb(self, index);
+        break;
     }
 }
 
-static void m_pa_context_subscribe_cb(pa_context *c,                           
-                                      pa_subscription_event_type_t t,          
-                                      uint32_t idx,                            
-                                      void *userdata)                          
+static void m_pa_dispatch_event(pa_context *c,
+                                pa_subscription_event_type_t t,
+                                uint32_t idx,
+                                void *userdata)
 {                                                                               
     if (!c || !userdata) 
         return;
@@ -3279,13 +4974,159 @@ static void m_pa_context_subscribe_cb(pa_context *c,
     }
 }
 
+static void m_event_clear(DeepinPulseAudioObject *self)
+{
+    m_pending_event *e = self->event_head;
+    m_pending_event *next = NULL;
+
+    if (self->event_timer) {
+        m_source_remove(self, self->event_timer);
+        self->event_timer = 0;
+    }
+    g_hash_table_remove_all(self->event_pending);
+    self->event_head = self->event_tail = NULL;
+    for (; e; e = next) {
+        next = e->next;
+        g_free(e);
+    }
+}
+
+/* End of the window: dispatch what is left of the queued events in the
+ * order they first arrived */
+static gboolean m_event_flush(gpointer userdata)
+{
+    DeepinPulseAudioObject *self = userdata;
+    m_pending_event *e = self->event_head;
+    m_pending_event *next = NULL;
+
+    self->event_timer = 0;
+    g_hash_table_remove_all(self->event_pending);
+    self->event_head = self->event_tail = NULL;
+    for (; e; e = next) {
+        next = e->next;
+        if (!e->cancelled && self->pa_ctx)
+            m_pa_dispatch_event(self->pa_ctx, 
+                                (pa_subscription_event_type_t) (e->key >> 32) | e->type, 
+                                (uint32_t) e->key, 
+                                self);
+        g_free(e);
+    }
+    return FALSE;
+}
+
+/* Merge an event into the one already pending for the same object:
+ * repeated CHANGEs collapse, CHANGE after NEW stays NEW, REMOVE wins over
+ * CHANGE and a NEW followed by REMOVE cancels out. */
+static void m_event_queue(DeepinPulseAudioObject *self, 
+                          pa_subscription_event_type_t t, 
+                          uint32_t idx)
+{
+    pa_subscription_event_type_t type = t & PA_SUBSCRIPTION_EVENT_TYPE_MASK;
+    gint64 key = (gint64) (t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) << 32 | idx;
+    m_pending_event *e = NULL;
+
+    e = g_hash_table_lookup(self->event_pending, &key);
+    if (e) {
+        if (type == PA_SUBSCRIPTION_EVENT_REMOVE) {
+            if (e->type == PA_SUBSCRIPTION_EVENT_NEW) {
+                e->cancelled = 1;
+                g_hash_table_remove(self->event_pending, &key);
+            } else {
+                e->type = PA_SUBSCRIPTION_EVENT_REMOVE;
+            }
+        } else if (type == PA_SUBSCRIPTION_EVENT_NEW) {
+            e->type = e->type == PA_SUBSCRIPTION_EVENT_REMOVE ? 
+                      PA_SUBSCRIPTION_EVENT_CHANGE : PA_SUBSCRIPTION_EVENT_NEW;
+        }
+        return;
+    }
+
+    e = g_new0(m_pending_event, 1);
+    e->key = key;
+    e->type = type;
+    if (self->event_tail)
+        self->event_tail->next = e;
+    else
+        self->event_head = e;
+    self->event_tail = e;
+    g_hash_table_insert(self->event_pending, &e->key, e);
+
+    if (!self->event_timer)
+        self->event_timer = m_source_attach(self, 
+                                            g_timeout_source_new(self->event_window), 
+                                            m_event_flush);
+}
+
+static void m_pa_context_subscribe_cb(pa_context *c,                           
+                                      pa_subscription_event_type_t t,          
+                                      uint32_t idx,                            
+                                      void *userdata)                          
+{                                                                               
+    if (!c || !userdata) 
+        return;
+
+    DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
+
+    if (self->event_window > 0)
+        m_event_queue(self, t, idx);
+    else
+        m_pa_dispatch_event(c, t, idx, self);
+}
+
+/* Facilities somebody listens to, or that the caches mirror, unless
+ * overridden by set_subscription_mask() */
+static pa_subscription_mask_t m_subscription_mask(DeepinPulseAudioObject *self)
+{
+    int mask = PA_SUBSCRIPTION_MASK_NULL;
+    int f;
+    int t;
+
+    if (self->subscribe_mask >= 0)
+        return (pa_subscription_mask_t) self->subscribe_mask;
+
+    // Populated caches follow every facility they mirror
+    if (self->cache_valid)
+        mask |= PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SOURCE | 
+                PA_SUBSCRIPTION_MASK_CARD | PA_SUBSCRIPTION_MASK_SERVER | 
+                PA_SUBSCRIPTION_MASK_SINK_INPUT | 
+                PA_SUBSCRIPTION_MASK_SOURCE_OUTPUT;
+
+    // the mask has the bit of facility f at 1 << f
+    for (f = 0; f < M_FACILITY_COUNT; f++) {
+        for (t = 0; t < M_EVENT_COUNT; t++) {
+            if (self->signal_cb[f][t])
+                mask |= 1 << f;
+        }
+    }
+    return (pa_subscription_mask_t) mask;
+}
+
+/* Tell the server about the current mask; called on READY and whenever
+ * callbacks or the override change */
+static void m_update_subscription(DeepinPulseAudioObject *self)
+{
+    pa_operation *pa_op = NULL;
+
+    if (!self->pa_ctx || pa_context_get_state(self->pa_ctx) != PA_CONTEXT_READY)
+        return;
+
+    if (!(pa_op = pa_context_subscribe(self->pa_ctx, 
+                                       m_subscription_mask(self), 
+                                       NULL, 
+                                       NULL))) {
+        ERROR("pa_context_subscribe() failed\n");
+        return;
+    }
+    pa_operation_unref(pa_op);
+    m_main_wakeup(self);
+}
+
 static void m_context_state_cb(pa_context *c, void *userdata) 
 {                
     if (!c || !userdata) 
         return;
 
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;                         
-    pa_operation *pa_op = NULL;
 
     switch (pa_context_get_state(c)) {                                          
         case PA_CONTEXT_UNCONNECTED:                                            
@@ -3294,31 +5135,35 @@ static void m_context_state_cb(pa_context *c, void *userdata)
         case PA_CONTEXT_SETTING_NAME:                                           
             break;                                                              
                                                                                 
-        case PA_CONTEXT_READY:                                                
+        case PA_CONTEXT_READY: {
+            pa_operation *pa_ops[6];
+            int i;
+
             pa_context_set_subscribe_callback(c, m_pa_context_subscribe_cb, self);
 
-            if (!(pa_op = pa_context_subscribe(c, (pa_subscription_mask_t)          
-                                           (PA_SUBSCRIPTION_MASK_ALL), NULL, NULL))) {
-            /*if (!(pa_op = pa_context_subscribe(c, (pa_subscription_mask_t)          */
-                                           /*(PA_SUBSCRIPTION_MASK_SINK|          */
-                                            /*PA_SUBSCRIPTION_MASK_SOURCE|        */
-                                            /*PA_SUBSCRIPTION_MASK_SINK_INPUT|    */
-                                            /*PA_SUBSCRIPTION_MASK_SOURCE_OUTPUT| */
-                                            /*PA_SUBSCRIPTION_MASK_CLIENT|        */
-                                            /*PA_SUBSCRIPTION_MASK_SERVER|        */
-                                            /*PA_SUBSCRIPTION_MASK_CARD), NULL, NULL))) {*/
-                ERROR("pa_context_subscribe() failed\n");                 
-                return;                                                         
-            }                                                                   
-            pa_operation_unref(pa_op);
+            // A warm started store is reconciled in the background and
+            // then kept current like after get_devices()
+            if (self->snapshot_pending) {
+                m_store_request_all(self, c, pa_ops);
+                for (i = 0; i < 6; i++) {
+                    if (pa_ops[i])
+                        pa_operation_unref(pa_ops[i]);
+                }
+                self->cache_valid = 1;
+            }
+
+            m_update_subscription(self);
             break;
+        }
                                                                                 
         case PA_CONTEXT_FAILED:                                                 
+            m_event_clear(self);
             pa_context_unref(self->pa_ctx);                                          
             self->pa_ctx = NULL;                                                     
                                                                                 
             ERROR("Connection failed, attempting reconnect\n");          
-            g_timeout_add_seconds(13, m_connect_to_pulse, self);               
+            m_source_attach(self, g_timeout_source_new_seconds(13), 
+                            (GSourceFunc) m_connect_to_pulse);
             return;                                                             
                                                                                 
         case PA_CONTEXT_TERMINATED:                                             
@@ -3348,6 +5193,7 @@ static PyObject *m_connect_to_pulse(DeepinPulseAudioObject *self)
         }
     }
 
+    m_main_wakeup(self);
     RETURN_TRUE;
 }
 
@@ -3396,132 +5242,108 @@ static void on_monitor_suspended_callback(pa_stream *p, void *userdata)
     }
 }
 
+/* Signals connect() takes, resolved to their place in signal_cb once so
+ * that events are dispatched without looking at names */
+static const struct {
+    const char *name;
+    pa_subscription_event_type_t facility;
+    pa_subscription_event_type_t type;
+} m_signals[] = 
+{
+    {"sink-new", PA_SUBSCRIPTION_EVENT_SINK, PA_SUBSCRIPTION_EVENT_NEW}, 
+    {"sink-changed", PA_SUBSCRIPTION_EVENT_SINK, PA_SUBSCRIPTION_EVENT_CHANGE}, 
+    {"sink-removed", PA_SUBSCRIPTION_EVENT_SINK, PA_SUBSCRIPTION_EVENT_REMOVE}, 
+    {"source-new", PA_SUBSCRIPTION_EVENT_SOURCE, PA_SUBSCRIPTION_EVENT_NEW}, 
+    {"source-changed", PA_SUBSCRIPTION_EVENT_SOURCE, PA_SUBSCRIPTION_EVENT_CHANGE}, 
+    {"source-removed", PA_SUBSCRIPTION_EVENT_SOURCE, PA_SUBSCRIPTION_EVENT_REMOVE}, 
+    {"card-new", PA_SUBSCRIPTION_EVENT_CARD, PA_SUBSCRIPTION_EVENT_NEW}, 
+    {"card-changed", PA_SUBSCRIPTION_EVENT_CARD, PA_SUBSCRIPTION_EVENT_CHANGE}, 
+    {"card-removed", PA_SUBSCRIPTION_EVENT_CARD, PA_SUBSCRIPTION_EVENT_REMOVE}, 
+    {"server-new", PA_SUBSCRIPTION_EVENT_SERVER, PA_SUBSCRIPTION_EVENT_NEW}, 
+    {"server-changed", PA_SUBSCRIPTION_EVENT_SERVER, PA_SUBSCRIPTION_EVENT_CHANGE}, 
+    {"server-removed", PA_SUBSCRIPTION_EVENT_SERVER, PA_SUBSCRIPTION_EVENT_REMOVE}, 
+    {"sink-input-new", PA_SUBSCRIPTION_EVENT_SINK_INPUT, PA_SUBSCRIPTION_EVENT_NEW}, 
+    {"sink-input-changed", PA_SUBSCRIPTION_EVENT_SINK_INPUT, PA_SUBSCRIPTION_EVENT_CHANGE}, 
+    {"sink-input-removed", PA_SUBSCRIPTION_EVENT_SINK_INPUT, PA_SUBSCRIPTION_EVENT_REMOVE}, 
+    {"source-output-new", PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT, PA_SUBSCRIPTION_EVENT_NEW}, 
+    {"source-output-changed", PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT, PA_SUBSCRIPTION_EVENT_CHANGE}, 
+    {"source-output-removed", PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT, PA_SUBSCRIPTION_EVENT_REMOVE}
+};
+
+#define M_SIGNAL_COUNT (sizeof(m_signals) / sizeof(m_signals[0]))
+
 static PyObject *m_connect(DeepinPulseAudioObject *self, PyObject *args)         
 {
     char *signal = NULL;                                                         
     PyObject *callback = NULL;                                                      
+    PyObject **slot = NULL;
+    int i;
                                                                                 
     if (!PyArg_ParseTuple(args, "sO:set_callback", &signal, &callback)) {             
         ERROR("invalid arguments to connect");                                  
         return NULL;                                                            
     }                                                                           
                                                                                 
-    if (!PyCallable_Check(callback)) {                                              
+    if (callback == Py_None) {
+        callback = NULL; /* connect(signal, None) removes the callback */
+    } else if (!PyCallable_Check(callback)) {                                              
         Py_INCREF(Py_False);                                                    
         return Py_False;                                                        
     }                                                                           
 
-    if (strcmp(signal, "sink-new") == 0) {                                         
-        Py_XINCREF(callback);                                                       
-        Py_XDECREF(self->sink_new_cb);                                           
-        self->sink_new_cb = callback;
+    for (i = 0; i < M_SIGNAL_COUNT; i++) {
+        if (strcmp(signal, m_signals[i].name) == 0) {
+            slot = &self->signal_cb[m_signals[i].facility][M_EVENT_SLOT(m_signals[i].type)];
+            Py_XINCREF(callback);
+            Py_XDECREF(*slot);
+            *slot = callback;
+            break;
+        }
     }
 
-    if (strcmp(signal, "sink-changed") == 0) {                                         
-        Py_XINCREF(callback);                                                       
-        Py_XDECREF(self->sink_changed_cb);                                           
-        self->sink_changed_cb = callback;
-    }
+    m_update_subscription(self);
 
-    if (strcmp(signal, "sink-removed") == 0) {                                         
-        Py_XINCREF(callback);                                                       
-        Py_XDECREF(self->sink_removed_cb);                                           
-        self->sink_removed_cb = callback;
-    }
+    Py_INCREF(Py_True);                                                         
+    return Py_True;                                                             
+}
 
-    if (strcmp(signal, "source-new") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->source_new_cb);                                         
-        self->source_new_cb = callback;                                          
-    }
-    
-    if (strcmp(signal, "source-changed") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->source_changed_cb);                                         
-        self->source_changed_cb = callback;                                          
-    }
+static PyObject *m_disconnect(DeepinPulseAudioObject *self, PyObject *args)
+{
+    char *signal = NULL;
+    PyObject *connect_args = NULL;
+    PyObject *ret = NULL;
 
-    if (strcmp(signal, "source-removed") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->source_removed_cb);                                         
-        self->source_removed_cb = callback;                                          
+    if (!PyArg_ParseTuple(args, "s", &signal)) {
+        ERROR("invalid arguments to disconnect");
+        return NULL;
     }
 
-    if (strcmp(signal, "card-new") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->card_new_cb);                                         
-        self->card_new_cb = callback;                                          
-    }                                                                           
-                                                                                
-    if (strcmp(signal, "card-changed") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->card_changed_cb);                                         
-        self->card_changed_cb = callback;                                          
-    }                                                                           
-                                                                                
-    if (strcmp(signal, "card-removed") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->card_removed_cb);                                         
-        self->card_removed_cb = callback;                                          
-    }                                                                           
-                                                                                
-
-    if (strcmp(signal, "server-new") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->server_new_cb);                                         
-        self->server_new_cb = callback;                                          
-    }                                                                           
-
-    if (strcmp(signal, "server-changed") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->server_changed_cb);                                         
-        self->server_changed_cb = callback;                                          
-    }                                                                           
-
-    if (strcmp(signal, "server-removed") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->server_removed_cb);                                         
-        self->server_removed_cb = callback;                                          
-    }                                                                           
-
-    if (strcmp(signal, "sink-input-new") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->sink_input_new_cb);                                         
-        self->sink_input_new_cb = callback;                                          
-    }                                                                           
-
-    if (strcmp(signal, "sink-input-changed") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->sink_input_changed_cb);                                         
-        self->sink_input_changed_cb = callback;                                          
-    }                                                                           
-
-    if (strcmp(signal, "sink-input-removed") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->sink_input_removed_cb);                                         
-        self->sink_input_removed_cb = callback;                                          
-    }                                                                           
+    connect_args = Py_BuildValue("(sO)", signal, Py_None);
+    if (!connect_args)
+        return NULL;
+    ret = m_connect(self, connect_args);
+    Py_DECREF(connect_args);
+    return ret;
+}
 
-    if (strcmp(signal, "source-output-new") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->source_output_new_cb);                                         
-        self->source_output_new_cb = callback;                                          
-    }                                                                           
+static PyObject *m_set_subscription_mask(DeepinPulseAudioObject *self, 
+                                         PyObject *args)
+{
+    int mask = -1;
 
-    if (strcmp(signal, "source-output-changed") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->source_output_changed_cb);                                         
-        self->source_output_changed_cb = callback;                                          
-    }                                                                           
+    if (!PyArg_ParseTuple(args, "i", &mask)) {
+        ERROR("invalid arguments to set_subscription_mask");
+        return NULL;
+    }
 
-    if (strcmp(signal, "source-output-removed") == 0) {                                     
-        Py_XINCREF(callback);                                                   
-        Py_XDECREF(self->source_output_removed_cb);                                         
-        self->source_output_removed_cb = callback;                                          
-    }                                                                           
+    self->subscribe_mask = mask < 0 ? -1 : mask & PA_SUBSCRIPTION_MASK_ALL;
+    m_update_subscription(self);
+    RETURN_TRUE;
+}
 
-    Py_INCREF(Py_True);                                                         
-    return Py_True;                                                             
+static PyObject *m_get_subscription_mask(DeepinPulseAudioObject *self)
+{
+    return INT(m_subscription_mask(self));
 }
 
 static PyObject *m_connect_record(DeepinPulseAudioObject *self, PyObject *args)
@@ -3588,6 +5410,7 @@ static PyObject *m_connect_record(DeepinPulseAudioObject *self, PyObject *args)
                                    (pa_stream_flags_t) (PA_STREAM_DONT_MOVE
                                                         |PA_STREAM_PEAK_DETECT
                                                         |PA_STREAM_ADJUST_LATENCY));
+    m_main_wakeup(self);
     
     if (res < 0) {
         ERROR("Failed to connect monitoring stream\n");
@@ -24,6 +24,15 @@
 #include <Python.h>
 #include <pulse/pulseaudio.h>
 #include <pulse/glib-mainloop.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 
 #define PACKAGE "Deepin PulseAudio Python Binding"
 
@@ -49,20 +58,335 @@ PyObject *STRING(const char *v)
     
 }
 
+#define M_TOMBSTONE_MAX 256
+#define M_SNAPSHOT_MAGIC 0x53415044 /* "DPAS" */
+#define M_SNAPSHOT_VERSION 1
+
+/* Object kinds mirrored by the state store */
+typedef enum {
+    M_SINK,
+    M_SOURCE,
+    M_SINK_INPUT,
+    M_SOURCE_OUTPUT,
+    M_CARD,
+    M_KIND_COUNT
+} m_kind;
+
+/* Callbacks kept per kind, M_KIND_COUNT standing for the server. Their
+ * names are resolved once, by connect_to_pulse() and connect(). */
+typedef enum {
+    M_SIGNAL_STATE,         /* entry of the kind in the connect_to_pulse() dict */
+    M_SIGNAL_CHANGED,       /* "<kind>-changed" */
+    M_SIGNAL_REMOVED,       /* "<kind>-removed" */
+    M_SIGNAL_COUNT
+} m_signal;
+
+/* Python objects an entry is materialized into on demand */
+typedef enum {
+    M_OBJECT_INFO,          /* device, stream or card dict */
+    M_OBJECT_CHANNELS,
+    M_OBJECT_ACTIVE_PORT,
+    M_OBJECT_VOLUME,
+    M_OBJECT_PROPLIST,
+    M_OBJECT_PORTS,
+    M_OBJECT_MUTE,
+    M_OBJECT_COUNT
+} m_object;
+
+typedef struct {
+    char *name;
+    char *description;
+    int available;
+    int direction;          /* card ports only */
+    uint32_t n_profiles;    /* card ports only */
+} m_port;
+
+typedef struct {
+    char *name;
+    char *description;
+    uint32_t n_sinks;
+    uint32_t n_sources;
+} m_profile;
+
+/* Fields an update is compared on, see m_entry_diff() */
+typedef enum {
+    M_FIELD_NAME,
+    M_FIELD_DESCRIPTION,
+    M_FIELD_VOLUME,
+    M_FIELD_MUTE,
+    M_FIELD_CHANNELS,
+    M_FIELD_ACTIVE_PORT,
+    M_FIELD_PORTS,
+    M_FIELD_CORKED,
+    M_FIELD_DEVICE,         /* sink or source a stream plays on */
+    M_FIELD_PROFILES,
+    M_FIELD_ACTIVE_PROFILE,
+    M_FIELD_PROPLIST,
+    M_FIELD_OTHER,          /* anything else, reported as the whole info */
+    M_FIELD_FALLBACK_SINK,  /* server only */
+    M_FIELD_FALLBACK_SOURCE,
+    M_FIELD_COUNT
+} m_field;
+
+#define M_FIELD_BIT(f) (1 << (f))
+#define M_FIELD_ALL (M_FIELD_BIT(M_FIELD_COUNT) - 1)
+
+/* C copy of the pa_*_info of one sink, source, stream or card */
+typedef struct {
+    m_kind kind;
+    uint32_t index;
+    guint64 generation;     /* of the last change */
+    guint64 created;        /* generation the object first appeared in */
+    char *name;
+    char *description;
+    char *driver;
+    char *resample_method;
+    uint32_t owner_module;
+    uint32_t client;
+    uint32_t parent;        /* card of a device, sink or source of a stream */
+    pa_volume_t base_volume;
+    int mute;
+    int corked;
+    int has_volume;
+    int volume_writable;
+    pa_channel_map channel_map;
+    pa_cvolume volume;
+    uint32_t n_ports;
+    m_port *ports;
+    int active_port;        /* into ports, -1 for none */
+    uint32_t n_profiles;
+    m_profile *profiles;
+    int active_profile;     /* into profiles, -1 for none */
+    pa_proplist *proplist;
+    int changed;            /* M_FIELD_BIT()s moved by the last update */
+    int added;              /* the last update created it */
+    int stale;              /* loaded from a snapshot, not confirmed since */
+    guint64 objects_generation;
+    PyObject *objects[M_OBJECT_COUNT]; /* built from this generation */
+} m_entry;
+
+typedef struct {
+    int valid;
+    guint64 generation;
+    char *user_name;
+    char *host_name;
+    char *server_version;
+    char *server_name;
+    char *default_sink_name;
+    char *default_source_name;
+    uint32_t cookie;
+    int changed;            /* M_FIELD_BIT()s moved by the last update */
+    int stale;              /* loaded from a snapshot, not confirmed since */
+} m_server;
+
+/* Remembers a removed entry for get_changes_since() */
+typedef struct {
+    gint64 key;             /* kind << 32 | index */
+    guint64 created;
+    guint64 removed;
+} m_tombstone;
+
 typedef struct {
     PyObject_HEAD
     PyObject *dict; /* Python attributes dictionary */
     pa_glib_mainloop *pa_ml;
+    GMainContext *main_ctx; /* pa_ml runs on it, see new() */
+    GMainLoop *main_loop; /* runs main_ctx on main_thread */
+    GThread *main_thread;
     pa_context *pa_ctx;
     pa_mainloop_api *pa_mlapi;
     pa_stream *stream_conn_record;
-    PyObject *event_cb; /* event callback */
+    PyObject *signal_cb[M_KIND_COUNT + 1][M_SIGNAL_COUNT]; /* see m_signal */
+    PyObject *events_cb; /* "events", see set_event_batching() */
     PyObject *state_cb; /* callback */                                       
-    PyObject *record_stream_cb; /* record stream callback */
+    PyObject *record_read_cb; /* "read" of the connect_record() dict */
+    PyObject *record_suspended_cb;
+    PyObject *pending_ops; /* set of operations still in flight */
+    GHashTable *volume_slots; /* volume writes in flight, see m_volume_coalesce */
+    int coalesce_volume;
+    int subscribe_mask; /* explicit subscription mask, -1 derives it */
+    int event_window; /* subscription event coalescing window in ms */
+    guint event_timer;
+    GHashTable *event_pending; /* facility << 32 | index -> m_pending_event */
+    struct m_pending_event *event_head; /* in arrival order */
+    struct m_pending_event *event_tail;
+    GHashTable *query_slots; /* introspection queries in flight */
+    int event_batch; /* deliver events as one "events" callback per dispatch */
+    guint batch_idle;
+    GHashTable *batch_pending; /* kind << 32 | index -> m_batched_event */
+    struct m_batched_event *batch_head; /* in arrival order */
+    struct m_batched_event *batch_tail;
+    pa_mainloop *fd_ml; /* replaces pa_ml once open_event_fd() was called */
+    int poll_fd; /* epoll set handed out by open_event_fd() */
+    int event_fd; /* readable while events wait for drain() */
+    int timer_fd; /* fires when fd_ml has a timer due */
+    int fd_blocking; /* m_event_fd_poll() may wait, see m_operation_wait */
+    int *fd_watched; /* descriptors of fd_ml mirrored into poll_fd */
+    unsigned long n_fd_watched;
+    pa_threaded_mainloop *io_ml; /* replaces pa_ml once start_io_thread() was called */
+    struct m_io_item *io_queue; /* handed over by the I/O thread, newest first */
+    int io_locked; /* depth of io_ml's lock taken by m_io_lock() */
+    GHashTable *entries[M_KIND_COUNT]; /* state store, index -> m_entry */
+    GHashTable *names[M_KIND_COUNT]; /* name -> m_entry, devices and cards */
+    m_server server;
+    guint64 generation; /* bumped on every store change */
+    guint64 kind_generation[M_KIND_COUNT];
+    GHashTable *tombstones; /* kind << 32 | index -> m_tombstone */
+    guint64 changes_floor; /* changes before this were not recorded */
+    char *snapshot_path; /* warm start file, see set_snapshot() */
+    int snapshot_pending; /* the store holds snapshot entries not confirmed yet */
 } DeepinPulseAudioObject;
 
+/* A subscription event waiting for the end of the coalescing window */
+typedef struct m_pending_event {
+    gint64 key; /* facility << 32 | index */
+    pa_subscription_event_type_t type;
+    int cancelled; /* NEW and REMOVE met inside the window */
+    struct m_pending_event *next;
+} m_pending_event;
+
+/* A decoded update waiting for the next m_batch_flush() */
+typedef struct m_batched_event {
+    gint64 key; /* kind << 32 | index, M_KIND_COUNT for the server */
+    int removed;
+    m_entry *entry; /* newest state of a device, stream or card */
+    m_server server; /* newest state of the server */
+    struct m_batched_event *next;
+} m_batched_event;
+
+/* An introspection query in flight for one object. Events that arrive
+ * meanwhile only mark it dirty, and one re-query follows the reply. */
+typedef struct {
+    gint64 key; /* facility << 32 | index */
+    DeepinPulseAudioObject *self;
+    int dirty;
+} m_query_slot;
+
+/* A volume write in flight for one sink, source or sink input. A newer
+ * value that arrives meanwhile is parked here and sent on completion. */
+typedef struct {
+    gint64 key; /* facility << 32 | index */
+    DeepinPulseAudioObject *self;
+    int queued;
+    pa_cvolume volume;
+} m_volume_slot;
+
+/* Handle returned by a setter that was given a completion callback */
+typedef struct {
+    PyObject_HEAD
+    DeepinPulseAudioObject *owner; /* borrowed, cleared on owner delete */
+    pa_operation *pa_op;
+    PyObject *done_cb;
+    int success; /* -1 pending, 0 failed or cancelled, 1 succeeded */
+} DeepinPulseAudioOperation;
+
+/* What the I/O thread of start_io_thread() hands over to Python */
+typedef enum {
+    M_IO_ENTRY,             /* decoded device, stream or card */
+    M_IO_REMOVED,
+    M_IO_SERVER,
+    M_IO_STATE,             /* context state change */
+    M_IO_OPERATION,         /* the server answered a setter */
+    M_IO_CALL,              /* run call on the Python side */
+    M_IO_PEAK,              /* record stream level */
+    M_IO_SUSPENDED          /* record stream suspended */
+} m_io_type;
+
+typedef struct m_io_item {
+    m_io_type type;
+    int event; /* ENTRY and SERVER came from a subscription event */
+    m_kind kind; /* REMOVED */
+    uint32_t index;
+    m_entry *entry;
+    m_server server;
+    int value; /* STATE: pa_context_state_t, OPERATION: success */
+    double peak;
+    DeepinPulseAudioOperation *op; /* only compared until found pending */
+    void (*call)(DeepinPulseAudioObject *self);
+    struct m_io_item *next;
+} m_io_item;
+
+/* Read-only mapping over a copy of a pa_proplist. Values only become
+ * Python strings when asked for. */
+typedef struct {
+    PyObject_HEAD
+    pa_proplist *proplist;
+} DeepinPulseAudioProplist;
+
+/* Fixed layout info records, see m_record_layouts */
+typedef enum {
+    M_RECORD_SINK,
+    M_RECORD_SOURCE,
+    M_RECORD_SINK_INPUT,
+    M_RECORD_SOURCE_OUTPUT,
+    M_RECORD_CARD,
+    M_RECORD_SERVER,
+    M_RECORD_COUNT
+} m_record;
+
+/* Values by position instead of a dict per object. Fields read as
+ * attributes or, like the dicts records replace, as record["name"]. */
+typedef struct {
+    PyObject_VAR_HEAD
+    PyObject *values[1];
+} DeepinPulseAudioRecord;
+
 static PyObject *m_deepin_pulseaudio_object_constants = NULL;
 static PyTypeObject *m_DeepinPulseAudio_Type = NULL;
+static PyTypeObject *m_DeepinPulseAudioProplist_Type = NULL;
+
+static const char *m_device_fields[] = 
+{
+    "name", "description", "base_volume", "n_ports", "mute", "ports", 
+    "proplist", NULL
+};
+
+static const char *m_sink_input_fields[] = 
+{
+    "name", "owner_module", "client", "sink", "channel", "resample_method", 
+    "driver", "proplist", "corked", "volume", "mute", "has_volume", 
+    "volume_writable", NULL
+};
+
+static const char *m_source_output_fields[] = 
+{
+    "name", "owner_module", "client", "source", "channel", "resample_method", 
+    "driver", "proplist", "corked", "volume", "mute", "has_volume", 
+    "volume_writable", NULL
+};
+
+static const char *m_card_fields[] = 
+{
+    "name", "n_profiles", "profiles", "active_profile", "proplist", "n_ports", 
+    "ports", NULL
+};
+
+static const char *m_server_fields[] = 
+{
+    "user_name", "host_name", "server_version", "server_name", 
+    "fallback_sink", "fallback_source", "cookie", NULL
+};
+
+/* Type name and field names of every m_record */
+static const struct {
+    const char *type_name;
+    const char **fields;
+} m_record_layouts[M_RECORD_COUNT] = 
+{
+    {"deepin_pulseaudio_small.SinkInfo", m_device_fields}, 
+    {"deepin_pulseaudio_small.SourceInfo", m_device_fields}, 
+    {"deepin_pulseaudio_small.SinkInputInfo", m_sink_input_fields}, 
+    {"deepin_pulseaudio_small.SourceOutputInfo", m_source_output_fields}, 
+    {"deepin_pulseaudio_small.CardInfo", m_card_fields}, 
+    {"deepin_pulseaudio_small.ServerInfo", m_server_fields}
+};
+
+/* Filled from DeepinPulseAudioRecord_Type at module init */
+static PyTypeObject m_record_types[M_RECORD_COUNT];
+static PyTypeObject *m_DeepinPulseAudioOperation_Type = NULL;
+/* Wakes Operation.wait() on threads that do not run the GMainContext */
+static GMutex m_operation_mutex;
+static GCond m_operation_cond;
 
 static DeepinPulseAudioObject *m_init_deepin_pulseaudio_object();
 static void m_pa_context_subscribe_cb(pa_context *c,                            
@@ -70,17 +394,51 @@ static void m_pa_context_subscribe_cb(pa_context *c,
                                       uint32_t idx,                             
                                       void *userdata);                          
 static void m_context_state_cb(pa_context *c, void *userdata);
+static void m_event_clear(DeepinPulseAudioObject *self);
+static gboolean m_event_flush(gpointer userdata);
+static void m_batch_clear(DeepinPulseAudioObject *self);
+static gboolean m_batch_flush(gpointer userdata);
+static m_batched_event *m_batch_slot(DeepinPulseAudioObject *self, m_kind kind, uint32_t index);
+static PyObject *m_batch_take(DeepinPulseAudioObject *self);
+static int m_event_fd_poll(struct pollfd *ufds, unsigned long nfds, int timeout, void *userdata);
+static void m_event_fd_dispatch(DeepinPulseAudioObject *self);
+gboolean m_connect_to_pulse_again(DeepinPulseAudioObject *self);
+static int m_io_thread(DeepinPulseAudioObject *self);
+static m_io_item *m_io_item_new(m_io_type type);
+static void m_io_push(DeepinPulseAudioObject *self, m_io_item *item);
+static void m_io_defer(DeepinPulseAudioObject *self, void (*call)(DeepinPulseAudioObject *self));
+static void m_io_run(DeepinPulseAudioObject *self);
+static void m_io_clear(DeepinPulseAudioObject *self);
+static void m_io_lock(DeepinPulseAudioObject *self);
+static void m_io_unlock(DeepinPulseAudioObject *self);
+static void m_update_subscription(DeepinPulseAudioObject *self);
 static DeepinPulseAudioObject *m_new(PyObject *self, PyObject *args);
 static PyObject *m_pa_volume_get_balance(PyObject *self, PyObject *args);
 
 static PyMethodDef deepin_pulseaudio_small_methods[] = 
 {
-    {"new", (PyCFunction)m_new, METH_NOARGS, "Deepin PulseAudio Construction"}, 
+    {"new", (PyCFunction)m_new, METH_VARARGS, "Deepin PulseAudio Construction, optionally on a GMainContext or a thread of its own"}, 
     {"volume_get_balance", m_pa_volume_get_balance, METH_VARARGS, "Get volume balance"},
     {NULL, NULL, 0, NULL}
 };
 
 static PyObject *m_delete(DeepinPulseAudioObject *self);
+static void m_store_init(DeepinPulseAudioObject *self);
+static void m_store_destroy(DeepinPulseAudioObject *self);
+static void m_snapshot_sweep(DeepinPulseAudioObject *self);
+static void m_snapshot_drop(DeepinPulseAudioObject *self, m_kind kind, uint32_t index);
+static void m_snapshot_reconcile(DeepinPulseAudioObject *self);
+static int m_snapshot_save(DeepinPulseAudioObject *self, const char *path);
+static PyObject *m_entry_object(m_entry *e, m_object which);
+static void m_operation_cancel_all(DeepinPulseAudioObject *self);
+static void m_operation_settle(DeepinPulseAudioOperation *op, int success);
+static void m_entry_update(DeepinPulseAudioObject *self, m_entry *e, int event);
+static void m_server_update(DeepinPulseAudioObject *self, const pa_server_info *i, int event);
+static void m_context_state_run(DeepinPulseAudioObject *self, pa_context *c, pa_context_state_t state);
+static void m_pa_event_removed_cb(DeepinPulseAudioObject *self, m_kind kind, uint32_t index);
+static void m_signal_clear(DeepinPulseAudioObject *self);
+static void m_record_read(DeepinPulseAudioObject *self, double v);
+static void m_record_suspended(DeepinPulseAudioObject *self);
 static void m_pa_server_info_cb(pa_context *c,
                                 const pa_server_info *i,
                                 void *userdata);
@@ -111,6 +469,13 @@ static PyObject *m_get_output_devices(DeepinPulseAudioObject *self);
 static PyObject *m_get_input_devices(DeepinPulseAudioObject *self);
 static PyObject *m_get_playback_streams(DeepinPulseAudioObject *self);
 static PyObject *m_get_record_streams(DeepinPulseAudioObject *self);
+static PyObject *m_get_sink_by_name(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_get_source_by_name(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_get_card_by_name(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_fallback_sink_index(DeepinPulseAudioObject *self);
+static PyObject *m_fallback_source_index(DeepinPulseAudioObject *self);
+static PyObject *m_get_generation(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_get_changes_since(DeepinPulseAudioObject *self, PyObject *args);
 
 static PyObject *m_set_output_active_port(DeepinPulseAudioObject *self, PyObject *args);
 static PyObject *m_set_input_active_port(DeepinPulseAudioObject *self, PyObject *args);
@@ -125,44 +490,111 @@ static PyObject *m_set_input_volume_with_balance(DeepinPulseAudioObject *self, P
 
 static PyObject *m_set_sink_input_mute(DeepinPulseAudioObject *self, PyObject *args);
 static PyObject *m_set_sink_input_volume(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_set_volume_coalescing(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_set_event_window(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_set_event_batching(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_open_event_fd(DeepinPulseAudioObject *self);
+static PyObject *m_drain(DeepinPulseAudioObject *self);
+static PyObject *m_start_io_thread(DeepinPulseAudioObject *self);
+static PyObject *m_set_snapshot(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_save_snapshot(DeepinPulseAudioObject *self);
 
 static PyObject *m_set_fallback_sink(DeepinPulseAudioObject *self, PyObject *args);
 static PyObject *m_set_fallback_source(DeepinPulseAudioObject *self, PyObject *args);
 
 static PyObject *m_connect_to_pulse(DeepinPulseAudioObject *self, PyObject *args);
 static PyObject *m_connect(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_disconnect(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_set_subscription_mask(DeepinPulseAudioObject *self, PyObject *args);
+static PyObject *m_get_subscription_mask(DeepinPulseAudioObject *self);
 static PyObject *m_connect_record(DeepinPulseAudioObject *self, PyObject *args);
 
+/* Methods that talk to libpulse hold the I/O thread's lock, if there is
+ * one, see start_io_thread() */
+#define M_IO_LOCKED(fn) \
+static PyObject *fn##_locked(DeepinPulseAudioObject *self, PyObject *args) \
+{ \
+    PyCFunction call = (PyCFunction) fn; \
+    PyObject *ret = NULL; \
+    m_io_lock(self); \
+    ret = call((PyObject *) self, args); \
+    m_io_unlock(self); \
+    return ret; \
+}
+
+M_IO_LOCKED(m_connect_to_pulse)
+M_IO_LOCKED(m_connect)
+M_IO_LOCKED(m_disconnect)
+M_IO_LOCKED(m_set_subscription_mask)
+M_IO_LOCKED(m_connect_record)
+M_IO_LOCKED(m_get_server_info)
+M_IO_LOCKED(m_get_cards)
+M_IO_LOCKED(m_get_output_devices)
+M_IO_LOCKED(m_get_input_devices)
+M_IO_LOCKED(m_get_playback_streams)
+M_IO_LOCKED(m_get_record_streams)
+M_IO_LOCKED(m_set_output_active_port)
+M_IO_LOCKED(m_set_input_active_port)
+M_IO_LOCKED(m_set_output_mute)
+M_IO_LOCKED(m_set_input_mute)
+M_IO_LOCKED(m_set_output_volume)
+M_IO_LOCKED(m_set_output_volume_with_balance)
+M_IO_LOCKED(m_set_input_volume)
+M_IO_LOCKED(m_set_input_volume_with_balance)
+M_IO_LOCKED(m_set_sink_input_mute)
+M_IO_LOCKED(m_set_sink_input_volume)
+M_IO_LOCKED(m_set_event_batching)
+M_IO_LOCKED(m_set_fallback_sink)
+M_IO_LOCKED(m_set_fallback_source)
+
 static PyMethodDef deepin_pulseaudio_object_methods[] = 
 {
     {"delete", (PyCFunction)m_delete, METH_NOARGS, "Deepin PulseAudio destruction"}, 
-    {"connect_to_pulse", (PyCFunction)m_connect_to_pulse, METH_VARARGS, "Connect to PulseAudio"},
-    {"connect", (PyCFunction)m_connect, METH_VARARGS, "Connect signal callback"},
-    {"connect_record", (PyCFunction)m_connect_record, METH_VARARGS, "Connect stream to a source"},
-
-    {"get_server_info", (PyCFunction)m_get_server_info, METH_NOARGS, "Get server info"},
-    {"get_cards", (PyCFunction)m_get_cards, METH_NOARGS, "Get card list"}, 
-    {"get_output_devices", (PyCFunction)m_get_output_devices, METH_NOARGS, "Get output device list"},  
-    {"get_input_devices", (PyCFunction)m_get_input_devices, METH_NOARGS, "Get input device list"},      
-    {"get_playback_streams", (PyCFunction)m_get_playback_streams, METH_NOARGS, "Get playback stream list"},
-    {"get_record_streams", (PyCFunction)m_get_record_streams, METH_NOARGS, "Get record stream list"},
-
-    {"set_output_active_port", (PyCFunction)m_set_output_active_port, METH_VARARGS, "Set output active port"}, 
-    {"set_input_active_port", (PyCFunction)m_set_input_active_port, METH_VARARGS, "Set input active port"}, 
-
-    {"set_output_mute", (PyCFunction)m_set_output_mute, METH_VARARGS, "Set output mute"}, 
-    {"set_input_mute", (PyCFunction)m_set_input_mute, METH_VARARGS, "Set input mute"}, 
-
-    {"set_output_volume", (PyCFunction)m_set_output_volume, METH_VARARGS, "Set output volume"}, 
-    {"set_output_volume_with_balance", (PyCFunction)m_set_output_volume_with_balance, METH_VARARGS, "Set output volume"}, 
-    {"set_input_volume", (PyCFunction)m_set_input_volume, METH_VARARGS, "Set input volume"}, 
-    {"set_input_volume_with_balance", (PyCFunction)m_set_input_volume_with_balance, METH_VARARGS, "Set input volume"}, 
-
-    {"set_sink_input_mute", (PyCFunction)m_set_sink_input_mute, METH_VARARGS, "Set sink_input mute"},
-    {"set_sink_input_volume", (PyCFunction)m_set_sink_input_volume, METH_VARARGS, "Set sink_input volume"},
+    {"connect_to_pulse", (PyCFunction)m_connect_to_pulse_locked, METH_VARARGS, "Connect to PulseAudio"},
+    {"connect", (PyCFunction)m_connect_locked, METH_VARARGS, "Connect signal callback"},
+    {"disconnect", (PyCFunction)m_disconnect_locked, METH_VARARGS, "Disconnect signal callback"},
+    {"set_subscription_mask", (PyCFunction)m_set_subscription_mask_locked, METH_VARARGS, "Override subscription mask, -1 derives it from the callbacks"},
+    {"get_subscription_mask", (PyCFunction)m_get_subscription_mask, METH_NOARGS, "Get subscription mask"},
+    {"connect_record", (PyCFunction)m_connect_record_locked, METH_VARARGS, "Connect stream to a source"},
+
+    {"get_server_info", (PyCFunction)m_get_server_info_locked, METH_NOARGS, "Get server info"},
+    {"get_cards", (PyCFunction)m_get_cards_locked, METH_NOARGS, "Get card list"}, 
+    {"get_output_devices", (PyCFunction)m_get_output_devices_locked, METH_NOARGS, "Get output device list"},  
+    {"get_input_devices", (PyCFunction)m_get_input_devices_locked, METH_NOARGS, "Get input device list"},      
+    {"get_playback_streams", (PyCFunction)m_get_playback_streams_locked, METH_NOARGS, "Get playback stream list"},
+    {"get_record_streams", (PyCFunction)m_get_record_streams_locked, METH_NOARGS, "Get record stream list"},
+    {"get_sink_by_name", (PyCFunction)m_get_sink_by_name, METH_VARARGS, "Get sink index by name"},
+    {"get_source_by_name", (PyCFunction)m_get_source_by_name, METH_VARARGS, "Get source index by name"},
+    {"get_card_by_name", (PyCFunction)m_get_card_by_name, METH_VARARGS, "Get card index by name"},
+    {"fallback_sink_index", (PyCFunction)m_fallback_sink_index, METH_NOARGS, "Get fallback sink index"},
+    {"fallback_source_index", (PyCFunction)m_fallback_source_index, METH_NOARGS, "Get fallback source index"},
+    {"get_generation", (PyCFunction)m_get_generation, METH_VARARGS, "Get store generation, or of one entry given kind and index"},
+    {"get_changes_since", (PyCFunction)m_get_changes_since, METH_VARARGS, "Get indices added, changed or removed after a generation"},
+
+    {"set_output_active_port", (PyCFunction)m_set_output_active_port_locked, METH_VARARGS, "Set output active port"}, 
+    {"set_input_active_port", (PyCFunction)m_set_input_active_port_locked, METH_VARARGS, "Set input active port"}, 
+
+    {"set_output_mute", (PyCFunction)m_set_output_mute_locked, METH_VARARGS, "Set output mute"}, 
+    {"set_input_mute", (PyCFunction)m_set_input_mute_locked, METH_VARARGS, "Set input mute"}, 
+
+    {"set_output_volume", (PyCFunction)m_set_output_volume_locked, METH_VARARGS, "Set output volume"}, 
+    {"set_output_volume_with_balance", (PyCFunction)m_set_output_volume_with_balance_locked, METH_VARARGS, "Set output volume"}, 
+    {"set_input_volume", (PyCFunction)m_set_input_volume_locked, METH_VARARGS, "Set input volume"}, 
+    {"set_input_volume_with_balance", (PyCFunction)m_set_input_volume_with_balance_locked, METH_VARARGS, "Set input volume"}, 
+
+    {"set_sink_input_mute", (PyCFunction)m_set_sink_input_mute_locked, METH_VARARGS, "Set sink_input mute"},
+    {"set_sink_input_volume", (PyCFunction)m_set_sink_input_volume_locked, METH_VARARGS, "Set sink_input volume"},
+    {"set_volume_coalescing", (PyCFunction)m_set_volume_coalescing, METH_VARARGS, "Only send the newest of rapid volume writes"},
+    {"set_event_window", (PyCFunction)m_set_event_window, METH_VARARGS, "Coalesce subscription events over a window in ms, 0 disables"},
+    {"set_event_batching", (PyCFunction)m_set_event_batching_locked, METH_VARARGS, "Deliver subscription events as one \"events\" callback per dispatch"},
+    {"open_event_fd", (PyCFunction)m_open_event_fd, METH_NOARGS, "Run without GLib, return a descriptor to poll before drain()"},
+    {"drain", (PyCFunction)m_drain, METH_NOARGS, "Dispatch what is ready and return the queued events"},
+    {"start_io_thread", (PyCFunction)m_start_io_thread, METH_NOARGS, "Run libpulse on a thread of its own, return a descriptor to poll before drain()"},
+    {"set_snapshot", (PyCFunction)m_set_snapshot, METH_VARARGS, "Keep the state in a file across runs, fill an empty store from it"},
+    {"save_snapshot", (PyCFunction)m_save_snapshot, METH_NOARGS, "Write the state to the snapshot file now"},
     
-    {"set_fallback_sink", (PyCFunction)m_set_fallback_sink, METH_VARARGS, "Set fallback sink"},
-    {"set_fallback_source", (PyCFunction)m_set_fallback_source, METH_VARARGS, "Set fallback source"},
+    {"set_fallback_sink", (PyCFunction)m_set_fallback_sink_locked, METH_VARARGS, "Set fallback sink"},
+    {"set_fallback_source", (PyCFunction)m_set_fallback_source_locked, METH_VARARGS, "Set fallback source"},
     {NULL, NULL, 0, NULL}
 };
 
@@ -281,232 +713,2759 @@ static PyTypeObject DeepinPulseAudio_Type = {
     (inquiry)m_deepin_pulseaudio_clear
 };
 
-PyMODINIT_FUNC initdeepin_pulseaudio_small() 
+static void m_operation_dealloc(DeepinPulseAudioOperation *self);
+static PyObject *m_operation_done(DeepinPulseAudioOperation *self);
+static PyObject *m_operation_wait(DeepinPulseAudioOperation *self, PyObject *args);
+static PyObject *m_operation_cancel(DeepinPulseAudioOperation *self);
+static PyObject *m_operation_get_success(DeepinPulseAudioOperation *self);
+
+static PyMethodDef deepin_pulseaudio_operation_methods[] = 
 {
-    PyObject *m = NULL;
-             
-    m_DeepinPulseAudio_Type = &DeepinPulseAudio_Type;
-    DeepinPulseAudio_Type.ob_type = &PyType_Type;
+    {"done", (PyCFunction)m_operation_done, METH_NOARGS, "Whether the operation finished"},
+    {"wait", (PyCFunction)m_operation_wait, METH_VARARGS, "Wait for the operation, optionally for timeout seconds"},
+    {"cancel", (PyCFunction)m_operation_cancel, METH_NOARGS, "Cancel the operation"},
+    {"get_success", (PyCFunction)m_operation_get_success, METH_NOARGS, "Get operation result"},
+    {NULL, NULL, 0, NULL}
+};
 
-    m = Py_InitModule("deepin_pulseaudio_small", deepin_pulseaudio_small_methods);
-    if (!m)
-        return;
-    // pulseaudio module constants
-    if (PyModule_AddObject(m, "CVOLUME_SNPRINT_MAX",
-                           PyLong_FromLong(PA_CVOLUME_SNPRINT_MAX)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "DECIBEL_MININFTY",
-                           PyFloat_FromDouble(PA_DECIBEL_MININFTY)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "SW_CVOLUME_SNPRINT_DB_MAX",
-                           PyLong_FromLong(PA_SW_CVOLUME_SNPRINT_DB_MAX)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "SW_VOLUME_SNPRINT_DB_MAX",
-                           PyLong_FromLong(PA_SW_VOLUME_SNPRINT_DB_MAX)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "VOLUME_INVALID",
-                           PyLong_FromUnsignedLong(PA_VOLUME_INVALID)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "VOLUME_MAX",
-                           PyLong_FromUnsignedLong(PA_VOLUME_MAX)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "VOLUME_MUTED",
-                           PyLong_FromUnsignedLong(PA_VOLUME_MUTED)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "VOLUME_NORM",
-                           PyLong_FromUnsignedLong(PA_VOLUME_NORM)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "VOLUME_SNPRINT_MAX",
-                           PyLong_FromLong(PA_VOLUME_SNPRINT_MAX)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "VOLUME_UI_MAX",
-                           PyLong_FromLong(PA_VOLUME_UI_MAX)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "API_VERSION",
-                           PyLong_FromLong(PA_API_VERSION)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "MAJOR",
-                           PyLong_FromLong(PA_MAJOR)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "MICRO",
-                           PyLong_FromLong(PA_MICRO)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "MINOR",
-                           PyLong_FromLong(PA_MINOR)) < 0) {
-        return;
-    }
-    if (PyModule_AddObject(m, "PROTOCOL_VERSION",
-                           PyLong_FromLong(PA_PROTOCOL_VERSION)) < 0) {
-        return;
-    }
-    m_deepin_pulseaudio_object_constants = PyDict_New();
+static PyObject *m_operation_getattr(DeepinPulseAudioOperation *op, 
+                                     char *name) 
+{
+    return Py_FindMethod(deepin_pulseaudio_operation_methods, (PyObject *)op, name);
 }
 
-static DeepinPulseAudioObject *m_init_deepin_pulseaudio_object() 
-{
-    DeepinPulseAudioObject *self = NULL;
+static PyTypeObject DeepinPulseAudioOperation_Type = {
+    PyObject_HEAD_INIT(NULL)
+    0, 
+    "deepin_pulseaudio_small.Operation", 
+    sizeof(DeepinPulseAudioOperation), 
+    0, 
+    (destructor)m_operation_dealloc,
+    0, 
+    (getattrfunc)m_operation_getattr, 
+    0, 
+};
 
-    self = (DeepinPulseAudioObject *) PyObject_GC_New(DeepinPulseAudioObject, 
-                                                      m_DeepinPulseAudio_Type);
-    if (!self)
-        return NULL;
-    
-    PyObject_GC_Track(self);
+static PyObject *m_proplist_value(const pa_proplist *p, const char *key)
+{
+    const char *value = pa_proplist_gets(p, key);
 
-    self->dict = NULL;
-    
-    self->state_cb = NULL;
-    self->event_cb = NULL;
-    self->record_stream_cb = NULL;
+    // binary properties have no string form
+    if (!value) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    return PyString_FromString(value);
+}
 
-    self->pa_ml = NULL;                                                         
-    self->pa_ctx = NULL;                                                        
-    self->pa_mlapi = NULL;                                                      
-    self->stream_conn_record = NULL;
-                                                                                
-    return self;
+static void m_proplist_dealloc(DeepinPulseAudioProplist *self)
+{
+    if (self->proplist)
+        pa_proplist_free(self->proplist);
+    PyObject_Del(self);
 }
 
-static DeepinPulseAudioObject *m_new(PyObject *dummy, PyObject *args) 
+static Py_ssize_t m_proplist_length(DeepinPulseAudioProplist *self)
 {
-    DeepinPulseAudioObject *self = NULL;
+    return pa_proplist_size(self->proplist);
+}
 
-    self = m_init_deepin_pulseaudio_object();
-    if (!self)
-        return NULL;
+static int m_proplist_contains(DeepinPulseAudioProplist *self, PyObject *key)
+{
+    if (!PyString_Check(key))
+        return 0;
+    return pa_proplist_contains(self->proplist, PyString_AS_STRING(key)) == 1;
+}
 
-    self->event_cb = PyDict_New();
-    if (!self->event_cb) {
-        ERROR("PyDict_New error");
-        m_delete(self);
-        return NULL;
-    }
-    
-    self->pa_ml = pa_glib_mainloop_new(g_main_context_default());
-    if (!self->pa_ml) {
-        ERROR("pa_glib_mainloop_new() failed");
-        m_delete(self);
+static PyObject *m_proplist_subscript(DeepinPulseAudioProplist *self, PyObject *key)
+{
+    if (!m_proplist_contains(self, key)) {
+        PyErr_SetObject(PyExc_KeyError, key);
         return NULL;
     }
+    return m_proplist_value(self->proplist, PyString_AS_STRING(key));
+}
 
-    self->pa_mlapi = pa_glib_mainloop_get_api(self->pa_ml);
-    if (!self->pa_mlapi) {
-        ERROR("pa_glib_mainloop_get_api() failed");
-        m_delete(self);
+static PyObject *m_proplist_get(DeepinPulseAudioProplist *self, PyObject *args)
+{
+    PyObject *key = NULL;
+    PyObject *default_value = Py_None;
+
+    if (!PyArg_ParseTuple(args, "O|O:get", &key, &default_value))
         return NULL;
+
+    if (!m_proplist_contains(self, key)) {
+        Py_INCREF(default_value);
+        return default_value;
     }
-    return self;
+    return m_proplist_value(self->proplist, PyString_AS_STRING(key));
 }
 
-static PyObject *m_pa_volume_get_balance(PyObject *self, PyObject *args)
+static PyObject *m_proplist_has_key(DeepinPulseAudioProplist *self, PyObject *key)
 {
-    pa_cvolume cvolume;
-    pa_channel_map channel_map;
-    PyObject *volume = NULL;
-    PyObject *channel = NULL;
-    PyObject *balance = NULL;
-    int channel_num = 0;
-    int i;
-    Py_ssize_t size_volume, size_channel;
-
-    if (!PyArg_ParseTuple(args, "iOO", &channel_num, &volume, &channel)) {
-        ERROR("invalid arguments to connect");                                  
-        return NULL;                                                            
-    }
-    if (PyList_Check(volume)) {
-        volume = PyList_AsTuple(volume);
-    }
-    if (!PyTuple_Check(volume)) {
-        ERROR("volume is not Tuple\n");
-        Py_RETURN_NONE;
-    }
+    return PyBool_FromLong(m_proplist_contains(self, key));
+}
 
-    if (PyList_Check(channel)) {
-        channel = PyList_AsTuple(channel);
-    }
-    if (!PyTuple_Check(channel)) {
-        ERROR("channel is not Tuple\n");
-        Py_RETURN_NONE;
-    }
+/* keys(), values() or items() */
+static PyObject *m_proplist_list(DeepinPulseAudioProplist *self, char what)
+{
+    PyObject *list = NULL;
+    PyObject *tmp_obj = NULL;
+    const char *key;
+    void *state = NULL;
 
-    memset(&cvolume, 0, sizeof(pa_cvolume));
-    memset(&channel_map, 0, sizeof(pa_channel_map));
-    channel_map.channels = channel_num;
-    cvolume.channels = channel_num;
+    list = PyList_New(0);
+    if (!list)
+        return NULL;
 
-    size_volume = PyTuple_Size(volume);
-    size_channel = PyTuple_Size(channel);
-    for (i = 0; i < size_volume; i++) {
-        cvolume.values[i] = PyInt_AsUnsignedLongMask(PyTuple_GetItem(volume, i));
-    }
-    for (i = 0; i < size_channel; i++) {
-        channel_map.map[i] = PyInt_AsUnsignedLongMask(PyTuple_GetItem(channel, i));
+    while ((key = pa_proplist_iterate(self->proplist, &state))) {
+        if (what == 'k')
+            tmp_obj = PyString_FromString(key);
+        else if (what == 'v')
+            tmp_obj = m_proplist_value(self->proplist, key);
+        else
+            tmp_obj = Py_BuildValue("(sN)", key, m_proplist_value(self->proplist, key));
+        if (!tmp_obj) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_Append(list, tmp_obj);
+        Py_DECREF(tmp_obj);
     }
-    balance = PyFloat_FromDouble(pa_cvolume_get_balance(&cvolume, &channel_map));
-    Py_INCREF(balance);
-    return balance;
+    return list;
 }
 
-static PyObject *m_delete(DeepinPulseAudioObject *self) 
+static PyObject *m_proplist_keys(DeepinPulseAudioProplist *self)
 {
-    if (self->event_cb) {
-        Py_XDECREF(self->event_cb);
-    }
-
-    if (self->stream_conn_record) {
-        pa_stream_disconnect(self->stream_conn_record);
-        pa_stream_unref(self->stream_conn_record);
-        self->stream_conn_record = NULL;
-    }
-                                                                                
-    if (self->pa_ctx) {                                                         
-        pa_context_disconnect(self->pa_ctx);                                    
-        pa_context_unref(self->pa_ctx);                                         
-        self->pa_ctx = NULL;                                                    
-    }                                                                           
-                                                                                
-    if (self->pa_ml) {                                                          
-        pa_glib_mainloop_free(self->pa_ml);                                     
-        self->pa_ml = NULL;                                                     
-    }
+    return m_proplist_list(self, 'k');
+}
 
-    Py_INCREF(Py_None);
-    return Py_None;
+static PyObject *m_proplist_values(DeepinPulseAudioProplist *self)
+{
+    return m_proplist_list(self, 'v');
 }
 
-//**********************************
-// pa get function
-static PyObject *m_get_server_info(DeepinPulseAudioObject *self)
+static PyObject *m_proplist_items(DeepinPulseAudioProplist *self)
 {
-    if (!self->pa_ctx || pa_context_get_state(self->pa_ctx) != PA_CONTEXT_READY) {
-        RETURN_FALSE;
-    }
-    pa_operation *pa_op = NULL;
-    if (!(pa_op = pa_context_get_server_info(self->pa_ctx, m_pa_server_info_cb, self))) {
-        ERROR("pa_context_get_server_info() failed");
-        RETURN_FALSE;
-    }
-    pa_operation_unref(pa_op);
-    RETURN_TRUE;
+    return m_proplist_list(self, 'i');
 }
 
-static PyObject *m_get_cards(DeepinPulseAudioObject *self) 
+/* A plain dict of every property, what info dicts used to carry */
+static PyObject *m_proplist_copy(DeepinPulseAudioProplist *self)
 {
-    if (!self->pa_ctx || pa_context_get_state(self->pa_ctx) != PA_CONTEXT_READY) {
-        RETURN_FALSE;
+    PyObject *prop_dict = NULL;
+    PyObject *tmp_obj = NULL;
+    const char *prop_key;
+    void *prop_state = NULL;
+
+    prop_dict = PyDict_New();
+    if (!prop_dict)
+        return NULL;
+
+    while ((prop_key = pa_proplist_iterate(self->proplist, &prop_state))) {
+        tmp_obj = m_proplist_value(self->proplist, prop_key);
+        PyDict_SetItemString(prop_dict, prop_key, tmp_obj);
+        Py_XDECREF(tmp_obj);
+    }
+    return prop_dict;
+}
+
+static PyObject *m_proplist_iter(DeepinPulseAudioProplist *self)
+{
+    PyObject *keys = NULL;
+    PyObject *iter = NULL;
+
+    keys = m_proplist_keys(self);
+    if (!keys)
+        return NULL;
+    iter = PyObject_GetIter(keys);
+    Py_DECREF(keys);
+    return iter;
+}
+
+static PyObject *m_proplist_repr(DeepinPulseAudioProplist *self)
+{
+    PyObject *prop_dict = NULL;
+    PyObject *repr = NULL;
+
+    prop_dict = m_proplist_copy(self);
+    if (!prop_dict)
+        return NULL;
+    repr = PyObject_Repr(prop_dict);
+    Py_DECREF(prop_dict);
+    return repr;
+}
+
+static PyMethodDef deepin_pulseaudio_proplist_methods[] = 
+{
+    {"get", (PyCFunction)m_proplist_get, METH_VARARGS, "Get a property, or default"},
+    {"has_key", (PyCFunction)m_proplist_has_key, METH_O, "Whether a property is set"},
+    {"keys", (PyCFunction)m_proplist_keys, METH_NOARGS, "Get property names"},
+    {"values", (PyCFunction)m_proplist_values, METH_NOARGS, "Get property values"},
+    {"items", (PyCFunction)m_proplist_items, METH_NOARGS, "Get (name, value) pairs"},
+    {"copy", (PyCFunction)m_proplist_copy, METH_NOARGS, "Get the properties as a dict"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyObject *m_proplist_getattr(DeepinPulseAudioProplist *self, 
+                                    char *name) 
+{
+    return Py_FindMethod(deepin_pulseaudio_proplist_methods, (PyObject *)self, name);
+}
+
+static PySequenceMethods deepin_pulseaudio_proplist_as_sequence = {
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    (objobjproc)m_proplist_contains, 
+};
+
+static PyMappingMethods deepin_pulseaudio_proplist_as_mapping = {
+    (lenfunc)m_proplist_length, 
+    (binaryfunc)m_proplist_subscript, 
+    0, 
+};
+
+static PyTypeObject DeepinPulseAudioProplist_Type = {
+    PyObject_HEAD_INIT(NULL)
+    0, 
+    "deepin_pulseaudio_small.Proplist", 
+    sizeof(DeepinPulseAudioProplist), 
+    0, 
+    (destructor)m_proplist_dealloc,
+    0, 
+    (getattrfunc)m_proplist_getattr, 
+    0, 
+    0, 
+    (reprfunc)m_proplist_repr, 
+    0, 
+    &deepin_pulseaudio_proplist_as_sequence, 
+    &deepin_pulseaudio_proplist_as_mapping, 
+    PyObject_HashNotImplemented, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    Py_TPFLAGS_DEFAULT, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    (getiterfunc)m_proplist_iter, 
+};
+
+static const char **m_record_fields(DeepinPulseAudioRecord *self)
+{
+    return m_record_layouts[Py_TYPE(self) - m_record_types].fields;
+}
+
+/* Position of the field called name, -1 if there is none */
+static int m_record_find(DeepinPulseAudioRecord *self, const char *name)
+{
+    const char **fields = m_record_fields(self);
+    int i;
+
+    for (i = 0; i < Py_SIZE(self); i++) {
+        if (strcmp(fields[i], name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void m_record_dealloc(DeepinPulseAudioRecord *self)
+{
+    Py_ssize_t i;
+
+    for (i = 0; i < Py_SIZE(self); i++)
+        Py_XDECREF(self->values[i]);
+    PyObject_Del(self);
+}
+
+static Py_ssize_t m_record_length(DeepinPulseAudioRecord *self)
+{
+    return Py_SIZE(self);
+}
+
+static int m_record_contains(DeepinPulseAudioRecord *self, PyObject *key)
+{
+    if (!PyString_Check(key))
+        return 0;
+    return m_record_find(self, PyString_AS_STRING(key)) >= 0;
+}
+
+static PyObject *m_record_subscript(DeepinPulseAudioRecord *self, PyObject *key)
+{
+    int i = -1;
+
+    if (PyString_Check(key))
+        i = m_record_find(self, PyString_AS_STRING(key));
+    if (i < 0) {
+        PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
+    }
+    Py_INCREF(self->values[i]);
+    return self->values[i];
+}
+
+static PyObject *m_record_get(DeepinPulseAudioRecord *self, PyObject *args)
+{
+    PyObject *key = NULL;
+    PyObject *default_value = Py_None;
+
+    if (!PyArg_ParseTuple(args, "O|O:get", &key, &default_value))
+        return NULL;
+
+    if (!m_record_contains(self, key)) {
+        Py_INCREF(default_value);
+        return default_value;
+    }
+    return m_record_subscript(self, key);
+}
+
+static PyObject *m_record_has_key(DeepinPulseAudioRecord *self, PyObject *key)
+{
+    return PyBool_FromLong(m_record_contains(self, key));
+}
+
+/* keys(), values() or items() */
+static PyObject *m_record_list(DeepinPulseAudioRecord *self, char what)
+{
+    const char **fields = m_record_fields(self);
+    PyObject *list = NULL;
+    PyObject *tmp_obj = NULL;
+    Py_ssize_t i;
+
+    list = PyList_New(Py_SIZE(self));
+    if (!list)
+        return NULL;
+
+    for (i = 0; i < Py_SIZE(self); i++) {
+        if (what == 'k') {
+            tmp_obj = PyString_FromString(fields[i]);
+        } else if (what == 'v') {
+            tmp_obj = self->values[i];
+            Py_INCREF(tmp_obj);
+        } else {
+            tmp_obj = Py_BuildValue("(sO)", fields[i], self->values[i]);
+        }
+        if (!tmp_obj) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, tmp_obj);
+    }
+    return list;
+}
+
+static PyObject *m_record_keys(DeepinPulseAudioRecord *self)
+{
+    return m_record_list(self, 'k');
+}
+
+static PyObject *m_record_values(DeepinPulseAudioRecord *self)
+{
+    return m_record_list(self, 'v');
+}
+
+static PyObject *m_record_items(DeepinPulseAudioRecord *self)
+{
+    return m_record_list(self, 'i');
+}
+
+/* A plain dict, what the callbacks used to get */
+static PyObject *m_record_copy(DeepinPulseAudioRecord *self)
+{
+    const char **fields = m_record_fields(self);
+    PyObject *dict = NULL;
+    Py_ssize_t i;
+
+    dict = PyDict_New();
+    if (!dict)
+        return NULL;
+
+    for (i = 0; i < Py_SIZE(self); i++)
+        PyDict_SetItemString(dict, fields[i], self->values[i]);
+    return dict;
+}
+
+static PyObject *m_record_iter(DeepinPulseAudioRecord *self)
+{
+    PyObject *keys = NULL;
+    PyObject *iter = NULL;
+
+    keys = m_record_keys(self);
+    if (!keys)
+        return NULL;
+    iter = PyObject_GetIter(keys);
+    Py_DECREF(keys);
+    return iter;
+}
+
+static PyObject *m_record_repr(DeepinPulseAudioRecord *self)
+{
+    const char **fields = m_record_fields(self);
+    const char *type_name = strrchr(Py_TYPE(self)->tp_name, '.') + 1;
+    PyObject *repr = NULL;
+    Py_ssize_t i;
+
+    repr = PyString_FromFormat("%s(", type_name);
+    for (i = 0; repr && i < Py_SIZE(self); i++) {
+        PyString_ConcatAndDel(&repr, PyString_FromFormat(i ? ", %s=" : "%s=", fields[i]));
+        if (repr)
+            PyString_ConcatAndDel(&repr, PyObject_Repr(self->values[i]));
+    }
+    if (repr)
+        PyString_ConcatAndDel(&repr, PyString_FromString(")"));
+    return repr;
+}
+
+static PyMethodDef deepin_pulseaudio_record_methods[] = 
+{
+    {"get", (PyCFunction)m_record_get, METH_VARARGS, "Get a field, or default"},
+    {"has_key", (PyCFunction)m_record_has_key, METH_O, "Whether there is such a field"},
+    {"keys", (PyCFunction)m_record_keys, METH_NOARGS, "Get field names"},
+    {"values", (PyCFunction)m_record_values, METH_NOARGS, "Get field values"},
+    {"items", (PyCFunction)m_record_items, METH_NOARGS, "Get (name, value) pairs"},
+    {"copy", (PyCFunction)m_record_copy, METH_NOARGS, "Get the fields as a dict"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyObject *m_record_getattr(DeepinPulseAudioRecord *self, 
+                                  char *name) 
+{
+    int i = m_record_find(self, name);
+
+    if (i >= 0) {
+        Py_INCREF(self->values[i]);
+        return self->values[i];
+    }
+    return Py_FindMethod(deepin_pulseaudio_record_methods, (PyObject *)self, name);
+}
+
+static PySequenceMethods deepin_pulseaudio_record_as_sequence = {
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    (objobjproc)m_record_contains, 
+};
+
+static PyMappingMethods deepin_pulseaudio_record_as_mapping = {
+    (lenfunc)m_record_length, 
+    (binaryfunc)m_record_subscript, 
+    0, 
+};
+
+/* Template for m_record_types, tp_name comes from m_record_layouts */
+static PyTypeObject DeepinPulseAudioRecord_Type = {
+    PyObject_HEAD_INIT(NULL)
+    0, 
+    NULL, 
+    offsetof(DeepinPulseAudioRecord, values), 
+    sizeof(PyObject *), 
+    (destructor)m_record_dealloc,
+    0, 
+    (getattrfunc)m_record_getattr, 
+    0, 
+    0, 
+    (reprfunc)m_record_repr, 
+    0, 
+    &deepin_pulseaudio_record_as_sequence, 
+    &deepin_pulseaudio_record_as_mapping, 
+    PyObject_HashNotImplemented, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    Py_TPFLAGS_DEFAULT, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    (getiterfunc)m_record_iter, 
+};
+
+PyMODINIT_FUNC initdeepin_pulseaudio_small() 
+{
+    PyObject *m = NULL;
+    int i;
+             
+    m_DeepinPulseAudio_Type = &DeepinPulseAudio_Type;
+    DeepinPulseAudio_Type.ob_type = &PyType_Type;
+    m_DeepinPulseAudioProplist_Type = &DeepinPulseAudioProplist_Type;
+    DeepinPulseAudioProplist_Type.ob_type = &PyType_Type;
+    for (i = 0; i < M_RECORD_COUNT; i++) {
+        m_record_types[i] = DeepinPulseAudioRecord_Type;
+        m_record_types[i].ob_type = &PyType_Type;
+        m_record_types[i].tp_name = m_record_layouts[i].type_name;
+    }
+    m_DeepinPulseAudioOperation_Type = &DeepinPulseAudioOperation_Type;
+    DeepinPulseAudioOperation_Type.ob_type = &PyType_Type;
+
+    m = Py_InitModule("deepin_pulseaudio_small", deepin_pulseaudio_small_methods);
+    if (!m)
+        return;
+    // pulseaudio module constants
+    if (PyModule_AddObject(m, "CVOLUME_SNPRINT_MAX",
+                           PyLong_FromLong(PA_CVOLUME_SNPRINT_MAX)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "DECIBEL_MININFTY",
+                           PyFloat_FromDouble(PA_DECIBEL_MININFTY)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SW_CVOLUME_SNPRINT_DB_MAX",
+                           PyLong_FromLong(PA_SW_CVOLUME_SNPRINT_DB_MAX)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SW_VOLUME_SNPRINT_DB_MAX",
+                           PyLong_FromLong(PA_SW_VOLUME_SNPRINT_DB_MAX)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "VOLUME_INVALID",
+                           PyLong_FromUnsignedLong(PA_VOLUME_INVALID)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "VOLUME_MAX",
+                           PyLong_FromUnsignedLong(PA_VOLUME_MAX)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "VOLUME_MUTED",
+                           PyLong_FromUnsignedLong(PA_VOLUME_MUTED)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "VOLUME_NORM",
+                           PyLong_FromUnsignedLong(PA_VOLUME_NORM)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "VOLUME_SNPRINT_MAX",
+                           PyLong_FromLong(PA_VOLUME_SNPRINT_MAX)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "VOLUME_UI_MAX",
+                           PyLong_FromLong(PA_VOLUME_UI_MAX)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "API_VERSION",
+                           PyLong_FromLong(PA_API_VERSION)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "MAJOR",
+                           PyLong_FromLong(PA_MAJOR)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "MICRO",
+                           PyLong_FromLong(PA_MICRO)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "MINOR",
+                           PyLong_FromLong(PA_MINOR)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "PROTOCOL_VERSION",
+                           PyLong_FromLong(PA_PROTOCOL_VERSION)) < 0) {
+        return;
+    }
+    // subscription masks for set_subscription_mask()
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_SINK",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_SINK)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_SOURCE",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_SOURCE)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_SINK_INPUT",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_SINK_INPUT)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_SOURCE_OUTPUT",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_SOURCE_OUTPUT)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_CLIENT",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_CLIENT)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_SERVER",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_SERVER)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_CARD",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_CARD)) < 0) {
+        return;
+    }
+    if (PyModule_AddObject(m, "SUBSCRIPTION_MASK_ALL",
+                           PyLong_FromLong(PA_SUBSCRIPTION_MASK_ALL)) < 0) {
+        return;
+    }
+    m_deepin_pulseaudio_object_constants = PyDict_New();
+}
+
+static DeepinPulseAudioObject *m_init_deepin_pulseaudio_object() 
+{
+    DeepinPulseAudioObject *self = NULL;
+
+    self = (DeepinPulseAudioObject *) PyObject_GC_New(DeepinPulseAudioObject, 
+                                                      m_DeepinPulseAudio_Type);
+    if (!self)
+        return NULL;
+    
+    PyObject_GC_Track(self);
+
+    self->dict = NULL;
+    
+    self->state_cb = NULL;
+    memset(self->signal_cb, 0, sizeof(self->signal_cb));
+    self->events_cb = NULL;
+    self->record_read_cb = NULL;
+    self->record_suspended_cb = NULL;
+    self->pending_ops = NULL;
+    self->volume_slots = NULL;
+    self->coalesce_volume = 0;
+    self->subscribe_mask = -1;
+    self->event_window = 0;
+    self->event_timer = 0;
+    self->event_pending = NULL;
+    self->event_head = NULL;
+    self->event_tail = NULL;
+    self->query_slots = NULL;
+    self->event_batch = 0;
+    self->batch_idle = 0;
+    self->batch_pending = NULL;
+    self->batch_head = NULL;
+    self->batch_tail = NULL;
+    self->fd_ml = NULL;
+    self->poll_fd = -1;
+    self->event_fd = -1;
+    self->timer_fd = -1;
+    self->fd_blocking = 0;
+    self->fd_watched = NULL;
+    self->n_fd_watched = 0;
+    self->io_ml = NULL;
+    self->io_queue = NULL;
+    self->io_locked = 0;
+    memset(self->entries, 0, sizeof(self->entries));
+    memset(self->names, 0, sizeof(self->names));
+    memset(&self->server, 0, sizeof(self->server));
+    self->generation = 0;
+    memset(self->kind_generation, 0, sizeof(self->kind_generation));
+    self->tombstones = NULL;
+    self->changes_floor = 0;
+    self->snapshot_path = NULL;
+    self->snapshot_pending = 0;
+
+    self->pa_ml = NULL;                                                         
+    self->main_ctx = NULL;
+    self->main_loop = NULL;
+    self->main_thread = NULL;
+    self->pa_ctx = NULL;                                                        
+    self->pa_mlapi = NULL;                                                      
+    self->stream_conn_record = NULL;
+                                                                                
+    return self;
+}
+
+/* Sources go to the context pa_ml runs on, which need not be the default one */
+static guint m_source_attach(DeepinPulseAudioObject *self, 
+                             GSource *source, 
+                             GSourceFunc func)
+{
+    guint id;
+
+    g_source_set_callback(source, func, self, NULL);
+    id = g_source_attach(source, self->main_ctx);
+    g_source_unref(source);
+    return id;
+}
+
+static void m_source_remove(DeepinPulseAudioObject *self, guint id)
+{
+    GSource *source = g_main_context_find_source_by_id(self->main_ctx, id);
+
+    if (source)
+        g_source_destroy(source);
+}
+
+/* The private thread may sit in poll while a method queued requests */
+static void m_main_wakeup(DeepinPulseAudioObject *self)
+{
+    if (self->main_thread)
+        g_main_context_wakeup(self->main_ctx);
+}
+
+/* The private thread only drops the GIL while it polls, see m_main_thread() */
+static gint m_main_poll(GPollFD *fds, guint nfds, gint timeout)
+{
+    gint ret;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = g_poll(fds, nfds, timeout);
+    Py_END_ALLOW_THREADS
+    return ret;
+}
+
+/* Runs the private context until m_main_stop(). Like any Python thread it
+ * holds the GIL while it dispatches, so it never runs alongside a method
+ * touching the context or the store. The loop is our own reference, as
+ * delete() from one of the callbacks leaves the thread to end by itself. */
+static gpointer m_main_thread(gpointer userdata)
+{
+    GMainLoop *loop = userdata;
+    GMainContext *ctx = g_main_loop_get_context(loop);
+    PyGILState_STATE gstate;
+
+    gstate = PyGILState_Ensure();
+    g_main_context_push_thread_default(ctx);
+    g_main_loop_run(loop);
+    g_main_context_pop_thread_default(ctx);
+    g_main_loop_unref(loop);
+    PyGILState_Release(gstate);
+    return NULL;
+}
+
+static void m_main_start(DeepinPulseAudioObject *self)
+{
+    PyEval_InitThreads();
+    g_main_context_set_poll_func(self->main_ctx, m_main_poll);
+    self->main_loop = g_main_loop_new(self->main_ctx, FALSE);
+    self->main_thread = g_thread_new("deepin-pulseaudio", m_main_thread, 
+                                     g_main_loop_ref(self->main_loop));
+}
+
+static gboolean m_main_quit(gpointer userdata)
+{
+    g_main_loop_quit(userdata);
+    return FALSE;
+}
+
+/* Quit the private thread and wait for it. The quit is queued on the
+ * context so that it is not lost on a thread that did not get to run the
+ * loop yet. */
+static void m_main_stop(DeepinPulseAudioObject *self)
+{
+    GSource *source = NULL;
+
+    if (!self->main_thread)
+        return;
+
+    if (g_thread_self() == self->main_thread) {
+        g_main_loop_quit(self->main_loop);
+        g_thread_unref(self->main_thread);
+    } else {
+        source = g_idle_source_new();
+        g_source_set_callback(source, m_main_quit, self->main_loop, NULL);
+        g_source_attach(source, self->main_ctx);
+        g_source_unref(source);
+        Py_BEGIN_ALLOW_THREADS
+        g_thread_join(self->main_thread);
+        Py_END_ALLOW_THREADS
+    }
+    self->main_thread = NULL;
+}
+
+/* PyGObject keeps the GMainContext right after the object head, both in
+ * gi's GLib.MainContext (a PyGBoxed) and in the static bindings'
+ * glib.MainContext. Mirrored here instead of building against pygobject.h. */
+typedef struct {
+    PyObject_HEAD
+    gpointer pointer;
+} m_pygobject_wrapper;
+
+/* The GMainContext wrapped by context, or NULL with TypeError set when it
+ * is no MainContext of a PyGObject module the application has loaded */
+static GMainContext *m_main_context_from(PyObject *context)
+{
+    static const char *modules[] = {"gi.repository.GLib", "glib"};
+    PyObject *module = NULL;
+    PyObject *type = NULL;
+    GMainContext *ctx = NULL;
+    int i;
+
+    for (i = 0; i < 2 && !ctx; i++) {
+        // only look at modules already there, importing gi into a pygtk
+        // application would break it
+        module = PyDict_GetItemString(PyImport_GetModuleDict(), modules[i]);
+        if (!module || !(type = PyObject_GetAttrString(module, "MainContext"))) {
+            PyErr_Clear();
+            continue;
+        }
+        if (PyType_Check(type) && PyObject_IsInstance(context, type) > 0)
+            ctx = ((m_pygobject_wrapper *) context)->pointer;
+        Py_DECREF(type);
+    }
+    if (!ctx)
+        ERROR("context is not a GLib.MainContext");
+    return ctx;
+}
+
+/* new(context=None, thread=False) attaches to context, a GLib.MainContext,
+ * instead of the default one. With thread a private context
+ * is created and run on a thread of our own, so the server traffic and
+ * the callbacks keep going however busy the application's main loop is. */
+static DeepinPulseAudioObject *m_new(PyObject *dummy, PyObject *args) 
+{
+    DeepinPulseAudioObject *self = NULL;
+    PyObject *context = Py_None;
+    PyObject *thread = Py_False;
+    GMainContext *ctx = NULL;
+    int private_thread = 0;
+
+    if (!PyArg_ParseTuple(args, "|OO", &context, &thread)) {
+        ERROR("invalid arguments to new");
+        return NULL;
+    }
+
+    private_thread = PyObject_IsTrue(thread) > 0;
+    if (context != Py_None) {
+        if (private_thread) {
+            ERROR("new takes a context or a thread, not both");
+            return NULL;
+        }
+        if (!(ctx = m_main_context_from(context)))
+            return NULL;
+    }
+
+    self = m_init_deepin_pulseaudio_object();
+    if (!self)
+        return NULL;
+
+    self->pending_ops = PySet_New(NULL);
+    if (!self->pending_ops) {
+        ERROR("PySet_New error");
+        m_delete(self);
+        return NULL;
+    }
+
+    self->volume_slots = g_hash_table_new_full(g_int64_hash, g_int64_equal, 
+                                               NULL, g_free);
+    
+    if (private_thread)
+        self->main_ctx = g_main_context_new();
+    else
+        self->main_ctx = g_main_context_ref(ctx ? ctx : g_main_context_default());
+
+    self->pa_ml = pa_glib_mainloop_new(self->main_ctx);
+    if (!self->pa_ml) {
+        ERROR("pa_glib_mainloop_new() failed");
+        m_delete(self);
+        return NULL;
+    }
+
+    self->pa_mlapi = pa_glib_mainloop_get_api(self->pa_ml);
+    if (!self->pa_mlapi) {
+        ERROR("pa_glib_mainloop_get_api() failed");
+        m_delete(self);
+        return NULL;
+    }
+
+    self->event_pending = g_hash_table_new(g_int64_hash, g_int64_equal);
+    self->query_slots = g_hash_table_new_full(g_int64_hash, g_int64_equal, 
+                                              NULL, g_free);
+    self->batch_pending = g_hash_table_new(g_int64_hash, g_int64_equal);
+    m_store_init(self);
+    if (private_thread)
+        m_main_start(self);
+    return self;
+}
+
+static PyObject *m_pa_volume_get_balance(PyObject *self, PyObject *args)
+{
+    pa_cvolume cvolume;
+    pa_channel_map channel_map;
+    PyObject *volume = NULL;
+    PyObject *channel = NULL;
+    PyObject *balance = NULL;
+    int channel_num = 0;
+    int i;
+    Py_ssize_t size_volume, size_channel;
+
+    if (!PyArg_ParseTuple(args, "iOO", &channel_num, &volume, &channel)) {
+        ERROR("invalid arguments to connect");                                  
+        return NULL;                                                            
+    }
+    if (PyList_Check(volume)) {
+        volume = PyList_AsTuple(volume);
+    }
+    if (!PyTuple_Check(volume)) {
+        ERROR("volume is not Tuple\n");
+        Py_RETURN_NONE;
+    }
+
+    if (PyList_Check(channel)) {
+        channel = PyList_AsTuple(channel);
+    }
+    if (!PyTuple_Check(channel)) {
+        ERROR("channel is not Tuple\n");
+        Py_RETURN_NONE;
+    }
+
+    memset(&cvolume, 0, sizeof(pa_cvolume));
+    memset(&channel_map, 0, sizeof(pa_channel_map));
+    channel_map.channels = channel_num;
+    cvolume.channels = channel_num;
+
+    size_volume = PyTuple_Size(volume);
+    size_channel = PyTuple_Size(channel);
+    for (i = 0; i < size_volume; i++) {
+        cvolume.values[i] = PyInt_AsUnsignedLongMask(PyTuple_GetItem(volume, i));
+    }
+    for (i = 0; i < size_channel; i++) {
+        channel_map.map[i] = PyInt_AsUnsignedLongMask(PyTuple_GetItem(channel, i));
+    }
+    balance = PyFloat_FromDouble(pa_cvolume_get_balance(&cvolume, &channel_map));
+    Py_INCREF(balance);
+    return balance;
+}
+
+static PyObject *m_delete(DeepinPulseAudioObject *self) 
+{
+    // Tear down single threaded. We may be inside a locked method.
+    if (self->io_ml) {
+        while (self->io_locked)
+            m_io_unlock(self);
+        pa_threaded_mainloop_stop(self->io_ml);
+    }
+    m_main_stop(self);
+
+    // The store as the session ends is what the next one starts from
+    if (self->snapshot_path) {
+        m_snapshot_save(self, self->snapshot_path);
+        g_free(self->snapshot_path);
+        self->snapshot_path = NULL;
+    }
+
+    m_signal_clear(self);
+
+    if (self->pending_ops) {
+        m_operation_cancel_all(self);
+        ZAP(self->pending_ops);
+    }
+
+    if (self->volume_slots) {
+        g_hash_table_destroy(self->volume_slots);
+        self->volume_slots = NULL;
+    }
+
+    if (self->event_pending) {
+        m_event_clear(self);
+        g_hash_table_destroy(self->event_pending);
+        self->event_pending = NULL;
+    }
+
+    if (self->query_slots) {
+        g_hash_table_destroy(self->query_slots);
+        self->query_slots = NULL;
+    }
+
+    if (self->batch_pending) {
+        m_batch_clear(self);
+        g_hash_table_destroy(self->batch_pending);
+        self->batch_pending = NULL;
+    }
+
+    m_store_destroy(self);
+
+    if (self->stream_conn_record) {
+        pa_stream_disconnect(self->stream_conn_record);
+        pa_stream_unref(self->stream_conn_record);
+        self->stream_conn_record = NULL;
+    }
+                                                                                
+    if (self->pa_ctx) {                                                         
+        pa_context_disconnect(self->pa_ctx);                                    
+        pa_context_unref(self->pa_ctx);                                         
+        self->pa_ctx = NULL;                                                    
+    }                                                                           
+                                                                                
+    if (self->pa_ml) {                                                          
+        pa_glib_mainloop_free(self->pa_ml);                                     
+        self->pa_ml = NULL;                                                     
+    }
+
+    if (self->main_loop) {
+        g_main_loop_unref(self->main_loop);
+        self->main_loop = NULL;
+    }
+
+    if (self->main_ctx) {
+        g_main_context_unref(self->main_ctx);
+        self->main_ctx = NULL;
+    }
+
+    if (self->fd_ml) {
+        pa_mainloop_free(self->fd_ml);
+        self->fd_ml = NULL;
+    }
+
+    if (self->io_ml) {
+        m_io_clear(self);
+        pa_threaded_mainloop_free(self->io_ml);
+        self->io_ml = NULL;
+    }
+
+    if (self->poll_fd >= 0)
+        close(self->poll_fd);
+    if (self->event_fd >= 0)
+        close(self->event_fd);
+    if (self->timer_fd >= 0)
+        close(self->timer_fd);
+    self->poll_fd = self->event_fd = self->timer_fd = -1;
+    g_free(self->fd_watched);
+    self->fd_watched = NULL;
+    self->n_fd_watched = 0;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+//**********************************
+// operation handle
+static DeepinPulseAudioOperation *m_operation_new(DeepinPulseAudioObject *owner, 
+                                                  PyObject *done_cb)
+{
+    DeepinPulseAudioOperation *op = NULL;
+
+    if (done_cb != Py_None && !PyCallable_Check(done_cb)) {
+        ERROR("operation callback is not callable");
+        return NULL;
+    }
+
+    op = PyObject_New(DeepinPulseAudioOperation, m_DeepinPulseAudioOperation_Type);
+    if (!op)
+        return NULL;
+
+    op->owner = owner;
+    op->pa_op = NULL;
+    op->success = -1;
+    Py_INCREF(done_cb);
+    op->done_cb = done_cb;
+    return op;
+}
+
+/* Drop the pa_operation and the owner's reference once op is settled */
+static void m_operation_finish(DeepinPulseAudioOperation *op)
+{
+    if (op->pa_op) {
+        pa_operation_unref(op->pa_op);
+        op->pa_op = NULL;
+    }
+    ZAP(op->done_cb);
+    if (op->owner && op->owner->pending_ops)
+        PySet_Discard(op->owner->pending_ops, (PyObject *) op);
+    op->owner = NULL;
+}
+
+/* Return value of a setter: True when no callback was given, else the
+ * operation, kept alive in pending_ops until the server answers */
+static PyObject *m_operation_start(DeepinPulseAudioOperation *op, 
+                                   pa_operation *pa_op)
+{
+    if (!op) {
+        pa_operation_unref(pa_op);
+        RETURN_TRUE;
+    }
+
+    op->pa_op = pa_op;
+    if (PySet_Add(op->owner->pending_ops, (PyObject *) op) < 0) {
+        pa_operation_cancel(pa_op);
+        Py_DECREF(op);
+        return NULL;
+    }
+    return (PyObject *) op;
+}
+
+static void m_pa_operation_success_cb(pa_context *c, 
+                                      int success, 
+                                      void *userdata)
+{
+    DeepinPulseAudioOperation *op = userdata;
+    m_io_item *item = NULL;
+
+    if (op->owner && m_io_thread(op->owner)) {
+        item = m_io_item_new(M_IO_OPERATION);
+        item->op = op;
+        item->value = success;
+        m_io_push(op->owner, item);
+        return;
+    }
+    m_operation_settle(op, success);
+}
+
+/* Settle op, waking the threads blocked in m_operation_wait_cond() */
+static void m_operation_set_success(DeepinPulseAudioOperation *op, 
+                                    int success)
+{
+    g_mutex_lock(&m_operation_mutex);
+    op->success = success;
+    g_cond_broadcast(&m_operation_cond);
+    g_mutex_unlock(&m_operation_mutex);
+}
+
+/* Record the answer and run the completion callback */
+static void m_operation_settle(DeepinPulseAudioOperation *op, int success)
+{
+    PyObject *done_cb = NULL;
+    PyObject *retval = NULL;
+
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+
+    // pending_ops may hold the last reference
+    Py_INCREF(op);
+    m_operation_set_success(op, success ? 1 : 0);
+    done_cb = op->done_cb;
+    op->done_cb = NULL;
+    m_operation_finish(op);
+
+    if (done_cb && PyCallable_Check(done_cb)) {
+        retval = PyEval_CallFunction(done_cb, "(OO)", op, 
+                                     success ? Py_True : Py_False);
+        Py_XDECREF(retval);
+    }
+    Py_XDECREF(done_cb);
+    Py_DECREF(op);
+    PyGILState_Release(gstate);
+}
+
+static void m_operation_cancel_all(DeepinPulseAudioObject *self)
+{
+    PyObject *ops = NULL;
+    DeepinPulseAudioOperation *op = NULL;
+    Py_ssize_t i;
+
+    ops = PySequence_List(self->pending_ops);
+    if (!ops) {
+        PyErr_Clear();
+        return;
+    }
+    for (i = 0; i < PyList_Size(ops); i++) {
+        op = (DeepinPulseAudioOperation *) PyList_GetItem(ops, i);
+        if (op->pa_op)
+            pa_operation_cancel(op->pa_op);
+        m_operation_set_success(op, 0);
+        m_operation_finish(op);
+    }
+    Py_DECREF(ops);
+}
+
+static void m_operation_dealloc(DeepinPulseAudioOperation *self)
+{
+    if (self->pa_op)
+        pa_operation_cancel(self->pa_op);
+    m_operation_finish(self);
+    PyObject_Del(self);
+}
+
+static PyObject *m_operation_done(DeepinPulseAudioOperation *self)
+{
+    if (self->success < 0) {
+        RETURN_FALSE;
+    }
+    RETURN_TRUE;
+}
+
+static gboolean m_operation_wait_timeout_cb(gpointer userdata)
+{
+    *(int *) userdata = 1;
+    return FALSE;
+}
+
+/* Wait on fd_ml directly while the owner runs without GLib */
+static void m_operation_wait_fd(DeepinPulseAudioOperation *self, 
+                                double timeout)
+{
+    DeepinPulseAudioObject *owner = self->owner;
+    gint64 deadline = g_get_monotonic_time() + (gint64) (timeout * 1000000);
+    int remaining = -1;
+
+    while (self->success < 0) {
+        if (timeout >= 0 && 
+            (remaining = (deadline - g_get_monotonic_time()) / 1000) <= 0)
+            break;
+        if (pa_mainloop_prepare(owner->fd_ml, remaining) < 0)
+            break;
+        owner->fd_blocking = 1;
+        Py_BEGIN_ALLOW_THREADS
+        pa_mainloop_poll(owner->fd_ml);
+        Py_END_ALLOW_THREADS
+        owner->fd_blocking = 0;
+        pa_mainloop_dispatch(owner->fd_ml);
+    }
+    // events dispatched meanwhile still wait for drain()
+    if (owner->batch_head)
+        eventfd_write(owner->event_fd, 1);
+}
+
+/* Take over from the host loop until the I/O thread handed the answer */
+static void m_operation_wait_io(DeepinPulseAudioOperation *self, 
+                                double timeout)
+{
+    DeepinPulseAudioObject *owner = self->owner;
+    gint64 deadline = g_get_monotonic_time() + (gint64) (timeout * 1000000);
+    struct pollfd pfd;
+    eventfd_t n;
+    int remaining = -1;
+
+    pfd.fd = owner->event_fd;
+    pfd.events = POLLIN;
+    while (self->success < 0) {
+        eventfd_read(owner->event_fd, &n);
+        m_io_run(owner);
+        if (self->success >= 0 || !owner->io_ml)
+            break;
+        if (timeout >= 0 && 
+            (remaining = (deadline - g_get_monotonic_time()) / 1000) <= 0)
+            break;
+        Py_BEGIN_ALLOW_THREADS
+        poll(&pfd, 1, remaining);
+        Py_END_ALLOW_THREADS
+    }
+    if (owner->io_ml && owner->batch_head)
+        eventfd_write(owner->event_fd, 1);
+}
+
+/* Sleep without the GIL until the thread running the GMainContext has
+ * dispatched the answer, or timeout seconds passed */
+static void m_operation_wait_cond(DeepinPulseAudioOperation *self, 
+                                  double timeout)
+{
+    gint64 deadline = g_get_monotonic_time() + (gint64) (timeout * 1000000);
+
+    Py_BEGIN_ALLOW_THREADS
+    g_mutex_lock(&m_operation_mutex);
+    while (self->success < 0) {
+        if (timeout < 0)
+            g_cond_wait(&m_operation_cond, &m_operation_mutex);
+        else if (!g_cond_wait_until(&m_operation_cond, &m_operation_mutex, 
+                                    deadline))
+            break;
+    }
+    g_mutex_unlock(&m_operation_mutex);
+    Py_END_ALLOW_THREADS
+}
+
+/* Drive the GMainContext our context is attached to until the server
+ * answered or timeout seconds passed. When another thread owns the
+ * context, as the private one of new(thread=True), that thread dispatches
+ * the reply and we sleep until it has. */
+static PyObject *m_operation_wait(DeepinPulseAudioOperation *self, 
+                                  PyObject *args)
+{
+    double timeout = -1;
+    GMainContext *ctx = NULL;
+    GSource *timer = NULL;
+    volatile int expired = 0;
+
+    if (!PyArg_ParseTuple(args, "|d", &timeout)) {
+        ERROR("invalid arguments to wait");
+        return NULL;
+    }
+
+    if (self->success >= 0) {
+        RETURN_TRUE;
+    }
+
+    if (self->owner && (self->owner->fd_ml || self->owner->io_ml)) {
+        if (self->owner->fd_ml)
+            m_operation_wait_fd(self, timeout);
+        else
+            m_operation_wait_io(self, timeout);
+        if (self->success < 0) {
+            RETURN_FALSE;
+        }
+        RETURN_TRUE;
+    }
+
+    ctx = self->owner ? self->owner->main_ctx : g_main_context_default();
+    if (!g_main_context_acquire(ctx)) {
+        m_operation_wait_cond(self, timeout);
+        if (self->success < 0) {
+            RETURN_FALSE;
+        }
+        RETURN_TRUE;
+    }
+
+    if (timeout >= 0) {
+        timer = g_timeout_source_new((guint) (timeout * 1000));
+        g_source_set_callback(timer, m_operation_wait_timeout_cb, 
+                              (gpointer) &expired, NULL);
+        g_source_attach(timer, ctx);
+    }
+
+    while (self->success < 0 && !expired) {
+        Py_BEGIN_ALLOW_THREADS
+        g_main_context_iteration(ctx, TRUE);
+        Py_END_ALLOW_THREADS
+    }
+
+    if (timer) {
+        g_source_destroy(timer);
+        g_source_unref(timer);
+    }
+    g_main_context_release(ctx);
+
+    if (self->success < 0) {
+        RETURN_FALSE;
+    }
+    RETURN_TRUE;
+}
+
+/* The completion callback is not run for a cancelled operation */
+static PyObject *m_operation_cancel(DeepinPulseAudioOperation *self)
+{
+    DeepinPulseAudioObject *owner = self->owner;
+
+    if (self->success >= 0) {
+        RETURN_FALSE;
+    }
+
+    m_io_lock(owner);
+    if (self->pa_op)
+        pa_operation_cancel(self->pa_op);
+    m_operation_set_success(self, 0);
+    m_operation_finish(self);
+    m_io_unlock(owner);
+    RETURN_TRUE;
+}
+
+static PyObject *m_operation_get_success(DeepinPulseAudioOperation *self)
+{
+    if (self->success < 0) {
+        Py_RETURN_NONE;
+    }
+    if (self->success) {
+        RETURN_TRUE;
+    }
+    RETURN_FALSE;
+}
+
+//**********************************
+// volume write coalescing
+static pa_operation *m_volume_send(DeepinPulseAudioObject *self, 
+                                   m_volume_slot *slot);
+
+static void m_pa_volume_written_cb(pa_context *c, 
+                                   int success, 
+                                   void *userdata)
+{
+    m_volume_slot *slot = userdata;
+    DeepinPulseAudioObject *self = slot->self;
+    pa_operation *pa_op = NULL;
+
+    if (slot->queued) {
+        slot->queued = 0;
+        if ((pa_op = m_volume_send(self, slot))) {
+            pa_operation_unref(pa_op);
+            return;
+        }
+    }
+    g_hash_table_remove(self->volume_slots, &slot->key);
+}
+
+static pa_operation *m_volume_send(DeepinPulseAudioObject *self, 
+                                   m_volume_slot *slot)
+{
+    uint32_t index = (uint32_t) slot->key;
+
+    switch (slot->key >> 32) {
+        case PA_SUBSCRIPTION_EVENT_SINK:
+            return pa_context_set_sink_volume_by_index(self->pa_ctx, 
+                    index, &slot->volume, m_pa_volume_written_cb, slot);
+        case PA_SUBSCRIPTION_EVENT_SOURCE:
+            return pa_context_set_source_volume_by_index(self->pa_ctx, 
+                    index, &slot->volume, m_pa_volume_written_cb, slot);
+        case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
+            return pa_context_set_sink_input_volume(self->pa_ctx, 
+                    index, &slot->volume, m_pa_volume_written_cb, slot);
+    }
+    return NULL;
+}
+
+/* Latest-wins volume write: while a write to the same object is in
+ * flight the new value replaces any queued one, and only the newest is
+ * sent once the server acknowledged the previous write. */
+static PyObject *m_volume_coalesce(DeepinPulseAudioObject *self, 
+                                   pa_subscription_event_type_t facility, 
+                                   uint32_t index, 
+                                   const pa_cvolume *volume)
+{
+    gint64 key = (gint64) facility << 32 | index;
+    m_volume_slot *slot = NULL;
+    pa_operation *pa_op = NULL;
+
+    slot = g_hash_table_lookup(self->volume_slots, &key);
+    if (slot) {
+        slot->volume = *volume;
+        slot->queued = 1;
+        RETURN_TRUE;
+    }
+
+    slot = g_new0(m_volume_slot, 1);
+    slot->key = key;
+    slot->self = self;
+    slot->volume = *volume;
+    if (!(pa_op = m_volume_send(self, slot))) {
+        g_free(slot);
+        ERROR("pa_context_set_volume() failed");
+        RETURN_FALSE;
+    }
+    g_hash_table_insert(self->volume_slots, &slot->key, slot);
+    pa_operation_unref(pa_op);
+    RETURN_TRUE;
+}
+
+//**********************************
+// pa get function
+//****************************************
+// state store: pa_*_info copied into C, Python objects built on demand
+static const char *m_kind_names[M_KIND_COUNT] = {
+    "sink", 
+    "source", 
+    "sinkinput", 
+    "sourceoutput", 
+    "card"
+};
+
+static int m_kind_from_name(const char *name)
+{
+    int kind;
+
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (strcmp(name, m_kind_names[kind]) == 0)
+            return kind;
+    }
+    return -1;
+}
+
+static void m_entry_drop_objects(m_entry *e)
+{
+    int i;
+
+    for (i = 0; i < M_OBJECT_COUNT; i++)
+        ZAP(e->objects[i]);
+    e->objects_generation = e->generation;
+}
+
+static void m_entry_free(gpointer data)
+{
+    m_entry *e = data;
+    uint32_t i;
+
+    m_entry_drop_objects(e);
+    for (i = 0; i < e->n_ports; i++) {
+        g_free(e->ports[i].name);
+        g_free(e->ports[i].description);
+    }
+    g_free(e->ports);
+    for (i = 0; i < e->n_profiles; i++) {
+        g_free(e->profiles[i].name);
+        g_free(e->profiles[i].description);
+    }
+    g_free(e->profiles);
+    g_free(e->name);
+    g_free(e->description);
+    g_free(e->driver);
+    g_free(e->resample_method);
+    if (e->proplist)
+        pa_proplist_free(e->proplist);
+    g_free(e);
+}
+
+static m_entry *m_entry_new(m_kind kind,
+                            uint32_t index,
+                            const char *name,
+                            const char *driver,
+                            const pa_proplist *proplist)
+{
+    m_entry *e = g_new0(m_entry, 1);
+
+    e->kind = kind;
+    e->index = index;
+    e->name = g_strdup(name);
+    e->driver = g_strdup(driver);
+    e->proplist = proplist ? pa_proplist_copy(proplist) : NULL;
+    e->active_port = -1;
+    e->active_profile = -1;
+    return e;
+}
+
+static void m_store_init(DeepinPulseAudioObject *self)
+{
+    int kind;
+
+    for (kind = 0; kind < M_KIND_COUNT; kind++)
+        self->entries[kind] = g_hash_table_new_full(g_direct_hash,
+                                                    g_direct_equal,
+                                                    NULL,
+                                                    m_entry_free);
+    self->tombstones = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                             NULL, g_free);
+    // Stream names are not unique, only devices and cards get a name index
+    self->names[M_SINK] = g_hash_table_new(g_str_hash, g_str_equal);
+    self->names[M_SOURCE] = g_hash_table_new(g_str_hash, g_str_equal);
+    self->names[M_CARD] = g_hash_table_new(g_str_hash, g_str_equal);
+}
+
+/* Drop the name index slot of e unless it already points elsewhere */
+static void m_store_unname(DeepinPulseAudioObject *self, m_entry *e)
+{
+    GHashTable *names = self->names[e->kind];
+
+    if (names && e->name && g_hash_table_lookup(names, e->name) == e)
+        g_hash_table_remove(names, e->name);
+}
+
+static void m_server_clear(m_server *s)
+{
+    g_free(s->user_name);
+    g_free(s->host_name);
+    g_free(s->server_version);
+    g_free(s->server_name);
+    g_free(s->default_sink_name);
+    g_free(s->default_source_name);
+    s->user_name = s->host_name = s->server_version = s->server_name = NULL;
+    s->default_sink_name = s->default_source_name = NULL;
+    s->cookie = 0;
+    s->valid = 0;
+}
+
+/* Fill an empty s from i */
+static void m_server_copy(m_server *s, const pa_server_info *i)
+{
+    s->user_name = g_strdup(i->user_name);
+    s->host_name = g_strdup(i->host_name);
+    s->server_version = g_strdup(i->server_version);
+    s->server_name = g_strdup(i->server_name);
+    s->default_sink_name = g_strdup(i->default_sink_name);
+    s->default_source_name = g_strdup(i->default_source_name);
+    s->cookie = i->cookie;
+    s->valid = 1;
+}
+
+/* The other way round, i only borrows the strings of s */
+static void m_server_info(const m_server *s, pa_server_info *i)
+{
+    memset(i, 0, sizeof(*i));
+    i->user_name = s->user_name;
+    i->host_name = s->host_name;
+    i->server_version = s->server_version;
+    i->server_name = s->server_name;
+    i->default_sink_name = s->default_sink_name;
+    i->default_source_name = s->default_source_name;
+    i->cookie = s->cookie;
+}
+
+/* Forget everything, e.g. before a full enumeration */
+static void m_store_clear(DeepinPulseAudioObject *self)
+{
+    int kind;
+
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (!self->entries[kind])
+            continue;
+        if (self->names[kind])
+            g_hash_table_remove_all(self->names[kind]);
+        g_hash_table_remove_all(self->entries[kind]);
+        self->kind_generation[kind] = ++self->generation;
+    }
+    m_server_clear(&self->server);
+    self->server.generation = ++self->generation;
+    if (self->tombstones)
+        g_hash_table_remove_all(self->tombstones);
+    self->changes_floor = self->generation;
+    self->server.stale = 0;
+    self->snapshot_pending = 0;
+}
+
+static void m_store_destroy(DeepinPulseAudioObject *self)
+{
+    int kind;
+
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (self->names[kind]) {
+            g_hash_table_destroy(self->names[kind]);
+            self->names[kind] = NULL;
+        }
+        if (self->entries[kind]) {
+            g_hash_table_destroy(self->entries[kind]);
+            self->entries[kind] = NULL;
+        }
+    }
+    m_server_clear(&self->server);
+    if (self->tombstones) {
+        g_hash_table_destroy(self->tombstones);
+        self->tombstones = NULL;
+    }
+}
+
+static m_entry *m_store_lookup(DeepinPulseAudioObject *self,
+                               m_kind kind,
+                               uint32_t index)
+{
+    if (!self->entries[kind])
+        return NULL;
+    return g_hash_table_lookup(self->entries[kind], GUINT_TO_POINTER(index));
+}
+
+/* Replace whatever the store held for e->index, which owns e from now on */
+static int m_cvolume_differ(const pa_cvolume *a, const pa_cvolume *b)
+{
+    return a->channels != b->channels ||
+           memcmp(a->values, b->values, a->channels * sizeof(pa_volume_t)) != 0;
+}
+
+static int m_channel_map_differ(const pa_channel_map *a, const pa_channel_map *b)
+{
+    return a->channels != b->channels ||
+           memcmp(a->map, b->map, a->channels * sizeof(pa_channel_position_t)) != 0;
+}
+
+static const char *m_active_port_name(const m_entry *e)
+{
+    return e->active_port < 0 ? NULL : e->ports[e->active_port].name;
+}
+
+static const char *m_active_profile_name(const m_entry *e)
+{
+    return e->active_profile < 0 ? NULL : e->profiles[e->active_profile].name;
+}
+
+/* M_FIELD_BIT()s of what a client can see differ between two copies of
+ * the same object */
+static int m_entry_diff(const m_entry *a, const m_entry *b)
+{
+    int fields = 0;
+    uint32_t i;
+
+    if (g_strcmp0(a->name, b->name))
+        fields |= M_FIELD_BIT(M_FIELD_NAME);
+    if (g_strcmp0(a->description, b->description))
+        fields |= M_FIELD_BIT(M_FIELD_DESCRIPTION);
+    if (m_cvolume_differ(&a->volume, &b->volume))
+        fields |= M_FIELD_BIT(M_FIELD_VOLUME);
+    if (a->mute != b->mute)
+        fields |= M_FIELD_BIT(M_FIELD_MUTE);
+    if (m_channel_map_differ(&a->channel_map, &b->channel_map))
+        fields |= M_FIELD_BIT(M_FIELD_CHANNELS);
+    if (g_strcmp0(m_active_port_name(a), m_active_port_name(b)))
+        fields |= M_FIELD_BIT(M_FIELD_ACTIVE_PORT);
+    if (a->n_ports != b->n_ports) {
+        fields |= M_FIELD_BIT(M_FIELD_PORTS);
+    } else {
+        for (i = 0; i < a->n_ports; i++) {
+            if (g_strcmp0(a->ports[i].name, b->ports[i].name) ||
+                g_strcmp0(a->ports[i].description, b->ports[i].description) ||
+                a->ports[i].available != b->ports[i].available ||
+                a->ports[i].direction != b->ports[i].direction ||
+                a->ports[i].n_profiles != b->ports[i].n_profiles) {
+                fields |= M_FIELD_BIT(M_FIELD_PORTS);
+                break;
+            }
+        }
+    }
+    if (a->corked != b->corked)
+        fields |= M_FIELD_BIT(M_FIELD_CORKED);
+    if (a->parent != b->parent && a->kind != M_SINK && a->kind != M_SOURCE)
+        fields |= M_FIELD_BIT(M_FIELD_DEVICE);
+    if (a->n_profiles != b->n_profiles) {
+        fields |= M_FIELD_BIT(M_FIELD_PROFILES);
+    } else {
+        for (i = 0; i < a->n_profiles; i++) {
+            if (g_strcmp0(a->profiles[i].name, b->profiles[i].name) ||
+                g_strcmp0(a->profiles[i].description, b->profiles[i].description) ||
+                a->profiles[i].n_sinks != b->profiles[i].n_sinks ||
+                a->profiles[i].n_sources != b->profiles[i].n_sources) {
+                fields |= M_FIELD_BIT(M_FIELD_PROFILES);
+                break;
+            }
+        }
+    }
+    if (g_strcmp0(m_active_profile_name(a), m_active_profile_name(b)))
+        fields |= M_FIELD_BIT(M_FIELD_ACTIVE_PROFILE);
+    if (a->proplist && b->proplist ? !pa_proplist_equal(a->proplist, b->proplist)
+                                   : a->proplist != b->proplist)
+        fields |= M_FIELD_BIT(M_FIELD_PROPLIST);
+    if (g_strcmp0(a->driver, b->driver) ||
+        g_strcmp0(a->resample_method, b->resample_method) ||
+        a->owner_module != b->owner_module ||
+        a->client != b->client ||
+        (a->parent != b->parent && (a->kind == M_SINK || a->kind == M_SOURCE)) ||
+        a->base_volume != b->base_volume ||
+        a->has_volume != b->has_volume ||
+        a->volume_writable != b->volume_writable)
+        fields |= M_FIELD_BIT(M_FIELD_OTHER);
+    return fields;
+}
+
+static m_entry *m_store_put(DeepinPulseAudioObject *self, m_entry *e)
+{
+    gint64 key = (gint64) e->kind << 32 | e->index;
+    m_entry *old = NULL;
+    m_tombstone *t = NULL;
+
+    if (!self->entries[e->kind]) {
+        m_entry_free(e);
+        return NULL;
+    }
+    old = m_store_lookup(self, e->kind, e->index);
+    if (old && !(e->changed = m_entry_diff(old, e))) {
+        // Nothing visible moved, keep the old entry and the objects
+        // already built from it
+        old->changed = 0;
+        old->added = 0;
+        old->stale = 0;
+        m_entry_free(e);
+        return old;
+    }
+    e->generation = ++self->generation;
+    e->created = e->generation;
+    if (old) {
+        e->created = old->created;
+        m_store_unname(self, old);
+    } else if ((t = g_hash_table_lookup(self->tombstones, &key))) {
+        // Back under the same index, report it as changed rather than
+        // removed and added
+        e->created = t->created;
+        g_hash_table_remove(self->tombstones, &key);
+    }
+    if (!old) {
+        e->changed = M_FIELD_ALL;
+        e->added = 1;
+    }
+    if (self->names[e->kind] && e->name)
+        g_hash_table_replace(self->names[e->kind], e->name, e);
+    e->objects_generation = e->generation;
+    self->kind_generation[e->kind] = e->generation;
+    g_hash_table_replace(self->entries[e->kind], GUINT_TO_POINTER(e->index), e);
+    return e;
+}
+
+static void m_store_remove(DeepinPulseAudioObject *self,
+                           m_kind kind,
+                           uint32_t index)
+{
+    m_entry *e = m_store_lookup(self, kind, index);
+    m_tombstone *t = NULL;
+
+    if (!e)
+        return;
+    self->kind_generation[kind] = ++self->generation;
+
+    // Tombstones are only kept for a while; past that get_changes_since()
+    // asks the caller for a full refresh instead
+    if (g_hash_table_size(self->tombstones) >= M_TOMBSTONE_MAX) {
+        g_hash_table_remove_all(self->tombstones);
+        self->changes_floor = self->generation - 1;
+    }
+    t = g_new0(m_tombstone, 1);
+    t->key = (gint64) kind << 32 | index;
+    t->created = e->created;
+    t->removed = self->generation;
+    g_hash_table_replace(self->tombstones, &t->key, t);
+
+    m_store_unname(self, e);
+    g_hash_table_remove(self->entries[kind], GUINT_TO_POINTER(index));
+}
+
+static m_entry *m_store_find(DeepinPulseAudioObject *self,
+                             m_kind kind,
+                             const char *name)
+{
+    if (!name || !self->names[kind])
+        return NULL;
+    return g_hash_table_lookup(self->names[kind], name);
+}
+
+static m_entry *m_sink_entry(const pa_sink_info *l)
+{
+    m_entry *e = m_entry_new(M_SINK, l->index, l->name, l->driver, l->proplist);
+    uint32_t i;
+
+    e->description = g_strdup(l->description);
+    e->owner_module = l->owner_module;
+    e->parent = l->card;
+    e->base_volume = l->base_volume;
+    e->mute = l->mute;
+    e->channel_map = l->channel_map;
+    e->volume = l->volume;
+    e->n_ports = l->n_ports;
+    e->ports = g_new0(m_port, l->n_ports);
+    for (i = 0; i < l->n_ports; i++) {
+        e->ports[i].name = g_strdup(l->ports[i]->name);
+        e->ports[i].description = g_strdup(l->ports[i]->description);
+        e->ports[i].available = l->ports[i]->available;
+        if (l->ports[i] == l->active_port)
+            e->active_port = i;
+    }
+    return e;
+}
+
+static m_entry *m_source_entry(const pa_source_info *l)
+{
+    m_entry *e = m_entry_new(M_SOURCE, l->index, l->name, l->driver, l->proplist);
+    uint32_t i;
+
+    e->description = g_strdup(l->description);
+    e->owner_module = l->owner_module;
+    e->parent = l->card;
+    e->base_volume = l->base_volume;
+    e->mute = l->mute;
+    e->channel_map = l->channel_map;
+    e->volume = l->volume;
+    e->n_ports = l->n_ports;
+    e->ports = g_new0(m_port, l->n_ports);
+    for (i = 0; i < l->n_ports; i++) {
+        e->ports[i].name = g_strdup(l->ports[i]->name);
+        e->ports[i].description = g_strdup(l->ports[i]->description);
+        e->ports[i].available = l->ports[i]->available;
+        if (l->ports[i] == l->active_port)
+            e->active_port = i;
+    }
+    return e;
+}
+
+static m_entry *m_sink_input_entry(const pa_sink_input_info *l)
+{
+    m_entry *e = m_entry_new(M_SINK_INPUT, l->index, l->name, l->driver, l->proplist);
+
+    e->resample_method = g_strdup(l->resample_method);
+    e->owner_module = l->owner_module;
+    e->client = l->client;
+    e->parent = l->sink;
+    e->mute = l->mute;
+    e->corked = l->corked;
+    e->has_volume = l->has_volume;
+    e->volume_writable = l->volume_writable;
+    e->channel_map = l->channel_map;
+    e->volume = l->volume;
+    return e;
+}
+
+static m_entry *m_source_output_entry(const pa_source_output_info *l)
+{
+    m_entry *e = m_entry_new(M_SOURCE_OUTPUT, l->index, l->name, l->driver, l->proplist);
+
+    e->resample_method = g_strdup(l->resample_method);
+    e->owner_module = l->owner_module;
+    e->client = l->client;
+    e->parent = l->source;
+    e->mute = l->mute;
+    e->corked = l->corked;
+    e->has_volume = l->has_volume;
+    e->volume_writable = l->volume_writable;
+    e->channel_map = l->channel_map;
+    e->volume = l->volume;
+    return e;
+}
+
+static m_entry *m_card_entry(const pa_card_info *i)
+{
+    m_entry *e = m_entry_new(M_CARD, i->index, i->name, i->driver, i->proplist);
+    uint32_t ctr;
+
+    e->owner_module = i->owner_module;
+    e->n_profiles = i->n_profiles;
+    e->profiles = g_new0(m_profile, i->n_profiles);
+    for (ctr = 0; ctr < i->n_profiles; ctr++) {
+        e->profiles[ctr].name = g_strdup(i->profiles[ctr].name);
+        e->profiles[ctr].description = g_strdup(i->profiles[ctr].description);
+        e->profiles[ctr].n_sinks = i->profiles[ctr].n_sinks;
+        e->profiles[ctr].n_sources = i->profiles[ctr].n_sources;
+        if (i->active_profile &&
+            g_strcmp0(i->active_profile->name, i->profiles[ctr].name) == 0)
+            e->active_profile = ctr;
+    }
+    e->n_ports = i->n_ports;
+    e->ports = g_new0(m_port, i->n_ports);
+    for (ctr = 0; ctr < i->n_ports; ctr++) {
+        e->ports[ctr].name = g_strdup(i->ports[ctr]->name);
+        e->ports[ctr].description = g_strdup(i->ports[ctr]->description);
+        e->ports[ctr].available = i->ports[ctr]->available;
+        e->ports[ctr].direction = i->ports[ctr]->direction;
+        e->ports[ctr].n_profiles = i->ports[ctr]->n_profiles;
+    }
+    return e;
+}
+
+/* Returns the M_FIELD_BIT()s that moved, 0 leaves the store untouched */
+static int m_store_server(DeepinPulseAudioObject *self, const pa_server_info *i)
+{
+    m_server *s = &self->server;
+    int changed = M_FIELD_ALL;
+
+    // The snapshot described another server instance, none of its indices
+    // mean anything here
+    if (s->stale && s->cookie != i->cookie)
+        m_snapshot_sweep(self);
+    s->stale = 0;
+
+    if (s->valid) {
+        changed = 0;
+        if (g_strcmp0(s->default_sink_name, i->default_sink_name))
+            changed |= M_FIELD_BIT(M_FIELD_FALLBACK_SINK);
+        if (g_strcmp0(s->default_source_name, i->default_source_name))
+            changed |= M_FIELD_BIT(M_FIELD_FALLBACK_SOURCE);
+        if (g_strcmp0(s->user_name, i->user_name) ||
+            g_strcmp0(s->host_name, i->host_name) ||
+            g_strcmp0(s->server_version, i->server_version) ||
+            g_strcmp0(s->server_name, i->server_name) ||
+            s->cookie != i->cookie)
+            changed |= M_FIELD_BIT(M_FIELD_OTHER);
+        s->changed = changed;
+        if (!changed)
+            return 0;
+    }
+    m_server_clear(s);
+    s->changed = changed;
+    m_server_copy(s, i);
+    s->generation = ++self->generation;
+    return changed;
+}
+
+/* Snapshot file: a header, the server, then every entry, all in host byte
+ * order with strings prefixed by their length including the NUL (0 for
+ * none). It is only meant to be read back on the same machine, by a
+ * libpulse of the same protocol version, see m_snapshot_load(). */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t protocol;      /* PA_PROTOCOL_VERSION of the writer */
+    uint32_t cookie;        /* of the server the state came from */
+    uint32_t n_entries;
+} m_snapshot_header;
+
+typedef struct {
+    const char *p;
+    const char *end;
+    int ok;                 /* cleared by the first short or bad read */
+} m_snapshot_cursor;
+
+static void m_snapshot_put_u32(FILE *fp, uint32_t v)
+{
+    fwrite(&v, sizeof(v), 1, fp);
+}
+
+static void m_snapshot_put_string(FILE *fp, const char *s)
+{
+    uint32_t len = s ? strlen(s) + 1 : 0;
+
+    m_snapshot_put_u32(fp, len);
+    if (len)
+        fwrite(s, 1, len, fp);
+}
+
+static void m_snapshot_put_entry(FILE *fp, const m_entry *e)
+{
+    const char *key = NULL;
+    void *state = NULL;
+    uint32_t i;
+
+    m_snapshot_put_u32(fp, e->kind);
+    m_snapshot_put_u32(fp, e->index);
+    m_snapshot_put_string(fp, e->name);
+    m_snapshot_put_string(fp, e->description);
+    m_snapshot_put_string(fp, e->driver);
+    m_snapshot_put_string(fp, e->resample_method);
+    m_snapshot_put_u32(fp, e->owner_module);
+    m_snapshot_put_u32(fp, e->client);
+    m_snapshot_put_u32(fp, e->parent);
+    m_snapshot_put_u32(fp, e->base_volume);
+    m_snapshot_put_u32(fp, e->mute);
+    m_snapshot_put_u32(fp, e->corked);
+    m_snapshot_put_u32(fp, e->has_volume);
+    m_snapshot_put_u32(fp, e->volume_writable);
+    fwrite(&e->channel_map, sizeof(pa_channel_map), 1, fp);
+    fwrite(&e->volume, sizeof(pa_cvolume), 1, fp);
+    m_snapshot_put_u32(fp, e->n_ports);
+    for (i = 0; i < e->n_ports; i++) {
+        m_snapshot_put_string(fp, e->ports[i].name);
+        m_snapshot_put_string(fp, e->ports[i].description);
+        m_snapshot_put_u32(fp, e->ports[i].available);
+        m_snapshot_put_u32(fp, e->ports[i].direction);
+        m_snapshot_put_u32(fp, e->ports[i].n_profiles);
+    }
+    m_snapshot_put_u32(fp, e->active_port);
+    m_snapshot_put_u32(fp, e->n_profiles);
+    for (i = 0; i < e->n_profiles; i++) {
+        m_snapshot_put_string(fp, e->profiles[i].name);
+        m_snapshot_put_string(fp, e->profiles[i].description);
+        m_snapshot_put_u32(fp, e->profiles[i].n_sinks);
+        m_snapshot_put_u32(fp, e->profiles[i].n_sources);
+    }
+    m_snapshot_put_u32(fp, e->active_profile);
+    // (uint32_t) -1 tells a missing proplist from an empty one
+    m_snapshot_put_u32(fp, e->proplist ? pa_proplist_size(e->proplist) : (uint32_t) -1);
+    while (e->proplist && (key = pa_proplist_iterate(e->proplist, &state))) {
+        m_snapshot_put_string(fp, key);
+        m_snapshot_put_string(fp, pa_proplist_gets(e->proplist, key));
+    }
+}
+
+/* Write the store to path, through a temporary file so that a reader never
+ * maps half of it */
+static int m_snapshot_save(DeepinPulseAudioObject *self, const char *path)
+{
+    m_server *s = &self->server;
+    m_snapshot_header h;
+    GHashTableIter iter;
+    gpointer value;
+    char *tmp = NULL;
+    FILE *fp = NULL;
+    int kind, ok;
+
+    // Nothing worth keeping before the server answered, and a snapshot
+    // the server has not confirmed yet is already on disk
+    if (!s->valid || self->snapshot_pending)
+        return 0;
+
+    memset(&h, 0, sizeof(h));
+    h.magic = M_SNAPSHOT_MAGIC;
+    h.version = M_SNAPSHOT_VERSION;
+    h.protocol = PA_PROTOCOL_VERSION;
+    h.cookie = s->cookie;
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (self->entries[kind])
+            h.n_entries += g_hash_table_size(self->entries[kind]);
+    }
+
+    tmp = g_malloc(strlen(path) + 5);
+    sprintf(tmp, "%s.tmp", path);
+    if (!(fp = fopen(tmp, "wb"))) {
+        g_free(tmp);
+        return 0;
+    }
+    fwrite(&h, sizeof(h), 1, fp);
+    m_snapshot_put_string(fp, s->user_name);
+    m_snapshot_put_string(fp, s->host_name);
+    m_snapshot_put_string(fp, s->server_version);
+    m_snapshot_put_string(fp, s->server_name);
+    m_snapshot_put_string(fp, s->default_sink_name);
+    m_snapshot_put_string(fp, s->default_source_name);
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (!self->entries[kind])
+            continue;
+        g_hash_table_iter_init(&iter, self->entries[kind]);
+        while (g_hash_table_iter_next(&iter, NULL, &value))
+            m_snapshot_put_entry(fp, value);
+    }
+
+    ok = !ferror(fp);
+    ok = fclose(fp) == 0 && ok;
+    if (ok)
+        ok = rename(tmp, path) == 0;
+    if (!ok)
+        unlink(tmp);
+    g_free(tmp);
+    return ok;
+}
+
+static void m_snapshot_get(m_snapshot_cursor *c, void *data, size_t len)
+{
+    if (!c->ok || (size_t) (c->end - c->p) < len) {
+        c->ok = 0;
+        memset(data, 0, len);
+        return;
+    }
+    memcpy(data, c->p, len);
+    c->p += len;
+}
+
+static uint32_t m_snapshot_get_u32(m_snapshot_cursor *c)
+{
+    uint32_t v;
+
+    m_snapshot_get(c, &v, sizeof(v));
+    return v;
+}
+
+static char *m_snapshot_get_string(m_snapshot_cursor *c)
+{
+    uint32_t len = m_snapshot_get_u32(c);
+    char *s = NULL;
+
+    if (!c->ok || !len)
+        return NULL;
+    if ((size_t) (c->end - c->p) < len || c->p[len - 1] != '\0') {
+        c->ok = 0;
+        return NULL;
+    }
+    s = g_strdup(c->p);
+    c->p += len;
+    return s;
+}
+
+/* Room left for n more items of at least size bytes each, so a corrupt
+ * count cannot make us allocate much */
+static int m_snapshot_fits(m_snapshot_cursor *c, uint32_t n, size_t size)
+{
+    if (c->ok && n > (size_t) (c->end - c->p) / size)
+        c->ok = 0;
+    return c->ok;
+}
+
+static m_entry *m_snapshot_get_entry(m_snapshot_cursor *c)
+{
+    m_entry *e = NULL;
+    uint32_t kind, index, i, n;
+    char *key = NULL;
+    char *value = NULL;
+
+    kind = m_snapshot_get_u32(c);
+    index = m_snapshot_get_u32(c);
+    if (!c->ok || kind >= M_KIND_COUNT) {
+        c->ok = 0;
+        return NULL;
+    }
+
+    e = m_entry_new(kind, index, NULL, NULL, NULL);
+    e->name = m_snapshot_get_string(c);
+    e->description = m_snapshot_get_string(c);
+    e->driver = m_snapshot_get_string(c);
+    e->resample_method = m_snapshot_get_string(c);
+    e->owner_module = m_snapshot_get_u32(c);
+    e->client = m_snapshot_get_u32(c);
+    e->parent = m_snapshot_get_u32(c);
+    e->base_volume = m_snapshot_get_u32(c);
+    e->mute = m_snapshot_get_u32(c);
+    e->corked = m_snapshot_get_u32(c);
+    e->has_volume = m_snapshot_get_u32(c);
+    e->volume_writable = m_snapshot_get_u32(c);
+    m_snapshot_get(c, &e->channel_map, sizeof(pa_channel_map));
+    m_snapshot_get(c, &e->volume, sizeof(pa_cvolume));
+    if (e->channel_map.channels > PA_CHANNELS_MAX ||
+        e->volume.channels > PA_CHANNELS_MAX)
+        c->ok = 0;
+
+    n = m_snapshot_get_u32(c);
+    if (m_snapshot_fits(c, n, 5 * sizeof(uint32_t))) {
+        e->ports = g_new0(m_port, n);
+        e->n_ports = n;
+    }
+    for (i = 0; i < e->n_ports; i++) {
+        e->ports[i].name = m_snapshot_get_string(c);
+        e->ports[i].description = m_snapshot_get_string(c);
+        e->ports[i].available = m_snapshot_get_u32(c);
+        e->ports[i].direction = m_snapshot_get_u32(c);
+        e->ports[i].n_profiles = m_snapshot_get_u32(c);
+    }
+    e->active_port = m_snapshot_get_u32(c);
+
+    n = m_snapshot_get_u32(c);
+    if (m_snapshot_fits(c, n, 4 * sizeof(uint32_t))) {
+        e->profiles = g_new0(m_profile, n);
+        e->n_profiles = n;
+    }
+    for (i = 0; i < e->n_profiles; i++) {
+        e->profiles[i].name = m_snapshot_get_string(c);
+        e->profiles[i].description = m_snapshot_get_string(c);
+        e->profiles[i].n_sinks = m_snapshot_get_u32(c);
+        e->profiles[i].n_sources = m_snapshot_get_u32(c);
+    }
+    e->active_profile = m_snapshot_get_u32(c);
+    if (e->active_port < -1 || e->active_port >= (int) e->n_ports ||
+        e->active_profile < -1 || e->active_profile >= (int) e->n_profiles)
+        c->ok = 0;
+
+    n = m_snapshot_get_u32(c);
+    if (c->ok && n != (uint32_t) -1 &&
+        m_snapshot_fits(c, n, 2 * sizeof(uint32_t))) {
+        e->proplist = pa_proplist_new();
+        for (i = 0; i < n && c->ok; i++) {
+            key = m_snapshot_get_string(c);
+            value = m_snapshot_get_string(c);
+            if (key && value)
+                pa_proplist_sets(e->proplist, key, value);
+            g_free(key);
+            g_free(value);
+        }
+    }
+
+    if (!c->ok) {
+        m_entry_free(e);
+        return NULL;
+    }
+    return e;
+}
+
+/* Fill the empty store from the snapshot at path. Its entries are served
+ * right away and marked stale until the server confirms them, see
+ * m_snapshot_sweep(). */
+static int m_snapshot_load(DeepinPulseAudioObject *self, const char *path)
+{
+    m_server *s = &self->server;
+    m_snapshot_header h;
+    m_snapshot_cursor c;
+    m_entry *e = NULL;
+    struct stat st;
+    void *map = NULL;
+    uint32_t i;
+    int fd;
+
+    if (s->valid || !self->entries[M_SINK])
+        return 0;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return 0;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(h)) {
+        close(fd);
+        return 0;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return 0;
+
+    c.p = map;
+    c.end = c.p + st.st_size;
+    c.ok = 1;
+    m_snapshot_get(&c, &h, sizeof(h));
+    if (h.magic != M_SNAPSHOT_MAGIC || h.version != M_SNAPSHOT_VERSION ||
+        h.protocol != PA_PROTOCOL_VERSION) {
+        munmap(map, st.st_size);
+        return 0;
+    }
+
+    s->user_name = m_snapshot_get_string(&c);
+    s->host_name = m_snapshot_get_string(&c);
+    s->server_version = m_snapshot_get_string(&c);
+    s->server_name = m_snapshot_get_string(&c);
+    s->default_sink_name = m_snapshot_get_string(&c);
+    s->default_source_name = m_snapshot_get_string(&c);
+    s->cookie = h.cookie;
+    s->valid = 1;
+    s->stale = 1;
+    s->changed = M_FIELD_ALL;
+    s->generation = ++self->generation;
+
+    for (i = 0; c.ok && i < h.n_entries; i++) {
+        if ((e = m_snapshot_get_entry(&c)) && (e = m_store_put(self, e)))
+            e->stale = 1;
+    }
+    munmap(map, st.st_size);
+
+    if (!c.ok) {
+        m_store_clear(self);
+        return 0;
+    }
+    self->snapshot_pending = 1;
+    return 1;
+}
+
+/* Drop the snapshot entries the server did not confirm: they went away
+ * while we were not running, or belong to another server instance */
+static void m_snapshot_sweep(DeepinPulseAudioObject *self)
+{
+    GHashTableIter iter;
+    gpointer value;
+    uint32_t *stale = NULL;
+    guint n, i;
+    int kind;
+
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (!self->entries[kind])
+            continue;
+        stale = g_new(uint32_t, g_hash_table_size(self->entries[kind]) + 1);
+        n = 0;
+        g_hash_table_iter_init(&iter, self->entries[kind]);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            if (((m_entry *) value)->stale)
+                stale[n++] = ((m_entry *) value)->index;
+        }
+        // Reported to listeners like any other removal
+        for (i = 0; i < n; i++)
+            m_snapshot_drop(self, kind, stale[i]);
+        g_free(stale);
+    }
+    self->snapshot_pending = 0;
+}
+
+/* A full enumeration just completed, which settles a warm start and is
+ * what the next one starts from */
+static void m_snapshot_reconcile(DeepinPulseAudioObject *self)
+{
+    if (self->snapshot_pending)
+        m_snapshot_sweep(self);
+    if (self->snapshot_path)
+        m_snapshot_save(self, self->snapshot_path);
+}
+
+static PyObject *m_port_build(const m_port *p)
+{
+    return Py_BuildValue("(ssi)", p->name, p->description, p->available);
+}
+
+/* Lookups are left to the Proplist, which owns its own copy so it can
+ * outlive the entry */
+static PyObject *m_proplist_build(const pa_proplist *p)
+{
+    DeepinPulseAudioProplist *proplist = NULL;
+
+    proplist = PyObject_New(DeepinPulseAudioProplist, m_DeepinPulseAudioProplist_Type);
+    if (!proplist)
+        return NULL;
+    proplist->proplist = p ? pa_proplist_copy(p) : pa_proplist_new();
+    return (PyObject *) proplist;
+}
+
+static PyObject *m_channel_map_build(const pa_channel_map *map)
+{
+    PyObject *channel_value = NULL;
+    PyObject *tmp_obj = NULL;
+    int i;
+
+    channel_value = PyList_New(0);
+    if (!channel_value)
+        return NULL;
+
+    for (i = 0; i < map->channels; i++) {
+        tmp_obj = INT(map->map[i]);
+        PyList_Append(channel_value, tmp_obj);
+        Py_DecRef(tmp_obj);
+    }
+    return channel_value;
+}
+
+static PyObject *m_volume_build(const pa_cvolume *volume)
+{
+    PyObject *volume_value = NULL;
+    PyObject *tmp_obj = NULL;
+    int i;
+
+    volume_value = PyList_New(0);
+    if (!volume_value)
+        return NULL;
+
+    for (i = 0; i < volume->channels; i++) {
+        tmp_obj = INT(volume->values[i]);
+        PyList_Append(volume_value, tmp_obj);
+        Py_DecRef(tmp_obj);
+    }
+    return volume_value;
+}
+
+/* Device ports are (name, description, available) tuples, card ports
+ * dicts */
+static PyObject *m_ports_build(const m_entry *e)
+{
+    PyObject *port_list = NULL;
+    PyObject *tmp_obj = NULL;
+    const m_port *port = NULL;
+    uint32_t i;
+
+    port_list = PyList_New(0);
+    if (!port_list)
+        return NULL;
+
+    for (i = 0; i < e->n_ports; i++) {
+        port = &e->ports[i];
+        if (e->kind != M_CARD)
+            tmp_obj = m_port_build(port);
+        else
+            tmp_obj = Py_BuildValue("{sssssisisi}",
+                                    "name", port->name,
+                                    "description", port->description,
+                                    "available", port->available,
+                                    "direction", port->direction,
+                                    "n_profiles", port->n_profiles);
+        PyList_Append(port_list, tmp_obj);
+        Py_XDECREF(tmp_obj);
+    }
+    return port_list;
+}
+
+/* A record of kind from a Py_BuildValue() tuple format with one item
+ * per field */
+static PyObject *m_record_build(m_record kind, const char *format, ...)
+{
+    DeepinPulseAudioRecord *record = NULL;
+    PyObject *values = NULL;
+    Py_ssize_t i, n;
+    va_list va;
+
+    va_start(va, format);
+    values = Py_VaBuildValue(format, va);
+    va_end(va);
+    if (!values)
+        return NULL;
+
+    n = PyTuple_GET_SIZE(values);
+    record = PyObject_NewVar(DeepinPulseAudioRecord, &m_record_types[kind], n);
+    if (!record) {
+        Py_DECREF(values);
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        record->values[i] = PyTuple_GET_ITEM(values, i);
+        Py_INCREF(record->values[i]);
+    }
+    Py_DECREF(values);
+    return (PyObject *) record;
+}
+
+static PyObject *m_device_build(m_entry *e)
+{
+    return m_record_build(e->kind == M_SINK ? M_RECORD_SINK : M_RECORD_SOURCE,
+                          "(ssiIOOO)",
+                          e->name,
+                          e->description,
+                          e->base_volume,
+                          e->n_ports,
+                          m_entry_object(e, M_OBJECT_MUTE),
+                          m_entry_object(e, M_OBJECT_PORTS),
+                          m_entry_object(e, M_OBJECT_PROPLIST));
+}
+
+static PyObject *m_stream_build(m_entry *e)
+{
+    return m_record_build(e->kind == M_SINK_INPUT ? M_RECORD_SINK_INPUT : M_RECORD_SOURCE_OUTPUT,
+                          "(siiiNssOiNiii)",
+                          e->name,
+                          e->owner_module,
+                          e->client,
+                          e->parent,
+                          m_channel_map_build(&e->channel_map),
+                          e->resample_method,
+                          e->driver,
+                          m_entry_object(e, M_OBJECT_PROPLIST),
+                          e->corked,
+                          m_volume_build(&e->volume),
+                          e->mute,
+                          e->has_volume,
+                          e->volume_writable);
+}
+
+static PyObject *m_profile_build(const m_profile *p)
+{
+    return Py_BuildValue("{sssssisi}",
+                         "name", p->name,
+                         "description", p->description,
+                         "n_sinks", p->n_sinks,
+                         "n_sources", p->n_sources);
+}
+
+static PyObject *m_profiles_build(const m_entry *e)
+{
+    PyObject *profile_list = NULL;
+    PyObject *tmp_obj = NULL;
+    uint32_t ctr;
+
+    profile_list = PyList_New(0);
+    if (!profile_list)
+        return NULL;
+
+    for (ctr = 0; ctr < e->n_profiles; ctr++) {
+        tmp_obj = m_profile_build(&e->profiles[ctr]);
+        PyList_Append(profile_list, tmp_obj);
+        Py_XDECREF(tmp_obj);
+    }
+    return profile_list;
+}
+
+static PyObject *m_active_profile_build(const m_entry *e)
+{
+    if (e->active_profile < 0) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    return m_profile_build(&e->profiles[e->active_profile]);
+}
+
+static PyObject *m_card_build(m_entry *e)
+{
+    PyObject *profile_list = NULL;
+
+    profile_list = m_profiles_build(e);
+    if (!profile_list)
+        return NULL;
+
+    return m_record_build(M_RECORD_CARD,
+                          "(siNNOiO)",
+                          e->name,
+                          e->n_profiles,
+                          profile_list,
+                          m_active_profile_build(e),
+                          m_entry_object(e, M_OBJECT_PROPLIST),
+                          e->n_ports,
+                          m_entry_object(e, M_OBJECT_PORTS));
+}
+
+static PyObject *m_server_build(const m_server *s)
+{
+    return m_record_build(M_RECORD_SERVER,
+                          "(ssssssi)",
+                          s->user_name,
+                          s->host_name,
+                          s->server_version,
+                          s->server_name,
+                          s->default_sink_name,
+                          s->default_source_name,
+                          s->cookie);
+}
+
+static PyObject *m_entry_build(m_entry *e, m_object which)
+{
+    switch (which) {
+        case M_OBJECT_CHANNELS:
+            return Py_BuildValue("{sisisN}",
+                                 "can_balance", pa_channel_map_can_balance(&e->channel_map),
+                                 "channels", e->channel_map.channels,
+                                 "map", m_channel_map_build(&e->channel_map));
+        case M_OBJECT_ACTIVE_PORT:
+            if (e->active_port < 0) {
+                Py_INCREF(Py_None);
+                return Py_None;
+            }
+            return m_port_build(&e->ports[e->active_port]);
+        case M_OBJECT_VOLUME:
+            return m_volume_build(&e->volume);
+        case M_OBJECT_PROPLIST:
+            return m_proplist_build(e->proplist);
+        case M_OBJECT_PORTS:
+            return m_ports_build(e);
+        case M_OBJECT_MUTE:
+            return PyBool_FromLong(e->mute);
+        default:
+            break;
+    }
+    switch (e->kind) {
+        case M_SINK:
+        case M_SOURCE:
+            return m_device_build(e);
+        case M_SINK_INPUT:
+        case M_SOURCE_OUTPUT:
+            return m_stream_build(e);
+        default:
+            return m_card_build(e);
+    }
+}
+
+/* Borrowed reference to a Python view of e, built on first use and kept
+ * until the entry changes */
+static PyObject *m_entry_object(m_entry *e, m_object which)
+{
+    if (e->objects_generation != e->generation)
+        m_entry_drop_objects(e);
+    if (!e->objects[which])
+        e->objects[which] = m_entry_build(e, which);
+    return e->objects[which];
+}
+
+/* Keys of the dicts handed out by m_entry_changes() */
+static const char *m_field_names[M_FIELD_COUNT] =
+{
+    "name", "description", "volume", "mute", "channels", "active_port",
+    "ports", "corked", "device", "profiles", "active_profile", "proplist",
+    "info", "fallback_sink", "fallback_source"
+};
+
+/* {field: new value} for the fields the last update of e moved */
+static PyObject *m_entry_changes(m_entry *e)
+{
+    PyObject *changes = NULL;
+    PyObject *value = NULL;
+    int f;
+
+    if (!(changes = PyDict_New()))
+        return NULL;
+
+    for (f = 0; f < M_FIELD_COUNT; f++) {
+        if (!(e->changed & M_FIELD_BIT(f)))
+            continue;
+        switch (f) {
+            case M_FIELD_NAME:
+                value = STRING(e->name);
+                break;
+            case M_FIELD_DESCRIPTION:
+                value = STRING(e->description);
+                break;
+            case M_FIELD_VOLUME:
+                value = m_entry_object(e, M_OBJECT_VOLUME);
+                Py_XINCREF(value);
+                break;
+            case M_FIELD_MUTE:
+                value = PyBool_FromLong(e->mute);
+                break;
+            case M_FIELD_CHANNELS:
+                value = m_entry_object(e, M_OBJECT_CHANNELS);
+                Py_XINCREF(value);
+                break;
+            case M_FIELD_ACTIVE_PORT:
+                value = m_entry_object(e, M_OBJECT_ACTIVE_PORT);
+                Py_XINCREF(value);
+                break;
+            case M_FIELD_PORTS:
+                value = m_entry_object(e, M_OBJECT_PORTS);
+                Py_XINCREF(value);
+                break;
+            case M_FIELD_CORKED:
+                value = PyBool_FromLong(e->corked);
+                break;
+            case M_FIELD_DEVICE:
+                value = INT(e->parent);
+                break;
+            case M_FIELD_PROFILES:
+                value = m_profiles_build(e);
+                break;
+            case M_FIELD_ACTIVE_PROFILE:
+                value = m_active_profile_build(e);
+                break;
+            case M_FIELD_PROPLIST:
+                value = m_entry_object(e, M_OBJECT_PROPLIST);
+                Py_XINCREF(value);
+                break;
+            case M_FIELD_OTHER:
+                value = m_entry_object(e, M_OBJECT_INFO);
+                Py_XINCREF(value);
+                break;
+            default:
+                continue;
+        }
+        if (!value) {
+            Py_DECREF(changes);
+            return NULL;
+        }
+        PyDict_SetItemString(changes, m_field_names[f], value);
+        Py_DECREF(value);
+    }
+    return changes;
+}
+
+/* Same for the server */
+static PyObject *m_server_changes(const m_server *s)
+{
+    PyObject *changes = NULL;
+    PyObject *value = NULL;
+    int f;
+
+    if (!(changes = PyDict_New()))
+        return NULL;
+
+    for (f = 0; f < M_FIELD_COUNT; f++) {
+        if (!(s->changed & M_FIELD_BIT(f)))
+            continue;
+        switch (f) {
+            // STRING() gives None once the last sink or source went away
+            case M_FIELD_FALLBACK_SINK:
+                value = STRING(s->default_sink_name);
+                break;
+            case M_FIELD_FALLBACK_SOURCE:
+                value = STRING(s->default_source_name);
+                break;
+            case M_FIELD_OTHER:
+                value = m_server_build(s);
+                break;
+            default:
+                continue;
+        }
+        if (!value) {
+            Py_DECREF(changes);
+            return NULL;
+        }
+        PyDict_SetItemString(changes, m_field_names[f], value);
+        Py_DECREF(value);
+    }
+    return changes;
+}
+
+/* The callable entry of dict for key, or NULL when there is none */
+static PyObject *m_dict_callback(PyObject *dict, const char *key)
+{
+    PyObject *func = NULL;
+
+    if (!dict || !PyDict_Check(dict))
+        return NULL;
+    if (!(func = PyDict_GetItemString(dict, key)) || !PyCallable_Check(func))
+        return NULL;
+    return func;
+}
+
+static void m_signal_set(PyObject **slot, PyObject *callback)
+{
+    Py_XINCREF(callback);
+    Py_XDECREF(*slot);
+    *slot = callback;
+}
+
+static void m_signal_clear(DeepinPulseAudioObject *self)
+{
+    int kind;
+    int signal;
+
+    for (kind = 0; kind <= M_KIND_COUNT; kind++) {
+        for (signal = 0; signal < M_SIGNAL_COUNT; signal++)
+            m_signal_set(&self->signal_cb[kind][signal], NULL);
+    }
+    m_signal_set(&self->events_cb, NULL);
+    m_signal_set(&self->record_read_cb, NULL);
+    m_signal_set(&self->record_suspended_cb, NULL);
+}
+
+/* Name of kind in the callbacks and signals, M_KIND_COUNT being the server */
+static const char *m_signal_kind_name(int kind)
+{
+    return kind < M_KIND_COUNT ? m_kind_names[kind] : "server";
+}
+
+static const char *m_signal_suffixes[M_SIGNAL_COUNT] = {
+    NULL, 
+    "changed", 
+    "removed"
+};
+
+/* Where connect() keeps the callback of name, NULL for a signal that is
+ * never emitted */
+static PyObject **m_signal_slot(DeepinPulseAudioObject *self, const char *name)
+{
+    char signal_name[32];
+    int kind;
+    int signal;
+
+    if (strcmp(name, "events") == 0)
+        return &self->events_cb;
+    for (kind = 0; kind <= M_KIND_COUNT; kind++) {
+        for (signal = M_SIGNAL_CHANGED; signal < M_SIGNAL_COUNT; signal++) {
+            // the server is never removed
+            if (kind == M_KIND_COUNT && signal == M_SIGNAL_REMOVED)
+                continue;
+            snprintf(signal_name, sizeof(signal_name), "%s-%s", 
+                     m_signal_kind_name(kind), m_signal_suffixes[signal]);
+            if (strcmp(name, signal_name) == 0)
+                return &self->signal_cb[kind][signal];
+        }
+    }
+    return NULL;
+}
+
+static PyObject *m_get_server_info(DeepinPulseAudioObject *self)
+{
+    if (!self->pa_ctx || pa_context_get_state(self->pa_ctx) != PA_CONTEXT_READY) {
+        RETURN_FALSE;
+    }
+    pa_operation *pa_op = NULL;
+    if (!(pa_op = pa_context_get_server_info(self->pa_ctx, m_pa_server_info_cb, self))) {
+        ERROR("pa_context_get_server_info() failed");
+        RETURN_FALSE;
+    }
+    pa_operation_unref(pa_op);
+    RETURN_TRUE;
+}
+
+static PyObject *m_get_cards(DeepinPulseAudioObject *self) 
+{
+    if (!self->pa_ctx || pa_context_get_state(self->pa_ctx) != PA_CONTEXT_READY) {
+        RETURN_FALSE;
     }
     pa_operation *pa_op = NULL;
     if (!(pa_op = pa_context_get_card_info_list(self->pa_ctx, m_pa_cardlist_cb, self))) {
@@ -575,6 +3534,185 @@ static PyObject *m_get_record_streams(DeepinPulseAudioObject *self)
     RETURN_TRUE;
 }
 
+static PyObject *m_get_by_name(DeepinPulseAudioObject *self, 
+                               PyObject *args, 
+                               m_kind kind)
+{
+    char *name = NULL;
+    m_entry *e = NULL;
+
+    if (!PyArg_ParseTuple(args, "s", &name)) {
+        ERROR("invalid arguments to get_by_name");
+        return NULL;
+    }
+    if (!(e = m_store_find(self, kind, name))) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    return INT(e->index);
+}
+
+static PyObject *m_get_sink_by_name(DeepinPulseAudioObject *self, PyObject *args)
+{
+    return m_get_by_name(self, args, M_SINK);
+}
+
+static PyObject *m_get_source_by_name(DeepinPulseAudioObject *self, PyObject *args)
+{
+    return m_get_by_name(self, args, M_SOURCE);
+}
+
+static PyObject *m_get_card_by_name(DeepinPulseAudioObject *self, PyObject *args)
+{
+    return m_get_by_name(self, args, M_CARD);
+}
+
+static PyObject *m_fallback_sink_index(DeepinPulseAudioObject *self)
+{
+    m_entry *e = m_store_find(self, M_SINK, self->server.default_sink_name);
+
+    if (!e) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    return INT(e->index);
+}
+
+static PyObject *m_fallback_source_index(DeepinPulseAudioObject *self)
+{
+    m_entry *e = m_store_find(self, M_SOURCE, self->server.default_source_name);
+
+    if (!e) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    return INT(e->index);
+}
+
+static PyObject *m_get_generation(DeepinPulseAudioObject *self, PyObject *args)
+{
+    char *kind_name = NULL;
+    int index = -1;
+    int kind = -1;
+    m_entry *e = NULL;
+
+    if (!PyArg_ParseTuple(args, "|si", &kind_name, &index)) {
+        ERROR("invalid arguments to get_generation");
+        return NULL;
+    }
+    if (!kind_name)
+        return PyLong_FromUnsignedLongLong(self->generation);
+
+    if ((kind = m_kind_from_name(kind_name)) < 0) {
+        ERROR("unknown kind");
+        return NULL;
+    }
+    if (!(e = m_store_lookup(self, kind, index))) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    return PyLong_FromUnsignedLongLong(e->generation);
+}
+
+/* (generation, changes) where changes maps each kind touched after since
+ * to its added, changed and removed indices, and "server" to True if the
+ * server info changed. None when since predates what the store remembers,
+ * the caller then has to refresh everything. */
+static PyObject *m_get_changes_since(DeepinPulseAudioObject *self, PyObject *args)
+{
+    unsigned PY_LONG_LONG since = 0;
+    PyObject *lists[M_KIND_COUNT][3];
+    PyObject *changes = NULL;
+    PyObject *tmp_obj = NULL;
+    GHashTableIter iter;
+    gpointer value;
+    m_entry *e = NULL;
+    m_tombstone *t = NULL;
+    int kind;
+    int i;
+
+    if (!PyArg_ParseTuple(args, "K", &since)) {
+        ERROR("invalid arguments to get_changes_since");
+        return NULL;
+    }
+    if (since < self->changes_floor || !self->tombstones) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    memset(lists, 0, sizeof(lists));
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (self->kind_generation[kind] <= since)
+            continue;
+        for (i = 0; i < 3; i++) {
+            if (!(lists[kind][i] = PyList_New(0)))
+                goto fail;
+        }
+
+        g_hash_table_iter_init(&iter, self->entries[kind]);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            e = value;
+            if (e->generation <= since)
+                continue;
+            tmp_obj = INT(e->index);
+            if (!tmp_obj ||
+                PyList_Append(lists[kind][e->created > since ? 0 : 1], tmp_obj) < 0) {
+                Py_XDECREF(tmp_obj);
+                goto fail;
+            }
+            Py_DecRef(tmp_obj);
+        }
+    }
+
+    g_hash_table_iter_init(&iter, self->tombstones);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        t = value;
+        kind = t->key >> 32;
+        // Appeared and vanished in between: nothing to report
+        if (t->removed <= since || t->created > since || !lists[kind][2])
+            continue;
+        tmp_obj = INT((uint32_t) t->key);
+        if (!tmp_obj || PyList_Append(lists[kind][2], tmp_obj) < 0) {
+            Py_XDECREF(tmp_obj);
+            goto fail;
+        }
+        Py_DecRef(tmp_obj);
+    }
+
+    if (!(changes = PyDict_New()))
+        goto fail;
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        if (!lists[kind][0])
+            continue;
+        tmp_obj = Py_BuildValue("{sNsNsN}",
+                                "added", lists[kind][0],
+                                "changed", lists[kind][1],
+                                "removed", lists[kind][2]);
+        // The lists went to tmp_obj
+        for (i = 0; i < 3; i++)
+            lists[kind][i] = NULL;
+        if (!tmp_obj ||
+            PyDict_SetItemString(changes, m_kind_names[kind], tmp_obj) < 0) {
+            Py_XDECREF(tmp_obj);
+            goto fail;
+        }
+        Py_DecRef(tmp_obj);
+    }
+    if (self->server.generation > since &&
+        PyDict_SetItemString(changes, "server", Py_True) < 0)
+        goto fail;
+
+    return Py_BuildValue("(KN)", (unsigned PY_LONG_LONG) self->generation, changes);
+
+fail:
+    for (kind = 0; kind < M_KIND_COUNT; kind++) {
+        for (i = 0; i < 3; i++)
+            Py_XDECREF(lists[kind][i]);
+    }
+    Py_XDECREF(changes);
+    return NULL;
+}
+
 //******************************************
 // pa set function
 static PyObject *m_set_output_active_port(DeepinPulseAudioObject *self, 
@@ -586,18 +3724,23 @@ static PyObject *m_set_output_active_port(DeepinPulseAudioObject *self,
 
     int index = 0;
     char *port = NULL;
+    PyObject *done_cb = NULL;
+    DeepinPulseAudioOperation *op = NULL;
 
-    if (!PyArg_ParseTuple(args, "is", &index, &port)) {
+    if (!PyArg_ParseTuple(args, "is|O", &index, &port, &done_cb)) {
         ERROR("invalid arguments to set_output_active_port");
         return NULL;
     }
+    if (done_cb && !(op = m_operation_new(self, done_cb)))
+        return NULL;
+
     pa_operation *pa_op = NULL;
-    if (!(pa_op = pa_context_set_sink_port_by_index(self->pa_ctx, index, port, NULL, NULL))) {
+    if (!(pa_op = pa_context_set_sink_port_by_index(self->pa_ctx, index, port, op ? m_pa_operation_success_cb : NULL, op))) {
         ERROR("pa_context_set_sink_port_by_index() failed");
+        Py_XDECREF(op);
         RETURN_FALSE;
     }
-    pa_operation_unref(pa_op);
-    RETURN_TRUE;
+    return m_operation_start(op, pa_op);
 }
 
 static PyObject *m_set_input_active_port(DeepinPulseAudioObject *self,         
@@ -608,19 +3751,24 @@ static PyObject *m_set_input_active_port(DeepinPulseAudioObject *self,
     }
     int index = 0;                                                              
     char *port = NULL;                                                          
+    PyObject *done_cb = NULL;
+    DeepinPulseAudioOperation *op = NULL;
                                                                                 
-    if (!PyArg_ParseTuple(args, "is", &index, &port)) {
+    if (!PyArg_ParseTuple(args, "is|O", &index, &port, &done_cb)) {
         ERROR("invalid arguments to set_input_active_port");                   
         return NULL;                                                            
     }                                                                           
                                                                                 
+    if (done_cb && !(op = m_operation_new(self, done_cb)))
+        return NULL;
+
     pa_operation *pa_op = NULL;
-    if (!(pa_op = pa_context_set_source_port_by_index(self->pa_ctx, index, port, NULL, NULL))) {
+    if (!(pa_op = pa_context_set_source_port_by_index(self->pa_ctx, index, port, op ? m_pa_operation_success_cb : NULL, op))) {
         ERROR("pa_context_set_source_port_by_index() failed");
+        Py_XDECREF(op);
         RETURN_FALSE;
     }
-    pa_operation_unref(pa_op);
-    RETURN_TRUE;
+    return m_operation_start(op, pa_op);
 }
 
 static PyObject *m_set_output_mute(DeepinPulseAudioObject *self, 
@@ -632,8 +3780,10 @@ static PyObject *m_set_output_mute(DeepinPulseAudioObject *self,
 
     int index = 0;
     PyObject *mute = NULL;
+    PyObject *done_cb = NULL;
+    DeepinPulseAudioOperation *op = NULL;
 
-    if (!PyArg_ParseTuple(args, "iO", &index, &mute)) {
+    if (!PyArg_ParseTuple(args, "iO|O", &index, &mute, &done_cb)) {
         ERROR("invalid arguments to set_output_mute");
         return NULL;
     }
@@ -642,14 +3792,17 @@ static PyObject *m_set_output_mute(DeepinPulseAudioObject *self,
         RETURN_FALSE;
     } 
                                                                             
+    if (done_cb && !(op = m_operation_new(self, done_cb)))
+        return NULL;
+
     pa_operation *pa_op = NULL;
     if (!(pa_op = pa_context_set_sink_mute_by_index(self->pa_ctx,
-                    index, mute == Py_True ? 1 : 0, NULL, NULL))) {
+                    index, mute == Py_True ? 1 : 0, op ? m_pa_operation_success_cb : NULL, op))) {
         ERROR("pa_context_set_sink_mute_by_index() failed");
+        Py_XDECREF(op);
         RETURN_FALSE;
     }
-    pa_operation_unref(pa_op);
-    RETURN_TRUE;
+    return m_operation_start(op, pa_op);
 }
 
 static PyObject *m_set_input_mute(DeepinPulseAudioObject *self, 
@@ -661,8 +3814,10 @@ static PyObject *m_set_input_mute(DeepinPulseAudioObject *self,
 
     int index = 0;
     PyObject *mute = NULL;
+    PyObject *done_cb = NULL;
+    DeepinPulseAudioOperation *op = NULL;
 
-    if (!PyArg_ParseTuple(args, "iO", &index, &mute)) {
+    if (!PyArg_ParseTuple(args, "iO|O", &index, &mute, &done_cb)) {
         ERROR("invalid arguments to set_input_mute");
         return NULL;
     }
@@ -671,14 +3826,17 @@ static PyObject *m_set_input_mute(DeepinPulseAudioObject *self,
         RETURN_FALSE;
     } 
                                                                             
+    if (done_cb && !(op = m_operation_new(self, done_cb)))
+        return NULL;
+
     pa_operation *pa_op = NULL;
     if (!(pa_op = pa_context_set_source_mute_by_index(self->pa_ctx,
-                    index, mute == Py_True ? 1 : 0, NULL, NULL))) {
+                    index, mute == Py_True ? 1 : 0, op ? m_pa_operation_success_cb : NULL, op))) {
         ERROR("pa_context_set_source_mute_by_index() failed");
+        Py_XDECREF(op);
         RETURN_FALSE;
     }
-    pa_operation_unref(pa_op);
-    RETURN_TRUE;
+    return m_operation_start(op, pa_op);
 }
 
 static PyObject *m_set_output_volume(DeepinPulseAudioObject *self, 
@@ -694,8 +3852,10 @@ static PyObject *m_set_output_volume(DeepinPulseAudioObject *self,
     pa_cvolume output_volume;
     Py_ssize_t tuple_size = 0;
     PyObject *tmp_obj = NULL;
+    PyObject *done_cb = NULL;
+    DeepinPulseAudioOperation *op = NULL;
 
-    if (!PyArg_ParseTuple(args, "iOi", &index, &volume, &channel_num)) {
+    if (!PyArg_ParseTuple(args, "iOi|O", &index, &volume, &channel_num, &done_cb)) {
         ERROR("invalid arguments to set_output_volume");
         return NULL;
     }
@@ -720,14 +3880,20 @@ static PyObject *m_set_output_volume(DeepinPulseAudioObject *self,
             output_volume.values[i] = PyInt_AsLong(PyTuple_GetItem(volume, i));
     }
 
+    if (!done_cb && self->coalesce_volume)
+        return m_volume_coalesce(self, PA_SUBSCRIPTION_EVENT_SINK, index, &output_volume);
+
+    if (done_cb && !(op = m_operation_new(self, done_cb)))
+        return NULL;
+
     pa_operation *pa_op = NULL;
     if (!(pa_op = pa_context_set_sink_volume_by_index(self->pa_ctx,
-                    index, &output_volume, NULL, NULL))) {
+                    index, &output_volume, op ? m_pa_operation_success_cb : NULL, op))) {
         ERROR("pa_context_set_sink_volume_by_index() failed");
+        Py_XDECREF(op);
         RETURN_FALSE;
     }
-    pa_operation_unref(pa_op);
-    RETURN_TRUE;
+    return m_operation_start(op, pa_op);
 }
 
 static PyObject *m_set_output_volume_with_balance(DeepinPulseAudioObject *self,
@@ -745,8 +3911,10 @@ static PyObject *m_set_output_volume_with_balance(DeepinPulseAudioObject *self,
     int channel_num = 1, i;
 
     PyObject *channel_map_list = NULL;
+    PyObject *done_cb = NULL;
+    DeepinPulseAudioOperation *op = NULL;
 
-    if (!PyArg_ParseTuple(args, "iIfiO", &index, &volume, &balance, &channel_num, &channel_map_list)) {
+    if (!PyArg_ParseTuple(args, "iIfiO|O", &index, &volume, &balance, &channel_num, &channel_map_list, &done_cb)) {
         ERROR("invalid arguments to set_output_volume");
         return NULL;
     }
@@ -765,14 +3933,20 @@ static PyObject *m_set_output_volume_with_balance(DeepinPulseAudioObject *self,
     }
     // set balance
     pa_cvolume_set_balance(&output_volume, &output_channel_map, balance);
+    if (!done_cb && self->coalesce_volume)
+        return m_volume_coalesce(self, PA_SUBSCRIPTION_EVENT_SINK, index, &output_volume);
+
+    if (done_cb && !(op = m_operation_new(self, done_cb)))
+        return NULL;
+
     pa_operation *pa_op = NULL;
     if (!(pa_op = pa_context_set_sink_volume_by_index(self->pa_ctx,
-                    index, &output_volume, NULL, NULL))) {
+                    index, &output_volume, op ? m_pa_operation_success_cb : NULL, op))) {
         ERROR("pa_context_set_sink_volume_by_index() failed");
+        Py_XDECREF(op);
         RETURN_FALSE;
     }
-    pa_operation_unref(pa_op);
-    RETURN_TRUE;
+    return m_operation_start(op, pa_op);
 }
 
 static PyObject *m_set_input_volume(DeepinPulseAudioObject *self, 
@@ -788,8 +3962,10 @@ static PyObject *m_set_input_volume(DeepinPulseAudioObject *self,
     pa_cvolume input_volume;
     Py_ssize_t tuple_size = 0;
     PyObject *tmp_obj = NULL;
+    PyObject *done_cb = NULL;
+    DeepinPulseAudioOperation *op = NULL;
 
-    if (!PyArg_ParseTuple(args, "iOi", &index, &volume, &channel_num)) {
+    if (!PyArg_ParseTuple(args, "iOi|O", &index, &volume, &channel_num, &done_cb)) {
         ERROR("invalid arguments to set_input_volume");
         return NULL;
     }
@@ -814,14 +3990,20 @@ static PyObject *m_set_input_volume(DeepinPulseAudioObject *self,
         input_volume.values[i] = PyInt_AsLong(PyTuple_GetItem(volume, i));
     }
 
+    if (!done_cb && self->coalesce_volume)
+        return m_volume_coalesce(self, PA_SUBSCRIPTION_EVENT_SOURCE, index, &input_volume);
+
+    if (done_cb && !(op = m_operation_new(self, done_cb)))
+        return NULL;
+
     pa_operation *pa_op = NULL;
     if (!(pa_op = pa_context_set_source_volume_by_index(self->pa_ctx,
-                    index, &input_volume, NULL, NULL))) {
+                    index, &input_volume, op ? m_pa_operation_success_cb : NULL, op))) {
         ERROR("pa_context_set_source_volume_by_index() failed");
+        Py_XDECREF(op);
         RETURN_FALSE;
     }
-    pa_operation_unref(pa_op);
-    RETURN_TRUE;
+    return m_operation_start(op, pa_op);
 }
 
 static PyObject *m_set_input_volume_with_balance(DeepinPulseAudioObject *self,
@@ -839,8 +4021,10 @@ static PyObject *m_set_input_volume_with_balance(DeepinPulseAudioObject *self,
     int channel_num = 1, i;
 
     PyObject *channel_map_list = NULL;
+    PyObject *done_cb = NULL;
+    DeepinPulseAudioOperation *op = NULL;
 
-    if (!PyArg_ParseTuple(args, "iIfiO", &index, &volume, &balance, &channel_num, &channel_map_list)) {
+    if (!PyArg_ParseTuple(args, "iIfiO|O", &index, &volume, &balance, &channel_num, &channel_map_list, &done_cb)) {
         ERROR("invalid arguments to set_output_volume");
         return NULL;
     }
@@ -859,14 +4043,20 @@ static PyObject *m_set_input_volume_with_balance(DeepinPulseAudioObject *self,
     }
     // set balance
     pa_cvolume_set_balance(&input_volume, &input_channel_map, balance);
+    if (!done_cb && self->coalesce_volume)
+        return m_volume_coalesce(self, PA_SUBSCRIPTION_EVENT_SOURCE, index, &input_volume);
+
+    if (done_cb && !(op = m_operation_new(self, done_cb)))
+        return NULL;
+
     pa_operation *pa_op = NULL;
     if (!(pa_op = pa_context_set_source_volume_by_index(self->pa_ctx,
-                    index, &input_volume, NULL, NULL))) {
+                    index, &input_volume, op ? m_pa_operation_success_cb : NULL, op))) {
         ERROR("pa_context_set_source_volume_by_index() failed");
+        Py_XDECREF(op);
         RETURN_FALSE;
     }
-    pa_operation_unref(pa_op);
-    RETURN_TRUE;
+    return m_operation_start(op, pa_op);
 }
 
 static PyObject *m_set_sink_input_mute(DeepinPulseAudioObject *self,
@@ -878,8 +4068,10 @@ static PyObject *m_set_sink_input_mute(DeepinPulseAudioObject *self,
 
     int index = 0;
     PyObject *mute = NULL;
+    PyObject *done_cb = NULL;
+    DeepinPulseAudioOperation *op = NULL;
 
-    if (!PyArg_ParseTuple(args, "iO", &index, &mute)) {
+    if (!PyArg_ParseTuple(args, "iO|O", &index, &mute, &done_cb)) {
         ERROR("invalid arguments to set_sink_input_mute");
         return NULL;
     }
@@ -888,14 +4080,17 @@ static PyObject *m_set_sink_input_mute(DeepinPulseAudioObject *self,
         RETURN_FALSE;
     }
 
+    if (done_cb && !(op = m_operation_new(self, done_cb)))
+        return NULL;
+
     pa_operation *pa_op = NULL;
     if (!(pa_op = pa_context_set_sink_input_mute(self->pa_ctx,
-                    index, mute == Py_True ? 1 : 0, NULL, NULL))) {
+                    index, mute == Py_True ? 1 : 0, op ? m_pa_operation_success_cb : NULL, op))) {
         ERROR("pa_context_set_sink_input_mute() failed");
+        Py_XDECREF(op);
         RETURN_FALSE;
     }
-    pa_operation_unref(pa_op);
-    RETURN_TRUE;
+    return m_operation_start(op, pa_op);
 }
 
 static PyObject *m_set_sink_input_volume(DeepinPulseAudioObject *self,
@@ -911,8 +4106,10 @@ static PyObject *m_set_sink_input_volume(DeepinPulseAudioObject *self,
     pa_cvolume pa_sink_input_volume;
     Py_ssize_t tuple_size = 0;
     PyObject *tmp_obj = NULL;
+    PyObject *done_cb = NULL;
+    DeepinPulseAudioOperation *op = NULL;
 
-    if (!PyArg_ParseTuple(args, "iOi", &index, &volume, &channel_num)) {
+    if (!PyArg_ParseTuple(args, "iOi|O", &index, &volume, &channel_num, &done_cb)) {
         ERROR("invalid arguments to set_input_volume");
         return NULL;
     }
@@ -937,14 +4134,20 @@ static PyObject *m_set_sink_input_volume(DeepinPulseAudioObject *self,
         pa_sink_input_volume.values[i] = PyInt_AsLong(PyTuple_GetItem(volume, i));
     }
 
+    if (!done_cb && self->coalesce_volume)
+        return m_volume_coalesce(self, PA_SUBSCRIPTION_EVENT_SINK_INPUT, index, &pa_sink_input_volume);
+
+    if (done_cb && !(op = m_operation_new(self, done_cb)))
+        return NULL;
+
     pa_operation *pa_op = NULL;
     if (!(pa_op = pa_context_set_sink_input_volume(self->pa_ctx,
-                    index, &pa_sink_input_volume, NULL, NULL))) {
+                    index, &pa_sink_input_volume, op ? m_pa_operation_success_cb : NULL, op))) {
         ERROR("pa_context_set_sink_input_volume() failed");
+        Py_XDECREF(op);
         RETURN_FALSE;
     }
-    pa_operation_unref(pa_op);
-    RETURN_TRUE;
+    return m_operation_start(op, pa_op);
 }
 
 static PyObject *m_set_fallback_sink(DeepinPulseAudioObject *self,
@@ -955,19 +4158,24 @@ static PyObject *m_set_fallback_sink(DeepinPulseAudioObject *self,
     }
 
     char *name = NULL;
+    PyObject *done_cb = NULL;
+    DeepinPulseAudioOperation *op = NULL;
 
-    if (!PyArg_ParseTuple(args, "s", &name)) {
+    if (!PyArg_ParseTuple(args, "s|O", &name, &done_cb)) {
         ERROR("invalid arguments to set_fallback_sink");
         return NULL;
     }
 
+    if (done_cb && !(op = m_operation_new(self, done_cb)))
+        return NULL;
+
     pa_operation *pa_op = NULL;
-    if (!(pa_op = pa_context_set_default_sink(self->pa_ctx, name, NULL, NULL))) {
+    if (!(pa_op = pa_context_set_default_sink(self->pa_ctx, name, op ? m_pa_operation_success_cb : NULL, op))) {
         ERROR("pa_context_set_default_sink() failed");
+        Py_XDECREF(op);
         RETURN_FALSE;
     }
-    pa_operation_unref(pa_op);
-    RETURN_TRUE;
+    return m_operation_start(op, pa_op);
 }
 
 static PyObject *m_set_fallback_source(DeepinPulseAudioObject *self,
@@ -978,378 +4186,404 @@ static PyObject *m_set_fallback_source(DeepinPulseAudioObject *self,
     }
 
     char *name = NULL;
+    PyObject *done_cb = NULL;
+    DeepinPulseAudioOperation *op = NULL;
 
-    if (!PyArg_ParseTuple(args, "s", &name)) {
+    if (!PyArg_ParseTuple(args, "s|O", &name, &done_cb)) {
         ERROR("invalid arguments to set_fallback_source");
         return NULL;
     }
 
+    if (done_cb && !(op = m_operation_new(self, done_cb)))
+        return NULL;
+
     pa_operation *pa_op = NULL;
-    if (!(pa_op = pa_context_set_default_source(self->pa_ctx, name, NULL, NULL))) {
+    if (!(pa_op = pa_context_set_default_source(self->pa_ctx, name, op ? m_pa_operation_success_cb : NULL, op))) {
         ERROR("pa_context_set_default_source() failed");
+        Py_XDECREF(op);
         RETURN_FALSE;
     }
-    pa_operation_unref(pa_op);
-    RETURN_TRUE;
+    return m_operation_start(op, pa_op);
 }
 
-//*****************************************
-// pulseaudio get info callback
-static void m_pa_server_info_cb(pa_context *c, 
-                                const pa_server_info *i, 
-                                void *userdata)
+static PyObject *m_set_volume_coalescing(DeepinPulseAudioObject *self,
+                                         PyObject *args)
 {
-    if (!c || !i || !userdata) 
-        return;
-    
-    PyGILState_STATE gstate;
-    gstate = PyGILState_Ensure();
-    DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
-    PyObject *tmp_obj = NULL;
-    PyObject *server_dict = NULL;
+    PyObject *enable = NULL;
 
-    server_dict = PyDict_New();
-    if (!server_dict) {
-        ERROR("PyDict_New error");
-        return;
+    if (!PyArg_ParseTuple(args, "O", &enable)) {
+        ERROR("invalid arguments to set_volume_coalescing");
+        return NULL;
     }
-    
-    tmp_obj = STRING(i->user_name);
-    PyDict_SetItemString(server_dict, "user_name", tmp_obj);
-    Py_DecRef(tmp_obj);
-
-    tmp_obj = STRING(i->host_name);
-    PyDict_SetItemString(server_dict, "host_name", tmp_obj);
-    Py_DecRef(tmp_obj);
 
-    tmp_obj = STRING(i->server_version);
-    PyDict_SetItemString(server_dict, "server_version", tmp_obj);
-    Py_DecRef(tmp_obj);
-
-    tmp_obj = STRING(i->server_name);
-    PyDict_SetItemString(server_dict, "server_name", tmp_obj);
-    Py_DecRef(tmp_obj);
-
-    tmp_obj = STRING(i->default_sink_name);
-    PyDict_SetItemString(server_dict, "fallback_sink", tmp_obj);
-    Py_DecRef(tmp_obj);
+    self->coalesce_volume = PyObject_IsTrue(enable) > 0;
+    RETURN_TRUE;
+}
 
-    tmp_obj = STRING(i->default_source_name);
-    PyDict_SetItemString(server_dict, "fallback_source", tmp_obj);
-    Py_DecRef(tmp_obj);
+static PyObject *m_set_event_window(DeepinPulseAudioObject *self,
+                                    PyObject *args)
+{
+    int window = 0;
 
-    tmp_obj = INT(i->cookie);
-    PyDict_SetItemString(server_dict, "cookie", tmp_obj);
-    Py_DecRef(tmp_obj);
+    if (!PyArg_ParseTuple(args, "i", &window)) {
+        ERROR("invalid arguments to set_event_window");
+        return NULL;
+    }
 
-    PyObject *func = NULL;
-    if (self->state_cb && PyDict_Check(self->state_cb) && ((func=PyDict_GetItemString(self->state_cb, "server")) != NULL)) {
-        if (PyCallable_Check(func)) {
-            PyEval_CallFunction(func, "(OO)", self, server_dict);
-        }
+    self->event_window = window > 0 && self->pa_ml ? window : 0;
+    // deliver what was held back under the old window right away
+    if (self->event_timer) {
+        m_source_remove(self, self->event_timer);
+        m_event_flush(self);
     }
-    Py_XDECREF(server_dict);
-    PyGILState_Release(gstate);
+    RETURN_TRUE;
 }
 
-static void m_pa_cardlist_cb(pa_context *c,
-                             const pa_card_info *i,
-                             int eol,
-                             void *userdata)
+/* set_event_batching(True) delivers subscription events as one call of
+ * the "events" callback per mainloop dispatch, with a list of
+ * (signal, index, value) tuples:
+ *   ("<kind>-new", index, info), ("<kind>-changed", index, {field: value}),
+ *   ("<kind>-removed", index, None), ("server-changed", None, {field: value})
+ * The single event callbacks are not called for them meanwhile. */
+static PyObject *m_set_event_batching(DeepinPulseAudioObject *self,
+                                      PyObject *args)
 {
-    if (!userdata || eol || !c || !i)
-        return;
-
-    PyGILState_STATE gstate;
-    gstate = PyGILState_Ensure();
-    DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
-
-    PyObject *card_dict = NULL;         // a dict save the card info
-    PyObject *profile_list = NULL;      // card_profile_info list
-    PyObject *profile_dict = NULL;
-    PyObject *port_list = NULL;         // card_port_info
-    PyObject *port_dict = NULL;
-    PyObject *active_profile = NULL;
-    PyObject *prop_dict = NULL;
-
-    int ctr = 0;
-    const char *prop_key;
-    void *prop_state = NULL;
-    PyObject *tmp_obj = NULL;
+    PyObject *enable = NULL;
 
-    card_dict = PyDict_New();
-    if (!card_dict) {
-        ERROR("PyDict_New error");
-        return;
+    if (!PyArg_ParseTuple(args, "O", &enable)) {
+        ERROR("invalid arguments to set_event_batching");
+        return NULL;
     }
 
-    active_profile = PyDict_New();
-    if (!active_profile) {
-        ERROR("PyDict_New error");
-        return;
+    // without GLib events are always batched
+    self->event_batch = PyObject_IsTrue(enable) > 0 || self->fd_ml || self->io_ml;
+    // deliver what was queued so far right away
+    if (!self->event_batch && self->batch_idle) {
+        m_source_remove(self, self->batch_idle);
+        m_batch_flush(self);
     }
+    m_update_subscription(self);
+    RETURN_TRUE;
+}
 
-    prop_dict = PyDict_New();
-    if (!prop_dict) {
-        ERROR("PyDict_New error");
-        return;
+/* Switch to api before the context exists. Nothing runs GLib sources
+ * after this, so events are always batched and drain() is the window. */
+static void m_leave_glib(DeepinPulseAudioObject *self, pa_mainloop_api *api)
+{
+    m_main_stop(self);
+    if (self->pa_ml) {
+        pa_glib_mainloop_free(self->pa_ml);
+        self->pa_ml = NULL;
     }
+    self->pa_mlapi = api;
 
-    profile_list = PyList_New(0);
-    if (!profile_list) {
-        ERROR("PyList_New error");
-        return;
+    if (self->event_timer) {
+        m_source_remove(self, self->event_timer);
+        m_event_flush(self);
     }
-    port_list = PyList_New(0);
-    if (!port_list) {
-        ERROR("PyList_New error");
-        return;
+    self->event_window = 0;
+    if (self->batch_idle) {
+        m_source_remove(self, self->batch_idle);
+        self->batch_idle = 0;
+        eventfd_write(self->event_fd, 1);
     }
+    self->event_batch = 1;
+    m_update_subscription(self);
+}
 
-    tmp_obj = STRING(i->name);
-    PyDict_SetItemString(card_dict, "name", tmp_obj);
-    Py_DecRef(tmp_obj);
-
-    tmp_obj = INT(i->n_profiles);
-    PyDict_SetItemString(card_dict, "n_profiles", tmp_obj);
-    Py_DecRef(tmp_obj);
-
-    // profile list
-    for (ctr = 0; ctr < i->n_profiles; ctr++) {
-        profile_dict = PyDict_New();
-        if (!profile_dict) {
-            ERROR("PyDict_New error");
-            return;
-        }
-        tmp_obj = STRING(i->profiles[ctr].name);
-        PyDict_SetItemString(profile_dict, "name", tmp_obj);
-        Py_DecRef(tmp_obj);
-
-        tmp_obj = STRING(i->profiles[ctr].description);
-        PyDict_SetItemString(profile_dict, "description", tmp_obj);
-        Py_DecRef(tmp_obj);
-
-        tmp_obj = INT(i->profiles[ctr].n_sinks);
-        PyDict_SetItemString(profile_dict, "n_sinks", tmp_obj);
-        Py_DecRef(tmp_obj);
-
-        tmp_obj = INT(i->profiles[ctr].n_sources);
-        PyDict_SetItemString(profile_dict, "n_sources", tmp_obj);
-        Py_DecRef(tmp_obj);
+/* open_event_fd() moves the connection off GLib onto a loop of our own,
+ * driven by drain(). The returned descriptor turns readable whenever
+ * drain() should be called, so it can sit in select(), epoll or asyncio's
+ * add_reader(). Subscription events are then only returned by drain(),
+ * as with set_event_batching(). Must come before connect_to_pulse(). */
+static PyObject *m_open_event_fd(DeepinPulseAudioObject *self)
+{
+    struct epoll_event ev;
 
-        PyList_Append(profile_list, profile_dict);
-        Py_DecRef(profile_dict);
+    if (self->fd_ml)
+        return INT(self->poll_fd);
+    if (self->pa_ctx || self->io_ml) {
+        ERROR("open_event_fd must be called before connect_to_pulse, instead of start_io_thread");
+        return NULL;
     }
-    PyDict_SetItemString(card_dict, "profiles", profile_list);
-    Py_DecRef(profile_list);
-
-    // active profile
-    if (i->active_profile) {
-        tmp_obj = STRING(i->active_profile->name);
-        PyDict_SetItemString(active_profile, "name", tmp_obj);
-        Py_DecRef(tmp_obj);
-
-        tmp_obj = STRING(i->active_profile->description);
-        PyDict_SetItemString(active_profile, "description", tmp_obj);
-        Py_DecRef(tmp_obj);
-
-        tmp_obj = INT(i->active_profile->n_sinks);
-        PyDict_SetItemString(active_profile, "n_sinks", tmp_obj);
-        Py_DecRef(tmp_obj);
-
-        tmp_obj = INT(i->active_profile->n_sources);
-        PyDict_SetItemString(active_profile, "n_sources", tmp_obj);
-        Py_DecRef(tmp_obj);
 
-        PyDict_SetItemString(card_dict, "active_profile", active_profile);
-        Py_DecRef(active_profile);
-    } else {
-        PyDict_SetItemString(card_dict, "active_profile", Py_None);
-        Py_DecRef(active_profile);
-    }
-    // proplist
-    while ((prop_key=pa_proplist_iterate(i->proplist, &prop_state))) {
-        tmp_obj = STRING(pa_proplist_gets(i->proplist, prop_key));
-        PyDict_SetItemString(prop_dict, prop_key, tmp_obj);
-        Py_DecRef(tmp_obj);
+    self->poll_fd = epoll_create1(EPOLL_CLOEXEC);
+    self->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    self->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (self->poll_fd < 0 || self->event_fd < 0 || self->timer_fd < 0) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        if (self->poll_fd >= 0)
+            close(self->poll_fd);
+        if (self->event_fd >= 0)
+            close(self->event_fd);
+        if (self->timer_fd >= 0)
+            close(self->timer_fd);
+        self->poll_fd = self->event_fd = self->timer_fd = -1;
+        return NULL;
     }
-    PyDict_SetItemString(card_dict, "proplist", prop_dict);
-    Py_DecRef(prop_dict);
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = self->event_fd;
+    epoll_ctl(self->poll_fd, EPOLL_CTL_ADD, self->event_fd, &ev);
+    ev.data.fd = self->timer_fd;
+    epoll_ctl(self->poll_fd, EPOLL_CTL_ADD, self->timer_fd, &ev);
+
+    self->fd_ml = pa_mainloop_new();
+    pa_mainloop_set_poll_func(self->fd_ml, m_event_fd_poll, self);
+    m_leave_glib(self, pa_mainloop_get_api(self->fd_ml));
+    return INT(self->poll_fd);
+}
 
-    tmp_obj = INT(i->n_ports);
-    PyDict_SetItemString(card_dict, "n_ports", tmp_obj);
-    Py_DecRef(tmp_obj);
+/* start_io_thread() runs libpulse on a thread of its own: all protocol
+ * I/O, and decoding what the server sends, happens there without the
+ * GIL. Decoded results are handed over through a lock free queue and
+ * reach Python, store and callbacks, in drain(), with the events returned
+ * as with open_event_fd(). Returns the descriptor that turns readable
+ * when there is something to drain. Must come before connect_to_pulse(). */
+static PyObject *m_start_io_thread(DeepinPulseAudioObject *self)
+{
+    if (self->io_ml)
+        return INT(self->event_fd);
+    if (self->pa_ctx || self->fd_ml) {
+        ERROR("start_io_thread must be called before connect_to_pulse, instead of open_event_fd");
+        return NULL;
+    }
 
-    // ports list
-    for (ctr = 0; ctr < i->n_ports; ctr++) {
-        port_dict = PyDict_New();
-        if (!port_dict) {
-            ERROR("PyDict_New error");
-            return;
+    if ((self->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return NULL;
+    }
+    // Leave GLib only once the thread runs, a failure keeps the object
+    // as it was
+    self->io_ml = pa_threaded_mainloop_new();
+    if (!self->io_ml || pa_threaded_mainloop_start(self->io_ml) < 0) {
+        if (self->io_ml) {
+            pa_threaded_mainloop_free(self->io_ml);
+            self->io_ml = NULL;
         }
-        tmp_obj = STRING(i->ports[ctr]->name);
-        PyDict_SetItemString(port_dict, "name", tmp_obj);
-        Py_DecRef(tmp_obj);
+        close(self->event_fd);
+        self->event_fd = -1;
+        ERROR("pa_threaded_mainloop_start() failed");
+        return NULL;
+    }
+    m_leave_glib(self, pa_threaded_mainloop_get_api(self->io_ml));
+    return INT(self->event_fd);
+}
 
-        tmp_obj = STRING(i->ports[ctr]->description);
-        PyDict_SetItemString(port_dict, "description", tmp_obj);
-        Py_DecRef(tmp_obj);
+/* Dispatch whatever is ready on the connection and return every event
+ * queued since the last call, see set_event_batching() for the items */
+static PyObject *m_drain(DeepinPulseAudioObject *self)
+{
+    eventfd_t n;
 
-        tmp_obj = INT(i->ports[ctr]->available);
-        PyDict_SetItemString(port_dict, "available", tmp_obj);
-        Py_DecRef(tmp_obj);
+    if (!self->fd_ml && !self->io_ml) {
+        ERROR("drain needs open_event_fd or start_io_thread");
+        return NULL;
+    }
 
-        tmp_obj = INT(i->ports[ctr]->direction);
-        PyDict_SetItemString(port_dict, "direction", tmp_obj);
-        Py_DecRef(tmp_obj);
+    // before taking anything, see m_io_push()
+    eventfd_read(self->event_fd, &n);
+    if (self->fd_ml)
+        m_event_fd_dispatch(self);
+    else
+        m_io_run(self);
+    return m_batch_take(self);
+}
 
-        tmp_obj = INT(i->ports[ctr]->n_profiles);
-        PyDict_SetItemString(port_dict, "n_profiles", tmp_obj);
-        Py_DecRef(tmp_obj);
+/* set_snapshot(path) keeps the store in path across runs. When the store
+ * is still empty it is filled from the file right away; returns whether
+ * that happened. None stops using a file. */
+static PyObject *m_set_snapshot(DeepinPulseAudioObject *self,
+                                PyObject *args)
+{
+    char *path = NULL;
 
-        PyList_Append(port_list, port_dict);
-        Py_DecRef(port_dict);
+    if (!PyArg_ParseTuple(args, "z", &path)) {
+        ERROR("invalid arguments to set_snapshot");
+        return NULL;
     }
-    PyDict_SetItemString(card_dict, "ports", port_list);
-    Py_DecRef(port_list);
 
-    PyObject *func = NULL;
-    if (self->state_cb && PyDict_Check(self->state_cb) && ((func=PyDict_GetItemString(self->state_cb, "card")) != NULL)) {
-        if (PyCallable_Check(func)) {
-            PyEval_CallFunction(func, "(OOi)", self, card_dict, i->index);
-        }
+    g_free(self->snapshot_path);
+    self->snapshot_path = g_strdup(path);
+    if (path && m_snapshot_load(self, path)) {
+        RETURN_TRUE;
     }
-    Py_XDECREF(card_dict);
-    PyGILState_Release(gstate);
+    RETURN_FALSE;
 }
 
-static void m_pa_sinklist_cb(pa_context *c, 
-                             const pa_sink_info *l, 
-                             int eol, 
-                             void *userdata) 
+static PyObject *m_save_snapshot(DeepinPulseAudioObject *self)
 {
-    if (!userdata || eol || !c || !l)
-        return;
-   
-    PyGILState_STATE gstate;
-    gstate = PyGILState_Ensure();
-    DeepinPulseAudioObject *self = userdata;
-
-    pa_sink_port_info **ports  = NULL;                                          
-    pa_sink_port_info *port = NULL;        
-    pa_sink_port_info *active_port = NULL;
-    PyObject *channel_value = NULL;
-    PyObject *ret_active_port_value = NULL;
-    PyObject *ret_volume_value = NULL;
-    PyObject *prop_dict = NULL;
-    PyObject *port_list = NULL;
-    int i = 0;
-    const char *prop_key;
-    void *prop_state = NULL;
-    PyObject *tmp_obj = NULL;
+    if (self->snapshot_path && m_snapshot_save(self, self->snapshot_path)) {
+        RETURN_TRUE;
+    }
+    RETURN_FALSE;
+}
 
-    PyObject *ret_channel_dict = NULL;
-    PyObject *ret_dev_dict = NULL;
+//*****************************************
+// pulseaudio get info callback
+/* An update that came from a subscription event: dropped when nothing
+ * visible moved, or handed to "<kind>-changed" as {field: new value}.
+ * Returns 0 when the full state callback should still run. */
+static int m_entry_changed(DeepinPulseAudioObject *self, m_entry *e)
+{
+    PyObject *func = NULL;
+    PyObject *changes = NULL;
+
+    if (!e->changed)
+        return 1;
+    if (e->added)
+        return 0;
+    if (!(func = self->signal_cb[e->kind][M_SIGNAL_CHANGED]))
+        return 0;
+    if ((changes = m_entry_changes(e))) {
+        PyEval_CallFunction(func, "(OiO)", self, e->index, changes);
+        Py_DECREF(changes);
+    }
+    return 1;
+}
 
-    channel_value = PyList_New(0);
-    if (!channel_value) {
-        ERROR("PyList_New error");
+/* Put a decoded entry into the store and call the state callback of its
+ * kind. On the I/O thread it is only queued for m_io_run(). */
+static void m_entry_update(DeepinPulseAudioObject *self, m_entry *e, int event)
+{
+    PyGILState_STATE gstate;
+    PyObject *func = NULL;
+    m_io_item *item = NULL;
+    m_kind kind = e->kind;
+    uint32_t index = e->index;
+
+    if (m_io_thread(self)) {
+        item = m_io_item_new(M_IO_ENTRY);
+        item->event = event;
+        item->entry = e;
+        m_io_push(self, item);
         return;
     }
-    ret_volume_value = PyList_New(0);
-    if (!ret_volume_value) {
-        ERROR("PyList_New error");
+
+    // Batched events are only decoded here, see m_batch_flush()
+    if (event && self->event_batch) {
+        m_batch_slot(self, kind, index)->entry = e;
         return;
     }
-    prop_dict = PyDict_New();
-    if (!prop_dict) {
-        ERROR("PyDict_New error");
-        return;
+
+    gstate = PyGILState_Ensure();
+    // Python objects are only built for a listener, and reused until the
+    // entry changes. Events that moved nothing are dropped.
+    e = m_store_put(self, e);
+    if (e && !(event && m_entry_changed(self, e)) &&
+        (func = self->signal_cb[kind][M_SIGNAL_STATE])) {
+        if (kind == M_SINK || kind == M_SOURCE)
+            PyEval_CallFunction(func, "(OOOOOi)",
+                                self, m_entry_object(e, M_OBJECT_CHANNELS),
+                                m_entry_object(e, M_OBJECT_ACTIVE_PORT),
+                                m_entry_object(e, M_OBJECT_VOLUME),
+                                m_entry_object(e, M_OBJECT_INFO),
+                                index);
+        else
+            PyEval_CallFunction(func, "(OOi)", self, m_entry_object(e, M_OBJECT_INFO), index);
     }
-    port_list = PyList_New(0);
-    if (!port_list) {
-        ERROR("PyList_New error");
+    PyGILState_Release(gstate);
+}
+
+static void m_server_update(DeepinPulseAudioObject *self,
+                            const pa_server_info *i,
+                            int event)
+{
+    PyGILState_STATE gstate;
+    PyObject *server_dict = NULL;
+    PyObject *changes = NULL;
+    PyObject *func = NULL;
+    m_io_item *item = NULL;
+    int changed;
+
+    if (m_io_thread(self)) {
+        item = m_io_item_new(M_IO_SERVER);
+        item->event = event;
+        m_server_copy(&item->server, i);
+        m_io_push(self, item);
         return;
     }
-                                                                                
-    while ((prop_key = pa_proplist_iterate(l->proplist, &prop_state))) {
-        tmp_obj = STRING(pa_proplist_gets(l->proplist, prop_key));
-        PyDict_SetItemString(prop_dict, prop_key, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    // channel list
-    for (i = 0; i < l->channel_map.channels; i++) {
-        tmp_obj = INT(l->channel_map.map[i]);
-        PyList_Append(channel_value, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    ret_channel_dict = Py_BuildValue("{sisnsO}", 
-                            "can_balance", pa_channel_map_can_balance(&l->channel_map),
-                            "channels", l->channel_map.channels,
-                            "map", channel_value);
-    Py_DecRef(channel_value);
 
-    // ports list
-    ports = l->ports;   
-    for (i = 0; i < l->n_ports; i++) {
-        port = ports[i];
-        tmp_obj = Py_BuildValue("(ssi)",
-                                port->name,
-                                port->description,
-                                port->available);
-        Py_XINCREF(tmp_obj);
-        PyList_Append(port_list, tmp_obj); 
-        Py_DecRef(tmp_obj);
-    }
-    // active port
-    active_port = l->active_port;
-    if (active_port) {
-        ret_active_port_value = Py_BuildValue("(ssi)", 
-                                          active_port->name,
-                                          active_port->description, 
-                                          active_port->available);
-    } else {
-        ret_active_port_value = Py_None;
-        Py_INCREF(Py_None);
-    }
-    // volume list
-    for (i = 0; i < l->volume.channels; i++) {
-        tmp_obj = INT(l->volume.values[i]);
-        PyList_Append(ret_volume_value, tmp_obj);
-        Py_DecRef(tmp_obj);
+    // Batched events are only decoded here, see m_batch_flush()
+    if (event && self->event_batch) {
+        m_server_copy(&m_batch_slot(self, M_KIND_COUNT, 0)->server, i);
+        return;
     }
-    PyObject *tmp_obj1 = PyBool_FromLong(l->mute);
-    ret_dev_dict = Py_BuildValue("{sssssisIsOsOsO}",
-                            "name", l->name,
-                            "description", l->description,
-                            "base_volume", l->base_volume,
-                            "n_ports", l->n_ports,
-                            "mute", tmp_obj1,
-                            "ports", port_list,
-                            "proplist", prop_dict);
-    Py_DecRef(tmp_obj1);
-    Py_DecRef(port_list);
-    Py_DecRef(prop_dict);
 
-    PyObject *func = NULL;
-    if (self->state_cb && PyDict_Check(self->state_cb) && ((func=PyDict_GetItemString(self->state_cb, "sink")) != NULL)) {
-        if (PyCallable_Check(func)) {
-            PyEval_CallFunction(func, "(OOOOOi)",
-                                self, ret_channel_dict,
-                                ret_active_port_value,
-                                ret_volume_value,
-                                ret_dev_dict,
-                                l->index);
-        }
+    gstate = PyGILState_Ensure();
+    changed = m_store_server(self, i);
+
+    if (event && !changed) {
+        // nothing visible moved
+    } else if (event && changed != M_FIELD_ALL &&
+               (func = self->signal_cb[M_KIND_COUNT][M_SIGNAL_CHANGED])) {
+        changes = m_server_changes(&self->server);
+        if (changes)
+            PyEval_CallFunction(func, "(OO)", self, changes);
+        Py_XDECREF(changes);
+    } else if ((func = self->signal_cb[M_KIND_COUNT][M_SIGNAL_STATE])) {
+        server_dict = m_server_build(&self->server);
+        if (server_dict)
+            PyEval_CallFunction(func, "(OO)", self, server_dict);
+        Py_XDECREF(server_dict);
     }
-    Py_XDECREF(ret_channel_dict);
-    Py_XDECREF(ret_active_port_value);
-    Py_XDECREF(ret_volume_value);
-    Py_XDECREF(ret_dev_dict);
     PyGILState_Release(gstate);
 }
 
+static void m_pa_server_info_cb(pa_context *c, 
+                                const pa_server_info *i, 
+                                void *userdata)
+{
+    if (!c || !i || !userdata) 
+        return;
+
+    m_server_update((DeepinPulseAudioObject *) userdata, i, 0);
+}
+
+static void m_card_update(DeepinPulseAudioObject *self,
+                          const pa_card_info *i,
+                          int event)
+{
+    m_entry_update(self, m_card_entry(i), event);
+}
+
+static void m_pa_cardlist_cb(pa_context *c,
+                             const pa_card_info *i,
+                             int eol,
+                             void *userdata)
+{
+    if (!userdata || eol || !c || !i)
+        return;
+
+    m_card_update((DeepinPulseAudioObject *) userdata, i, 0);
+}
+
+static void m_sink_update(DeepinPulseAudioObject *self,
+                          const pa_sink_info *l,
+                          int event)
+{
+    m_entry_update(self, m_sink_entry(l), event);
+}
+
+static void m_pa_sinklist_cb(pa_context *c, 
+                             const pa_sink_info *l, 
+                             int eol, 
+                             void *userdata) 
+{
+    if (!userdata || eol || !c || !l)
+        return;
+
+    m_sink_update((DeepinPulseAudioObject *) userdata, l, 0);
+}
+
 // See above.  This callback is pretty much identical to the previous
+static void m_source_update(DeepinPulseAudioObject *self,
+                            const pa_source_info *l,
+                            int event)
+{
+    m_entry_update(self, m_source_entry(l), event);
+}
+
 static void m_pa_sourcelist_cb(pa_context *c, 
                                const pa_source_info *l, 
                                int eol, 
@@ -1358,121 +4592,14 @@ static void m_pa_sourcelist_cb(pa_context *c,
     if (!userdata || eol || !c || !l)
         return;
 
-    PyGILState_STATE gstate;
-    gstate = PyGILState_Ensure();
-    DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
-    
-    pa_source_port_info **ports = NULL;                                         
-    pa_source_port_info *port = NULL;      
-    pa_source_port_info *active_port = NULL;
-    PyObject *channel_value = NULL;
-    PyObject *ret_active_port_value = NULL;
-    PyObject *ret_volume_value = NULL;
-    PyObject *prop_dict = NULL;
-    PyObject *port_list = NULL;
-    int i = 0;                                                                  
-    const char *prop_key;
-    void *prop_state = NULL;
-    PyObject *tmp_obj = NULL;
-                                                                                
-    PyObject *ret_channel_dict = NULL;
-    PyObject *ret_dev_dict = NULL;
-
-    channel_value = PyList_New(0);
-    if (!channel_value) {
-        ERROR("PyList_New error");
-        return;
-    }
-    ret_volume_value = PyList_New(0);
-    if (!ret_volume_value) {
-        ERROR("PyList_New error");
-        return;
-    }
-    prop_dict = PyDict_New();
-    if (!prop_dict) {
-        ERROR("PyDict_New error\n");
-        return;
-    }
-    port_list = PyList_New(0);
-    if (!port_list) {
-        ERROR("PyList_New error");
-        return;
-    }
-                                                                                
-    while ((prop_key=pa_proplist_iterate(l->proplist, &prop_state))) {
-        tmp_obj = STRING(pa_proplist_gets(l->proplist, prop_key));
-        PyDict_SetItemString(prop_dict, prop_key,tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    // channel list
-    for (i = 0; i < l->channel_map.channels; i++) {                    
-        tmp_obj = INT(l->channel_map.map[i]);
-        PyList_Append(channel_value, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }                                                                   
-    ret_channel_dict = Py_BuildValue("{sisnsO}",
-                            "can_balance", pa_channel_map_can_balance(&l->channel_map),
-                            "channels", l->channel_map.channels,
-                            "map", channel_value);
-    Py_DecRef(channel_value);
-
-    // ports list
-    ports = l->ports;                                                   
-    for (i = 0; i < l->n_ports; i++) {                                  
-        port = ports[i];                                                
-        tmp_obj = Py_BuildValue("(ssi)",
-                                port->name,
-                                port->description,
-                                port->available);
-        PyList_Append(port_list, tmp_obj);
-        Py_DecRef(tmp_obj);
-    } 
-    // active port
-    active_port = l->active_port;                                       
-    if (active_port) {
-        ret_active_port_value = Py_BuildValue("(ssi)",
-                                          active_port->name,
-                                          active_port->description,         
-                                          active_port->available);               
-    } else {
-        ret_active_port_value = Py_None;
-        Py_INCREF(Py_None);
-    }
-    // volume list
-    for (i = 0; i < l->volume.channels; i++) {
-        tmp_obj = INT(l->volume.values[i]);
-        PyList_Append(ret_volume_value, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    PyObject *tmp_obj1 = PyBool_FromLong(l->mute);
-    ret_dev_dict = Py_BuildValue("{sssssisIsOsOsO}",
-                            "name", l->name,
-                            "description", l->description,
-                            "base_volume", l->base_volume,
-                            "n_ports", l->n_ports,
-                            "mute", tmp_obj1,
-                            "ports", port_list,
-                            "proplist", prop_dict);
-    Py_DecRef(tmp_obj1);
-    Py_DecRef(port_list);
-    Py_DecRef(prop_dict);
+    m_source_update((DeepinPulseAudioObject *) userdata, l, 0);
+}
 
-    PyObject *func = NULL;
-    if (self->state_cb && PyDict_Check(self->state_cb) && ((func=PyDict_GetItemString(self->state_cb, "source")) != NULL)) {
-        if (PyCallable_Check(func)) {
-            PyEval_CallFunction(func, "(OOOOOi)",
-                                self, ret_channel_dict,
-                                ret_active_port_value,
-                                ret_volume_value,
-                                ret_dev_dict,
-                                l->index);
-        }
-    }
-    Py_XDECREF(ret_channel_dict);
-    Py_XDECREF(ret_active_port_value);
-    Py_XDECREF(ret_volume_value);
-    Py_XDECREF(ret_dev_dict);
-    PyGILState_Release(gstate);
+static void m_sinkinput_update(DeepinPulseAudioObject *self,
+                               const pa_sink_input_info *l,
+                               int event)
+{
+    m_entry_update(self, m_sink_input_entry(l), event);
 }
 
 static void m_pa_sinkinputlist_info_cb(pa_context *c,
@@ -1483,79 +4610,14 @@ static void m_pa_sinkinputlist_info_cb(pa_context *c,
     if (!userdata || eol || !c || !l)
         return;
 
-    PyGILState_STATE gstate;
-    gstate = PyGILState_Ensure();
-    DeepinPulseAudioObject *self = userdata;
-    
-    PyObject *volume_value = NULL;
-    PyObject *channel_value = NULL;
-    PyObject *prop_dict = NULL;
-    int i;
-    const char *prop_key;
-    void *prop_state = NULL;
-    PyObject *tmp_obj = NULL;
-    PyObject *retval = NULL;
-
-    channel_value = PyList_New(0);
-    if (!channel_value) {
-        ERROR("PyList_New error");
-        return;
-    }
-    volume_value = PyList_New(0);
-    if (!volume_value) {
-        ERROR("PyList_New error");
-        return;
-    }
-    prop_dict = PyDict_New();
-    if (!prop_dict) {
-        ERROR("PyDict_New error\n");
-        return;
-    }
-
-    // proplist
-    while ((prop_key=pa_proplist_iterate(l->proplist, &prop_state))) {
-        tmp_obj = STRING(pa_proplist_gets(l->proplist, prop_key));
-        PyDict_SetItemString(prop_dict, prop_key, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    // channel list
-    for (i = 0; i < l->channel_map.channels; i++) {
-        tmp_obj = INT(l->channel_map.map[i]);
-        PyList_Append(channel_value, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    //volume list
-    for (i = 0; i < l->volume.channels; i++) {
-        tmp_obj = INT(l->volume.values[i]);
-        PyList_Append(volume_value, tmp_obj);
-        Py_DecRef(tmp_obj);
-    }
-    retval = Py_BuildValue("{sssisisisOsssssOsisOsisisi}",
-                            "name", l->name,
-                            "owner_module", l->owner_module,
-                            "client", l->client,
-                            "sink", l->sink,
-                            "channel", channel_value,
-                            "resample_method", l->resample_method,
-                            "driver", l->driver,
-                            "proplist", prop_dict,
-                            "corked", l->corked,
-                            "volume", volume_value,
-                            "mute", l->mute,
-                            "has_volume", l->has_volume,
-                            "volume_writable", l->volume_writable);
-    Py_DecRef(channel_value);
-    Py_DecRef(prop_dict);
-    Py_DecRef(volume_value);
+    m_sinkinput_update((DeepinPulseAudioObject *) userdata, l, 0);
+}
 
-    PyObject *func = NULL;
-    if (self->state_cb && PyDict_Check(self->state_cb) && ((func=PyDict_GetItemString(self->state_cb, "sinkinput")) != NULL)) {
-        if (PyCallable_Check(func)) {
-            PyEval_CallFunction(func, "(OOi)", self, retval, l->index);
-        }
-    }
-    Py_XDECREF(retval);
-    PyGILState_Release(gstate);
+static void m_sourceoutput_update(DeepinPulseAudioObject *self,
+                                  const pa_source_output_info *l,
+                                  int event)
+{
+    m_entry_update(self, m_source_output_entry(l), event);
 }
 
 static void m_pa_sourceoutputlist_info_cb(pa_context *c,
@@ -1563,108 +4625,212 @@ static void m_pa_sourceoutputlist_info_cb(pa_context *c,
                                           int eol,
                                           void *userdata)
 {
+    // Requested last on connect, so every other list is complete by now
+    if (eol > 0 && userdata)
+        m_io_defer((DeepinPulseAudioObject *) userdata, m_snapshot_reconcile);
     if (!userdata || eol || !c || !l)
         return;
 
-    PyGILState_STATE gstate;
-    gstate = PyGILState_Ensure();
-    DeepinPulseAudioObject *self = userdata;
-    
-    PyObject *volume_value = NULL;
-    PyObject *channel_value = NULL;
-    PyObject *prop_dict = NULL;
-    int i;
-    const char *prop_key;
-    void *prop_state = NULL;
-    PyObject *tmp_obj = NULL;
-    PyObject *retval = NULL;
+    m_sourceoutput_update((DeepinPulseAudioObject *) userdata, l, 0);
+}
 
-    channel_value = PyList_New(0);
-    if (!channel_value) {
-        ERROR("PyList_New error");
-        return;
-    }
-    volume_value = PyList_New(0);
-    if (!volume_value) {
-        ERROR("PyList_New error");
-        return;
-    }
-    prop_dict = PyDict_New();
-    if (!prop_dict) {
-        ERROR("PyDict_New error\n");
-        return;
-    }
+//****************************************
+// per object introspection queries
+static int m_query_send(DeepinPulseAudioObject *self, m_query_slot *slot);
 
-    // proplist
-    while ((prop_key=pa_proplist_iterate(l->proplist, &prop_state))) {
-        tmp_obj = STRING(pa_proplist_gets(l->proplist, prop_key));
-        PyDict_SetItemString(prop_dict, prop_key,tmp_obj);
-        Py_DecRef(tmp_obj);
+static void m_query_done(m_query_slot *slot)
+{
+    DeepinPulseAudioObject *self = slot->self;
+
+    if (slot->dirty) {
+        slot->dirty = 0;
+        if (m_query_send(self, slot))
+            return;
     }
-    // channel list
-    for (i = 0; i < l->channel_map.channels; i++) {
-        tmp_obj = INT(l->channel_map.map[i]);
-        PyList_Append(channel_value, tmp_obj);
-        Py_DecRef(tmp_obj);
+    g_hash_table_remove(self->query_slots, &slot->key);
+}
+
+static void m_pa_server_query_cb(pa_context *c, 
+                                 const pa_server_info *i, 
+                                 void *userdata)
+{
+    m_query_slot *slot = userdata;
+    DeepinPulseAudioObject *self = slot->self;
+
+    m_query_done(slot);
+    if (i)
+        m_server_update(self, i, 1);
+}
+
+static void m_pa_card_query_cb(pa_context *c, 
+                               const pa_card_info *i, 
+                               int eol, 
+                               void *userdata)
+{
+    m_query_slot *slot = userdata;
+
+    if (eol)
+        m_query_done(slot);
+    else if (i)
+        m_card_update(slot->self, i, 1);
+}
+
+static void m_pa_sink_query_cb(pa_context *c, 
+                               const pa_sink_info *l, 
+                               int eol, 
+                               void *userdata)
+{
+    m_query_slot *slot = userdata;
+
+    if (eol)
+        m_query_done(slot);
+    else if (l)
+        m_sink_update(slot->self, l, 1);
+}
+
+static void m_pa_source_query_cb(pa_context *c, 
+                                 const pa_source_info *l, 
+                                 int eol, 
+                                 void *userdata)
+{
+    m_query_slot *slot = userdata;
+
+    if (eol)
+        m_query_done(slot);
+    else if (l)
+        m_source_update(slot->self, l, 1);
+}
+
+static void m_pa_sinkinput_query_cb(pa_context *c, 
+                                    const pa_sink_input_info *l, 
+                                    int eol, 
+                                    void *userdata)
+{
+    m_query_slot *slot = userdata;
+
+    if (eol)
+        m_query_done(slot);
+    else if (l)
+        m_sinkinput_update(slot->self, l, 1);
+}
+
+static void m_pa_sourceoutput_query_cb(pa_context *c, 
+                                       const pa_source_output_info *l, 
+                                       int eol, 
+                                       void *userdata)
+{
+    m_query_slot *slot = userdata;
+
+    if (eol)
+        m_query_done(slot);
+    else if (l)
+        m_sourceoutput_update(slot->self, l, 1);
+}
+
+static int m_query_send(DeepinPulseAudioObject *self, m_query_slot *slot)
+{
+    uint32_t idx = (uint32_t) slot->key;
+    pa_operation *o = NULL;
+
+    if (!self->pa_ctx)
+        return 0;
+
+    switch (slot->key >> 32) {
+        case PA_SUBSCRIPTION_EVENT_SINK:
+            o = pa_context_get_sink_info_by_index(self->pa_ctx, idx, m_pa_sink_query_cb, slot);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SOURCE:
+            o = pa_context_get_source_info_by_index(self->pa_ctx, idx, m_pa_source_query_cb, slot);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
+            o = pa_context_get_sink_input_info(self->pa_ctx, idx, m_pa_sinkinput_query_cb, slot);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT:
+            o = pa_context_get_source_output_info(self->pa_ctx, idx, m_pa_sourceoutput_query_cb, slot);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SERVER:
+            o = pa_context_get_server_info(self->pa_ctx, m_pa_server_query_cb, slot);
+            break;
+        case PA_SUBSCRIPTION_EVENT_CARD:
+            o = pa_context_get_card_info_by_index(self->pa_ctx, idx, m_pa_card_query_cb, slot);
+            break;
     }
-    //volume list
-    for (i = 0; i < l->volume.channels; i++) {
-        tmp_obj = INT(l->volume.values[i]);
-        PyList_Append(volume_value, tmp_obj);
-        Py_DecRef(tmp_obj);
+    if (!o) {
+        ERROR("pa_context_get_info() failed");
+        return 0;
     }
-    retval = Py_BuildValue("{sssisisisOsssssOsisOsisisi}",
-                            "name", l->name,
-                            "owner_module", l->owner_module,
-                            "client", l->client,
-                            "source", l->source,
-                            "channel", channel_value,
-                            "resample_method", l->resample_method,
-                            "driver", l->driver,
-                            "proplist", prop_dict,
-                            "corked", l->corked,
-                            "volume", volume_value,
-                            "mute", l->mute,
-                            "has_volume", l->has_volume,
-                            "volume_writable", l->volume_writable);
-    Py_DecRef(channel_value);
-    Py_DecRef(prop_dict);
-    Py_DecRef(volume_value);
+    pa_operation_unref(o);
+    return 1;
+}
 
-    PyObject *func = NULL;
-    if (self->state_cb && PyDict_Check(self->state_cb) && ((func=PyDict_GetItemString(self->state_cb, "sourceoutput")) != NULL)) {
-        if (PyCallable_Check(func)) {
-            PyEval_CallFunction(func, "(OOi)", self, retval, l->index);
-        }
+/* Refresh one object, at most one query per object in flight */
+static void m_query_object(DeepinPulseAudioObject *self, 
+                           pa_subscription_event_type_t facility, 
+                           uint32_t idx)
+{
+    gint64 key = (gint64) facility << 32 | idx;
+    m_query_slot *slot = NULL;
+
+    slot = g_hash_table_lookup(self->query_slots, &key);
+    if (slot) {
+        slot->dirty = 1;
+        return;
     }
-    Py_XDECREF(retval);
-    PyGILState_Release(gstate);
+
+    slot = g_new0(m_query_slot, 1);
+    slot->key = key;
+    slot->self = self;
+    if (!m_query_send(self, slot)) {
+        g_free(slot);
+        return;
+    }
+    g_hash_table_insert(self->query_slots, &slot->key, slot);
 }
 
 //****************************************
 // remove event callback
 static void m_pa_event_removed_cb(DeepinPulseAudioObject *self,
-                                  uint32_t index,
-                                  const char *key)
+                                  m_kind kind,
+                                  uint32_t index)
 {
-    if (!self || !key) 
+    m_io_item *item = NULL;
+
+    if (!self) 
         return;
 
-    PyGILState_STATE gstate;
-    gstate = PyGILState_Ensure();
-    PyObject *callback = PyDict_GetItemString(self->event_cb, key);
-    if (!callback || !PyCallable_Check(callback)) {
+    if (m_io_thread(self)) {
+        item = m_io_item_new(M_IO_REMOVED);
+        item->kind = kind;
+        item->index = index;
+        m_io_push(self, item);
+        return;
+    }
+
+    if (self->event_batch) {
+        m_batch_slot(self, kind, index)->removed = 1;
         return;
     }
 
-    PyEval_CallFunction(callback, "(Oi)", self, index);
+    PyGILState_STATE gstate;
+    gstate = PyGILState_Ensure();
+    m_store_remove(self, kind, index);
+    PyObject *callback = self->signal_cb[kind][M_SIGNAL_REMOVED];
+    if (callback)
+        PyEval_CallFunction(callback, "(Oi)", self, index);
     PyGILState_Release(gstate);
 }
 
-static void m_pa_context_subscribe_cb(pa_context *c,                           
-                                      pa_subscription_event_type_t t,          
-                                      uint32_t idx,                            
-                                      void *userdata)                          
+static void m_snapshot_drop(DeepinPulseAudioObject *self,
+                            m_kind kind,
+                            uint32_t index)
+{
+    m_pa_event_removed_cb(self, kind, index);
+}
+
+static void m_pa_dispatch_event(pa_context *c,
+                                pa_subscription_event_type_t t,
+                                uint32_t idx,
+                                void *userdata)
 {                                                                               
     if (!c || !userdata) 
         return;
@@ -1674,81 +4840,541 @@ static void m_pa_context_subscribe_cb(pa_context *c,
     switch (t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) {
         case PA_SUBSCRIPTION_EVENT_SINK: {
             if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
-                m_pa_event_removed_cb(self, idx, "sink-removed");
-            else {
-                pa_operation *o;
-                if (!(o = pa_context_get_sink_info_by_index(c, idx, m_pa_sinklist_cb, self))) {
-                    ERROR("pa_context_get_sink_info_by_index() failed");
-                    return;
-                }
-                pa_operation_unref(o);
-            }
+                m_pa_event_removed_cb(self, M_SINK, idx);
+            else
+                m_query_object(self, PA_SUBSCRIPTION_EVENT_SINK, idx);
             break;
         }
         case PA_SUBSCRIPTION_EVENT_SOURCE: {
             if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
-                m_pa_event_removed_cb(self, idx, "source-removed");
-            else {
-                pa_operation *o;
-                if (!(o = pa_context_get_source_info_by_index(c, idx, m_pa_sourcelist_cb, self))) {
-                    ERROR("pa_context_get_source_info_by_index() failed");
-                    return;
-                }
-                pa_operation_unref(o);
-            }
+                m_pa_event_removed_cb(self, M_SOURCE, idx);
+            else
+                m_query_object(self, PA_SUBSCRIPTION_EVENT_SOURCE, idx);
             break;
         }
         case PA_SUBSCRIPTION_EVENT_SINK_INPUT: {
             if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
-                m_pa_event_removed_cb(self, idx, "sinkinput-removed");
-            else {
-                pa_operation *o;
-                if (!(o = pa_context_get_sink_input_info(c, idx, m_pa_sinkinputlist_info_cb, self))) {
-                    ERROR("pa_context_get_sink_input_info() failed");
-                    return;
-                }
-                pa_operation_unref(o);
-            }
+                m_pa_event_removed_cb(self, M_SINK_INPUT, idx);
+            else
+                m_query_object(self, PA_SUBSCRIPTION_EVENT_SINK_INPUT, idx);
             break;
         }
         case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT: {
             if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
-                m_pa_event_removed_cb(self, idx, "sourceoutput-removed");
-            else {
-                pa_operation *o;
-                if (!(o = pa_context_get_source_output_info(c, idx, m_pa_sourceoutputlist_info_cb, self))) {
-                    ERROR("pa_context_get_sink_input_info() failed");
-                    return;
-                }
-                pa_operation_unref(o);
-            }
+                m_pa_event_removed_cb(self, M_SOURCE_OUTPUT, idx);
+            else
+                m_query_object(self, PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT, idx);
             break;
         }
         case PA_SUBSCRIPTION_EVENT_CLIENT:                                      
             break;                                                              
-        case PA_SUBSCRIPTION_EVENT_SERVER: {
-            pa_operation *o;
-            if (!(o = pa_context_get_server_info(c, m_pa_server_info_cb, self))) {
-                ERROR("pa_context_get_server_info() failed");
-                return;
-            }
-            pa_operation_unref(o);
+        case PA_SUBSCRIPTION_EVENT_SERVER:
+            m_query_object(self, PA_SUBSCRIPTION_EVENT_SERVER, idx);
             break;
-        }
         case PA_SUBSCRIPTION_EVENT_CARD: {
             if ((t & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
-                m_pa_event_removed_cb(self, idx, "card-removed");
-            else {
-                pa_operation *o;
-                if (!(o = pa_context_get_card_info_by_index(c, idx, m_pa_cardlist_cb, self))) {
-                    ERROR("pa_context_get_card_info_by_index() failed");
-                    return;
-                }
-                pa_operation_unref(o);
-            }
+                m_pa_event_removed_cb(self, M_CARD, idx);
+            else
+                m_query_object(self, PA_SUBSCRIPTION_EVENT_CARD, idx);
+            break;
+        }
+    }
+}
+
+static void m_event_clear(DeepinPulseAudioObject *self)
+{
+    m_pending_event *e = self->event_head;
+    m_pending_event *next = NULL;
+
+    if (self->event_timer) {
+        m_source_remove(self, self->event_timer);
+        self->event_timer = 0;
+    }
+    g_hash_table_remove_all(self->event_pending);
+    self->event_head = self->event_tail = NULL;
+    for (; e; e = next) {
+        next = e->next;
+        g_free(e);
+    }
+}
+
+static void m_batched_event_reset(m_batched_event *b)
+{
+    if (b->entry)
+        m_entry_free(b->entry);
+    b->entry = NULL;
+    m_server_clear(&b->server);
+    b->removed = 0;
+}
+
+/* Queue slot for the next update of an object. Only its newest state
+ * matters, delivered at the position of its first event in the batch. */
+static m_batched_event *m_batch_slot(DeepinPulseAudioObject *self,
+                                     m_kind kind,
+                                     uint32_t index)
+{
+    gint64 key = (gint64) kind << 32 | index;
+    m_batched_event *b = NULL;
+
+    if ((b = g_hash_table_lookup(self->batch_pending, &key))) {
+        m_batched_event_reset(b);
+        return b;
+    }
+
+    b = g_new0(m_batched_event, 1);
+    b->key = key;
+    if (self->batch_tail)
+        self->batch_tail->next = b;
+    else
+        self->batch_head = b;
+    self->batch_tail = b;
+    g_hash_table_insert(self->batch_pending, &b->key, b);
+
+    // Runs once the mainloop has dispatched everything that is ready,
+    // without GLib drain() returns it
+    if (self->event_fd < 0 && !self->batch_idle)
+        self->batch_idle = m_source_attach(self, g_idle_source_new(), m_batch_flush);
+    return b;
+}
+
+/* Put one queued update into the store and describe what it did as a
+ * (signal, index, value) tuple, NULL when nothing visible moved */
+static PyObject *m_batch_apply(DeepinPulseAudioObject *self,
+                               m_batched_event *b)
+{
+    m_kind kind = (m_kind) (b->key >> 32);
+    uint32_t index = (uint32_t) b->key;
+    pa_server_info i;
+    m_entry *e = NULL;
+    char signal[32];
+
+    if (kind == M_KIND_COUNT) {
+        m_server_info(&b->server, &i);
+        if (!m_store_server(self, &i))
+            return NULL;
+        return Py_BuildValue("(sON)", "server-changed", Py_None,
+                             m_server_changes(&self->server));
+    }
+
+    if (b->removed) {
+        if (!m_store_lookup(self, kind, index))
+            return NULL;
+        m_store_remove(self, kind, index);
+        snprintf(signal, sizeof(signal), "%s-removed", m_kind_names[kind]);
+        return Py_BuildValue("(siO)", signal, index, Py_None);
+    }
+
+    if (!b->entry)
+        return NULL;
+    e = m_store_put(self, b->entry);
+    b->entry = NULL;
+    if (!e || !e->changed)
+        return NULL;
+    if (e->added) {
+        snprintf(signal, sizeof(signal), "%s-new", m_kind_names[kind]);
+        return Py_BuildValue("(siO)", signal, index,
+                             m_entry_object(e, M_OBJECT_INFO));
+    }
+    snprintf(signal, sizeof(signal), "%s-changed", m_kind_names[kind]);
+    return Py_BuildValue("(siN)", signal, index, m_entry_changes(e));
+}
+
+/* Apply everything queued so far to the store, in arrival order, and
+ * return it as a list of (signal, index, value). Needs the GIL. */
+static PyObject *m_batch_take(DeepinPulseAudioObject *self)
+{
+    m_batched_event *b = self->batch_head;
+    m_batched_event *next = NULL;
+    PyObject *events = PyList_New(0);
+    PyObject *item = NULL;
+
+    g_hash_table_remove_all(self->batch_pending);
+    self->batch_head = self->batch_tail = NULL;
+    for (; b; b = next) {
+        next = b->next;
+        if ((item = m_batch_apply(self, b))) {
+            if (events)
+                PyList_Append(events, item);
+            Py_DECREF(item);
+        } else if (PyErr_Occurred()) {
+            PyErr_Print();
+        }
+        m_batched_event_reset(b);
+        g_free(b);
+    }
+    return events;
+}
+
+/* Hand the batch to the "events" callback under a single GIL acquisition */
+static gboolean m_batch_flush(gpointer userdata)
+{
+    DeepinPulseAudioObject *self = userdata;
+    PyObject *events = NULL;
+    PyObject *func = NULL;
+    PyGILState_STATE gstate;
+
+    self->batch_idle = 0;
+    gstate = PyGILState_Ensure();
+    events = m_batch_take(self);
+    func = self->events_cb;
+    if (events && PyList_GET_SIZE(events) && func)
+        PyEval_CallFunction(func, "(OO)", self, events);
+    Py_XDECREF(events);
+    PyGILState_Release(gstate);
+    return FALSE;
+}
+
+/* Drop whatever is queued, the connection it came from is gone */
+static void m_batch_clear(DeepinPulseAudioObject *self)
+{
+    m_batched_event *b = self->batch_head;
+    m_batched_event *next = NULL;
+
+    if (self->batch_idle) {
+        m_source_remove(self, self->batch_idle);
+        self->batch_idle = 0;
+    }
+    g_hash_table_remove_all(self->batch_pending);
+    self->batch_head = self->batch_tail = NULL;
+    for (; b; b = next) {
+        next = b->next;
+        m_batched_event_reset(b);
+        g_free(b);
+    }
+}
+
+/* Poll function of fd_ml. The descriptors and the timeout the loop is
+ * about to wait for are mirrored into poll_fd, so the host loop wakes up
+ * exactly when drain() has something to dispatch. libpulse enabling a
+ * deferred event or a new timer writes the loop's wakeup pipe, which is
+ * among the descriptors. */
+static int m_event_fd_poll(struct pollfd *ufds,
+                           unsigned long nfds,
+                           int timeout,
+                           void *userdata)
+{
+    DeepinPulseAudioObject *self = userdata;
+    struct epoll_event ev;
+    struct itimerspec its;
+    unsigned long i, j;
+
+    for (i = 0; i < self->n_fd_watched; i++) {
+        for (j = 0; j < nfds; j++) {
+            if (ufds[j].fd == self->fd_watched[i] && ufds[j].events)
+                break;
+        }
+        if (j == nfds)
+            epoll_ctl(self->poll_fd, EPOLL_CTL_DEL, self->fd_watched[i], NULL);
+    }
+
+    self->fd_watched = g_renew(int, self->fd_watched, nfds);
+    self->n_fd_watched = 0;
+    for (j = 0; j < nfds; j++) {
+        if (!ufds[j].events)
+            continue;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = (ufds[j].events & POLLIN ? EPOLLIN : 0) | 
+                    (ufds[j].events & POLLOUT ? EPOLLOUT : 0);
+        ev.data.fd = ufds[j].fd;
+        if (epoll_ctl(self->poll_fd, EPOLL_CTL_MOD, ufds[j].fd, &ev) < 0 && 
+            errno == ENOENT)
+            epoll_ctl(self->poll_fd, EPOLL_CTL_ADD, ufds[j].fd, &ev);
+        self->fd_watched[self->n_fd_watched++] = ufds[j].fd;
+    }
+
+    // Re-arming also resets a timer that fired already, 0 would disarm it
+    memset(&its, 0, sizeof(its));
+    if (timeout >= 0) {
+        its.it_value.tv_sec = timeout / 1000;
+        its.it_value.tv_nsec = (timeout % 1000) * 1000000L + 1;
+    }
+    timerfd_settime(self->timer_fd, 0, &its, NULL);
+
+    return poll(ufds, nfds, self->fd_blocking ? timeout : 0);
+}
+
+/* Run fd_ml until nothing is ready any more */
+static void m_event_fd_dispatch(DeepinPulseAudioObject *self)
+{
+    self->fd_blocking = 0;
+    while (pa_mainloop_prepare(self->fd_ml, -1) >= 0 && 
+           pa_mainloop_poll(self->fd_ml) >= 0 && 
+           pa_mainloop_dispatch(self->fd_ml) > 0)
+        ;
+}
+
+static void m_connect_to_pulse_later(DeepinPulseAudioObject *self)
+{
+    m_connect_to_pulse_again(self);
+}
+
+static void m_connect_to_pulse_timer_cb(pa_mainloop_api *a,
+                                        pa_time_event *e,
+                                        const struct timeval *tv,
+                                        void *userdata)
+{
+    a->time_free(e);
+    m_io_defer((DeepinPulseAudioObject *) userdata, m_connect_to_pulse_later);
+}
+
+//****************************************
+// I/O thread, see start_io_thread()
+static int m_io_thread(DeepinPulseAudioObject *self)
+{
+    return self->io_ml && pa_threaded_mainloop_in_thread(self->io_ml);
+}
+
+static m_io_item *m_io_item_new(m_io_type type)
+{
+    m_io_item *item = g_new0(m_io_item, 1);
+
+    item->type = type;
+    return item;
+}
+
+static void m_io_item_free(m_io_item *item)
+{
+    if (item->entry)
+        m_entry_free(item->entry);
+    m_server_clear(&item->server);
+    g_free(item);
+}
+
+/* Lock free hand over from the I/O thread. The first item after a
+ * drain() wakes up whoever polls event_fd. */
+static void m_io_push(DeepinPulseAudioObject *self, m_io_item *item)
+{
+    m_io_item *head = NULL;
+
+    do {
+        head = g_atomic_pointer_get(&self->io_queue);
+        item->next = head;
+    } while (!g_atomic_pointer_compare_and_exchange(&self->io_queue, head, item));
+    if (!head)
+        eventfd_write(self->event_fd, 1);
+}
+
+/* Everything pushed so far, oldest first */
+static m_io_item *m_io_take(DeepinPulseAudioObject *self)
+{
+    m_io_item *head = NULL;
+    m_io_item *prev = NULL;
+    m_io_item *next = NULL;
+
+    do {
+        head = g_atomic_pointer_get(&self->io_queue);
+    } while (!g_atomic_pointer_compare_and_exchange(&self->io_queue, head, NULL));
+    for (; head; head = next) {
+        next = head->next;
+        head->next = prev;
+        prev = head;
+    }
+    return prev;
+}
+
+/* Run call with the GIL, later if we are on the I/O thread */
+static void m_io_defer(DeepinPulseAudioObject *self,
+                       void (*call)(DeepinPulseAudioObject *self))
+{
+    m_io_item *item = NULL;
+
+    if (!m_io_thread(self)) {
+        call(self);
+        return;
+    }
+    item = m_io_item_new(M_IO_CALL);
+    item->call = call;
+    m_io_push(self, item);
+}
+
+/* op may be gone if it was cancelled meanwhile, so it is only looked for */
+static int m_io_operation_pending(DeepinPulseAudioObject *self,
+                                  DeepinPulseAudioOperation *op)
+{
+    PyObject *it = NULL;
+    PyObject *o = NULL;
+    int found = 0;
+
+    if (!self->pending_ops || !(it = PyObject_GetIter(self->pending_ops)))
+        return 0;
+    while (!found && (o = PyIter_Next(it))) {
+        found = o == (PyObject *) op;
+        Py_DECREF(o);
+    }
+    Py_DECREF(it);
+    return found;
+}
+
+/* Replay one item on the Python side, through the same paths the GLib
+ * mainloop takes */
+static void m_io_apply(DeepinPulseAudioObject *self, m_io_item *item)
+{
+    pa_server_info i;
+
+    switch (item->type) {
+        case M_IO_ENTRY:
+            m_entry_update(self, item->entry, item->event);
+            item->entry = NULL;
             break;
+        case M_IO_REMOVED:
+            m_pa_event_removed_cb(self, item->kind, item->index);
+            break;
+        case M_IO_SERVER:
+            m_server_info(&item->server, &i);
+            m_server_update(self, &i, item->event);
+            break;
+        case M_IO_STATE:
+            if (self->pa_ctx)
+                m_context_state_run(self, self->pa_ctx, item->value);
+            break;
+        case M_IO_OPERATION:
+            if (m_io_operation_pending(self, item->op))
+                m_operation_settle(item->op, item->value);
+            break;
+        case M_IO_CALL:
+            item->call(self);
+            break;
+        case M_IO_PEAK:
+            m_record_read(self, item->peak);
+            break;
+        case M_IO_SUSPENDED:
+            m_record_suspended(self);
+            break;
+    }
+}
+
+/* Hand everything the I/O thread queued to Python, in the order it
+ * happened. The lock keeps the thread off the context meanwhile. */
+static void m_io_run(DeepinPulseAudioObject *self)
+{
+    m_io_item *item = NULL;
+    m_io_item *next = NULL;
+
+    m_io_lock(self);
+    for (item = m_io_take(self); item; item = next) {
+        next = item->next;
+        // a callback may have deleted us
+        if (self->io_ml)
+            m_io_apply(self, item);
+        m_io_item_free(item);
+    }
+    m_io_unlock(self);
+}
+
+static void m_io_clear(DeepinPulseAudioObject *self)
+{
+    m_io_item *item = NULL;
+    m_io_item *next = NULL;
+
+    for (item = m_io_take(self); item; item = next) {
+        next = item->next;
+        m_io_item_free(item);
+    }
+}
+
+/* The I/O thread holds its lock while it dispatches, and never needs the
+ * GIL. A Python thread waiting for the lock drops the GIL, as the holder
+ * may be another Python thread inside m_io_run() that wants it back. */
+static void m_io_lock(DeepinPulseAudioObject *self)
+{
+    if (!self || !self->io_ml)
+        return;
+    Py_BEGIN_ALLOW_THREADS
+    pa_threaded_mainloop_lock(self->io_ml);
+    Py_END_ALLOW_THREADS
+    self->io_locked++;
+}
+
+static void m_io_unlock(DeepinPulseAudioObject *self)
+{
+    if (self)
+        m_main_wakeup(self);
+    if (!self || !self->io_ml || !self->io_locked)
+        return;
+    self->io_locked--;
+    pa_threaded_mainloop_unlock(self->io_ml);
+}
+
+/* End of the window: dispatch what is left of the queued events in the
+ * order they first arrived */
+static gboolean m_event_flush(gpointer userdata)
+{
+    DeepinPulseAudioObject *self = userdata;
+    m_pending_event *e = self->event_head;
+    m_pending_event *next = NULL;
+
+    self->event_timer = 0;
+    g_hash_table_remove_all(self->event_pending);
+    self->event_head = self->event_tail = NULL;
+    for (; e; e = next) {
+        next = e->next;
+        if (!e->cancelled && self->pa_ctx)
+            m_pa_dispatch_event(self->pa_ctx, 
+                                (pa_subscription_event_type_t) (e->key >> 32) | e->type, 
+                                (uint32_t) e->key, 
+                                self);
+        g_free(e);
+    }
+    return FALSE;
+}
+
+/* Merge an event into the one already pending for the same object:
+ * repeated CHANGEs collapse, CHANGE after NEW stays NEW, REMOVE wins over
+ * CHANGE and a NEW followed by REMOVE cancels out. */
+static void m_event_queue(DeepinPulseAudioObject *self, 
+                          pa_subscription_event_type_t t, 
+                          uint32_t idx)
+{
+    pa_subscription_event_type_t type = t & PA_SUBSCRIPTION_EVENT_TYPE_MASK;
+    gint64 key = (gint64) (t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) << 32 | idx;
+    m_pending_event *e = NULL;
+
+    e = g_hash_table_lookup(self->event_pending, &key);
+    if (e) {
+        if (type == PA_SUBSCRIPTION_EVENT_REMOVE) {
+            if (e->type == PA_SUBSCRIPTION_EVENT_NEW) {
+                e->cancelled = 1;
+                g_hash_table_remove(self->event_pending, &key);
+            } else {
+                e->type = PA_SUBSCRIPTION_EVENT_REMOVE;
+            }
+        } else if (type == PA_SUBSCRIPTION_EVENT_NEW) {
+            e->type = e->type == PA_SUBSCRIPTION_EVENT_REMOVE ? 
+                      PA_SUBSCRIPTION_EVENT_CHANGE : PA_SUBSCRIPTION_EVENT_NEW;
         }
+        return;
     }
+
+    e = g_new0(m_pending_event, 1);
+    e->key = key;
+    e->type = type;
+    if (self->event_tail)
+        self->event_tail->next = e;
+    else
+        self->event_head = e;
+    self->event_tail = e;
+    g_hash_table_insert(self->event_pending, &e->key, e);
+
+    if (!self->event_timer)
+        self->event_timer = m_source_attach(self, 
+                                            g_timeout_source_new(self->event_window), 
+                                            m_event_flush);
+}
+
+static void m_pa_context_subscribe_cb(pa_context *c,                           
+                                      pa_subscription_event_type_t t,          
+                                      uint32_t idx,                            
+                                      void *userdata)                          
+{                                                                               
+    if (!c || !userdata) 
+        return;
+
+    DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
+
+    if (self->event_window > 0)
+        m_event_queue(self, t, idx);
+    else
+        m_pa_dispatch_event(c, t, idx, self);
 }
 
 static PyObject *m_connect_to_pulse_func(DeepinPulseAudioObject *self)
@@ -1781,17 +5407,67 @@ gboolean m_connect_to_pulse_again(DeepinPulseAudioObject *self)
     return FALSE;
 }
 
-static void m_context_state_cb(pa_context *c, void *userdata) 
+/* Facility of every kind, M_KIND_COUNT being the server */
+static const pa_subscription_mask_t m_kind_masks[M_KIND_COUNT + 1] = 
 {
-    if (!c || !userdata) 
+    PA_SUBSCRIPTION_MASK_SINK, 
+    PA_SUBSCRIPTION_MASK_SOURCE, 
+    PA_SUBSCRIPTION_MASK_SINK_INPUT, 
+    PA_SUBSCRIPTION_MASK_SOURCE_OUTPUT, 
+    PA_SUBSCRIPTION_MASK_CARD, 
+    PA_SUBSCRIPTION_MASK_SERVER
+};
+
+/* Facilities somebody listens to, unless overridden by
+ * set_subscription_mask() */
+static pa_subscription_mask_t m_subscription_mask(DeepinPulseAudioObject *self)
+{
+    int mask = PA_SUBSCRIPTION_MASK_NULL;
+    int batched = self->fd_ml || self->io_ml || (self->event_batch && self->events_cb);
+    int kind;
+    int signal;
+
+    if (self->subscribe_mask >= 0)
+        return (pa_subscription_mask_t) self->subscribe_mask;
+
+    for (kind = 0; kind <= M_KIND_COUNT; kind++) {
+        for (signal = 0; signal < M_SIGNAL_COUNT; signal++) {
+            if (batched || self->signal_cb[kind][signal])
+                mask |= m_kind_masks[kind];
+        }
+    }
+    return (pa_subscription_mask_t) mask;
+}
+
+/* Tell the server about the current mask; called on READY and whenever
+ * callbacks or the override change */
+static void m_update_subscription(DeepinPulseAudioObject *self)
+{
+    pa_operation *pa_op = NULL;
+
+    if (!self->pa_ctx || pa_context_get_state(self->pa_ctx) != PA_CONTEXT_READY)
         return;
 
+    if (!(pa_op = pa_context_subscribe(self->pa_ctx, 
+                                       m_subscription_mask(self), 
+                                       NULL, 
+                                       NULL))) {
+        ERROR("pa_context_subscribe() failed\n");
+        return;
+    }
+    pa_operation_unref(pa_op);
+}
+
+static void m_context_state_run(DeepinPulseAudioObject *self,
+                                pa_context *c,
+                                pa_context_state_t state)
+{
     PyGILState_STATE gstate;
     gstate = PyGILState_Ensure();
-    DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;                         
     pa_operation *pa_op = NULL;
+    struct timeval tv;
 
-    switch (pa_context_get_state(c)) {                                          
+    switch (state) {                                          
         case PA_CONTEXT_UNCONNECTED:
         case PA_CONTEXT_CONNECTING:
         case PA_CONTEXT_AUTHORIZING:
@@ -1801,20 +5477,7 @@ static void m_context_state_cb(pa_context *c, void *userdata)
         case PA_CONTEXT_READY: {
             pa_context_set_subscribe_callback(c, m_pa_context_subscribe_cb, self);
 
-            /*if (!(pa_op = pa_context_subscribe(c, (pa_subscription_mask_t)          */
-                                           /*(PA_SUBSCRIPTION_MASK_ALL), NULL, NULL))) {*/
-            if (!(pa_op = pa_context_subscribe(c, (pa_subscription_mask_t)
-                                           (PA_SUBSCRIPTION_MASK_SINK|
-                                            PA_SUBSCRIPTION_MASK_SOURCE|
-                                            PA_SUBSCRIPTION_MASK_SINK_INPUT|
-                                            PA_SUBSCRIPTION_MASK_SOURCE_OUTPUT|
-                                            PA_SUBSCRIPTION_MASK_CLIENT|
-                                            PA_SUBSCRIPTION_MASK_SERVER|
-                                            PA_SUBSCRIPTION_MASK_CARD), NULL, NULL))) {
-                ERROR("pa_context_subscribe() failed\n");
-                return;
-            }
-            pa_operation_unref(pa_op);
+            m_update_subscription(self);
 
             if (!(pa_op = pa_context_get_server_info(c, m_pa_server_info_cb, self))) {
                 ERROR("pa_context_get_server_info() failed");
@@ -1855,6 +5518,12 @@ static void m_context_state_cb(pa_context *c, void *userdata)
         }
                                                                                 
         case PA_CONTEXT_FAILED: {
+            m_operation_cancel_all(self);
+            g_hash_table_remove_all(self->volume_slots);
+            m_event_clear(self);
+            g_hash_table_remove_all(self->query_slots);
+            m_batch_clear(self);
+            m_store_clear(self);
             pa_context_unref(self->pa_ctx);
             self->pa_ctx = NULL;
 
@@ -1862,7 +5531,14 @@ static void m_context_state_cb(pa_context *c, void *userdata)
             system("pulseaudio -D");
                                                                                 
             ERROR("Connection failed, attempting reconnect\n");          
-            g_timeout_add_seconds(13, (GSourceFunc)m_connect_to_pulse_again, self);               
+            if (!self->pa_ml) {
+                pa_timeval_add(pa_gettimeofday(&tv), 13 * PA_USEC_PER_SEC);
+                self->pa_mlapi->time_new(self->pa_mlapi, &tv, 
+                                         m_connect_to_pulse_timer_cb, self);
+            } else {
+                m_source_attach(self, g_timeout_source_new_seconds(13), 
+                                (GSourceFunc) m_connect_to_pulse_again);
+            }
             return;                                                             
         }
                                                                                 
@@ -1876,18 +5552,39 @@ static void m_context_state_cb(pa_context *c, void *userdata)
     PyGILState_Release(gstate);
 }
 
+static void m_context_state_cb(pa_context *c, void *userdata) 
+{
+    DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
+    m_io_item *item = NULL;
+
+    if (!c || !userdata) 
+        return;
+
+    if (m_io_thread(self)) {
+        item = m_io_item_new(M_IO_STATE);
+        item->value = pa_context_get_state(c);
+        m_io_push(self, item);
+        return;
+    }
+    m_context_state_run(self, c, pa_context_get_state(c));
+}
+
 static PyObject *m_connect_to_pulse(DeepinPulseAudioObject *self, PyObject *args)
 {
     if (self->pa_ctx) {
         RETURN_FALSE;
     }
     PyObject *cb_fun = NULL;
+    int kind;
     if (!PyArg_ParseTuple(args, "O", &cb_fun)) {
         ERROR("invalid arguments to connect_to_pulse");
         return NULL;
     }
     Py_XINCREF(cb_fun);                                                   
     self->state_cb = cb_fun;
+    for (kind = 0; kind <= M_KIND_COUNT; kind++)
+        m_signal_set(&self->signal_cb[kind][M_SIGNAL_STATE], 
+                     m_dict_callback(cb_fun, m_signal_kind_name(kind)));
 
     return m_connect_to_pulse_func(self);
 }
@@ -1896,35 +5593,93 @@ static PyObject *m_connect(DeepinPulseAudioObject *self, PyObject *args)
 {                                                                               
     PyObject *signal = NULL;
     PyObject *callback = NULL;
+    PyObject **slot = NULL;
                                                                                 
     if (!PyArg_ParseTuple(args, "OO:set_callback", &signal, &callback)) {
         ERROR("invalid arguments to connect");
         return NULL;
     }
                                                                                 
-    if (!PyCallable_Check(callback) || !PyString_CheckExact(signal)) {
+    if (!PyString_CheckExact(signal) || 
+        (callback != Py_None && !PyCallable_Check(callback))) {
         Py_INCREF(Py_False);
         return Py_False;
     }
 
-    if (PyDict_Contains(self->event_cb, signal)) {
-        PyDict_DelItem(self->event_cb, signal);
+    // connect(signal, None) removes the callback. Signals nobody emits
+    // are accepted and dropped.
+    if ((slot = m_signal_slot(self, PyString_AS_STRING(signal))))
+        m_signal_set(slot, callback != Py_None ? callback : NULL);
+    m_update_subscription(self);
+    RETURN_TRUE;
+}
+
+static PyObject *m_disconnect(DeepinPulseAudioObject *self, PyObject *args)
+{
+    PyObject *signal = NULL;
+    PyObject *connect_args = NULL;
+    PyObject *ret = NULL;
+
+    if (!PyArg_ParseTuple(args, "O", &signal)) {
+        ERROR("invalid arguments to disconnect");
+        return NULL;
+    }
+
+    connect_args = Py_BuildValue("(OO)", signal, Py_None);
+    if (!connect_args)
+        return NULL;
+    ret = m_connect(self, connect_args);
+    Py_DECREF(connect_args);
+    return ret;
+}
+
+static PyObject *m_set_subscription_mask(DeepinPulseAudioObject *self, 
+                                         PyObject *args)
+{
+    int mask = -1;
+
+    if (!PyArg_ParseTuple(args, "i", &mask)) {
+        ERROR("invalid arguments to set_subscription_mask");
+        return NULL;
     }
-    PyDict_SetItem(self->event_cb, signal, callback);
+
+    self->subscribe_mask = mask < 0 ? -1 : mask & PA_SUBSCRIPTION_MASK_ALL;
+    m_update_subscription(self);
     RETURN_TRUE;
 }
 
+static PyObject *m_get_subscription_mask(DeepinPulseAudioObject *self)
+{
+    return INT(m_subscription_mask(self));
+}
+
 // connect to record
-static void on_monitor_read_callback(pa_stream *p, size_t length, void *userdata)
+static void m_record_read(DeepinPulseAudioObject *self, double v)
 {
     PyGILState_STATE gstate;
+    PyObject *func = NULL;
+    m_io_item *item = NULL;
+
+    if (m_io_thread(self)) {
+        item = m_io_item_new(M_IO_PEAK);
+        item->peak = v;
+        m_io_push(self, item);
+        return;
+    }
+
     gstate = PyGILState_Ensure();
+    if ((func = self->record_read_cb))
+        PyEval_CallFunction(func, "(Od)", self, v);
+    PyGILState_Release(gstate);
+}
+
+static void on_monitor_read_callback(pa_stream *p, size_t length, void *userdata)
+{
     DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
     const void *data;
     double v;
 
     if (pa_stream_peek(p, &data, &length) < 0) {
-        ERROR("Failed to read data from stream\n");
         return;
     }
     
@@ -1940,31 +5695,29 @@ static void on_monitor_read_callback(pa_stream *p, size_t length, void *userdata
     if (v < 0) v = 0;
     if (v > 1) v = 1;
     
+    m_record_read(self, v);
+}
+
+static void m_record_suspended(DeepinPulseAudioObject *self)
+{
+    PyGILState_STATE gstate;
     PyObject *func = NULL;
-    if (self->record_stream_cb && PyDict_Check(self->record_stream_cb) &&
-        ((func=PyDict_GetItemString(self->record_stream_cb, "read")) != NULL)) {
-        if (PyCallable_Check(func)) {
-            PyEval_CallFunction(func, "(Od)", self, v);
-        }
+
+    if (m_io_thread(self)) {
+        m_io_push(self, m_io_item_new(M_IO_SUSPENDED));
+        return;
     }
 
+    gstate = PyGILState_Ensure();
+    if ((func = self->record_suspended_cb))
+        PyEval_CallFunction(func, "(O)", self);
     PyGILState_Release(gstate);
 }
 
 static void on_monitor_suspended_callback(pa_stream *p, void *userdata)
 {
-    PyGILState_STATE gstate;
-    gstate = PyGILState_Ensure();
-    DeepinPulseAudioObject *self = (DeepinPulseAudioObject *) userdata;
-    PyObject *func = NULL;
-    if (pa_stream_is_suspended(p) && self->record_stream_cb &&
-        PyDict_Check(self->record_stream_cb) &&
-        ((func=PyDict_GetItemString(self->record_stream_cb, "suspended")) != NULL)) {
-        if (PyCallable_Check(func)) {
-            PyEval_CallFunction(func, "(O)", self);
-        }
-    }
-    PyGILState_Release(gstate);
+    if (pa_stream_is_suspended(p))
+        m_record_suspended((DeepinPulseAudioObject *) userdata);
 }
 
 static PyObject *m_connect_record(DeepinPulseAudioObject *self, PyObject *args)
@@ -1981,9 +5734,8 @@ static PyObject *m_connect_record(DeepinPulseAudioObject *self, PyObject *args)
         RETURN_FALSE;
     }
 
-    Py_XINCREF(callback);
-    Py_XDECREF(self->record_stream_cb);
-    self->record_stream_cb = callback;
+    m_signal_set(&self->record_read_cb, m_dict_callback(callback, "read"));
+    m_signal_set(&self->record_suspended_cb, m_dict_callback(callback, "suspended"));
 
     if (self->stream_conn_record) {
         pa_stream_disconnect(self->stream_conn_record);
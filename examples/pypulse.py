@@ -39,17 +39,7 @@ def get_volume_balance(channel_num, volume_list, channel_list):
     return deepin_pulseaudio.volume_get_balance(channel_num, volume_list, channel_list)
 
 def get_fallback_sink_index():
-    name = PULSE.get_fallback_sink()
-    dev = PULSE.get_output_devices()
-    for key in dev.keys():
-        if name == dev[key]['name']:
-            return key
-    return None
+    return PULSE.fallback_sink_index()
 
 def get_fallback_source_index():
-    name = PULSE.get_fallback_source()
-    dev = PULSE.get_input_devices()
-    for key in dev.keys():
-        if name == dev[key]['name']:
-            return key
-    return None
+    return PULSE.fallback_source_index()
@@ -59,14 +59,7 @@ def get_fallback_sink_name():
         return None
     
 def get_fallback_sink_index():
-    if 'fallback_sink' in server_info:
-        name = server_info['fallback_sink']
-    else:
-        return None
-    for key in output_devices.keys():
-        if name == output_devices[key]['name']:
-            return key
-    return None
+    return PULSE.fallback_sink_index()
 
 def get_fallback_source_name():
     if 'fallback_source' in server_info:
@@ -75,11 +68,4 @@ def get_fallback_source_name():
         return None
     
 def get_fallback_source_index():
-    if 'fallback_source' in server_info:
-        name = server_info['fallback_source']
-    else:
-        return None
-    for key in input_devices.keys():
-        if name == output_devices[key]['name']:
-            return key
-    return None
+    return PULSE.fallback_source_index()